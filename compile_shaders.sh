@@ -6,6 +6,7 @@ set -euo pipefail
 SHADERCROSS_BIN="${SHADERCROSS_BIN:-SDL3_shadercross-3.0.0-darwin-arm64-x64/bin/shadercross}"
 SHADER_SRC_DIR="${SHADER_SRC_DIR:-shaders}"
 OUT_DIR="${OUT_DIR:-MyApp.app/Contents/Resources/shaders}"
+CLEAN="${CLEAN:-0}" # 1 = wipe OUT_DIR and recompile everything
 
 # Ensure shadercross exists
 if [[ ! -x "$SHADERCROSS_BIN" ]]; then
@@ -13,10 +14,20 @@ if [[ ! -x "$SHADERCROSS_BIN" ]]; then
   exit 1
 fi
 
-# Clean output directory
-rm -rf "$OUT_DIR"
+# Only recompile shaders whose outputs are out of date, so a running build hot reloads just the pipelines that changed
+if [[ "$CLEAN" == 1 ]]; then
+  rm -rf "$OUT_DIR"
+fi
 mkdir -p "$OUT_DIR"
 
+# newest shared header; every shader is treated as depending on all of them
+newest_header=""
+while IFS= read -r -d '' header; do
+  if [[ -z "$newest_header" || "$header" -nt "$newest_header" ]]; then
+    newest_header="$header"
+  fi
+done < <(find "$SHADER_SRC_DIR" -type f -name "*.h" -print0)
+
 # Compile each .hlsl file to .msl, .json, .spv, .dxil
 # Preserves relative subdirectories from SHADER_SRC_DIR
 echo "Scanning '$SHADER_SRC_DIR' for .hlsl files..."
@@ -32,6 +43,17 @@ while IFS= read -r -d '' src; do
   out_base="$OUT_DIR/$base_no_ext"
   mkdir -p "$(dirname "$out_base")"
 
+  up_to_date=true
+  for ext in msl json spv dxil; do
+    out="$out_base.$ext"
+    if [[ ! -f "$out" || "$src" -nt "$out" || ( -n "$newest_header" && "$newest_header" -nt "$out" ) ]]; then
+      up_to_date=false
+    fi
+  done
+  if [[ "$up_to_date" == true ]]; then
+    continue
+  fi
+
   echo "Compiling: $rel"
   "$SHADERCROSS_BIN" "$src" -o "$out_base.msl"
   "$SHADERCROSS_BIN" "$src" -o "$out_base.json"
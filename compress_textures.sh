@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+
+set -euo pipefail
+
+# Offline block compression and mip generation for material textures
+# Writes <name>.dds next to each <name>.png; texture.c prefers the .dds/.ktx2 over the .png
+# and falls back to the .png (uncompressed RGBA8, mips built on the CPU at load) if the device can't sample the BC format
+# UNCOMPRESSED=1 writes RGBA8 <name>.ktx2 with the mip chain baked in instead (uses toktx from KTX-Software)
+
+# Config (override via environment variables if desired)
+COMPRESSONATOR_BIN="${COMPRESSONATOR_BIN:-compressonatorcli}"
+TEXTURE_DIR="${TEXTURE_DIR:-MyApp.app/Contents/Resources/textures}"
+ALBEDO_FORMAT="${ALBEDO_FORMAT:-BC7}" # BC7 for quality, BC1 for half the size (no smooth alpha)
+DATA_FORMAT="${DATA_FORMAT:-BC7}"     # metallic-roughness (and other linear data)
+NORMAL_FORMAT="BC5"                   # two channels; z is reconstructed in the shader
+MIP_LEVELS="${MIP_LEVELS:-6}"         # textures are never color targets, so the mips have to be baked in or built on the CPU
+UNCOMPRESSED="${UNCOMPRESSED:-0}"
+TOKTX_BIN="${TOKTX_BIN:-toktx}"
+
+# Ensure the encoder exists
+if [[ "$UNCOMPRESSED" == 1 ]]; then
+  if ! command -v "$TOKTX_BIN" >/dev/null 2>&1; then
+    echo "Error: toktx not found or not executable at: $TOKTX_BIN" >&2
+    exit 1
+  fi
+elif ! command -v "$COMPRESSONATOR_BIN" >/dev/null 2>&1; then
+  echo "Error: compressonatorcli not found or not executable at: $COMPRESSONATOR_BIN" >&2
+  echo "Download it from https://github.com/GPUOpen-Tools/compressonator/releases" >&2
+  exit 1
+fi
+
+# Texture usage is inferred from the file name:
+#   *normal*                                 -> BC5
+#   *metallic*, *roughness*, *_mr.*, *_orm.* -> DATA_FORMAT
+#   everything else                          -> ALBEDO_FORMAT (sRGB is decided at load time)
+echo "Scanning '$TEXTURE_DIR' for .png files..."
+found_any=false
+while IFS= read -r -d '' src; do
+  found_any=true
+
+  name="$(basename "$src")"
+  lower="$(echo "$name" | tr '[:upper:]' '[:lower:]')"
+  if [[ "$UNCOMPRESSED" == 1 ]]; then
+    out="${src%.*}.ktx2"
+  else
+    out="${src%.*}.dds"
+  fi
+
+  case "$lower" in
+    *normal*)                              format="$NORMAL_FORMAT"; oetf="linear" ;;
+    *metallic*|*roughness*|*_mr.*|*_orm.*) format="$DATA_FORMAT";   oetf="linear" ;;
+    *)                                     format="$ALBEDO_FORMAT"; oetf="srgb" ;;
+  esac
+
+  # skip textures that are already up to date
+  if [[ -f "$out" && "$out" -nt "$src" ]]; then
+    continue
+  fi
+
+  if [[ "$UNCOMPRESSED" == 1 ]]; then
+    # oetf tells the mip filter whether to average in linear space
+    echo "Generating mips: $name -> RGBA8 ($oetf)"
+    "$TOKTX_BIN" --t2 --genmipmap --levels "$MIP_LEVELS" --assign_oetf "$oetf" "$out" "$src"
+  else
+    echo "Compressing: $name -> $format"
+    "$COMPRESSONATOR_BIN" -fd "$format" -miplevels "$MIP_LEVELS" "$src" "$out" >/dev/null
+  fi
+done < <(find "$TEXTURE_DIR" -type f -name "*.png" -print0)
+
+if [[ "$found_any" == false ]]; then
+  echo "No .png files found in '$TEXTURE_DIR'."
+fi
+
+echo "Done."
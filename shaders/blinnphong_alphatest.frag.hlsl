@@ -73,7 +73,10 @@ Fragment_Output main(Fragment_Input fragment)
     F0 = lerp(F0, albedo.rgb, metallic); // if metallic, use albedo color as F0
 
 #ifdef USE_NORMAL_MAP
-    float3 N_ts = texture_normal.Sample(sampler_normal, fragment.texture_coordinate).xyz * 2.0f - 1.0f;
+    // only xy are stored (BC5 has no blue channel), so z is reconstructed
+    float3 N_ts;
+    N_ts.xy = texture_normal.Sample(sampler_normal, fragment.texture_coordinate).xy * 2.0f - 1.0f;
+    N_ts.z = sqrt(saturate(1.0f - dot(N_ts.xy, N_ts.xy)));
     // If normal map uses OpenGL convention (green down), uncomment:
     // N_ts.y = -N_ts.y;
     float3 T = normalize(fragment.tangent_viewspace);
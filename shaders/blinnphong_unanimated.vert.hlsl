@@ -1,9 +1,13 @@
 #define USE_NORMAL_MAP
 
+#include "shaders/vertex.h"
+
 cbuffer TransformUBO : register(b0, space1)
 {
     float4x4 mvp;
     float4x4 mv;
+    float4 position_offset; // see Vertex_DecodePosition
+    float4 position_scale;
 #ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
     float4x4 mv_inverse_transpose; // upper-left 3x3 = inverse-transpose of (V*M).xyz
 #endif
@@ -11,12 +15,9 @@ cbuffer TransformUBO : register(b0, space1)
 
 struct Vertex_Input
 {
-    float3 position : TEXCOORD0;
-    float3 normal   : TEXCOORD1;
+    float4 position           : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent     : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
     float2 texture_coordinate : TEXCOORD2;
-#ifdef USE_NORMAL_MAP
-    float4 tangent : TEXCOORD3; // .w = handedness
-#endif
 };
 
 struct Vertex_Output
@@ -35,7 +36,8 @@ Vertex_Output main(Vertex_Input vertex)
 {
     Vertex_Output output;
 
-    float4 position_worldspace = float4(vertex.position, 1.0f);
+    float4 position_worldspace = float4(Vertex_DecodePosition(vertex.position, position_offset, position_scale), 1.0f);
+    float3 normal = Vertex_DecodeOctahedral(vertex.normal_tangent.xy);
     output.position_clipspace = mul(mvp, position_worldspace);
 
     float4 position_viewspace = mul(mv, position_worldspace);
@@ -44,18 +46,18 @@ Vertex_Output main(Vertex_Input vertex)
     // Transform normal to view space
 #ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
     float3x3 normalMat = (float3x3)mv_inverse_transpose;
-    float3 N_vs = normalize(mul(normalMat, vertex.normal));
+    float3 N_vs = normalize(mul(normalMat, normal));
 #else
-    float3 N_vs = normalize(mul((float3x3)mv, vertex.normal));
+    float3 N_vs = normalize(mul((float3x3)mv, normal));
 #endif
     output.normal_viewspace = N_vs;
 
 #ifdef USE_NORMAL_MAP
     // Transform tangent to view space and build an orthonormal TBN
-    float3 T_vs = normalize(mul((float3x3)mv, vertex.tangent.xyz));
+    float3 T_vs = normalize(mul((float3x3)mv, Vertex_DecodeOctahedral(vertex.normal_tangent.zw)));
     // Orthonormalize T against N
     T_vs = normalize(T_vs - N_vs * dot(T_vs, N_vs));
-    float3 B_vs = normalize(cross(N_vs, T_vs)) * vertex.tangent.w; // handedness in .w
+    float3 B_vs = normalize(cross(N_vs, T_vs)) * Vertex_DecodeBitangentSign(vertex.position);
 
     output.tangent_viewspace = T_vs;
     output.bitangent_viewspace = B_vs;
@@ -0,0 +1,133 @@
+// Bins the point and spot lights into the camera's clusters (see clusters.h in src)
+// a group per depth slice, a thread per screen tile; the group loads the lights' bounding spheres into shared memory
+// a batch at a time, and every thread tests the batch against its cluster's view space bounds
+// the lights are in world space; their spheres are moved into view space as they are loaded
+
+#include "shaders/clusters.h"
+
+#define CLUSTER_THREADS (CLUSTER_GRID_X * CLUSTER_GRID_Y)
+
+// Light_Point in lights.h
+struct Light_Point
+{
+    float3 position; // world space
+    float  attenuation_constant_linear;
+    float3 color;
+    float  attenuation_constant_quadratic;
+};
+
+// Light_Spot in lights.h; only what the bounds need
+struct Light_Spot
+{
+    float3 position; // world space
+    float  attenuation_constant_linear;
+    float3 color;
+    float  attenuation_constant_quadratic;
+    float3 direction; // world space, from the light towards its target
+    float  cutoff_inner;
+    float  cutoff_outer;
+    uint   shadow_caster;
+    float  shadow_bias_scale;
+    float           _;
+    float4x4 shadow_world_to_clip;
+    float4 shadow_atlas_rect;
+};
+
+StructuredBuffer<Light_Point> buffer_pointlights : register(t0, space0);
+StructuredBuffer<Light_Spot>  buffer_spotlights  : register(t1, space0);
+
+RWStructuredBuffer<uint> clusters : register(u0, space1); // CLUSTER_STRIDE uints per cluster
+
+// UBO_Clusters in clusters.c
+cbuffer UBO_Clusters : register(b0, space2)
+{
+    float4x4 view_matrix;
+    float projection_x; // view space x / z -> ndc x
+    float projection_y;
+    float near_plane;
+    float far_plane;
+    uint  point_count;
+    uint  spot_count;
+};
+
+groupshared float4 shared_spheres[CLUSTER_THREADS]; // view space center, radius
+
+// the view is rigid, so the radius stays
+float4 Sphere_ToViewSpace(float4 sphere)
+{
+    return float4(mul(view_matrix, float4(sphere.xyz, 1.0f)).xyz, sphere.w);
+}
+
+float4 Sphere_Point(Light_Point light)
+{
+    return float4(light.position, Light_Range(light.attenuation_constant_linear, light.attenuation_constant_quadratic));
+}
+
+// the smallest sphere around the cone: its far cap's for wide cones, else the one through the apex and the cap's rim
+float4 Sphere_Spot(Light_Spot light)
+{
+    float range = Light_Range(light.attenuation_constant_linear, light.attenuation_constant_quadratic);
+    if (range > 1e30f) return float4(light.position, range);
+
+    float cos_angle = light.cutoff_outer;
+    float sin_angle = sqrt(saturate(1.0f - cos_angle * cos_angle));
+    if (cos_angle < 0.70710678f) return float4(light.position + light.direction * (cos_angle * range), sin_angle * range);
+    float radius = range / (2.0f * cos_angle);
+    return float4(light.position + light.direction * radius, radius);
+}
+
+bool Sphere_IntersectsAABB(float4 sphere, float3 aabb_min, float3 aabb_max)
+{
+    float3 outside = max(aabb_min - sphere.xyz, 0.0f) + max(sphere.xyz - aabb_max, 0.0f);
+    return dot(outside, outside) <= sphere.w * sphere.w;
+}
+
+[numthreads(CLUSTER_GRID_X, CLUSTER_GRID_Y, 1)]
+void main(uint3 cluster_id : SV_DispatchThreadID, uint thread_index : SV_GroupIndex)
+{
+    // the tile in ndc (y is down the screen) and the slice's depth range, then the box around the frustum between them
+    float2 ndc_min = float2(-1.0f + 2.0f * cluster_id.x / CLUSTER_GRID_X, 1.0f - 2.0f * (cluster_id.y + 1) / CLUSTER_GRID_Y);
+    float2 ndc_max = float2(-1.0f + 2.0f * (cluster_id.x + 1) / CLUSTER_GRID_X, 1.0f - 2.0f * cluster_id.y / CLUSTER_GRID_Y);
+    float depth_near = near_plane * pow(far_plane / near_plane, (float)cluster_id.z / CLUSTER_GRID_Z);
+    float depth_far = near_plane * pow(far_plane / near_plane, (float)(cluster_id.z + 1) / CLUSTER_GRID_Z);
+    float2 scale = 1.0f / float2(projection_x, projection_y);
+    float2 xy_min = min(ndc_min * depth_near, ndc_min * depth_far) * scale;
+    float2 xy_max = max(ndc_max * depth_near, ndc_max * depth_far) * scale;
+    float3 aabb_min = float3(xy_min, depth_near);
+    float3 aabb_max = float3(xy_max, depth_far);
+
+    uint cluster_index = (cluster_id.z * CLUSTER_GRID_Y + cluster_id.y) * CLUSTER_GRID_X + cluster_id.x;
+    uint first_slot = cluster_index * CLUSTER_STRIDE + 1;
+    uint count = 0;
+
+    for (uint batch = 0; batch < point_count; batch += CLUSTER_THREADS)
+    {
+        uint light_index = batch + thread_index;
+        shared_spheres[thread_index] = light_index < point_count ? Sphere_ToViewSpace(Sphere_Point(buffer_pointlights[light_index])) : float4(0.0f, 0.0f, 0.0f, -1.0f);
+        GroupMemoryBarrierWithGroupSync();
+
+        uint batch_count = min(CLUSTER_THREADS, point_count - batch);
+        for (uint i = 0; i < batch_count && count < CLUSTER_MAX_LIGHTS; i++)
+        {
+            if (Sphere_IntersectsAABB(shared_spheres[i], aabb_min, aabb_max)) clusters[first_slot + count++] = batch + i;
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+    uint point_count_cluster = count;
+
+    for (uint batch = 0; batch < spot_count; batch += CLUSTER_THREADS)
+    {
+        uint light_index = batch + thread_index;
+        shared_spheres[thread_index] = light_index < spot_count ? Sphere_ToViewSpace(Sphere_Spot(buffer_spotlights[light_index])) : float4(0.0f, 0.0f, 0.0f, -1.0f);
+        GroupMemoryBarrierWithGroupSync();
+
+        uint batch_count = min(CLUSTER_THREADS, spot_count - batch);
+        for (uint i = 0; i < batch_count && count < CLUSTER_MAX_LIGHTS; i++)
+        {
+            if (Sphere_IntersectsAABB(shared_spheres[i], aabb_min, aabb_max)) clusters[first_slot + count++] = batch + i;
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    clusters[first_slot - 1] = point_count_cluster | ((count - point_count_cluster) << 16);
+}
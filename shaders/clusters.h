@@ -0,0 +1,20 @@
+// Clustered light culling (see clusters.h in src): the grid and the layout of the cluster buffer
+// cluster_lights.comp writes it, the PBR fragment shader reads its cluster's lights from it
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_MAX_LIGHTS 127
+#define CLUSTER_STRIDE (CLUSTER_MAX_LIGHTS + 1) // uints per cluster: the counts, then the light indices
+
+// low 16 bits: point lights, high 16 bits: spot lights; the point light indices come first
+uint Cluster_PointCount(uint counts) { return counts & 0xFFFF; }
+uint Cluster_SpotCount(uint counts)  { return counts >> 16; }
+
+// where 1 / (1 + linear * d + quadratic * d^2) falls to 1/256; unbounded for a light without attenuation
+float Light_Range(float linear, float quadratic)
+{
+    if (quadratic > 0.0f) return (-linear + sqrt(linear * linear + 4.0f * quadratic * 255.0f)) / (2.0f * quadratic);
+    if (linear > 0.0f) return 255.0f / linear;
+    return 3.402823466e+38f;
+}
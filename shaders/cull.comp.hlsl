@@ -0,0 +1,183 @@
+// Culls the frame's unanimated models and static batch submeshes (see gpucull.h)
+// one thread per record; phase 0 writes its prepass and shadow commands, phase 1 its late prepass and main commands
+// a culled command draws zero instances
+
+// GPUCull_Record in gpucull.c
+struct Cull_Record
+{
+    float3 aabb_min;
+    uint first_index;
+    float3 aabb_max;
+    uint index_count;
+};
+
+// SDL_GPUIndexedIndirectDrawCommand
+struct Indexed_Indirect_Command
+{
+    uint num_indices;
+    uint num_instances;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+#define SHADOW_CASCADE_COUNT 4 // lights.h
+
+// GPUCull_View
+static const uint VIEW_PREPASS = 0;
+static const uint VIEW_PREPASS_LATE = 1;
+static const uint VIEW_MAIN = 2;
+static const uint VIEW_SHADOW = 3; // one per cascade
+
+Texture2D<float2> pyramid         : register(t0, space0); // min, max view space depth
+SamplerState      sampler_pyramid : register(s0, space0);
+
+StructuredBuffer<Cull_Record> records : register(t1, space0);
+
+RWStructuredBuffer<Indexed_Indirect_Command> commands : register(u0, space1); // record_count commands per view
+
+// UBO_Cull in gpucull.c
+cbuffer UBO_Cull : register(b0, space2)
+{
+    float4x4 occlusion_view; // the camera the pyramid was drawn from
+    float4x4 occlusion_view_projection;
+    float4 planes_camera[6]; // xyz = inward normal, w = distance
+    float4 planes_shadow[SHADOW_CASCADE_COUNT * 6]; // six per cascade
+    uint record_count;
+    uint phase;
+    uint occlusion;
+    uint pyramid_level_count;
+    uint screen_width;  // of the part of the prepass that was drawn into; the pyramid covers more when it is smaller
+    uint screen_height;
+};
+
+// same test as Frustum_IntersectsAABB
+bool IntersectsFrustum(float4 planes[6], float3 center, float3 extent)
+{
+    [unroll]
+    for (int i = 0; i < 6; i++)
+    {
+        float center_distance = dot(planes[i].xyz, center) + planes[i].w;
+        float radius = dot(abs(planes[i].xyz), extent);
+        if (center_distance + radius < 0.0) return false;
+    }
+    return true;
+}
+
+bool IntersectsCascade(uint cascade, float3 center, float3 extent)
+{
+    float4 planes[6];
+    [unroll]
+    for (int i = 0; i < 6; i++) planes[i] = planes_shadow[cascade * 6 + i];
+    return IntersectsFrustum(planes, center, extent);
+}
+
+// pyramid texel of level that holds the prepass pixel; the last texel of a level also holds what rounding left over
+int2 PyramidTexel(int2 pixel, uint level, int2 level_size)
+{
+    return min((pixel >> 1) >> level, level_size - 1);
+}
+
+// The box is occluded when its nearest point is behind the farthest depth anywhere under its screen rectangle,
+// read at the level where that rectangle spans at most 2x2 texels
+bool IsOccluded(float3 aabb_min, float3 aabb_max)
+{
+    if (occlusion == 0) return false;
+
+    float2 uv_min = float2(1.0, 1.0);
+    float2 uv_max = float2(0.0, 0.0);
+    float nearest = 3.402823e38f;
+    [unroll]
+    for (uint i = 0; i < 8; i++)
+    {
+        float4 corner = float4
+        (
+            (i & 1) ? aabb_max.x : aabb_min.x,
+            (i & 2) ? aabb_max.y : aabb_min.y,
+            (i & 4) ? aabb_max.z : aabb_min.z,
+            1.0
+        );
+        float view_z = mul(occlusion_view, corner).z;
+        if (view_z <= 0.0) return false; // reaches behind the camera, where the projection doesn't hold
+        float4 clip = mul(occlusion_view_projection, corner);
+        float2 uv = float2(clip.x, -clip.y) / clip.w * 0.5 + 0.5;
+        uv_min = min(uv_min, uv);
+        uv_max = max(uv_max, uv);
+        nearest = min(nearest, view_z);
+    }
+
+    int2 screen_size = int2(screen_width, screen_height);
+    int2 pixel_min = clamp(int2(floor(saturate(uv_min) * screen_size)), 0, screen_size - 1);
+    int2 pixel_max = clamp(int2(floor(saturate(uv_max) * screen_size)), 0, screen_size - 1);
+
+    uint level = 0;
+    int2 level_size;
+    int2 texel_min;
+    int2 texel_max;
+    for (;;)
+    {
+        uint width, height, level_count;
+        pyramid.GetDimensions(level, width, height, level_count);
+        level_size = int2(width, height);
+        texel_min = PyramidTexel(pixel_min, level, level_size);
+        texel_max = PyramidTexel(pixel_max, level, level_size);
+        if (all(texel_max - texel_min <= 1)) break;
+        if (level + 1 >= pyramid_level_count) return false;
+        level++;
+    }
+
+    float farthest = 0.0;
+    for (int y = texel_min.y; y <= texel_max.y; y++)
+    {
+        for (int x = texel_min.x; x <= texel_max.x; x++)
+        {
+            float2 uv = (float2(x, y) + 0.5) / float2(level_size);
+            farthest = max(farthest, pyramid.SampleLevel(sampler_pyramid, uv, level).y);
+        }
+    }
+
+    // a little slack for the prepass's 16 bit depth
+    return nearest > farthest * (1.0 + 1.0 / 512.0);
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 gid : SV_DispatchThreadID)
+{
+    uint i = gid.x;
+    if (i >= record_count) return;
+
+    Cull_Record record = records[i];
+    float3 center = (record.aabb_min + record.aabb_max) * 0.5;
+    float3 extent = (record.aabb_max - record.aabb_min) * 0.5;
+
+    Indexed_Indirect_Command command;
+    command.num_indices = record.index_count;
+    command.first_index = record.first_index;
+    command.vertex_offset = 0;
+    command.first_instance = 0;
+
+    bool visible = IntersectsFrustum(planes_camera, center, extent) && !IsOccluded(record.aabb_min, record.aabb_max);
+
+    if (phase == 0)
+    {
+        command.num_instances = visible ? 1 : 0;
+        commands[VIEW_PREPASS * record_count + i] = command;
+
+        [unroll]
+        for (uint cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+        {
+            command.num_instances = IntersectsCascade(cascade, center, extent) ? 1 : 0;
+            commands[(VIEW_SHADOW + cascade) * record_count + i] = command;
+        }
+    }
+    else
+    {
+        bool drawn = commands[VIEW_PREPASS * record_count + i].num_instances != 0;
+
+        command.num_instances = visible && !drawn ? 1 : 0;
+        commands[VIEW_PREPASS_LATE * record_count + i] = command;
+
+        command.num_instances = visible ? 1 : 0;
+        commands[VIEW_MAIN * record_count + i] = command;
+    }
+}
@@ -21,6 +21,9 @@ cbuffer UBO_Fog : register(b0, space3)
 
     float4x4 InvProj;         // inverse projection (for view-ray)
     float4x4 InvView;         // inverse view (view->world), for height fog
+
+    float2 UVScale;           // screen uv -> texture uv, for the drawn sub-rectangle
+    float2 padding1;
 };
 
 float3 GetViewRay(float2 uv)
@@ -87,9 +90,10 @@ struct Fragment_Input
 
 float4 main(Fragment_Input fragment) : SV_TARGET
 {
-    float4 scene = texture_color.Sample(sampler_color, fragment.uv);
+    float2 texture_uv = fragment.uv * UVScale;
+    float4 scene = texture_color.Sample(sampler_color, texture_uv);
 
-    float vd = texture_prepass.Sample(sampler_prepass, fragment.uv).a;
+    float vd = texture_prepass.Sample(sampler_prepass, texture_uv).a;
 
     // If depth is 0 (sky) decide how you want to fog it. Here we apply max fog.
     if (vd <= 0.0f)
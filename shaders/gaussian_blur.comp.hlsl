@@ -7,8 +7,8 @@ RWTexture2D<float4> texture_out : register(u0, space1);
 cbuffer GaussianBlurParams : register(b0, space2)
 {
     uint horizontal; // 0 = vertical, 1 = horizontal
-    float stride;    // not used in this implementation, but could be for adjustable blur radius
-    float2 _pad;     // keep cbuffer aligned (optional)
+    float stride;    // in texels between taps
+    float2 uv_max;   // taps are clamped to it, to stay inside the drawn sub-rectangle
 }
 
 static const float weight[5] = { 0.2270270270, 0.1945945946, 0.1216216216, 0.0540540541, 0.0162162162 };
@@ -26,15 +26,15 @@ void main(uint3 gid : SV_DispatchThreadID)
     float2 texel = 1.0 / float2(w, h);
     float2 uv = (float2(pix) + 0.5) * texel;
 
-    float3 result = texture_in.SampleLevel(sampler_linear, uv, 0).rgb * weight[0];
+    float4 result = texture_in.SampleLevel(sampler_linear, uv, 0) * weight[0];
 
     if (horizontal != 0)
     {
         [unroll]
         for (int i = 1; i < 5; ++i)
         {
-            result += texture_in.SampleLevel(sampler_linear, uv + float2(texel.x * i * stride, 0.0), 0).rgb * weight[i];
-            result += texture_in.SampleLevel(sampler_linear, uv - float2(texel.x * i * stride, 0.0), 0).rgb * weight[i];
+            result += texture_in.SampleLevel(sampler_linear, min(uv + float2(texel.x * i * stride, 0.0), uv_max), 0) * weight[i];
+            result += texture_in.SampleLevel(sampler_linear, min(uv - float2(texel.x * i * stride, 0.0), uv_max), 0) * weight[i];
         }
     }
     else
@@ -42,10 +42,10 @@ void main(uint3 gid : SV_DispatchThreadID)
         [unroll]
         for (int i = 1; i < 5; ++i)
         {
-            result += texture_in.SampleLevel(sampler_linear, uv + float2(0.0, texel.y * i * stride), 0).rgb * weight[i];
-            result += texture_in.SampleLevel(sampler_linear, uv - float2(0.0, texel.y * i * stride), 0).rgb * weight[i];
+            result += texture_in.SampleLevel(sampler_linear, min(uv + float2(0.0, texel.y * i * stride), uv_max), 0) * weight[i];
+            result += texture_in.SampleLevel(sampler_linear, min(uv - float2(0.0, texel.y * i * stride), uv_max), 0) * weight[i];
         }
     }
 
-    texture_out[pix] = float4(result, 1.0);
+    texture_out[pix] = result; // all four channels: bloom reads rgb, shadow moments need alpha too
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+// One level of the Hi-Z pyramid (see gpucull.h): min and max view space depth of the texels under each texel
+// levels are half the size of the one above, rounded down like a mip chain, so the last row and column
+// also take the texels that rounding left over
+
+Texture2D<float4> source : register(t0, space0); // the prepass (A = view space z) for level 0, else the level above
+
+[[vk::image_format("rg32f")]]
+RWTexture2D<float2> destination : register(u0, space1);
+
+// UBO_HiZ in gpucull.c
+cbuffer UBO_HiZ : register(b0, space2)
+{
+    uint from_prepass;
+};
+
+static const float far_depth = 3.402823e38f;
+
+[numthreads(8, 8, 1)]
+void main(uint3 gid : SV_DispatchThreadID)
+{
+    uint2 destination_size;
+    destination.GetDimensions(destination_size.x, destination_size.y);
+    uint2 dst = gid.xy;
+    if (dst.x >= destination_size.x || dst.y >= destination_size.y) return;
+
+    uint2 source_size;
+    source.GetDimensions(source_size.x, source_size.y);
+
+    uint2 first = min(dst * 2, source_size - 1);
+    uint2 last = dst * 2 + 1;
+    if (dst.x == destination_size.x - 1) last.x = source_size.x - 1;
+    if (dst.y == destination_size.y - 1) last.y = source_size.y - 1;
+    last = min(last, source_size - 1);
+
+    float2 result = float2(far_depth, 0.0);
+    for (uint y = first.y; y <= last.y; y++)
+    {
+        for (uint x = first.x; x <= last.x; x++)
+        {
+            float4 s = source.Load(int3(x, y, 0));
+            // the prepass is cleared to 0 where nothing was drawn
+            float2 depth = from_prepass ? (s.a > 0.0 ? s.aa : float2(far_depth, far_depth)) : s.rg;
+            result.x = min(result.x, depth.x);
+            result.y = max(result.y, depth.y);
+        }
+    }
+    destination[dst] = result;
+}
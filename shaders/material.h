@@ -0,0 +1,11 @@
+// Material textures are layers of the bound material pools (see materialpool.h);
+// each draw's Material_Parameters says which layers, at the index the vertex shader passes on as draw_index
+
+// Material_Parameters in model.h
+struct Material_Parameters
+{
+    uint layer_diffuse;
+    uint layer_metallic_roughness;
+    uint layer_normal;
+    uint _padding;
+};
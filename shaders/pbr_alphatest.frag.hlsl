@@ -1,4 +1,7 @@
 #include "shaders/pbr.h"
+#include "shaders/material.h"
+#include "shaders/clusters.h"
+#include "shaders/shadow_moments.h"
 
 #ifdef __HLSL_VERSION
     #define CLIP_TEST(v)  clip(v)
@@ -10,6 +13,15 @@
     #define CLIP_TEST(v)  if (any((v) < 0)) discard
 #endif
 
+// Light_Point and Light_Spot in lights.h; world space
+struct Light_Point
+{
+    float3 position;
+    float  attenuation_constant_linear;
+    float3 color;
+    float  attenuation_constant_quadratic;
+};
+
 struct Light_Spot
 {
     float3 position;
@@ -19,22 +31,30 @@ struct Light_Spot
     float3 direction;
     float  cutoff_inner; // passed as SDL_cosf(glm_rad(angle))
     float  cutoff_outer;
-    uint   shadow_caster;
-    float           _[2];
+    uint   shadow_caster;   // has a tile in the spot shadow atlas
+    float  shadow_bias_scale; // SHADOW_BIAS in the tile's depth units is shadow_bias_scale / w^2
+    float           _;
+    float4x4 shadow_world_to_clip; // the light's view projection
+    float4 shadow_atlas_rect;     // uv offset xy, size zw
 };
 
-Texture2D    texture_diffuse            : register(t0, space2);
-SamplerState sampler_diffuse            : register(s0, space2);
-Texture2D    texture_metallic_roughness : register(t1, space2);
-SamplerState sampler_metallic_roughness : register(s1, space2);
-Texture2D    texture_normal             : register(t2, space2);
-SamplerState sampler_normal             : register(s2, space2);
-Texture2D    shadow_map                 : register(t3, space2);
-SamplerState sampler_shadow_map         : register(s3, space2);
-Texture2D    texture_ssao               : register(t4, space2);
-SamplerState sampler_ssao               : register(s4, space2);
-
-StructuredBuffer<Light_Spot> buffer_spotlights : register(t5, space2);
+Texture2DArray texture_diffuse            : register(t0, space2);
+SamplerState   sampler_diffuse            : register(s0, space2);
+Texture2DArray texture_metallic_roughness : register(t1, space2);
+SamplerState   sampler_metallic_roughness : register(s1, space2);
+Texture2DArray texture_normal             : register(t2, space2);
+SamplerState   sampler_normal             : register(s2, space2);
+Texture2D      shadow_map                 : register(t3, space2); // 2x2 atlas of the cascades (see lights.h), or its moments
+SamplerState   sampler_shadow_map         : register(s3, space2);
+Texture2D      texture_ssao               : register(t4, space2);
+SamplerState   sampler_ssao               : register(s4, space2);
+Texture2D      spot_shadow_atlas          : register(t5, space2); // a tile per shadowed spot light (see lights.h)
+SamplerState   sampler_spot_shadow_atlas  : register(s5, space2);
+
+StructuredBuffer<Light_Spot> buffer_spotlights : register(t6, space2);
+StructuredBuffer<Light_Point> buffer_pointlights : register(t7, space2);
+StructuredBuffer<uint> buffer_clusters : register(t8, space2); // CLUSTER_STRIDE uints per cluster (see clusters.h)
+StructuredBuffer<Material_Parameters> buffer_materials : register(t9, space2);
 
 struct Light_Directional
 {
@@ -54,11 +74,17 @@ struct Light_Directional
 //     float           ___;
 // };
 
+#define SHADOW_CASCADE_COUNT 4 // lights.h
+#define SPOT_SHADOW_ATLAS_SIZE 2048 // lights.h
+
+// Shadow_Settings in lights.h
 // struct Shadow_Uniform
 // {
+//     float4x4 shadow_view_to_cascade[SHADOW_CASCADE_COUNT];
+//     float4 shadow_cascade_bias;
 //     float2 shadow_texel_size;
-//     float  shadow_bias;
 //     float  shadow_pcf_radius; // in texels
+//     float  shadow_blur_reach;
 // };
 
 cbuffer UBO_Main_Frag : register(b0, space3)
@@ -72,29 +98,31 @@ cbuffer UBO_Main_Frag : register(b0, space3)
     float3 color_ground;
     float           ___;
     
-    float2 shadow_texel_size;
-    float  shadow_bias;
-    float  shadow_pcf_radius; // in texels
+    float4x4 shadow_view_to_cascade[SHADOW_CASCADE_COUNT]; // camera view space -> cascade clip space
+    float4 shadow_cascade_bias; // in each cascade's depth units
+    float2 shadow_texel_size;   // of the atlas
+    float  shadow_pcf_radius;   // in texels
+    float  shadow_blur_reach;   // in texels, of the moments blur
     
     float2 screen_inv_resolution;
     uint   settings_render;
-    float         ____;
+    float         _____;
+
+    float  cluster_depth_scale; // slice = log(view depth) * scale + bias
+    float  cluster_depth_bias;
+    float2 cluster_tile_scale; // clusters per pixel of the drawn sub-rectangle
+
+    float4x4 view_matrix;
+    float4x4 inverse_view_matrix;
 }
 
 #define SETTINGS_RENDER_ENABLE_SSAO     (1 << 2)
 #define SETTINGS_RENDER_ENABLE_SHADOWS  (1 << 3)
+#define SETTINGS_RENDER_FILTERED_SHADOWS (1 << 9)
 
-float ShadowFactor(float4 position_clipspace_light)
+// uv is in the atlas; the caller keeps the kernel inside one tile
+float ShadowFactor(Texture2D atlas, SamplerState atlas_sampler, float2 texel_size, float2 uv, float fragment_depth, float shadow_bias)
 {
-    float3 ndc = position_clipspace_light.xyz / max(position_clipspace_light.w, 1e-7f);
-    float2 uv  = ndc.xy * 0.5f + 0.5f;
-    uv.y = 1.0f - uv.y;
-    float fragment_depth = ndc.z;
-
-    // If outside shadow map or behind far plane, consider fully lit
-    if (uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f || fragment_depth > 1.0f)
-        return 1.0f;
-
     // bypass PCF
     // float map_depth = shadow_map.SampleLevel(sampler_shadow_map, uv, 0.0).r;
     // return (fragment_depth <= (map_depth + shadow_bias));
@@ -109,8 +137,8 @@ float ShadowFactor(float4 position_clipspace_light)
         // [unroll]
         for (int x = -radius; x <= radius; x++)
         {
-            float2 offset = float2((float)x, (float)y) * shadow_texel_size;
-            float map_depth = shadow_map.SampleLevel(sampler_shadow_map, uv + offset, 0.0).r; // read depth
+            float2 offset = float2((float)x, (float)y) * texel_size;
+            float map_depth = atlas.SampleLevel(atlas_sampler, uv + offset, 0.0).r; // read depth
             sum += (fragment_depth <= (map_depth + shadow_bias));
         }
     }
@@ -119,6 +147,83 @@ float ShadowFactor(float4 position_clipspace_light)
     return sum / (kernel * kernel);
 }
 
+// The first cascade the fragment and its PCF kernel (or the moments blur) are inside of; fully lit past the last one
+float ShadowFactor_Directional(float3 position_viewspace)
+{
+    bool filtered = (settings_render & SETTINGS_RENDER_FILTERED_SHADOWS) != 0;
+
+    // the kernel's reach, in a tile's uv (a tile is half the atlas)
+    float reach = filtered ? shadow_blur_reach : (float)(int)shadow_pcf_radius;
+    float margin = (reach + 1.0f) * shadow_texel_size.x * 2.0f;
+
+    [unroll]
+    for (uint cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        float3 ndc = mul(shadow_view_to_cascade[cascade], float4(position_viewspace, 1.0f)).xyz; // orthographic, w = 1
+        float2 uv = ndc.xy * float2(0.5f, -0.5f) + 0.5f;
+        if (any(uv < margin) || any(uv > 1.0f - margin) || ndc.z > 1.0f) continue;
+
+        float2 tile = float2(cascade & 1, cascade >> 1);
+        if (filtered)
+        {
+            float4 moments = shadow_map.SampleLevel(sampler_shadow_map, (uv + tile) * 0.5f, 0.0);
+            return Shadow_EVSM(moments, ndc.z - shadow_cascade_bias[cascade]);
+        }
+        return ShadowFactor(shadow_map, sampler_shadow_map, shadow_texel_size, (uv + tile) * 0.5f, ndc.z, shadow_cascade_bias[cascade]);
+    }
+    return 1.0f;
+}
+
+// The light's tile, drawn in perspective: depth units shrink with distance, so the bias does too
+// the kernel is clamped into the tile; past the tile's edge the fragment is outside the cone anyway
+float ShadowFactor_Spot(Light_Spot light, float3 position_worldspace)
+{
+    float4 clip = mul(light.shadow_world_to_clip, float4(position_worldspace, 1.0f));
+    if (clip.w <= 0.0f) return 1.0f; // behind the light
+    float3 ndc = clip.xyz / clip.w;
+    if (ndc.z > 1.0f) return 1.0f; // past the far plane
+
+    float2 uv = ndc.xy * float2(0.5f, -0.5f) + 0.5f;
+    float2 texel_size = (1.0f / SPOT_SHADOW_ATLAS_SIZE).xx;
+    float margin = ((float)(int)shadow_pcf_radius + 0.5f) * texel_size.x;
+    float2 tile_min = light.shadow_atlas_rect.xy + margin;
+    float2 tile_max = light.shadow_atlas_rect.xy + light.shadow_atlas_rect.zw - margin;
+    float2 atlas_uv = clamp(light.shadow_atlas_rect.xy + uv * light.shadow_atlas_rect.zw, tile_min, tile_max);
+    return ShadowFactor(spot_shadow_atlas, sampler_spot_shadow_atlas, texel_size, atlas_uv, ndc.z, light.shadow_bias_scale / (clip.w * clip.w));
+}
+
+// the first uint of the fragment's cluster: its light counts; the light indices follow
+uint Cluster_FirstSlot(float2 pixel, float view_depth)
+{
+    uint2 tile = min((uint2)(pixel * cluster_tile_scale), uint2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    uint slice = (uint)clamp(log(max(view_depth, 1e-4f)) * cluster_depth_scale + cluster_depth_bias, 0.0f, CLUSTER_GRID_Z - 1.0f);
+    return ((slice * CLUSTER_GRID_Y + tile.y) * CLUSTER_GRID_X + tile.x) * CLUSTER_STRIDE;
+}
+
+// Cook-Torrance for one light; L points from the fragment to the light, radiance includes attenuation
+float3 Light_Contribution(float3 N, float3 V, float3 L, float3 radiance, float3 albedo, float metallic, float roughness, float3 F0)
+{
+    float3 H = normalize(L + V);
+
+    float NdotH = saturate(dot(N, H));
+    float NdotV = saturate(dot(N, V));
+    float NdotL = saturate(dot(N, L));
+    float VdotH = saturate(dot(V, H));
+
+    float D = Distribution_GGX(NdotH, roughness);
+    float G = Geometry_Smith(NdotV, NdotL, roughness);
+    float3 F = Fresnel_Schlick(VdotH, F0);
+
+    float3 numerator = D * G * F;
+    float denominator = 4.0f * NdotV * NdotL + 1e-7f;
+    float3 specular = numerator / denominator;
+
+    float3 kS = F;
+    float3 kD = (1.0f.xxx - kS) * (1.0f - metallic);
+
+    return (kD * albedo / 3.14159265f + specular) * radiance * NdotL;
+}
+
 struct Fragment_Input
 {
     float4 position_clipspace_camera : SV_Position;
@@ -127,7 +232,7 @@ struct Fragment_Input
     float2 texture_coordinate        : TEXCOORD2;
     float3 tangent_viewspace         : TEXCOORD3;
     float3 bitangent_viewspace       : TEXCOORD4;
-    float4 position_clipspace_light  : TEXCOORD5;
+    nointerpolation uint draw_index  : TEXCOORD5;
 };
 
 struct Fragment_Output
@@ -139,17 +244,22 @@ Fragment_Output main(Fragment_Input fragment)
 {
     Fragment_Output output;
 
-    float4 albedo = texture_diffuse.Sample(sampler_diffuse, fragment.texture_coordinate);
+    Material_Parameters material = buffer_materials[fragment.draw_index];
+
+    float4 albedo = texture_diffuse.Sample(sampler_diffuse, float3(fragment.texture_coordinate, material.layer_diffuse));
     CLIP_TEST(albedo.a - 0.5);
 
-    float3 mr_sample = texture_metallic_roughness.Sample(sampler_metallic_roughness, fragment.texture_coordinate).rgb;
+    float3 mr_sample = texture_metallic_roughness.Sample(sampler_metallic_roughness, float3(fragment.texture_coordinate, material.layer_metallic_roughness)).rgb;
     float metallic = mr_sample.b;
     float roughness = mr_sample.g;
     float ao = mr_sample.r;
 
     // Normal Mapping
 
-    float3 N_ts = texture_normal.Sample(sampler_normal, fragment.texture_coordinate).xyz * 2.0f - 1.0f;
+    // only xy are stored (BC5 has no blue channel), so z is reconstructed
+    float3 N_ts;
+    N_ts.xy = texture_normal.Sample(sampler_normal, float3(fragment.texture_coordinate, material.layer_normal)).xy * 2.0f - 1.0f;
+    N_ts.z = sqrt(saturate(1.0f - dot(N_ts.xy, N_ts.xy)));
     
     // If normal map uses OpenGL convention (green down):
     // N_ts.y = -N_ts.y;
@@ -198,49 +308,49 @@ Fragment_Output main(Fragment_Input fragment)
     float3 light_directional_contribution = (kD * albedo.rgb / 3.14159265f + specular) * radiance * NdotL_directional;
 
     if (light_directional.is_shadow_caster && (settings_render & SETTINGS_RENDER_ENABLE_SHADOWS))
-        Lo += light_directional_contribution * ShadowFactor(fragment.position_clipspace_light);
+        Lo += light_directional_contribution * ShadowFactor_Directional(fragment.position_viewspace);
     else
         Lo += light_directional_contribution;
 
-    // Spotlights
+    // Point and spot lights: only the ones in this fragment's cluster
 
-    for (int i = 0; i < 1; i++) // TODO: number of active lights as uniform
+    uint cluster = Cluster_FirstSlot(fragment.position_clipspace_camera.xy, fragment.position_viewspace.z);
+    uint cluster_counts = buffer_clusters[cluster];
+    uint point_count = Cluster_PointCount(cluster_counts);
+    uint spot_count = Cluster_SpotCount(cluster_counts);
+    float3 position_worldspace = mul(inverse_view_matrix, float4(fragment.position_viewspace, 1.0f)).xyz;
+
+    for (uint i = 0; i < point_count; i++)
     {
-        Light_Spot light = buffer_spotlights[i];
+        Light_Point light = buffer_pointlights[buffer_clusters[cluster + 1 + i]];
 
-        float3 L_unnormalized = light.position - fragment.position_viewspace;
+        float3 L_unnormalized = mul(view_matrix, float4(light.position, 1.0f)).xyz - fragment.position_viewspace;
         float distance_to_light = length(L_unnormalized);
         float attenuation = 1.0f / (1.0f + light.attenuation_constant_linear * distance_to_light + light.attenuation_constant_quadratic * (distance_to_light * distance_to_light));
 
-        float3 L = normalize(L_unnormalized);
-        float3 H = normalize(L + V);
-
-        // assume we are given the normalized direction the light is coming FROM
-        float theta = dot(L, -light.direction);
-        float epsilon = light.cutoff_inner - light.cutoff_outer;
-        float intensity = saturate((theta - light.cutoff_outer) / epsilon + 1e-7f);
-
-        float3 radiance_spot = light.color * intensity * attenuation;
+        Lo += Light_Contribution(N, V, L_unnormalized / distance_to_light, light.color * attenuation, albedo.rgb, metallic, roughness, F0);
+    }
 
-        float NdotH = saturate(dot(N, H));
-        float NdotL = saturate(dot(N, L));
-        float VdotH = saturate(dot(V, H));
+    for (uint ii = 0; ii < spot_count; ii++)
+    {
+        Light_Spot light = buffer_spotlights[buffer_clusters[cluster + 1 + point_count + ii]];
 
-        float D_spot = Distribution_GGX(NdotH, roughness);
-        float G_spot = Geometry_Smith(NdotV, NdotL, roughness);
-        float3 F_spot = Fresnel_Schlick(VdotH, F0);
+        float3 L_unnormalized = mul(view_matrix, float4(light.position, 1.0f)).xyz - fragment.position_viewspace;
+        float distance_to_light = length(L_unnormalized);
+        float attenuation = 1.0f / (1.0f + light.attenuation_constant_linear * distance_to_light + light.attenuation_constant_quadratic * (distance_to_light * distance_to_light));
 
-        float3 numerator_spot = D_spot * G_spot * F_spot;
-        float denominator_spot = 4.0f * NdotV * NdotL + 1e-7f;
-        float3 specular_spot = numerator_spot / denominator_spot;
+        float3 L = L_unnormalized / distance_to_light;
 
-        float3 kS_spot = F_spot;
-        float3 kD_spot = (1.0f.xxx - kS_spot) * (1.0f - metallic);
+        // assume we are given the normalized direction the light is coming FROM
+        float theta = dot(L, -mul((float3x3)view_matrix, light.direction));
+        float epsilon = light.cutoff_inner - light.cutoff_outer;
+        float intensity = saturate((theta - light.cutoff_outer) / epsilon + 1e-7f);
+        if (intensity <= 0.0f) continue;
 
-        float3 light_spot_contribution = (kD_spot * albedo.rgb / 3.14159265f + specular_spot) * radiance_spot * NdotL;
+        float3 light_spot_contribution = Light_Contribution(N, V, L, light.color * intensity * attenuation, albedo.rgb, metallic, roughness, F0);
 
         if (light.shadow_caster && (settings_render & SETTINGS_RENDER_ENABLE_SHADOWS))
-            Lo += light_spot_contribution * ShadowFactor(fragment.position_clipspace_light);
+            Lo += light_spot_contribution * ShadowFactor_Spot(light, position_worldspace);
         else
             Lo += light_spot_contribution;
     }
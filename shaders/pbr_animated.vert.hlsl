@@ -1,17 +1,5 @@
-cbuffer Transforms : register(b0, space1)
-{
-    float4x4 mvp;
-    float4x4 mv;
-    float4x4 mvp_light; // light_view_projection * model
-#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-    float4x4 mv_inverse_transpose; // upper-left 3x3 = inverse-transpose of (V*M).xyz
-#endif
-};
-
-cbuffer Skinning : register(b1, space1)
-{
-    uint base_joint_offset_bytes; // offset into the joint matrix storage buffer
-};
+#include "shaders/vertex.h"
+#include "shaders/transforms.h"
 
 // WARNING: StructuredBuffers are not natively supported by SDL's GPU API.
 // They will work with SDL_shadercross because it does special processing to
@@ -19,16 +7,15 @@ cbuffer Skinning : register(b1, space1)
 // See https://github.com/libsdl-org/SDL/issues/12200 for details.
 
 // Storage buffer containing all joint matrices for all models for this frame.
-StructuredBuffer<float4x4> joint_matrix_buffer : register(t0, space0);
+StructuredBuffer<float4x4> joint_matrix_buffer : register(t1, space0);
 
 struct Vertex_Input
 {
-    float3 position : TEXCOORD0;
-    float3 normal : TEXCOORD1;
+    float4 position : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
     float2 texture_coordinate : TEXCOORD2;
-    float4 tangent : TEXCOORD3; // .w = handedness
-    uint bone_indices : TEXCOORD4; // 4 8-bit bone indices packed into a single 32-bit uint
-    float4 bone_weights : TEXCOORD5;
+    uint bone_indices : TEXCOORD3; // 4 8-bit bone indices packed into a single 32-bit uint
+    float4 bone_weights : TEXCOORD4; // unorm8
 };
 
 struct Vertex_Output
@@ -39,13 +26,15 @@ struct Vertex_Output
     float2 texture_coordinate         : TEXCOORD2;
     float3 tangent_viewspace          : TEXCOORD3;
     float3 bitangent_viewspace        : TEXCOORD4;
-    float4 position_clipspace_light   : TEXCOORD5;
+    nointerpolation uint draw_index   : TEXCOORD5; // into the material parameters (see pbr_alphatest.frag)
 };
 
 Vertex_Output main(Vertex_Input vertex)
 {
     Vertex_Output output;
 
+    Transforms transforms = transform_buffer[transform_index];
+
     // Unpack 4 x 8-bit indices
     uint index0 = (vertex.bone_indices >> 0)  & 0xFF;
     uint index1 = (vertex.bone_indices >> 8)  & 0xFF;
@@ -65,39 +54,39 @@ Vertex_Output main(Vertex_Input vertex)
     skin_matrix += joint_matrix_buffer[index3] * vertex.bone_weights.w;
 
     // Skinned position
-    float4 skinned_position_worldspace = mul(skin_matrix, float4(vertex.position, 1.0f));
-    output.skinned_position_clipspace = mul(mvp, skinned_position_worldspace);
+    float3 position = Vertex_DecodePosition(vertex.position, transforms.position_offset, transforms.position_scale);
+    float4 skinned_position_worldspace = mul(skin_matrix, float4(position, 1.0f));
+    output.skinned_position_clipspace = mul(transforms.mvp, skinned_position_worldspace);
 
-    float4 skinned_position_viewspace = mul(mv, skinned_position_worldspace);
+    float4 skinned_position_viewspace = mul(transforms.mv, skinned_position_worldspace);
     output.skinned_position_viewspace = skinned_position_viewspace.xyz;
 
     // Assume skin matrix has no non-uniform scaling
     float3x3 skin3x3 = (float3x3)skin_matrix;
-    float3 N_ws = normalize(mul(skin3x3, vertex.normal));
-    float3 T_ws = normalize(mul(skin3x3, vertex.tangent.xyz));
+    float3 N_ws = normalize(mul(skin3x3, Vertex_DecodeOctahedral(vertex.normal_tangent.xy)));
+    float3 T_ws = normalize(mul(skin3x3, Vertex_DecodeOctahedral(vertex.normal_tangent.zw)));
 
     // Transform to view space
 #ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-    float3x3 normalMat = (float3x3)mv_inverse_transpose;
+    float3x3 normalMat = (float3x3)transforms.mv_inverse_transpose;
     float3 N_vs = normalize(mul(normalMat, N_ws));
 #else
-    float3x3 mv3x3 = (float3x3)mv;
+    float3x3 mv3x3 = (float3x3)transforms.mv;
     float3 N_vs = normalize(mul(mv3x3, N_ws));
 #endif
 
-    float3 T_vs = normalize(mul((float3x3)mv, T_ws));
+    float3 T_vs = normalize(mul((float3x3)transforms.mv, T_ws));
 
     // Orthonormalize T against N and build B using handedness
     T_vs = normalize(T_vs - N_vs * dot(T_vs, N_vs));
-    float3 B_vs = normalize(cross(N_vs, T_vs)) * vertex.tangent.w;
+    float3 B_vs = normalize(cross(N_vs, T_vs)) * Vertex_DecodeBitangentSign(vertex.position);
 
     output.normal_viewspace    = N_vs;
     output.tangent_viewspace   = T_vs;
     output.bitangent_viewspace = B_vs;
 
     output.texture_coordinate = vertex.texture_coordinate;
-
-    output.position_clipspace_light = mul(mvp_light, skinned_position_worldspace);
+    output.draw_index = transform_index;
 
     return output;
 }
\ No newline at end of file
@@ -8,8 +8,12 @@
     #define CLIP_TEST(v)  if (any((v) < 0)) discard
 #endif
 
-Texture2D    texture_diffuse : register(t0, space2);
-SamplerState sampler_diffuse : register(s0, space2);
+#include "shaders/material.h"
+
+Texture2DArray texture_diffuse : register(t0, space2);
+SamplerState   sampler_diffuse : register(s0, space2);
+
+StructuredBuffer<Material_Parameters> buffer_materials : register(t1, space2);
 
 struct Fragment_Input
 {
@@ -17,6 +21,7 @@ struct Fragment_Input
     float3 position_viewspace : TEXCOORD0;
     float3 normal_viewspace   : TEXCOORD1;
     float2 texture_coordinate : TEXCOORD2;
+    nointerpolation uint draw_index : TEXCOORD3;
 };
 
 struct Fragment_Output
@@ -26,7 +31,8 @@ struct Fragment_Output
 
 Fragment_Output main(Fragment_Input fragment)
 {
-    float4 albedo = texture_diffuse.Sample(sampler_diffuse, fragment.texture_coordinate);
+    Material_Parameters material = buffer_materials[fragment.draw_index];
+    float4 albedo = texture_diffuse.Sample(sampler_diffuse, float3(fragment.texture_coordinate, material.layer_diffuse));
     CLIP_TEST(albedo.a - 0.5);
     
     Fragment_Output output;
@@ -0,0 +1,59 @@
+#include "shaders/vertex.h"
+#include "shaders/transforms.h"
+
+// Model_Instance in model.h; transforms.mvp, mv and model have M = identity, so the instance's model matrix is applied first
+struct Instance
+{
+    float4x4 model;
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+    float4x4 normal; // upper-left 3x3 = inverse-transpose of M.xyz
+#endif
+};
+
+// see the StructuredBuffer warning in pbr_animated.vert.hlsl
+StructuredBuffer<Instance> instance_buffer : register(t1, space0);
+
+struct Vertex_Input
+{
+    float4 position           : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent     : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
+    float2 texture_coordinate : TEXCOORD2;
+};
+
+struct Vertex_Output
+{
+    float4 position_clipspace : SV_Position;
+    float3 position_viewspace : TEXCOORD0;
+    float3 normal_viewspace   : TEXCOORD1;
+    float2 texture_coordinate : TEXCOORD2;
+    nointerpolation uint draw_index : TEXCOORD3; // into the material parameters (see prepass.frag)
+};
+
+Vertex_Output main(Vertex_Input vertex, uint instance_id : SV_InstanceID)
+{
+    Vertex_Output output;
+
+    Transforms transforms = transform_buffer[transform_index];
+    Instance instance = instance_buffer[instance_id];
+
+    float4 position_modelspace = float4(Vertex_DecodePosition(vertex.position, transforms.position_offset, transforms.position_scale), 1.0f);
+    float4 position_worldspace = mul(instance.model, position_modelspace);
+    float3 normal = Vertex_DecodeOctahedral(vertex.normal_tangent.xy);
+    output.position_clipspace = mul(transforms.mvp, position_worldspace);
+
+    float4 position_viewspace = mul(transforms.mv, position_worldspace);
+    output.position_viewspace = position_viewspace.xyz;
+
+    // Transform normal to view space
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+    float3 N_vs = normalize(mul((float3x3)transforms.mv, mul((float3x3)instance.normal, normal)));
+#else
+    float3 N_vs = normalize(mul((float3x3)transforms.mv, mul((float3x3)instance.model, normal)));
+#endif
+    output.normal_viewspace = N_vs;
+
+    output.texture_coordinate = vertex.texture_coordinate;
+    output.draw_index = transform_index;
+
+    return output;
+}
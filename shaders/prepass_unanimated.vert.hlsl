@@ -1,19 +1,11 @@
-cbuffer TransformUBO : register(b0, space1)
-{
-    float4x4 mvp;
-    float4x4 mv;
-    float4x4 mvp_light; // light_view_projection * model
-#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-    float4x4 mv_inverse_transpose; // upper-left 3x3 = inverse-transpose of (V*M).xyz
-#endif
-};
+#include "shaders/vertex.h"
+#include "shaders/transforms.h"
 
 struct Vertex_Input
 {
-    float3 position           : TEXCOORD0;
-    float3 normal             : TEXCOORD1;
+    float4 position           : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent     : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
     float2 texture_coordinate : TEXCOORD2;
-    float4 tangent            : TEXCOORD3; // .w = handedness
 };
 
 struct Vertex_Output
@@ -22,28 +14,33 @@ struct Vertex_Output
     float3 position_viewspace : TEXCOORD0;
     float3 normal_viewspace   : TEXCOORD1;
     float2 texture_coordinate : TEXCOORD2;
+    nointerpolation uint draw_index : TEXCOORD3; // into the material parameters (see prepass.frag)
 };
 
 Vertex_Output main(Vertex_Input vertex)
 {
     Vertex_Output output;
 
-    float4 position_worldspace = float4(vertex.position, 1.0f);
-    output.position_clipspace = mul(mvp, position_worldspace);
+    Transforms transforms = transform_buffer[transform_index];
+
+    float4 position_worldspace = float4(Vertex_DecodePosition(vertex.position, transforms.position_offset, transforms.position_scale), 1.0f);
+    float3 normal = Vertex_DecodeOctahedral(vertex.normal_tangent.xy);
+    output.position_clipspace = mul(transforms.mvp, position_worldspace);
 
-    float4 position_viewspace = mul(mv, position_worldspace);
+    float4 position_viewspace = mul(transforms.mv, position_worldspace);
     output.position_viewspace = position_viewspace.xyz;
 
     // Transform normal to view space
 #ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-    float3x3 normalMat = (float3x3)mv_inverse_transpose;
-    float3 N_vs = normalize(mul(normalMat, vertex.normal));
+    float3x3 normalMat = (float3x3)transforms.mv_inverse_transpose;
+    float3 N_vs = normalize(mul(normalMat, normal));
 #else
-    float3 N_vs = normalize(mul((float3x3)mv, vertex.normal));
+    float3 N_vs = normalize(mul((float3x3)transforms.mv, normal));
 #endif
     output.normal_viewspace = N_vs;
 
     output.texture_coordinate = vertex.texture_coordinate;
+    output.draw_index = transform_index;
 
     return output;
 }
\ No newline at end of file
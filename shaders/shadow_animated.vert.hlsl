@@ -0,0 +1,46 @@
+#include "shaders/vertex.h"
+#include "shaders/transforms.h"
+
+// UBO_Shadow in render.h: the cascade being drawn
+cbuffer Shadow : register(b1, space1)
+{
+    float4x4 cascade_view_projection;
+};
+
+// see the StructuredBuffer warning in pbr_animated.vert.hlsl
+StructuredBuffer<float4x4> joint_matrix_buffer : register(t1, space0);
+
+struct Vertex_Input
+{
+    float4 position : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
+    float2 texture_coordinate : TEXCOORD2;
+    uint bone_indices : TEXCOORD3; // 4 8-bit bone indices packed into a single 32-bit uint
+    float4 bone_weights : TEXCOORD4; // unorm8
+};
+
+struct Vertex_Output
+{
+    float4 position_clipspace : SV_Position;
+};
+
+// skinned like pbr_animated.vert
+Vertex_Output main(Vertex_Input vertex)
+{
+    Vertex_Output output;
+
+    Transforms transforms = transform_buffer[transform_index];
+
+    uint base_offset = base_joint_offset_bytes / sizeof(float4x4);
+    float4x4 skin_matrix = (float4x4)0;
+    skin_matrix += joint_matrix_buffer[base_offset + ((vertex.bone_indices >> 0)  & 0xFF)] * vertex.bone_weights.x;
+    skin_matrix += joint_matrix_buffer[base_offset + ((vertex.bone_indices >> 8)  & 0xFF)] * vertex.bone_weights.y;
+    skin_matrix += joint_matrix_buffer[base_offset + ((vertex.bone_indices >> 16) & 0xFF)] * vertex.bone_weights.z;
+    skin_matrix += joint_matrix_buffer[base_offset + ((vertex.bone_indices >> 24) & 0xFF)] * vertex.bone_weights.w;
+
+    float3 position = Vertex_DecodePosition(vertex.position, transforms.position_offset, transforms.position_scale);
+    float4 skinned_position = mul(skin_matrix, float4(position, 1.0f));
+    output.position_clipspace = mul(cascade_view_projection, mul(transforms.model, skinned_position));
+
+    return output;
+}
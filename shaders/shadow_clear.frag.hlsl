@@ -0,0 +1,20 @@
+// Clears one tile of the spot shadow atlas to the far plane (see Render_SpotShadows)
+// drawn as a fullscreen quad over the tile's viewport; depth is written as is (compare ALWAYS)
+
+struct Fragment_Input
+{
+    float4 position : SV_Position;
+    float2 texcoord : TEXCOORD0;
+};
+
+struct Fragment_Output
+{
+    float depth : SV_Depth;
+};
+
+Fragment_Output main(Fragment_Input fragment)
+{
+    Fragment_Output output;
+    output.depth = 1.0;
+    return output;
+}
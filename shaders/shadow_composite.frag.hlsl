@@ -0,0 +1,23 @@
+// Copies a cascade's cached static layer into its tile of the shadow atlas (see lights.h)
+// drawn as a fullscreen quad over the tile's viewport; depth is written as is (compare ALWAYS)
+
+Texture2D    shadow_cache         : register(t0, space2);
+SamplerState sampler_shadow_cache : register(s0, space2); // nearest; tile and cache are the same size
+
+struct Fragment_Input
+{
+    float4 position : SV_Position;
+    float2 texcoord : TEXCOORD0;
+};
+
+struct Fragment_Output
+{
+    float depth : SV_Depth;
+};
+
+Fragment_Output main(Fragment_Input fragment)
+{
+    Fragment_Output output;
+    output.depth = shadow_cache.SampleLevel(sampler_shadow_cache, fragment.texcoord, 0.0).r;
+    return output;
+}
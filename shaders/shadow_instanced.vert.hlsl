@@ -0,0 +1,45 @@
+#include "shaders/vertex.h"
+#include "shaders/transforms.h"
+
+// UBO_Shadow in render.h: the cascade being drawn
+cbuffer Shadow : register(b1, space1)
+{
+    float4x4 cascade_view_projection;
+};
+
+// Model_Instance in model.h; transforms.mvp, mv and model have M = identity, so the instance's model matrix is applied first
+struct Instance
+{
+    float4x4 model;
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+    float4x4 normal;
+#endif
+};
+
+// see the StructuredBuffer warning in pbr_animated.vert.hlsl
+StructuredBuffer<Instance> instance_buffer : register(t1, space0);
+
+struct Vertex_Input
+{
+    float4 position           : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent     : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
+    float2 texture_coordinate : TEXCOORD2;
+};
+
+struct Vertex_Output
+{
+    float4 position_clipspace : SV_Position;
+};
+
+Vertex_Output main(Vertex_Input vertex, uint instance_id : SV_InstanceID)
+{
+    Vertex_Output output;
+
+    Transforms transforms = transform_buffer[transform_index];
+
+    float4 position_modelspace = float4(Vertex_DecodePosition(vertex.position, transforms.position_offset, transforms.position_scale), 1.0f);
+    float4 position_worldspace = mul(instance_buffer[instance_id].model, position_modelspace);
+    output.position_clipspace = mul(cascade_view_projection, mul(transforms.model, position_worldspace));
+
+    return output;
+}
@@ -0,0 +1,23 @@
+// The cascade atlas's depth as exponential variance moments (see shadow_moments.h), one texel each;
+// Render_ShadowMoments blurs them afterwards with gaussian_blur
+#include "shaders/shadow_moments.h"
+
+Texture2D<float> shadow_map     : register(t0, space0);
+SamplerState     sampler_nearest: register(s0, space0);
+
+[[vk::image_format("rgba16f")]]
+RWTexture2D<float4> moments : register(u0, space1);
+
+[numthreads(8, 8, 1)]
+void main(uint3 gid : SV_DispatchThreadID)
+{
+    uint2 pix = gid.xy;
+
+    uint w, h;
+    moments.GetDimensions(w, h);
+
+    if (pix.x >= w || pix.y >= h) return;
+
+    float2 uv = (float2(pix) + 0.5) / float2(w, h);
+    moments[pix] = Shadow_EVSMMoments(shadow_map.SampleLevel(sampler_nearest, uv, 0));
+}
@@ -0,0 +1,39 @@
+// Exponential variance shadow maps (see lights.h): depth in [0, 1] is moved to [-1, 1] and warped into e^(c d) and
+// -e^(-c d); each warp is stored with its square, so a filtered sample holds their means and variances
+// the exponents are kept low enough for rgba16f: the largest stored value, e^(2c), has to stay under 65504, the largest half float
+#define SHADOW_EVSM_EXPONENT_POSITIVE 5.0f
+#define SHADOW_EVSM_EXPONENT_NEGATIVE 5.0f
+#define SHADOW_EVSM_VARIANCE_BIAS 0.0001f  // in depth units, scaled by each warp's slope into its least variance
+#define SHADOW_EVSM_BLEED_REDUCTION 0.25f  // visibility below it is cut to 0 and the rest stretched back over [0, 1]
+
+float2 Shadow_EVSMWarp(float depth)
+{
+    float d = depth * 2.0f - 1.0f;
+    return float2(exp(SHADOW_EVSM_EXPONENT_POSITIVE * d), -exp(-SHADOW_EVSM_EXPONENT_NEGATIVE * d));
+}
+
+float4 Shadow_EVSMMoments(float depth)
+{
+    float2 warped = Shadow_EVSMWarp(depth);
+    return float4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);
+}
+
+// upper bound of the share of the filter's texels that are no closer than depth (Chebyshev's inequality)
+float Shadow_Chebyshev(float2 moments, float depth, float min_variance)
+{
+    if (depth <= moments.x) return 1.0f;
+    float variance = max(moments.y - moments.x * moments.x, min_variance);
+    float d = depth - moments.x;
+    float p_max = variance / (variance + d * d);
+    return saturate((p_max - SHADOW_EVSM_BLEED_REDUCTION) / (1.0f - SHADOW_EVSM_BLEED_REDUCTION));
+}
+
+// moments: one filtered sample of Shadow_EVSMMoments; depth is the fragment's, bias already taken off
+float Shadow_EVSM(float4 moments, float depth)
+{
+    float2 warped = Shadow_EVSMWarp(depth);
+    float2 slope = float2(SHADOW_EVSM_EXPONENT_POSITIVE, SHADOW_EVSM_EXPONENT_NEGATIVE) * abs(warped) * 2.0f * SHADOW_EVSM_VARIANCE_BIAS;
+    float positive = Shadow_Chebyshev(moments.xy, warped.x, slope.x * slope.x);
+    float negative = Shadow_Chebyshev(moments.zw, warped.y, slope.y * slope.y);
+    return min(positive, negative);
+}
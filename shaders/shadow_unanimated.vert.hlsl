@@ -1,14 +1,17 @@
-cbuffer TransformUBO : register(b0, space1)
+#include "shaders/vertex.h"
+#include "shaders/transforms.h"
+
+// UBO_Shadow in render.h: the cascade being drawn
+cbuffer Shadow : register(b1, space1)
 {
-    float4x4 mvp_light;
+    float4x4 cascade_view_projection;
 };
 
 struct Vertex_Input
 {
-    float3 position           : TEXCOORD0;
-    float3 normal             : TEXCOORD1;
+    float4 position           : TEXCOORD0; // quantized; .w = handedness
+    float4 normal_tangent     : TEXCOORD1; // octahedral normal (xy) and tangent (zw)
     float2 texture_coordinate : TEXCOORD2;
-    float4 tangent            : TEXCOORD3; // .w = handedness
 };
 
 struct Vertex_Output
@@ -20,8 +23,10 @@ Vertex_Output main(Vertex_Input vertex)
 {
     Vertex_Output output;
 
-    float4 position_worldspace = float4(vertex.position, 1.0f);
-    output.position_clipspace = mul(mvp_light, position_worldspace);
+    Transforms transforms = transform_buffer[transform_index];
+
+    float4 position_worldspace = float4(Vertex_DecodePosition(vertex.position, transforms.position_offset, transforms.position_scale), 1.0f);
+    output.position_clipspace = mul(cascade_view_projection, mul(transforms.model, position_worldspace));
 
     return output;
 }
\ No newline at end of file
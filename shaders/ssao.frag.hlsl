@@ -12,6 +12,7 @@ cbuffer UBO_SSAO : register(b0, space3)
     float intensity;
     float power;
     uint kernel_size;
+    float2 uv_scale; // screen uv -> texture uv, for the drawn sub-rectangle
 }
 
 struct Fragment_Input
@@ -100,7 +101,7 @@ float2 projectToUV(float3 posVS, float2 projFocal)
 
 Fragment_Output main(Fragment_Input fragment)
 {
-    float4 gbuffer = texture_prepass.SampleLevel(sampler_prepass, fragment.texcoord, 0.0);
+    float4 gbuffer = texture_prepass.SampleLevel(sampler_prepass, fragment.texcoord * uv_scale, 0.0);
     float3 normal = normalize(gbuffer.rgb);
     float  depth_viewspace  = gbuffer.a;
 
@@ -152,7 +153,7 @@ Fragment_Output main(Fragment_Input fragment)
             continue;
 
         // Fetch view-space depth at the sample's screen position
-        float sampleDepthVS = texture_prepass.SampleLevel(sampler_prepass, sampleUV, 0.0).a;
+        float sampleDepthVS = texture_prepass.SampleLevel(sampler_prepass, sampleUV * uv_scale, 0.0).a;
 
         // If scene depth is closer than the sample position, it's occluded.
         // LH: larger z => farther. Occlusion if (scene depth) < (sample z - bias).
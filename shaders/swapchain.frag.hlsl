@@ -1,8 +1,11 @@
 #define SETTINGS_RENDER_ENABLE_BLOOM (1 << 7)
 
+// UBO_Swapchain_Frag in render.h
 cbuffer Settings_Uniform : register(b0, space3)
 {
     uint settings_render;
+    float _;
+    float2 uv_scale; // screen uv -> texture uv, for the drawn sub-rectangle
 };
 
 Texture2D    texture_hdr   : register(t0, space2);
@@ -48,12 +51,16 @@ float LinearizeDepth(float depth, float near, float far)
 float4 main(FragmentInput input): SV_Target0
 {
     float exposure = 1.0; // Adjust as needed
-    float4 hdr = texture_hdr.Sample(sampler_hdr, input.TexCoord);
+    // kept half a texel inside the drawn sub-rectangle, so filtering doesn't reach what is left over past it
+    float2 size;
+    texture_hdr.GetDimensions(size.x, size.y);
+    float2 uv = min(input.TexCoord * uv_scale, uv_scale - 0.5 / size);
+    float4 hdr = texture_hdr.Sample(sampler_hdr, uv);
     float alpha = hdr.a;
     float3 color = hdr.rgb * exposure;
     if (settings_render & SETTINGS_RENDER_ENABLE_BLOOM)
     {
-        float3 bloom = texture_bloom.Sample(sampler_bloom, input.TexCoord).rgb;
+        float3 bloom = texture_bloom.Sample(sampler_bloom, uv).rgb;
         color += bloom;
     }
 
@@ -0,0 +1,25 @@
+// Per-frame model transforms (Model_Transforms in model.h, filled by Render_UpdateTransforms)
+// every model draw pushes UBO_Draw and reads its transforms from the storage buffer at slot 0
+
+// Model_Transforms in model.h
+struct Transforms
+{
+    float4x4 mvp;
+    float4x4 mv;
+    float4x4 model; // M; the shadow passes apply the view projection of the cascade they draw (see lights.h)
+    float4 position_offset; // see Vertex_DecodePosition
+    float4 position_scale;
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+    float4x4 mv_inverse_transpose; // upper-left 3x3 = inverse-transpose of (V*M).xyz
+#endif
+};
+
+// UBO_Draw in render.h
+cbuffer Draw : register(b0, space1)
+{
+    uint transform_index;
+    uint base_joint_offset_bytes; // bone animated only; offset into the joint matrix storage buffer
+};
+
+// see the StructuredBuffer warning in pbr_animated.vert.hlsl
+StructuredBuffer<Transforms> transform_buffer : register(t0, space0);
@@ -0,0 +1,23 @@
+// Decoding of the quantized vertex layouts (Vertex_PBR_Quantized, Vertex_BoneAnimated_Quantized in model.h)
+
+// xyz arrive as unorm16 in [0, 1] across the mesh AABB (or as floats with offset 0 and scale 1)
+float3 Vertex_DecodePosition(float4 position, float4 position_offset, float4 position_scale)
+{
+    return position.xyz * position_scale.xyz + position_offset.xyz;
+}
+
+// w is 0 or 1
+float Vertex_DecodeBitangentSign(float4 position)
+{
+    return position.w * 2.0f - 1.0f;
+}
+
+// inverse of Model_EncodeOctahedral
+float3 Vertex_DecodeOctahedral(float2 encoded)
+{
+    float3 direction = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = saturate(-direction.z);
+    direction.x += direction.x >= 0.0f ? -fold : fold;
+    direction.y += direction.y >= 0.0f ? -fold : fold;
+    return normalize(direction);
+}
@@ -0,0 +1,100 @@
+#include "clusters.h"
+#include "globals.h"
+#include "gpumemory.h"
+
+// UBO_Clusters in cluster_lights.comp.hlsl
+Struct (UBO_Clusters)
+{
+    mat4 view_matrix;   // the lights are in world space
+    float projection_x; // projection_matrix[0][0]: view space x / z -> ndc x
+    float projection_y; // projection_matrix[1][1]
+    float near_plane;
+    float far_plane;
+    Uint32 point_count;
+    Uint32 spot_count;
+    Uint32 _padding[2];
+};
+
+static SDL_GPUBuffer* cluster_buffer = NULL; // CLUSTER_COUNT runs of CLUSTER_STRIDE Uint32s
+
+void Clusters_Quit(void)
+{
+    GPUMemory_ReleaseBuffer(cluster_buffer);
+    cluster_buffer = NULL;
+}
+
+SDL_GPUBuffer* Clusters_GetBuffer(void)
+{
+    return cluster_buffer;
+}
+
+// slice = log(view depth) * depth_scale + depth_bias; slice k starts at near * (far / near)^(k / CLUSTER_GRID_Z)
+void Clusters_GetDepthSlicing(const Camera* camera, float* depth_scale, float* depth_bias)
+{
+    float log_depth_range = SDL_logf(camera->far_plane / camera->near_plane);
+    *depth_scale = (float)CLUSTER_GRID_Z / log_depth_range;
+    *depth_bias = -(float)CLUSTER_GRID_Z * SDL_logf(camera->near_plane) / log_depth_range;
+}
+
+// Bins this frame's lights into the clusters of the camera (see clusters.h)
+bool Clusters_Update(SDL_GPUCommandBuffer* command_buffer, const Camera* camera)
+{
+    if (cluster_buffer == NULL)
+    {
+        cluster_buffer = GPUMemory_CreateBuffer
+        (
+            GPUMEMORY_CATEGORY_BUFFER,
+            "light clusters",
+            &(SDL_GPUBufferCreateInfo)
+            {
+                .usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE | SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+                .size = CLUSTER_COUNT * CLUSTER_STRIDE * sizeof(Uint32)
+            }
+        );
+        if (cluster_buffer == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create light cluster buffer: %s", SDL_GetError());
+            return false;
+        }
+    }
+
+    SDL_GPUComputePass* cluster_pass = SDL_BeginGPUComputePass
+    (
+        command_buffer,
+        NULL,
+        0,
+        (SDL_GPUStorageBufferReadWriteBinding[])
+        {{
+            .buffer = cluster_buffer,
+            .cycle = true // the previous frame's main pass may still be reading it
+        }},
+        1
+    );
+    if (!cluster_pass)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin light cluster pass: %s", SDL_GetError());
+        return false;
+    }
+    SDL_BindGPUComputePipeline(cluster_pass, pipeline_cluster_lights);
+    SDL_BindGPUComputeStorageBuffers
+    (
+        cluster_pass,
+        0, // first slot
+        (SDL_GPUBuffer*[]){ lights_point_storage_buffer, lights_storage_buffer },
+        2 // num_bindings
+    );
+    UBO_Clusters ubo_clusters =
+    {
+        .projection_x = camera->projection_matrix[0][0],
+        .projection_y = camera->projection_matrix[1][1],
+        .near_plane = camera->near_plane,
+        .far_plane = camera->far_plane,
+        .point_count = (Uint32)SDL_min(Array_Len(lights_point), MAX_POINT_LIGHTS),
+        .spot_count = (Uint32)SDL_min(Array_Len(lights_spot), MAX_SPOT_LIGHTS),
+    };
+    glm_mat4_copy((vec4*)camera->view_matrix, ubo_clusters.view_matrix);
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &ubo_clusters, sizeof(ubo_clusters));
+    SDL_DispatchGPUCompute(cluster_pass, 1, 1, CLUSTER_GRID_Z); // a group per slice, a thread per tile
+    SDL_EndGPUComputePass(cluster_pass);
+    return true;
+}
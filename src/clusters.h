@@ -0,0 +1,34 @@
+#ifndef CLUSTERS_H
+#define CLUSTERS_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "camera.h"
+
+/*
+    Clustered light culling
+    the view frustum is split into CLUSTER_GRID_X by CLUSTER_GRID_Y tiles of the screen and CLUSTER_GRID_Z slices of
+    view depth, spaced exponentially from the near to the far plane so a cluster is about as deep as it is wide
+    a compute pass (cluster_lights.comp) tests every point and spot light against the bounds of every cluster and writes
+    each cluster's light list; the PBR fragment shader only shades the lights in the list of the cluster it is in
+    a light reaches as far as its attenuation takes it to 1/256, so a light without attenuation is in every cluster
+    a cluster holds at most CLUSTER_MAX_LIGHTS; past that, lights are left out (point lights are listed first)
+    after the lights are uploaded (Lights_Upload), before the main pass
+    the grid is repeated in shaders/clusters.h
+    main thread only
+*/
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define CLUSTER_MAX_LIGHTS 127
+#define CLUSTER_STRIDE (CLUSTER_MAX_LIGHTS + 1) // Uint32s per cluster: the counts, then the light indices
+
+bool Clusters_Update(SDL_GPUCommandBuffer* command_buffer, const Camera* camera);
+void Clusters_GetDepthSlicing(const Camera* camera, float* depth_scale, float* depth_bias);
+SDL_GPUBuffer* Clusters_GetBuffer(void);
+void Clusters_Quit(void);
+
+#endif // CLUSTERS_H
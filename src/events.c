@@ -2,6 +2,12 @@
 #include "globals.h"
 #include "audio.h"
 #include "camera.h"
+#include "loader.h"
+#include "hotreload.h"
+#include "streamer.h"
+#include "gpumemory.h"
+#include "materialpool.h"
+#include "render.h"
 
 
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
@@ -74,7 +80,7 @@ bool HandleEvent_InputState_DEBUG(SDL_Event* event)
                 } break;
                 case SDL_SCANCODE_R:
                 {
-                    SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Event: request to reload assets and reinitialize renderer");
+                    SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Event: request to reinitialize renderer");
                     renderer_needs_to_be_reinitialized = true;
                 } break;
                 case SDL_SCANCODE_TAB:
@@ -98,6 +104,7 @@ bool HandleEvent_InputState_DEBUG(SDL_Event* event)
                 case SDL_SCANCODE_5: Bit_Toggle(settings_render, SETTINGS_RENDER_ENABLE_FOG);   break;
                 case SDL_SCANCODE_6: Bit_Toggle(settings_render, SETTINGS_RENDER_UPSCALE_SSAO); break;
                 case SDL_SCANCODE_7: Bit_Toggle(settings_render, SETTINGS_RENDER_ENABLE_BLOOM); break;
+                case SDL_SCANCODE_M: GPUMemory_LogReport(); break;
                 default: break;
             }
         } break;
@@ -145,7 +152,7 @@ bool HandleEvent_InputState_FIRSTPERSONCONTROLLER(SDL_Event* event)
                 } break;
                 case SDL_SCANCODE_R:
                 {
-                    SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Event: request to reload assets and reinitialize renderer");
+                    SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Event: request to reinitialize renderer");
                     renderer_needs_to_be_reinitialized = true;
                 } break;
                 case SDL_SCANCODE_TAB:
@@ -169,6 +176,7 @@ bool HandleEvent_InputState_FIRSTPERSONCONTROLLER(SDL_Event* event)
                 case SDL_SCANCODE_5: Bit_Toggle(settings_render, SETTINGS_RENDER_ENABLE_FOG);   break;
                 case SDL_SCANCODE_6: Bit_Toggle(settings_render, SETTINGS_RENDER_UPSCALE_SSAO); break;
                 case SDL_SCANCODE_7: Bit_Toggle(settings_render, SETTINGS_RENDER_ENABLE_BLOOM); break;
+                case SDL_SCANCODE_M: GPUMemory_LogReport(); break;
                 case SDL_SCANCODE_SPACE:
                 {
                     // Player_Print(&player);
@@ -190,23 +198,56 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
     TTF_CloseFont(font);
     TTF_Quit();
     
+    Loader_Quit(); // joins the workers before anything they might still reference goes away
+    Occlusion_Quit();
     SDL_WaitForGPUIdle(gpu_device); // Wait for GPU to finish all commands
-    if (text_transfer_buffer) SDL_ReleaseGPUTransferBuffer(gpu_device, text_transfer_buffer);
+
+    // before the streamer and hot reload go away, since freeing a material unregisters its textures from both
+    if (models_unanimated)
+    {
+        for (size_t i = 0; i < Array_Len(models_unanimated); i++) Model_Free(&models_unanimated[i]);
+        Array_Len(models_unanimated) = 0;
+    }
+    if (models_instanced)
+    {
+        for (size_t i = 0; i < Array_Len(models_instanced); i++) Model_Free(&models_instanced[i]);
+        Array_Len(models_instanced) = 0;
+    }
+    if (models_bone_animated)
+    {
+        for (size_t i = 0; i < Array_Len(models_bone_animated); i++) Model_BoneAnimated_Free(&models_bone_animated[i]);
+        Array_Len(models_bone_animated) = 0;
+    }
+    HotReload_Quit();
+    Streamer_Quit();
+    MaterialPool_Quit(); // after every material is freed
+
+    if (sprites)
+    {
+        for (size_t i = 0; i < Array_Len(sprites); i++) GPUMemory_ReleaseTexture(sprites[i].texture);
+        Array_Len(sprites) = 0;
+    }
+    GPUMemory_ReleaseBuffer(text_renderable.vertex_buffer);
+    GPUMemory_ReleaseBuffer(text_renderable.index_buffer);
+    if (text_transfer_buffer) GPUMemory_ReleaseTransferBuffer(text_transfer_buffer);
+    GPUMemory_ReleaseBuffer(joint_matrix_storage_buffer);
+    GPUMemory_ReleaseTransferBuffer(joint_matrix_transfer_buffer);
+    GPUMemory_ReleaseBuffer(lights_storage_buffer);
+    GPUMemory_ReleaseTransferBuffer(lights_transfer_buffer);
+    GPUMemory_ReleaseBuffer(lights_point_storage_buffer);
+    GPUMemory_ReleaseTransferBuffer(lights_point_transfer_buffer);
+    Render_Quit();
+    GPUMemory_Quit(); // reports whatever is left as a leak
+
     if (pipeline_unanimated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
     if (pipeline_bone_animated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_bone_animated);
     // if (pipeline_rigid_animated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_rigid_animated);
-    // if (pipeline_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_instanced);
-    if (msaa_texture) SDL_ReleaseGPUTexture(gpu_device, msaa_texture);
-    if (depth_texture) SDL_ReleaseGPUTexture(gpu_device, depth_texture);
-    // if (models_unanimated) 
-    // {
-    //     for (Uint32 i = 0; i < models_unanimated.len; i++)
-    //     {
-    //         Model_Free(models_unanimated + i);
-    //     }
-    //     SDL_free(models_unanimated);
-    //     SDL_memset(&models_unanimated, 0, sizeof(Array_Model));
-    // }
+    if (pipeline_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_instanced);
+    if (pipeline_prepass_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_prepass_instanced);
+    if (pipeline_shadow_depth_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_depth_instanced);
+    if (pipeline_shadow_depth_bone_animated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_depth_bone_animated);
+    if (pipeline_shadow_composite) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_composite);
+    if (pipeline_shadow_clear) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_clear);
     if (sampler_albedo) SDL_ReleaseGPUSampler(gpu_device, sampler_albedo);
     if (window && gpu_device) SDL_ReleaseWindowFromGPUDevice(gpu_device, window);
     if (gpu_device) SDL_DestroyGPUDevice(gpu_device);
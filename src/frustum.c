@@ -0,0 +1,132 @@
+#include "frustum.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Gribb-Hartmann plane extraction for clip space depth 0..1; works for perspective and orthographic matrices
+// without the near plane the frustum reaches all the way back to the eye (or, for orthographic, without end),
+// which is what shadow casters need: anything between the light and its near plane still casts onto what is inside
+void Frustum_FromMatrix(mat4 view_projection, bool include_near_plane, Frustum* frustum)
+{
+    vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i][0] = view_projection[0][i];
+        rows[i][1] = view_projection[1][i];
+        rows[i][2] = view_projection[2][i];
+        rows[i][3] = view_projection[3][i];
+    }
+
+    vec4 planes[6];
+    glm_vec4_add(rows[3], rows[0], planes[0]); // left
+    glm_vec4_sub(rows[3], rows[0], planes[1]); // right
+    glm_vec4_add(rows[3], rows[1], planes[2]); // bottom
+    glm_vec4_sub(rows[3], rows[1], planes[3]); // top
+    glm_vec4_copy(rows[2], planes[4]);         // near (z >= 0)
+    glm_vec4_sub(rows[3], rows[2], planes[5]); // far
+
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+    {
+        if (i >= 6 || (i == 4 && !include_near_plane))
+        {
+            // padding; 0 * x + 1 is never negative
+            frustum->normal_x[i] = frustum->normal_y[i] = frustum->normal_z[i] = 0.0f;
+            frustum->distance[i] = 1.0f;
+            continue;
+        }
+        float length = glm_vec3_norm(planes[i]);
+        float inverse_length = length > 0.0f ? 1.0f / length : 0.0f;
+        frustum->normal_x[i] = planes[i][0] * inverse_length;
+        frustum->normal_y[i] = planes[i][1] * inverse_length;
+        frustum->normal_z[i] = planes[i][2] * inverse_length;
+        frustum->distance[i] = length > 0.0f ? planes[i][3] * inverse_length : 1.0f;
+    }
+}
+
+// Conservative: a box that straddles two planes outside a corner of the frustum still counts as intersecting
+// a box is outside a plane when its center is further behind it than the box's extent along the normal
+bool Frustum_IntersectsAABB(const Frustum* frustum, const vec3 aabb_min, const vec3 aabb_max)
+{
+    float center[3], extent[3];
+    for (int i = 0; i < 3; i++)
+    {
+        center[i] = (aabb_min[i] + aabb_max[i]) * 0.5f;
+        extent[i] = (aabb_max[i] - aabb_min[i]) * 0.5f;
+    }
+
+#if defined(__SSE2__)
+    __m128 center_x = _mm_set1_ps(center[0]);
+    __m128 center_y = _mm_set1_ps(center[1]);
+    __m128 center_z = _mm_set1_ps(center[2]);
+    __m128 extent_x = _mm_set1_ps(extent[0]);
+    __m128 extent_y = _mm_set1_ps(extent[1]);
+    __m128 extent_z = _mm_set1_ps(extent[2]);
+    __m128 sign_mask = _mm_set1_ps(-0.0f);
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i += 4)
+    {
+        __m128 normal_x = _mm_loadu_ps(frustum->normal_x + i);
+        __m128 normal_y = _mm_loadu_ps(frustum->normal_y + i);
+        __m128 normal_z = _mm_loadu_ps(frustum->normal_z + i);
+        __m128 distance = _mm_loadu_ps(frustum->distance + i);
+        __m128 center_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal_x, center_x), _mm_mul_ps(normal_y, center_y)), _mm_add_ps(_mm_mul_ps(normal_z, center_z), distance));
+        __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, normal_x), extent_x), _mm_mul_ps(_mm_andnot_ps(sign_mask, normal_y), extent_y)), _mm_mul_ps(_mm_andnot_ps(sign_mask, normal_z), extent_z));
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(center_distance, radius), _mm_setzero_ps()))) return false;
+    }
+    return true;
+#elif defined(__ARM_NEON)
+    float32x4_t center_x = vdupq_n_f32(center[0]);
+    float32x4_t center_y = vdupq_n_f32(center[1]);
+    float32x4_t center_z = vdupq_n_f32(center[2]);
+    float32x4_t extent_x = vdupq_n_f32(extent[0]);
+    float32x4_t extent_y = vdupq_n_f32(extent[1]);
+    float32x4_t extent_z = vdupq_n_f32(extent[2]);
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i += 4)
+    {
+        float32x4_t normal_x = vld1q_f32(frustum->normal_x + i);
+        float32x4_t normal_y = vld1q_f32(frustum->normal_y + i);
+        float32x4_t normal_z = vld1q_f32(frustum->normal_z + i);
+        float32x4_t signed_distance = vld1q_f32(frustum->distance + i);
+        signed_distance = vmlaq_f32(signed_distance, normal_x, center_x);
+        signed_distance = vmlaq_f32(signed_distance, normal_y, center_y);
+        signed_distance = vmlaq_f32(signed_distance, normal_z, center_z);
+        signed_distance = vmlaq_f32(signed_distance, vabsq_f32(normal_x), extent_x);
+        signed_distance = vmlaq_f32(signed_distance, vabsq_f32(normal_y), extent_y);
+        signed_distance = vmlaq_f32(signed_distance, vabsq_f32(normal_z), extent_z);
+        uint32x4_t outside = vcltq_f32(signed_distance, vdupq_n_f32(0.0f));
+        uint32x2_t outside_pairs = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+        if (vget_lane_u32(vpmax_u32(outside_pairs, outside_pairs), 0)) return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+    {
+        float center_distance = frustum->normal_x[i] * center[0] + frustum->normal_y[i] * center[1] + frustum->normal_z[i] * center[2] + frustum->distance[i];
+        float radius = SDL_fabsf(frustum->normal_x[i]) * extent[0] + SDL_fabsf(frustum->normal_y[i]) * extent[1] + SDL_fabsf(frustum->normal_z[i]) * extent[2];
+        if (center_distance + radius < 0.0f) return false;
+    }
+    return true;
+#endif
+}
+
+// Bounds of a transformed box (Arvo): the center is transformed, the extent by the absolute upper 3x3
+void Frustum_TransformAABB(mat4 matrix, const vec3 aabb_min, const vec3 aabb_max, vec3 out_min, vec3 out_max)
+{
+    vec3 center, extent;
+    for (int i = 0; i < 3; i++)
+    {
+        center[i] = (aabb_min[i] + aabb_max[i]) * 0.5f;
+        extent[i] = (aabb_max[i] - aabb_min[i]) * 0.5f;
+    }
+
+    vec3 world_center;
+    glm_mat4_mulv3(matrix, center, 1.0f, world_center);
+    for (int i = 0; i < 3; i++)
+    {
+        float world_extent = SDL_fabsf(matrix[0][i]) * extent[0] + SDL_fabsf(matrix[1][i]) * extent[1] + SDL_fabsf(matrix[2][i]) * extent[2];
+        out_min[i] = world_center[i] - world_extent;
+        out_max[i] = world_center[i] + world_extent;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+
+#define CGLM_FORCE_DEPTH_ZERO_TO_ONE
+#define CGLM_FORCE_LEFT_HANDED
+#include "../external/cglm/cglm.h"
+
+// View frustum planes (normals point inward), stored plane-wise so four planes are tested in one SIMD step
+// there are 6 planes plus 2 padding planes that pass everything (3 without a near plane)
+#define FRUSTUM_PLANE_COUNT 8
+
+Struct (Frustum)
+{
+    float normal_x[FRUSTUM_PLANE_COUNT];
+    float normal_y[FRUSTUM_PLANE_COUNT];
+    float normal_z[FRUSTUM_PLANE_COUNT];
+    float distance[FRUSTUM_PLANE_COUNT];
+};
+
+void Frustum_FromMatrix(mat4 view_projection, bool include_near_plane, Frustum* frustum);
+bool Frustum_IntersectsAABB(const Frustum* frustum, const vec3 aabb_min, const vec3 aabb_max);
+void Frustum_TransformAABB(mat4 matrix, const vec3 aabb_min, const vec3 aabb_max, vec3 out_min, vec3 out_max);
+
+#endif // FRUSTUM_H
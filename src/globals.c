@@ -51,14 +51,18 @@ bool mouse_invertY = false;
 Player player = {0};
 
 Collider Array colliders = NULL;
+Occluder Array occluders = NULL;
 Trigger Array triggers = NULL;
 
 Model Array models_unanimated = NULL;
+Model Array models_instanced = NULL;
 Model_BoneAnimated Array models_bone_animated = NULL;
+Material material_loading = {0};
 
 Light_Directional light_directional = {0};
 Light_Hemisphere light_hemisphere = {0};
 Light_Spot Array lights_spot = NULL;
+Light_Point Array lights_point = NULL;
 
 Sprite Array sprites = NULL;
 
@@ -75,6 +79,7 @@ SDL_GPUPresentMode swapchain_present_mode = SDL_GPU_PRESENTMODE_VSYNC;
 double minimum_frame_time = 1.0 / 60.0;
 SDL_GPUSampleCount msaa_level = SDL_GPU_SAMPLECOUNT_1;
 Uint32 n_mipmap_levels = 6;
+Uint64 gpu_memory_budget_bytes = 1024ull * 1024 * 1024;
 SDL_GPUDevice* gpu_device = NULL;
 
 SDL_GPUGraphicsPipeline* pipeline_prepass_unanimated = NULL;
@@ -82,7 +87,8 @@ SDL_GPUGraphicsPipeline* pipeline_ssao = NULL;
 SDL_GPUGraphicsPipeline* pipeline_unanimated = NULL;
 SDL_GPUGraphicsPipeline* pipeline_bone_animated = NULL;
 // SDL_GPUGraphicsPipeline* pipeline_rigid_animated = NULL;
-// SDL_GPUGraphicsPipeline* pipeline_instanced = NULL;
+SDL_GPUGraphicsPipeline* pipeline_prepass_instanced = NULL;
+SDL_GPUGraphicsPipeline* pipeline_instanced = NULL;
 SDL_GPUGraphicsPipeline* pipeline_text = NULL;
 SDL_GPUGraphicsPipeline* pipeline_swapchain = NULL;
 SDL_GPUGraphicsPipeline* pipeline_sprite = NULL;
@@ -94,6 +100,10 @@ SDL_GPUComputePipeline* pipeline_bloom_threshold = NULL;
 SDL_GPUComputePipeline* pipeline_bloom_downsample = NULL;
 SDL_GPUComputePipeline* pipeline_bloom_upsample = NULL;
 SDL_GPUComputePipeline* pipeline_gaussian_blur = NULL;
+SDL_GPUComputePipeline* pipeline_cull = NULL;
+SDL_GPUComputePipeline* pipeline_cluster_lights = NULL;
+SDL_GPUComputePipeline* pipeline_shadow_moments = NULL;
+SDL_GPUComputePipeline* pipeline_hiz_build = NULL;
 
 SDL_GPUTexture* prepass_texture = NULL;
 SDL_GPUTexture* prepass_texture_half = NULL;
@@ -113,25 +123,44 @@ SDL_GPUTexture* msaa_texture = NULL;
 SDL_GPUTexture* virtual_screen_texture = NULL;
 Uint32 virtual_screen_texture_width = 0;
 Uint32 virtual_screen_texture_height = 360;
+float render_scale = 1.0f;
+Uint32 render_width = 0, render_height = 0;
+float dynamic_resolution_min_scale = 0.5f;
+double dynamic_resolution_target_frame_time = 1.0 / 60.0;
 SDL_GPUSampler* sampler_albedo = NULL;
 
 SDL_GPUBuffer* joint_matrix_storage_buffer = NULL;
 SDL_GPUTransferBuffer* joint_matrix_transfer_buffer = NULL;
 SDL_GPUBuffer* lights_storage_buffer = NULL;
 SDL_GPUTransferBuffer* lights_transfer_buffer = NULL;
+SDL_GPUBuffer* lights_point_storage_buffer = NULL;
+SDL_GPUTransferBuffer* lights_point_transfer_buffer = NULL;
 
 SDL_GPUTexture* shadow_map_texture = NULL;
+SDL_GPUTexture* shadow_cache_textures[SHADOW_CASCADE_COUNT] = {0};
+SDL_GPUTexture* spot_shadow_atlas_texture = NULL;
+SDL_GPUTexture* shadow_moments_textures[2] = {0};
 SDL_GPUSampler* sampler_nearest_nomips = NULL;
 SDL_GPUSampler* sampler_linear_nomips = NULL;
+SDL_GPUSampler* sampler_nearest_mips = NULL;
 SDL_GPUGraphicsPipeline* pipeline_shadow_depth = NULL;
+SDL_GPUGraphicsPipeline* pipeline_shadow_depth_instanced = NULL;
+SDL_GPUGraphicsPipeline* pipeline_shadow_depth_bone_animated = NULL;
+SDL_GPUGraphicsPipeline* pipeline_shadow_composite = NULL;
+SDL_GPUGraphicsPipeline* pipeline_shadow_clear = NULL;
 SDL_GPUTextureFormat depth_sample_texture_format = SDL_GPU_TEXTUREFORMAT_INVALID;
 Uint32 SHADOW_MAP_SIZE = 1024;
-float SHADOW_ORTHO_HALF_WIDTH = 30.0f;
-float SHADOW_NEAR = 0.1f;
-float SHADOW_FAR  = 150.0f;
-float SHADOW_BIAS = 0.00002f;
+float SHADOW_DISTANCE = 80.0f;
+float SHADOW_CASCADE_SPLIT_LAMBDA = 0.75f;
+float SHADOW_CASCADE_CACHE_MARGIN = 0.25f;
+float SHADOW_CASTER_DISTANCE = 50.0f;
+float SHADOW_BIAS = 0.003f;
 float SHADOW_PCF_RADIUS = 1.5f; // in texels
+float SHADOW_MOMENTS_BLUR_STRIDE = 1.0f;
 mat4 light_view_matrix = {0};
 mat4 light_proj_matrix = {0};
 mat4 light_viewproj_matrix = {0};
-Shadow_Settings shadow_settings = {0};
\ No newline at end of file
+Shadow_Settings shadow_settings = {0};
+Shadow_Cascade shadow_cascades[SHADOW_CASCADE_COUNT] = {0};
+Uint32 static_geometry_generation = 0;
+Spot_Shadow spot_shadows[MAX_SPOT_LIGHTS] = {0};
\ No newline at end of file
@@ -27,6 +27,9 @@ Enum (Uint32, Settings_Render)
     SETTINGS_RENDER_ENABLE_FOG              = 1 << 5,
     SETTINGS_RENDER_UPSCALE_SSAO            = 1 << 6,
     SETTINGS_RENDER_ENABLE_BLOOM            = 1 << 7,
+    SETTINGS_RENDER_CPU_OCCLUSION_CULLING   = 1 << 8,
+    SETTINGS_RENDER_FILTERED_SHADOWS        = 1 << 9, // EVSM for the cascades instead of PCF; set from settings.txt
+    SETTINGS_RENDER_DYNAMIC_RESOLUTION      = 1 << 10, // render_scale follows the frame time
 };
 
 extern Settings_Render settings_render;
@@ -65,14 +68,18 @@ extern bool mouse_invertY;
 extern Player player;
 
 extern Collider Array colliders;
+extern Occluder Array occluders;
 extern Trigger Array triggers;
 
 extern Model Array models_unanimated;
+extern Model Array models_instanced;
 extern Model_BoneAnimated Array models_bone_animated;
+extern Material material_loading; // drawn until a streamed mesh's textures are uploaded (see loader.c)
 
 extern Light_Directional light_directional;
 extern Light_Hemisphere light_hemisphere;
 extern Light_Spot Array lights_spot;
+extern Light_Point Array lights_point;
 
 extern Sprite Array sprites;
 
@@ -85,12 +92,14 @@ extern SDL_GPUTransferBuffer* text_transfer_buffer;
 
 // GPU
 #define MAX_TOTAL_JOINTS_TO_RENDER 99 // This determines the size of the joint matrix storage buffer
-#define MAX_TOTAL_LIGHTS 16
+#define MAX_SPOT_LIGHTS 256
+#define MAX_POINT_LIGHTS 256
 extern SDL_GPUSwapchainComposition swapchain_composition;
 extern SDL_GPUPresentMode swapchain_present_mode;
 extern double minimum_frame_time;
 extern SDL_GPUSampleCount msaa_level;
 extern Uint32 n_mipmap_levels;
+extern Uint64 gpu_memory_budget_bytes; // 0 disables the warning (see gpumemory.h)
 extern SDL_GPUDevice* gpu_device;
 
 extern SDL_GPUGraphicsPipeline* pipeline_prepass_unanimated;
@@ -98,7 +107,8 @@ extern SDL_GPUGraphicsPipeline* pipeline_ssao;
 extern SDL_GPUGraphicsPipeline* pipeline_unanimated;
 extern SDL_GPUGraphicsPipeline* pipeline_bone_animated;
 // extern SDL_GPUGraphicsPipeline* pipeline_rigid_animated;
-// extern SDL_GPUGraphicsPipeline* pipeline_instanced;
+extern SDL_GPUGraphicsPipeline* pipeline_prepass_instanced;
+extern SDL_GPUGraphicsPipeline* pipeline_instanced;
 extern SDL_GPUGraphicsPipeline* pipeline_swapchain;
 extern SDL_GPUGraphicsPipeline* pipeline_text;
 extern SDL_GPUGraphicsPipeline* pipeline_sprite;
@@ -110,6 +120,10 @@ extern SDL_GPUComputePipeline* pipeline_bloom_threshold;
 extern SDL_GPUComputePipeline* pipeline_bloom_downsample;
 extern SDL_GPUComputePipeline* pipeline_bloom_upsample;
 extern SDL_GPUComputePipeline* pipeline_gaussian_blur;
+extern SDL_GPUComputePipeline* pipeline_cull;
+extern SDL_GPUComputePipeline* pipeline_hiz_build;
+extern SDL_GPUComputePipeline* pipeline_cluster_lights;
+extern SDL_GPUComputePipeline* pipeline_shadow_moments;
 
 extern SDL_GPUTexture* prepass_texture;
 extern SDL_GPUTexture* prepass_texture_half;
@@ -130,27 +144,46 @@ extern SDL_GPUTexture* msaa_texture;
 extern SDL_GPUTexture* virtual_screen_texture;
 extern Uint32 virtual_screen_texture_width;
 extern Uint32 virtual_screen_texture_height;
+extern float render_scale;                  // of the virtual screen's size that is drawn into (see Render_UpdateDynamicResolution)
+extern Uint32 render_width, render_height;  // this frame's sub-rectangle of the screen sized render targets, from the top left
+extern float dynamic_resolution_min_scale;
+extern double dynamic_resolution_target_frame_time;
 extern SDL_GPUSampler* sampler_albedo;
 
 extern SDL_GPUBuffer* joint_matrix_storage_buffer;
 extern SDL_GPUTransferBuffer* joint_matrix_transfer_buffer;
 extern SDL_GPUBuffer* lights_storage_buffer;
 extern SDL_GPUTransferBuffer* lights_transfer_buffer;
+extern SDL_GPUBuffer* lights_point_storage_buffer;
+extern SDL_GPUTransferBuffer* lights_point_transfer_buffer;
 
 extern SDL_GPUTexture* shadow_map_texture;
+extern SDL_GPUTexture* shadow_cache_textures[SHADOW_CASCADE_COUNT];
+extern SDL_GPUTexture* spot_shadow_atlas_texture;
+extern SDL_GPUTexture* shadow_moments_textures[2]; // only with SETTINGS_RENDER_FILTERED_SHADOWS; [0] is read, [1] is for the blur
 extern SDL_GPUSampler* sampler_nearest_nomips;
 extern SDL_GPUSampler* sampler_linear_nomips;
+extern SDL_GPUSampler* sampler_nearest_mips;
 extern SDL_GPUGraphicsPipeline* pipeline_shadow_depth;
+extern SDL_GPUGraphicsPipeline* pipeline_shadow_depth_instanced;
+extern SDL_GPUGraphicsPipeline* pipeline_shadow_depth_bone_animated;
+extern SDL_GPUGraphicsPipeline* pipeline_shadow_composite;
+extern SDL_GPUGraphicsPipeline* pipeline_shadow_clear;
 extern SDL_GPUTextureFormat depth_sample_texture_format;
-extern Uint32 SHADOW_MAP_SIZE;
-extern float SHADOW_ORTHO_HALF_WIDTH;       // covers +-30m around focus
-extern float SHADOW_NEAR;
-extern float SHADOW_FAR;
-extern float SHADOW_BIAS;           // constant bias in depth compare space
+extern Uint32 SHADOW_MAP_SIZE;                // of one cascade
+extern float SHADOW_DISTANCE;                 // from the camera, where the last cascade ends
+extern float SHADOW_CASCADE_SPLIT_LAMBDA;     // 0 = uniform splits, 1 = logarithmic
+extern float SHADOW_CASCADE_CACHE_MARGIN;     // how much larger cached cascades are than their slice
+extern float SHADOW_CASTER_DISTANCE;          // how far towards the light casters are caught
+extern float SHADOW_BIAS;           // constant bias in world units
 extern float SHADOW_PCF_RADIUS;        // in texels
+extern float SHADOW_MOMENTS_BLUR_STRIDE; // in texels between the blur's taps; it reaches 4 strides
 extern mat4 light_view_matrix;
 extern mat4 light_proj_matrix;
 extern mat4 light_viewproj_matrix;
 extern Shadow_Settings shadow_settings;
+extern Shadow_Cascade shadow_cascades[SHADOW_CASCADE_COUNT];
+extern Uint32 static_geometry_generation; // bumped whenever an unanimated or instanced model is added or removed
+extern Spot_Shadow spot_shadows[MAX_SPOT_LIGHTS]; // one per lights_spot entry
 
 #endif // GLOBALS_H
\ No newline at end of file
@@ -0,0 +1,491 @@
+#include "gpucull.h"
+#include "globals.h"
+#include "gpumemory.h"
+#include "frustum.h"
+
+#define GPUCULL_PYRAMID_FORMAT SDL_GPU_TEXTUREFORMAT_R32G32_FLOAT // min, max view space depth
+
+// Cull_Record in cull.comp.hlsl
+Struct (GPUCull_Record)
+{
+    vec3 aabb_min;      // world space
+    Uint32 first_index; // of the LOD Model_SelectLODs picked
+    vec3 aabb_max;
+    Uint32 index_count;
+};
+
+// UBO_Cull in cull.comp.hlsl
+Struct (UBO_Cull)
+{
+    mat4 occlusion_view;            // the camera the pyramid was drawn from
+    mat4 occlusion_view_projection;
+    vec4 planes_camera[6];          // xyz = inward normal, w = distance
+    vec4 planes_shadow[SHADOW_CASCADE_COUNT * 6]; // six per cascade, no near plane (see Frustum_FromMatrix)
+    Uint32 record_count;
+    Uint32 phase;                   // 0: GPUCull_Update, 1: GPUCull_UpdateOcclusion
+    Uint32 occlusion;               // 0 when there is no pyramid to test against
+    Uint32 pyramid_level_count;
+    Uint32 screen_width;            // of the part of the prepass the pyramid was built from (render_width)
+    Uint32 screen_height;
+    Uint32 _padding[2];
+};
+
+// UBO_HiZ in hiz_build.comp.hlsl
+Struct (UBO_HiZ)
+{
+    Uint32 from_prepass; // level 0 reads the prepass, the others the level above
+    Uint32 _padding[3];
+};
+
+static SDL_GPUBuffer* gpucull_record_buffer = NULL;
+static SDL_GPUBuffer* gpucull_command_buffer = NULL; // GPUCULL_VIEW_COUNT runs of record_count commands, in GPUCull_View order
+static SDL_GPUTransferBuffer* gpucull_transfer_buffer = NULL;
+static Uint32 gpucull_capacity = 0;
+static Uint32 gpucull_record_count = 0; // this frame's
+
+// the cull shader samples the pyramid's mip chain; each level is built in its own storage texture and copied in,
+// since a level can't be written while the one above it is read from the same texture
+static SDL_GPUTexture* gpucull_pyramid = NULL;
+static SDL_GPUTexture* gpucull_pyramid_levels[GPUCULL_PYRAMID_MAX_LEVELS] = {0}; // NULL if the format can't be a storage texture
+static Uint32 gpucull_pyramid_width = 0;  // level 0
+static Uint32 gpucull_pyramid_height = 0;
+static Uint32 gpucull_pyramid_level_count = 0;
+static Uint32 gpucull_screen_width = 0;   // the prepass size the pyramid is made for
+static Uint32 gpucull_screen_height = 0;
+static bool gpucull_pyramid_valid = false; // holds the previous frame's depth
+static Uint32 gpucull_pyramid_render_width = 0; // the part of the prepass that was drawn into; the rest is far
+static Uint32 gpucull_pyramid_render_height = 0;
+static mat4 gpucull_pyramid_view;           // the camera it was drawn from
+static mat4 gpucull_pyramid_view_projection;
+
+static mat4 gpucull_view;                 // this frame's camera, for GPUCull_UpdateOcclusion
+static mat4 gpucull_view_projection;
+static bool gpucull_prepass_occlusion = false; // the prepass commands were tested against the previous pyramid
+
+static void GPUCull_ReleasePyramid(void)
+{
+    GPUMemory_ReleaseTexture(gpucull_pyramid);
+    gpucull_pyramid = NULL;
+    for (int i = 0; i < GPUCULL_PYRAMID_MAX_LEVELS; i++)
+    {
+        GPUMemory_ReleaseTexture(gpucull_pyramid_levels[i]);
+        gpucull_pyramid_levels[i] = NULL;
+    }
+    gpucull_pyramid_width = gpucull_pyramid_height = gpucull_pyramid_level_count = 0;
+    gpucull_screen_width = gpucull_screen_height = 0;
+    gpucull_pyramid_render_width = gpucull_pyramid_render_height = 0;
+    gpucull_pyramid_valid = false;
+}
+
+static void GPUCull_ReleaseBuffers(void)
+{
+    GPUMemory_ReleaseBuffer(gpucull_record_buffer);
+    GPUMemory_ReleaseBuffer(gpucull_command_buffer);
+    GPUMemory_ReleaseTransferBuffer(gpucull_transfer_buffer);
+    gpucull_record_buffer = NULL;
+    gpucull_command_buffer = NULL;
+    gpucull_transfer_buffer = NULL;
+    gpucull_capacity = 0;
+    gpucull_record_count = 0;
+}
+
+void GPUCull_Quit(void)
+{
+    GPUCull_ReleaseBuffers();
+    GPUCull_ReleasePyramid();
+}
+
+// grows the buffers to hold at least count records; the old contents are not kept
+static bool GPUCull_Reserve(Uint32 count)
+{
+    if (count <= gpucull_capacity) return true;
+
+    Uint32 capacity = SDL_max(count, SDL_max(gpucull_capacity * 2, 1024u));
+    GPUCull_ReleaseBuffers();
+
+    gpucull_record_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_BUFFER,
+        "cull records",
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+            .size = capacity * sizeof(GPUCull_Record)
+        }
+    );
+    if (gpucull_record_buffer == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create cull record buffer: %s", SDL_GetError());
+        return false;
+    }
+
+    gpucull_command_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_BUFFER,
+        "cull indirect draws",
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+            .size = capacity * GPUCULL_VIEW_COUNT * sizeof(SDL_GPUIndexedIndirectDrawCommand)
+        }
+    );
+    if (gpucull_command_buffer == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create indirect draw buffer: %s", SDL_GetError());
+        return false;
+    }
+
+    gpucull_transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "cull records",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = capacity * sizeof(GPUCull_Record)
+        }
+    );
+    if (gpucull_transfer_buffer == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create cull record transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+
+    gpucull_capacity = capacity;
+    return true;
+}
+
+// (re)creates the pyramid for the current prepass size; a new one holds nothing to test against until it is built
+static bool GPUCull_ReservePyramid(void)
+{
+    if (gpucull_pyramid && gpucull_screen_width == virtual_screen_texture_width && gpucull_screen_height == virtual_screen_texture_height)
+    {
+        return true;
+    }
+    GPUCull_ReleasePyramid();
+
+    Uint32 width = SDL_max((virtual_screen_texture_width + 1) / 2, 1);
+    Uint32 height = SDL_max((virtual_screen_texture_height + 1) / 2, 1);
+    Uint32 level_count = 1;
+    while (level_count < GPUCULL_PYRAMID_MAX_LEVELS && SDL_max(width, height) >> level_count) level_count++;
+
+    gpucull_pyramid = GPUMemory_CreateTexture
+    (
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "hi-z pyramid",
+        &(SDL_GPUTextureCreateInfo)
+        {
+            .type = SDL_GPU_TEXTURETYPE_2D,
+            .format = GPUCULL_PYRAMID_FORMAT,
+            .width = width,
+            .height = height,
+            .layer_count_or_depth = 1,
+            .num_levels = level_count,
+            .sample_count = SDL_GPU_SAMPLECOUNT_1,
+            .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER
+        }
+    );
+    if (gpucull_pyramid == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create Hi-Z pyramid: %s", SDL_GetError());
+        return false;
+    }
+
+    gpucull_pyramid_width = width;
+    gpucull_pyramid_height = height;
+    gpucull_pyramid_level_count = level_count;
+    gpucull_screen_width = virtual_screen_texture_width;
+    gpucull_screen_height = virtual_screen_texture_height;
+
+    // without the levels the pyramid is never built, and culling is frustum only
+    SDL_GPUTextureUsageFlags level_usage = SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE;
+    if (!SDL_GPUTextureSupportsFormat(gpu_device, GPUCULL_PYRAMID_FORMAT, SDL_GPU_TEXTURETYPE_2D, level_usage))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Hi-Z pyramid format can't be a storage texture; occlusion culling is off");
+        return true;
+    }
+    for (Uint32 i = 0; i < level_count; i++)
+    {
+        gpucull_pyramid_levels[i] = GPUMemory_CreateTexture
+        (
+            GPUMEMORY_CATEGORY_RENDER_TARGET,
+            "hi-z pyramid level",
+            &(SDL_GPUTextureCreateInfo)
+            {
+                .type = SDL_GPU_TEXTURETYPE_2D,
+                .format = GPUCULL_PYRAMID_FORMAT,
+                .width = SDL_max(width >> i, 1),
+                .height = SDL_max(height >> i, 1),
+                .layer_count_or_depth = 1,
+                .num_levels = 1,
+                .sample_count = SDL_GPU_SAMPLECOUNT_1,
+                .usage = level_usage
+            }
+        );
+        if (gpucull_pyramid_levels[i] == NULL)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to create Hi-Z pyramid level %u; occlusion culling is off: %s", i, SDL_GetError());
+            for (Uint32 ii = 0; ii < i; ii++)
+            {
+                GPUMemory_ReleaseTexture(gpucull_pyramid_levels[ii]);
+                gpucull_pyramid_levels[ii] = NULL;
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+static void GPUCull_CopyPlanes(const Frustum* frustum, vec4 planes[6])
+{
+    for (int i = 0; i < 6; i++)
+    {
+        planes[i][0] = frustum->normal_x[i];
+        planes[i][1] = frustum->normal_y[i];
+        planes[i][2] = frustum->normal_z[i];
+        planes[i][3] = frustum->distance[i];
+    }
+}
+
+static void GPUCull_GetPlanes(mat4 view_projection, bool include_near_plane, vec4 planes[6])
+{
+    Frustum frustum;
+    Frustum_FromMatrix(view_projection, include_near_plane, &frustum);
+    GPUCull_CopyPlanes(&frustum, planes);
+}
+
+static void GPUCull_Dispatch(SDL_GPUCommandBuffer* command_buffer, const UBO_Cull* ubo_cull, bool cycle)
+{
+    SDL_GPUComputePass* cull_pass = SDL_BeginGPUComputePass
+    (
+        command_buffer,
+        NULL,
+        0,
+        (SDL_GPUStorageBufferReadWriteBinding[])
+        {{
+            .buffer = gpucull_command_buffer,
+            .cycle = cycle
+        }},
+        1
+    );
+    SDL_BindGPUComputePipeline(cull_pass, pipeline_cull);
+    SDL_BindGPUComputeSamplers
+    (
+        cull_pass,
+        0, // first slot
+        &(SDL_GPUTextureSamplerBinding){ .texture = gpucull_pyramid, .sampler = sampler_nearest_mips },
+        1 // num_bindings
+    );
+    SDL_BindGPUComputeStorageBuffers(cull_pass, 0, &gpucull_record_buffer, 1);
+    SDL_PushGPUComputeUniformData(command_buffer, 0, ubo_cull, sizeof(*ubo_cull));
+    SDL_DispatchGPUCompute(cull_pass, (ubo_cull->record_count + 63) / 64, 1, 1);
+    SDL_EndGPUComputePass(cull_pass);
+}
+
+// Writes the records of every visible unanimated model and dispatches the cull shader in its own submission,
+// which runs before the passes that draw from the commands
+// after Model_SelectLODs, Model_UpdateVisibility and Lights_UpdateShadowCascades; on failure the models are drawn
+// without it (GPUCull_Draw returns false)
+bool GPUCull_Update(Camera* camera)
+{
+    gpucull_record_count = 0;
+    gpucull_prepass_occlusion = false;
+    Uint32 count = 0;
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        model->cull_command_count = 0;
+        if (!model->visibility) continue;
+        count += model->submeshes ? (Uint32)Array_Len(model->submeshes) : 1;
+    }
+
+    if (count == 0) return true;
+    if (!GPUCull_Reserve(count) || !GPUCull_ReservePyramid()) return false;
+
+    GPUCull_Record* records = SDL_MapGPUTransferBuffer(gpu_device, gpucull_transfer_buffer, true);
+    if (records == NULL)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_MapGPUTransferBuffer failed: %s", SDL_GetError());
+        return false;
+    }
+
+    Uint32 index = 0;
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        if (!model->visibility) continue;
+        model->cull_first_command = index;
+        if (model->submeshes == NULL)
+        {
+            GPUCull_Record* record = &records[index++];
+            glm_vec3_copy(model->aabb_min, record->aabb_min);
+            glm_vec3_copy(model->aabb_max, record->aabb_max);
+            record->first_index = 0;
+            record->index_count = model->mesh.index_count;
+            continue;
+        }
+        for (size_t ii = 0; ii < Array_Len(model->submeshes); ii++)
+        {
+            const Submesh* submesh = &model->submeshes[ii];
+            const Submesh_LOD* lod = &submesh->lods[submesh->lod];
+            GPUCull_Record* record = &records[index++];
+            glm_vec3_copy((float*)submesh->aabb_min, record->aabb_min);
+            glm_vec3_copy((float*)submesh->aabb_max, record->aabb_max);
+            record->first_index = lod->first_index;
+            record->index_count = lod->index_count;
+        }
+    }
+
+    SDL_UnmapGPUTransferBuffer(gpu_device, gpucull_transfer_buffer);
+
+    SDL_GPUCommandBuffer* command_buffer_cull = SDL_AcquireGPUCommandBuffer(gpu_device);
+    if (command_buffer_cull == NULL)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_AcquireGPUCommandBuffer failed: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(command_buffer_cull);
+    SDL_UploadToGPUBuffer
+    (
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation){ .transfer_buffer = gpucull_transfer_buffer, .offset = 0 },
+        &(SDL_GPUBufferRegion){ .buffer = gpucull_record_buffer, .offset = 0, .size = count * sizeof(GPUCull_Record) },
+        true // cycle
+    );
+    SDL_EndGPUCopyPass(copy_pass);
+
+    UBO_Cull ubo_cull =
+    {
+        .record_count = count,
+        .phase = 0,
+        .occlusion = gpucull_pyramid_valid,
+        .pyramid_level_count = gpucull_pyramid_level_count,
+        .screen_width = gpucull_pyramid_render_width,
+        .screen_height = gpucull_pyramid_render_height,
+    };
+    glm_mat4_copy(gpucull_pyramid_view, ubo_cull.occlusion_view);
+    glm_mat4_copy(gpucull_pyramid_view_projection, ubo_cull.occlusion_view_projection);
+    GPUCull_GetPlanes(camera->view_projection_matrix, true, ubo_cull.planes_camera);
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        GPUCull_CopyPlanes(&shadow_cascades[i].view.frustum, &ubo_cull.planes_shadow[i * 6]);
+    }
+    GPUCull_Dispatch(command_buffer_cull, &ubo_cull, true); // last frame's passes may still be drawing from the commands
+    SDL_SubmitGPUCommandBuffer(command_buffer_cull);
+
+    // only now, so that anything that failed above leaves every model on the fallback path
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        if (!model->visibility) continue;
+        model->cull_command_count = model->submeshes ? (Uint32)Array_Len(model->submeshes) : 1;
+    }
+    gpucull_record_count = count;
+    gpucull_prepass_occlusion = gpucull_pyramid_valid;
+    glm_mat4_copy(camera->view_matrix, gpucull_view);
+    glm_mat4_copy(camera->view_projection_matrix, gpucull_view_projection);
+    return true;
+}
+
+// Builds the pyramid level by level from the prepass's view space depth (alpha), then copies the levels into its mip chain
+static bool GPUCull_BuildPyramid(SDL_GPUCommandBuffer* command_buffer, SDL_GPUTexture* prepass_texture)
+{
+    if (gpucull_pyramid_levels[0] == NULL) return false;
+
+    for (Uint32 i = 0; i < gpucull_pyramid_level_count; i++)
+    {
+        SDL_GPUComputePass* hiz_pass = SDL_BeginGPUComputePass
+        (
+            command_buffer,
+            (SDL_GPUStorageTextureReadWriteBinding[])
+            {{
+                .texture = gpucull_pyramid_levels[i],
+                .cycle = true
+            }},
+            1,
+            NULL,
+            0
+        );
+        SDL_BindGPUComputePipeline(hiz_pass, pipeline_hiz_build);
+        SDL_BindGPUComputeStorageTextures
+        (
+            hiz_pass,
+            0, // first slot
+            i == 0 ? &prepass_texture : &gpucull_pyramid_levels[i - 1],
+            1 // num_bindings
+        );
+        UBO_HiZ ubo_hiz = { .from_prepass = i == 0 };
+        SDL_PushGPUComputeUniformData(command_buffer, 0, &ubo_hiz, sizeof(ubo_hiz));
+        Uint32 width = SDL_max(gpucull_pyramid_width >> i, 1);
+        Uint32 height = SDL_max(gpucull_pyramid_height >> i, 1);
+        SDL_DispatchGPUCompute(hiz_pass, (width + 7) / 8, (height + 7) / 8, 1);
+        SDL_EndGPUComputePass(hiz_pass);
+    }
+
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    for (Uint32 i = 0; i < gpucull_pyramid_level_count; i++)
+    {
+        SDL_CopyGPUTextureToTexture
+        (
+            copy_pass,
+            &(SDL_GPUTextureLocation){ .texture = gpucull_pyramid_levels[i] },
+            &(SDL_GPUTextureLocation){ .texture = gpucull_pyramid, .mip_level = i },
+            SDL_max(gpucull_pyramid_width >> i, 1),
+            SDL_max(gpucull_pyramid_height >> i, 1),
+            1, // depth
+            false // cycle; this frame's prepass commands were culled against it, in an earlier submission
+        );
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+    return true;
+}
+
+// After the prepass: builds this frame's pyramid from it and culls the late prepass and main commands against it
+bool GPUCull_UpdateOcclusion(SDL_GPUCommandBuffer* command_buffer, SDL_GPUTexture* prepass_texture)
+{
+    if (gpucull_record_count == 0) return true;
+
+    bool built = GPUCull_BuildPyramid(command_buffer, prepass_texture);
+    gpucull_pyramid_valid = built;
+    gpucull_pyramid_render_width = render_width;
+    gpucull_pyramid_render_height = render_height;
+    glm_mat4_copy(gpucull_view, gpucull_pyramid_view);
+    glm_mat4_copy(gpucull_view_projection, gpucull_pyramid_view_projection);
+
+    UBO_Cull ubo_cull =
+    {
+        .record_count = gpucull_record_count,
+        .phase = 1,
+        .occlusion = built,
+        .pyramid_level_count = gpucull_pyramid_level_count,
+        .screen_width = gpucull_pyramid_render_width,
+        .screen_height = gpucull_pyramid_render_height,
+    };
+    glm_mat4_copy(gpucull_view, ubo_cull.occlusion_view);
+    glm_mat4_copy(gpucull_view_projection, ubo_cull.occlusion_view_projection);
+    GPUCull_GetPlanes(gpucull_view_projection, true, ubo_cull.planes_camera);
+    GPUCull_Dispatch(command_buffer, &ubo_cull, false); // keeps the prepass and shadow commands
+    return built;
+}
+
+// only when the prepass skipped something the previous pyramid occluded
+bool GPUCull_HasLateDraws(void)
+{
+    return gpucull_record_count > 0 && gpucull_prepass_occlusion;
+}
+
+// Draws the model's submeshes that the cull shader kept for the view; false if the model has no commands this frame
+bool GPUCull_Draw(SDL_GPURenderPass* render_pass, const Model* model, GPUCull_View view)
+{
+    if (model->cull_command_count == 0) return false;
+
+    Uint32 first_command = model->cull_first_command + view * gpucull_record_count;
+    SDL_DrawGPUIndexedPrimitivesIndirect
+    (
+        render_pass,
+        gpucull_command_buffer,
+        first_command * sizeof(SDL_GPUIndexedIndirectDrawCommand),
+        model->cull_command_count
+    );
+    return true;
+}
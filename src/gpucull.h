@@ -0,0 +1,46 @@
+#ifndef GPUCULL_H
+#define GPUCULL_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "model.h"
+#include "lights.h"
+
+/*
+    GPU culling of unanimated models
+    every visible unanimated model gets one SDL_GPUIndexedIndirectDrawCommand per view and per submesh (one for the whole
+    mesh if it is not a static batch); the cull compute shader tests the bounds and writes the selected LOD's index range,
+    or zero instances when the bounds are culled
+    a model is then drawn with one SDL_DrawGPUIndexedPrimitivesIndirect over its range of commands, however many submeshes it has
+    SDL_GPU has no draw count buffer, so culled commands are still issued (as empty draws)
+
+    occlusion: a Hi-Z pyramid of the min and max view space depth of the prepass (half resolution at level 0)
+    1. GPUCull_Update, before the shadow pass: shadow commands against each cascade's frustum (a view per cascade, so a
+       cascade only draws what is in its own slice); prepass commands against the camera's frustum and the previous frame's pyramid
+    2. GPUCull_UpdateOcclusion, after the prepass: builds this frame's pyramid, then the main commands against it, and late
+       prepass commands for whatever is visible in it but was occluded in the previous one (disocclusion)
+    3. the late prepass draws those on top of the prepass, so the main pass (depth EQUAL) finds their depth
+    the pyramid misses the late draws, which only makes it more conservative
+    instanced and bone animated models are not culled here; they keep their CPU frustum test (Model_UpdateVisibility)
+    main thread only
+*/
+
+Enum (Uint8, GPUCull_View)
+{
+    GPUCULL_VIEW_PREPASS,
+    GPUCULL_VIEW_PREPASS_LATE,
+    GPUCULL_VIEW_MAIN,
+    GPUCULL_VIEW_SHADOW, // cascade 0; cascade i is GPUCULL_VIEW_SHADOW + i
+    GPUCULL_VIEW_COUNT = GPUCULL_VIEW_SHADOW + SHADOW_CASCADE_COUNT
+};
+
+#define GPUCULL_PYRAMID_MAX_LEVELS 16
+
+bool GPUCull_Update(Camera* camera);
+bool GPUCull_UpdateOcclusion(SDL_GPUCommandBuffer* command_buffer, SDL_GPUTexture* prepass_texture);
+bool GPUCull_HasLateDraws(void);
+bool GPUCull_Draw(SDL_GPURenderPass* render_pass, const Model* model, GPUCull_View view);
+void GPUCull_Quit(void);
+
+#endif // GPUCULL_H
@@ -0,0 +1,320 @@
+#include "gpumemory.h"
+#include "globals.h"
+
+Struct (GPUMemory_Resource)
+{
+    const void* resource;
+    Uint64 size;
+    GPUMemory_Category category;
+    char owner[GPUMEMORY_OWNER_LENGTH];
+};
+
+Struct (GPUMemory_Owner)
+{
+    const char* owner;
+    Uint64 size;
+    Uint32 count;
+};
+
+static GPUMemory_Resource Array gpumemory_resources = NULL; // sorted by resource pointer
+static SDL_Mutex* gpumemory_mutex = NULL; // the loader creates buffers from its own thread
+static Uint64 gpumemory_category_bytes[GPUMEMORY_CATEGORY_COUNT];
+static Uint64 gpumemory_total_bytes = 0;
+static Uint64 gpumemory_peak_bytes = 0;
+static bool gpumemory_over_budget = false;
+
+static const char* gpumemory_category_names[GPUMEMORY_CATEGORY_COUNT] =
+{
+    "render targets",
+    "meshes",
+    "textures",
+    "buffers",
+    "staging",
+};
+
+#define GPUMEMORY_MB(bytes) ((double)(bytes) / (1024.0 * 1024.0))
+
+bool GPUMemory_Init(void)
+{
+    Array_Init(gpumemory_resources, 1024);
+    if (gpumemory_resources == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate GPU memory tracking array");
+        return false;
+    }
+
+    gpumemory_mutex = SDL_CreateMutex();
+    if (gpumemory_mutex == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create GPU memory tracking mutex: %s", SDL_GetError());
+        Array_Free(gpumemory_resources);
+        return false;
+    }
+
+    return true;
+}
+
+// index of resource, or of where it would be inserted
+static size_t GPUMemory_Search(const void* resource)
+{
+    size_t low = 0;
+    size_t high = Array_Len(gpumemory_resources);
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if ((uintptr_t)gpumemory_resources[middle].resource < (uintptr_t)resource)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static int GPUMemory_CompareOwnerNames(const void* a, const void* b)
+{
+    return SDL_strcmp(((const GPUMemory_Resource*)a)->owner, ((const GPUMemory_Resource*)b)->owner);
+}
+
+static int GPUMemory_CompareOwnerSizes(const void* a, const void* b)
+{
+    Uint64 size_a = ((const GPUMemory_Owner*)a)->size;
+    Uint64 size_b = ((const GPUMemory_Owner*)b)->size;
+    return (size_a < size_b) - (size_a > size_b); // largest first
+}
+
+// Logs the totals of every category, then the largest owners (max_owners of them; 0 for all)
+// sorts resources by owner in place
+static void GPUMemory_LogResources(GPUMemory_Resource* resources, size_t count, size_t max_owners, SDL_LogPriority priority)
+{
+    Uint64 category_bytes[GPUMEMORY_CATEGORY_COUNT] = {0};
+    Uint32 category_counts[GPUMEMORY_CATEGORY_COUNT] = {0};
+    Uint64 total_bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        category_bytes[resources[i].category] += resources[i].size;
+        category_counts[resources[i].category]++;
+        total_bytes += resources[i].size;
+    }
+
+    for (int i = 0; i < GPUMEMORY_CATEGORY_COUNT; i++)
+    {
+        if (category_counts[i] == 0) continue;
+        SDL_LogMessage(SDL_LOG_CATEGORY_GPU, priority, "  %-15s %9.2f MB in %u resource(s)", gpumemory_category_names[i], GPUMEMORY_MB(category_bytes[i]), category_counts[i]);
+    }
+    SDL_LogMessage(SDL_LOG_CATEGORY_GPU, priority, "  %-15s %9.2f MB", "total", GPUMEMORY_MB(total_bytes));
+
+    if (count == 0) return;
+
+    GPUMemory_Owner* owners = SDL_malloc(sizeof(GPUMemory_Owner) * count);
+    if (owners == NULL) return;
+
+    SDL_qsort(resources, count, sizeof(GPUMemory_Resource), GPUMemory_CompareOwnerNames);
+    size_t owner_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (owner_count == 0 || SDL_strcmp(owners[owner_count - 1].owner, resources[i].owner) != 0)
+        {
+            owners[owner_count++] = (GPUMemory_Owner){ .owner = resources[i].owner };
+        }
+        owners[owner_count - 1].size += resources[i].size;
+        owners[owner_count - 1].count++;
+    }
+    SDL_qsort(owners, owner_count, sizeof(GPUMemory_Owner), GPUMemory_CompareOwnerSizes);
+
+    size_t listed = max_owners ? SDL_min(owner_count, max_owners) : owner_count;
+    for (size_t i = 0; i < listed; i++)
+    {
+        SDL_LogMessage(SDL_LOG_CATEGORY_GPU, priority, "  %9.2f MB in %u resource(s): %s", GPUMEMORY_MB(owners[i].size), owners[i].count, owners[i].owner);
+    }
+    if (listed < owner_count)
+    {
+        SDL_LogMessage(SDL_LOG_CATEGORY_GPU, priority, "  ... and %u more owner(s)", (Uint32)(owner_count - listed));
+    }
+
+    SDL_free(owners);
+}
+
+// everything still tracked here was never released
+void GPUMemory_Quit(void)
+{
+    if (gpumemory_resources == NULL) return;
+
+    size_t leak_count = Array_Len(gpumemory_resources);
+    if (leak_count > 0)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "%u GPU resource(s) were never released (peak use was %.2f MB):", (Uint32)leak_count, GPUMEMORY_MB(gpumemory_peak_bytes));
+        GPUMemory_LogResources(gpumemory_resources, leak_count, 0, SDL_LOG_PRIORITY_WARN);
+    }
+    else
+    {
+        SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Every GPU resource was released (peak use was %.2f MB)", GPUMEMORY_MB(gpumemory_peak_bytes));
+    }
+
+    Array_Free(gpumemory_resources);
+    SDL_DestroyMutex(gpumemory_mutex);
+    gpumemory_mutex = NULL;
+    SDL_zeroa(gpumemory_category_bytes);
+    gpumemory_total_bytes = 0;
+    gpumemory_peak_bytes = 0;
+    gpumemory_over_budget = false;
+}
+
+static void GPUMemory_Track(const void* resource, Uint64 size, GPUMemory_Category category, const char* owner)
+{
+    if (gpumemory_resources == NULL) return;
+
+    GPUMemory_Resource tracked =
+    {
+        .resource = resource,
+        .size = size,
+        .category = category,
+    };
+    SDL_strlcpy(tracked.owner, owner ? owner : "unknown", sizeof(tracked.owner));
+
+    SDL_LockMutex(gpumemory_mutex);
+
+    if (!Array_Insert(gpumemory_resources, GPUMemory_Search(resource), tracked))
+    {
+        SDL_UnlockMutex(gpumemory_mutex);
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to track GPU resource of %s", tracked.owner);
+        return;
+    }
+    gpumemory_category_bytes[category] += size;
+    gpumemory_total_bytes += size;
+    gpumemory_peak_bytes = SDL_max(gpumemory_peak_bytes, gpumemory_total_bytes);
+
+    // once per crossing, not once per resource
+    bool crossed_budget = !gpumemory_over_budget && gpu_memory_budget_bytes > 0 && gpumemory_total_bytes > gpu_memory_budget_bytes;
+    if (crossed_budget) gpumemory_over_budget = true;
+
+    SDL_UnlockMutex(gpumemory_mutex);
+
+    if (crossed_budget)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "GPU memory budget of %.2f MB exceeded (creating %.2f MB for %s)", GPUMEMORY_MB(gpu_memory_budget_bytes), GPUMEMORY_MB(size), tracked.owner);
+        GPUMemory_LogReport();
+    }
+}
+
+static void GPUMemory_Untrack(const void* resource)
+{
+    if (gpumemory_resources == NULL) return;
+
+    SDL_LockMutex(gpumemory_mutex);
+
+    size_t index = GPUMemory_Search(resource);
+    if (index < Array_Len(gpumemory_resources) && gpumemory_resources[index].resource == resource)
+    {
+        GPUMemory_Resource* tracked = &gpumemory_resources[index];
+        gpumemory_category_bytes[tracked->category] -= tracked->size;
+        gpumemory_total_bytes -= tracked->size;
+        Array_DeleteShift(gpumemory_resources, index);
+        if (gpumemory_total_bytes <= gpu_memory_budget_bytes) gpumemory_over_budget = false;
+    }
+    else
+    {
+        SDL_LogTrace(SDL_LOG_CATEGORY_GPU, "Releasing an untracked GPU resource");
+    }
+
+    SDL_UnlockMutex(gpumemory_mutex);
+}
+
+// every level and layer (or depth slice), times the sample count
+static Uint64 GPUMemory_EstimateTextureSize(const SDL_GPUTextureCreateInfo* create_info)
+{
+    Uint64 size = 0;
+    Uint32 level_count = SDL_max(create_info->num_levels, 1);
+    for (Uint32 level = 0; level < level_count; level++)
+    {
+        Uint32 width = SDL_max(create_info->width >> level, 1);
+        Uint32 height = SDL_max(create_info->height >> level, 1);
+        Uint32 depth = create_info->type == SDL_GPU_TEXTURETYPE_3D ? SDL_max(create_info->layer_count_or_depth >> level, 1) : SDL_max(create_info->layer_count_or_depth, 1);
+        size += SDL_CalculateGPUTextureFormatSize(create_info->format, width, height, depth);
+    }
+    return size << create_info->sample_count; // SDL_GPU_SAMPLECOUNT_N is log2(N)
+}
+
+SDL_GPUTexture* GPUMemory_CreateTexture(GPUMemory_Category category, const char* owner, const SDL_GPUTextureCreateInfo* create_info)
+{
+    SDL_GPUTexture* texture = SDL_CreateGPUTexture(gpu_device, create_info);
+    if (texture) GPUMemory_Track(texture, GPUMemory_EstimateTextureSize(create_info), category, owner);
+    return texture;
+}
+
+SDL_GPUBuffer* GPUMemory_CreateBuffer(GPUMemory_Category category, const char* owner, const SDL_GPUBufferCreateInfo* create_info)
+{
+    SDL_GPUBuffer* buffer = SDL_CreateGPUBuffer(gpu_device, create_info);
+    if (buffer) GPUMemory_Track(buffer, create_info->size, category, owner);
+    return buffer;
+}
+
+SDL_GPUTransferBuffer* GPUMemory_CreateTransferBuffer(const char* owner, const SDL_GPUTransferBufferCreateInfo* create_info)
+{
+    SDL_GPUTransferBuffer* transfer_buffer = SDL_CreateGPUTransferBuffer(gpu_device, create_info);
+    if (transfer_buffer) GPUMemory_Track(transfer_buffer, create_info->size, GPUMEMORY_CATEGORY_STAGING, owner);
+    return transfer_buffer;
+}
+
+// the release functions ignore NULL
+void GPUMemory_ReleaseTexture(SDL_GPUTexture* texture)
+{
+    if (texture == NULL) return;
+    GPUMemory_Untrack(texture);
+    SDL_ReleaseGPUTexture(gpu_device, texture);
+}
+
+void GPUMemory_ReleaseBuffer(SDL_GPUBuffer* buffer)
+{
+    if (buffer == NULL) return;
+    GPUMemory_Untrack(buffer);
+    SDL_ReleaseGPUBuffer(gpu_device, buffer);
+}
+
+void GPUMemory_ReleaseTransferBuffer(SDL_GPUTransferBuffer* transfer_buffer)
+{
+    if (transfer_buffer == NULL) return;
+    GPUMemory_Untrack(transfer_buffer);
+    SDL_ReleaseGPUTransferBuffer(gpu_device, transfer_buffer);
+}
+
+// copies the owner a resource was created for, so a replacement can be created under the same one
+bool GPUMemory_GetOwner(const void* resource, char* owner, size_t owner_size)
+{
+    if (gpumemory_resources == NULL) return false;
+
+    SDL_LockMutex(gpumemory_mutex);
+    size_t index = GPUMemory_Search(resource);
+    bool found = index < Array_Len(gpumemory_resources) && gpumemory_resources[index].resource == resource;
+    if (found) SDL_strlcpy(owner, gpumemory_resources[index].owner, owner_size);
+    SDL_UnlockMutex(gpumemory_mutex);
+
+    return found;
+}
+
+Uint64 GPUMemory_GetTotalBytes(void)
+{
+    return gpumemory_total_bytes;
+}
+
+Uint64 GPUMemory_GetCategoryBytes(GPUMemory_Category category)
+{
+    return category < GPUMEMORY_CATEGORY_COUNT ? gpumemory_category_bytes[category] : 0;
+}
+
+void GPUMemory_LogReport(void)
+{
+    if (gpumemory_resources == NULL) return;
+
+    SDL_LockMutex(gpumemory_mutex);
+    size_t count = Array_Len(gpumemory_resources);
+    GPUMemory_Resource* resources = SDL_malloc(sizeof(GPUMemory_Resource) * SDL_max(count, 1));
+    if (resources) SDL_memcpy(resources, gpumemory_resources, sizeof(GPUMemory_Resource) * count);
+    Uint64 peak_bytes = gpumemory_peak_bytes;
+    SDL_UnlockMutex(gpumemory_mutex);
+
+    if (resources == NULL) return;
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "GPU memory (estimated; budget %.2f MB, peak %.2f MB):", GPUMEMORY_MB(gpu_memory_budget_bytes), GPUMEMORY_MB(peak_bytes));
+    GPUMemory_LogResources(resources, count, GPUMEMORY_REPORT_MAX_OWNERS, SDL_LOG_PRIORITY_INFO);
+    SDL_free(resources);
+}
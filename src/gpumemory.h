@@ -0,0 +1,40 @@
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+
+// GPU memory tracking
+// every texture, buffer and transfer buffer is created and released through here, which records an estimate of its size
+// (what the resource needs, not what the driver actually allocates) under a category and an owner
+// totals are kept per category; crossing gpu_memory_budget_bytes (settings.txt: gpu_memory_budget_mb) logs a warning,
+// and whatever is still alive at GPUMemory_Quit is reported as a leak
+
+#define GPUMEMORY_OWNER_LENGTH 64
+#define GPUMEMORY_REPORT_MAX_OWNERS 16 // largest owners listed by GPUMemory_LogReport
+
+Enum (Uint8, GPUMemory_Category)
+{
+    GPUMEMORY_CATEGORY_RENDER_TARGET, // render targets and other screen sized textures
+    GPUMEMORY_CATEGORY_MESH,          // vertex and index buffers
+    GPUMEMORY_CATEGORY_TEXTURE,       // material textures and sprites
+    GPUMEMORY_CATEGORY_BUFFER,        // storage buffers
+    GPUMEMORY_CATEGORY_STAGING,       // transfer buffers
+    GPUMEMORY_CATEGORY_COUNT
+};
+
+bool GPUMemory_Init(void);
+void GPUMemory_Quit(void);
+SDL_GPUTexture* GPUMemory_CreateTexture(GPUMemory_Category category, const char* owner, const SDL_GPUTextureCreateInfo* create_info);
+SDL_GPUBuffer* GPUMemory_CreateBuffer(GPUMemory_Category category, const char* owner, const SDL_GPUBufferCreateInfo* create_info);
+SDL_GPUTransferBuffer* GPUMemory_CreateTransferBuffer(const char* owner, const SDL_GPUTransferBufferCreateInfo* create_info);
+void GPUMemory_ReleaseTexture(SDL_GPUTexture* texture);
+void GPUMemory_ReleaseBuffer(SDL_GPUBuffer* buffer);
+void GPUMemory_ReleaseTransferBuffer(SDL_GPUTransferBuffer* transfer_buffer);
+bool GPUMemory_GetOwner(const void* resource, char* owner, size_t owner_size);
+Uint64 GPUMemory_GetTotalBytes(void);
+Uint64 GPUMemory_GetCategoryBytes(GPUMemory_Category category);
+void GPUMemory_LogReport(void);
+
+#endif // GPUMEMORY_H
@@ -0,0 +1,322 @@
+#include "hotreload.h"
+#include "globals.h"
+#include "loader.h"
+#include "pipeline.h"
+#include "streamer.h"
+
+Enum (Uint8, HotReload_Type)
+{
+    HOTRELOAD_TYPE_SETTINGS,
+    HOTRELOAD_TYPE_SHADER,
+    HOTRELOAD_TYPE_SCENE,
+    HOTRELOAD_TYPE_TEXTURE,
+};
+
+Struct (HotReload_File)
+{
+    char name[MAXIMUM_URI_LENGTH]; // shader file name, scene file name (in models/) or texture uri (in textures/)
+    SDL_Time modify_time;          // of what is loaded right now
+    SDL_Time changed_time;         // a newer time stamp that hasn't settled yet; 0 if none
+    MaterialPool_Texture texture;  // textures only
+    Uint32 scene_id;               // scenes only
+    Texture_Usage usage;           // textures only
+    HotReload_Type type;
+};
+
+#define HOTRELOAD_MAX_SHADERS 64
+
+static HotReload_File Array hotreload_files = NULL;
+static Uint32 Array hotreload_stale_scenes = NULL; // replaced by a reload; unloaded as soon as the loader is idle
+static Uint64 hotreload_last_poll_ticks = 0;
+
+// newest time stamp of whatever file the asset is currently read from; 0 if there is none
+static SDL_Time HotReload_GetModifyTime(const HotReload_File* file)
+{
+    char path[MAXIMUM_URI_LENGTH];
+    SDL_PathInfo info;
+
+    switch (file->type)
+    {
+        case HOTRELOAD_TYPE_SETTINGS:
+            SDL_snprintf(path, sizeof(path), "%s%s", base_path, file->name);
+            break;
+        case HOTRELOAD_TYPE_SHADER:
+            if (!Pipeline_GetShaderPath(file->name, path, sizeof(path))) return 0;
+            break;
+        case HOTRELOAD_TYPE_SCENE:
+            SDL_snprintf(path, sizeof(path), "%smodels/%s", base_path, file->name);
+            break;
+        case HOTRELOAD_TYPE_TEXTURE:
+        {
+            // Texture_Load prefers a .ktx2 or .dds next to the image, so any of the three counts
+            const char* extension = SDL_strrchr(file->name, '.');
+            int stem_length = extension ? (int)(extension - file->name) : (int)SDL_strlen(file->name);
+            static const char* container_extensions[] = { "ktx2", "dds" };
+            SDL_Time newest = 0;
+            for (size_t i = 0; i < SDL_arraysize(container_extensions); i++)
+            {
+                SDL_snprintf(path, sizeof(path), "%stextures/%.*s.%s", base_path, stem_length, file->name, container_extensions[i]);
+                if (SDL_GetPathInfo(path, &info)) newest = SDL_max(newest, info.modify_time);
+            }
+            SDL_snprintf(path, sizeof(path), "%stextures/%s", base_path, file->name);
+            if (SDL_GetPathInfo(path, &info)) newest = SDL_max(newest, info.modify_time);
+            return newest;
+        }
+    }
+
+    if (!SDL_GetPathInfo(path, &info)) return 0;
+    return info.modify_time;
+}
+
+static void HotReload_Watch(HotReload_Type type, const char* name, Texture_Usage usage, MaterialPool_Texture texture, Uint32 scene_id)
+{
+    if (hotreload_files == NULL || name == NULL) return;
+
+    HotReload_File file =
+    {
+        .texture = texture,
+        .scene_id = scene_id,
+        .usage = usage,
+        .type = type,
+    };
+    SDL_strlcpy(file.name, name, sizeof(file.name));
+    file.modify_time = HotReload_GetModifyTime(&file);
+
+    if (!Array_Append(hotreload_files, file))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to watch %s for changes", name);
+    }
+}
+
+void HotReload_WatchScene(const char* filename, Uint32 scene_id)
+{
+    if (hotreload_files == NULL) return;
+
+    for (size_t i = 0; i < Array_Len(hotreload_files); i++)
+    {
+        HotReload_File* file = &hotreload_files[i];
+        if (file->type == HOTRELOAD_TYPE_SCENE && SDL_strcmp(file->name, filename) == 0)
+        {
+            file->scene_id = scene_id;
+            return;
+        }
+    }
+    HotReload_Watch(HOTRELOAD_TYPE_SCENE, filename, 0, MATERIALPOOL_TEXTURE_NONE, scene_id);
+}
+
+void HotReload_WatchTexture(const char* uri, Texture_Usage usage, MaterialPool_Texture texture)
+{
+    HotReload_Watch(HOTRELOAD_TYPE_TEXTURE, uri, usage, texture, 0);
+}
+
+// called whenever a material texture is released, so a later reload can't touch it
+void HotReload_ForgetTexture(MaterialPool_Texture texture)
+{
+    if (hotreload_files == NULL || texture == MATERIALPOOL_TEXTURE_NONE) return;
+
+    for (size_t i = Array_Len(hotreload_files); i-- > 0;)
+    {
+        if (hotreload_files[i].type == HOTRELOAD_TYPE_TEXTURE && hotreload_files[i].texture == texture)
+        {
+            Array_DeleteSwap(hotreload_files, i);
+        }
+    }
+}
+
+// called when a texture is recreated under a new handle (see Model_ReplaceTexture)
+void HotReload_ReplaceTexture(MaterialPool_Texture old_texture, MaterialPool_Texture new_texture)
+{
+    if (hotreload_files == NULL || old_texture == MATERIALPOOL_TEXTURE_NONE) return;
+
+    for (size_t i = 0; i < Array_Len(hotreload_files); i++)
+    {
+        if (hotreload_files[i].type == HOTRELOAD_TYPE_TEXTURE && hotreload_files[i].texture == old_texture)
+        {
+            hotreload_files[i].texture = new_texture;
+        }
+    }
+}
+
+// Decodes the texture once and gives every material that uses it (with the same usage) a fresh copy
+// the streamer recreates each one with as many levels as it had before
+static bool HotReload_ReloadTexture(const HotReload_File* changed)
+{
+    Texture_Data texture_data = {0};
+    if (!Texture_Load(changed->name, changed->usage, &texture_data))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to reload texture: %s", changed->name);
+        Texture_Free(&texture_data);
+        return false;
+    }
+
+    bool success = true;
+    int replaced = 0;
+    SDL_Time modify_time = changed->modify_time;
+    char name[MAXIMUM_URI_LENGTH];
+    SDL_strlcpy(name, changed->name, sizeof(name));
+    Texture_Usage usage = changed->usage;
+
+    // collected first, since every replacement renames entries of hotreload_files
+    size_t match_count = 0;
+    MaterialPool_Texture* matches = SDL_malloc(sizeof(MaterialPool_Texture) * SDL_max(Array_Len(hotreload_files), 1));
+    if (matches == NULL)
+    {
+        Texture_Free(&texture_data);
+        return false;
+    }
+    for (size_t i = 0; i < Array_Len(hotreload_files); i++)
+    {
+        HotReload_File* file = &hotreload_files[i];
+        if (file->type != HOTRELOAD_TYPE_TEXTURE || file->usage != usage || SDL_strcmp(file->name, name) != 0) continue;
+        matches[match_count++] = file->texture;
+        file->modify_time = modify_time; // every copy is current now
+        file->changed_time = 0;
+    }
+
+    for (size_t i = 0; i < match_count; i++)
+    {
+        Texture_Data copy;
+        if (!Texture_Duplicate(&texture_data, &copy) || !Streamer_ReplaceTextureData(matches[i], &copy))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to replace texture %s", name);
+            success = false;
+            continue;
+        }
+        replaced++;
+    }
+
+    SDL_free(matches);
+    Texture_Free(&texture_data);
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Reloaded texture %s (%d material(s))", name, replaced);
+    return success;
+}
+
+static void HotReload_OnSceneReloaded(const char* filename, Uint32 scene_id, bool success, void* userdata)
+{
+    Uint32 previous_scene_id = (Uint32)(uintptr_t)userdata;
+
+    if (success)
+    {
+        Array_Append(hotreload_stale_scenes, previous_scene_id);
+        return;
+    }
+
+    // keep the old copy and drop whatever part of the new one made it in
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to reload scene %s; keeping the previous version", filename);
+    Array_Append(hotreload_stale_scenes, scene_id);
+    for (size_t i = 0; i < Array_Len(hotreload_files); i++)
+    {
+        HotReload_File* file = &hotreload_files[i];
+        if (file->type == HOTRELOAD_TYPE_SCENE && file->scene_id == scene_id)
+        {
+            file->scene_id = previous_scene_id;
+        }
+    }
+}
+
+static bool HotReload_Apply(HotReload_File* file)
+{
+    switch (file->type)
+    {
+        case HOTRELOAD_TYPE_SETTINGS:
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%s changed; reinitializing the renderer", file->name);
+            renderer_needs_to_be_reinitialized = true;
+            return true;
+        case HOTRELOAD_TYPE_SHADER:
+            return Pipeline_ReloadShader(file->name);
+        case HOTRELOAD_TYPE_SCENE:
+        {
+            // both copies are resident until the new one is complete, so there is never a frame without collision
+            Uint32 scene_id = Loader_RequestScene(file->name, HotReload_OnSceneReloaded, (void*)(uintptr_t)file->scene_id);
+            if (scene_id == 0) return false;
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Reloading scene %s", file->name);
+            file->scene_id = scene_id;
+            return true;
+        }
+        case HOTRELOAD_TYPE_TEXTURE:
+            return HotReload_ReloadTexture(file);
+    }
+    return false;
+}
+
+bool HotReload_Init(void)
+{
+    Array_Init(hotreload_files, 256);
+    Array_Init(hotreload_stale_scenes, 8);
+    if (hotreload_files == NULL || hotreload_stale_scenes == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate hot reload watch list");
+        return false;
+    }
+
+    HotReload_Watch(HOTRELOAD_TYPE_SETTINGS, "settings.txt", 0, MATERIALPOOL_TEXTURE_NONE, 0);
+
+    const char* shader_filenames[HOTRELOAD_MAX_SHADERS];
+    int shader_count = SDL_min(Pipeline_GetShaderFilenames(shader_filenames, HOTRELOAD_MAX_SHADERS), HOTRELOAD_MAX_SHADERS);
+    for (int i = 0; i < shader_count; i++)
+    {
+        HotReload_Watch(HOTRELOAD_TYPE_SHADER, shader_filenames[i], 0, MATERIALPOOL_TEXTURE_NONE, 0);
+    }
+
+    // scenes and textures are added as they are loaded
+    hotreload_last_poll_ticks = SDL_GetTicks();
+    return true;
+}
+
+void HotReload_Quit(void)
+{
+    Array_Free(hotreload_files);
+    Array_Free(hotreload_stale_scenes);
+}
+
+// Once per frame, before anything is drawn
+bool HotReload_Update(void)
+{
+    if (hotreload_files == NULL) return true;
+
+    bool success = true;
+
+    // the loader holds indices into the model arrays, so replaced scenes wait until it is idle
+    if (Array_Len(hotreload_stale_scenes) > 0 && Loader_IsIdle())
+    {
+        for (size_t i = 0; i < Array_Len(hotreload_stale_scenes); i++)
+        {
+            success = Model_UnloadScene(hotreload_stale_scenes[i]) && success;
+        }
+        Array_Len(hotreload_stale_scenes) = 0;
+    }
+
+    Uint64 ticks = SDL_GetTicks();
+    if (ticks - hotreload_last_poll_ticks < HOTRELOAD_POLL_INTERVAL_MS) return success;
+    hotreload_last_poll_ticks = ticks;
+
+    for (size_t i = 0; i < Array_Len(hotreload_files); i++)
+    {
+        HotReload_File* file = &hotreload_files[i];
+
+        SDL_Time modify_time = HotReload_GetModifyTime(file);
+        if (modify_time == 0 || modify_time == file->modify_time)
+        {
+            file->changed_time = 0;
+            continue;
+        }
+
+        // exporters and compilers write in several steps; wait until the time stamp holds still for a whole interval
+        if (modify_time != file->changed_time)
+        {
+            file->changed_time = modify_time;
+            continue;
+        }
+
+        file->modify_time = modify_time;
+        file->changed_time = 0;
+        if (!HotReload_Apply(file))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Hot reload of %s failed", file->name);
+            success = false;
+        }
+    }
+
+    return success;
+}
@@ -0,0 +1,26 @@
+#ifndef HOTRELOAD_H
+#define HOTRELOAD_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "texture.h"
+#include "materialpool.h"
+
+// Polls modification times of settings.txt, compiled shaders, scenes and textures, and reloads only what changed:
+//   settings.txt -> render targets and pipelines (Render_Init, as the R key does)
+//   a shader     -> the pipelines built from it (Pipeline_ReloadShader)
+//   a scene      -> that scene, streamed in through the loader; the old copy is unloaded once the new one is complete
+//   a texture    -> that texture, swapped into every material that uses it (through the streamer, see streamer.c)
+
+#define HOTRELOAD_POLL_INTERVAL_MS 500 // a change is applied once its time stamp has held still for one interval
+
+bool HotReload_Init(void);
+void HotReload_Quit(void);
+bool HotReload_Update(void);
+void HotReload_WatchScene(const char* filename, Uint32 scene_id);
+void HotReload_WatchTexture(const char* uri, Texture_Usage usage, MaterialPool_Texture texture);
+void HotReload_ForgetTexture(MaterialPool_Texture texture);
+void HotReload_ReplaceTexture(MaterialPool_Texture old_texture, MaterialPool_Texture new_texture);
+
+#endif // HOTRELOAD_H
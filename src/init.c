@@ -8,6 +8,11 @@
 #include "sprite.h"
 #include "render.h"
 #include "lights.h"
+#include "loader.h"
+#include "hotreload.h"
+#include "streamer.h"
+#include "gpumemory.h"
+#include "materialpool.h"
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
 {
@@ -40,6 +45,13 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
         return SDL_APP_FAILURE;
     }
 
+    // before anything is created on the device, so every resource is accounted for
+    if (!GPUMemory_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize GPU memory tracking");
+        return SDL_APP_FAILURE;
+    }
+
     window = SDL_CreateWindow("SDL GPU glTF Viewer", 1352, 815, window_flags);
     if (window == NULL)
     {
@@ -123,6 +135,13 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
         return SDL_APP_FAILURE;
     }
 
+    Array_Init(models_instanced, 1);
+    if (!models_instanced)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize models_instanced array");
+        return SDL_APP_FAILURE;
+    }
+
     Array_Init(models_bone_animated, 1);
     if (!models_bone_animated)
     {
@@ -137,6 +156,19 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
         return SDL_APP_FAILURE;
     }
 
+    Array_Init(occluders, 1);
+    if (!occluders)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize occluders array");
+        return SDL_APP_FAILURE;
+    }
+
+    if (!Occlusion_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize occlusion culling");
+        return SDL_APP_FAILURE;
+    }
+
     Array_Init(triggers, 1);
     if (!triggers)
     {
@@ -144,18 +176,52 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
         return SDL_APP_FAILURE;
     }
 
+    // before the loader, which allocates the loading material from it
+    if (!MaterialPool_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize material pools");
+        return SDL_APP_FAILURE;
+    }
+
+    if (!Loader_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize loader");
+        return SDL_APP_FAILURE;
+    }
+
+    // before any scene is loaded, so every material texture is registered
+    if (!Streamer_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize texture streaming");
+        return SDL_APP_FAILURE;
+    }
+
+    // before any scene is loaded, so every scene and texture gets watched
+    if (!HotReload_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize hot reload");
+        return SDL_APP_FAILURE;
+    }
+
+    // blocks until the start scenes are in; anything requested later streams in over several frames
     if (!Model_Load_AllScenes())
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to load models");
         return SDL_APP_FAILURE;
     }
 
-    Array_Init(lights_spot, MAX_TOTAL_LIGHTS);
+    Array_Init(lights_spot, MAX_SPOT_LIGHTS);
     if (!lights_spot)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize spot lights array");
         return SDL_APP_FAILURE;
     }
+    Array_Init(lights_point, MAX_POINT_LIGHTS);
+    if (!lights_point)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize point lights array");
+        return SDL_APP_FAILURE;
+    }
     if (!Lights_LoadLights())
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to load lights");
@@ -172,9 +238,10 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
     // STORAGE BUFFERS ////////////////////////////////////////////////////////
 
     // TODO size joint buffers appropriately based on the number of joints in the loaded models
-    joint_matrix_storage_buffer = SDL_CreateGPUBuffer
+    joint_matrix_storage_buffer = GPUMemory_CreateBuffer
     (
-        gpu_device, 
+        GPUMEMORY_CATEGORY_BUFFER,
+        "joint matrices",
         &(SDL_GPUBufferCreateInfo)
         {
             .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
@@ -187,9 +254,9 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
         return SDL_APP_FAILURE;
     }
 
-    joint_matrix_transfer_buffer = SDL_CreateGPUTransferBuffer
+    joint_matrix_transfer_buffer = GPUMemory_CreateTransferBuffer
     (
-        gpu_device,
+        "joint matrices",
         &(SDL_GPUTransferBufferCreateInfo)
         {
             .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
@@ -202,33 +269,66 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
         return SDL_APP_FAILURE;
     }
 
-    lights_storage_buffer = SDL_CreateGPUBuffer
+    lights_storage_buffer = GPUMemory_CreateBuffer
     (
-        gpu_device, 
+        GPUMEMORY_CATEGORY_BUFFER,
+        "lights",
         &(SDL_GPUBufferCreateInfo)
         {
-            .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
-            .size = MAX_TOTAL_LIGHTS * sizeof(Light_Spot)
+            // read by the light clusters (clusters.h) and the main pass
+            .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+            .size = MAX_SPOT_LIGHTS * sizeof(Light_Spot)
         }
     );
     if (lights_storage_buffer == NULL)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create bone matrix storage buffer: %s", SDL_GetError());
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create spot light storage buffer: %s", SDL_GetError());
         return SDL_APP_FAILURE;
     }
 
-    lights_transfer_buffer = SDL_CreateGPUTransferBuffer
+    lights_transfer_buffer = GPUMemory_CreateTransferBuffer
     (
-        gpu_device,
+        "lights",
         &(SDL_GPUTransferBufferCreateInfo)
         {
             .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-            .size = MAX_TOTAL_JOINTS_TO_RENDER * sizeof(mat4)
+            .size = MAX_SPOT_LIGHTS * sizeof(Light_Spot)
         }
     );
     if (lights_transfer_buffer == NULL)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create bone matrix transfer buffer: %s", SDL_GetError());
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create spot light transfer buffer: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    lights_point_storage_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_BUFFER,
+        "point lights",
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+            .size = MAX_POINT_LIGHTS * sizeof(Light_Point)
+        }
+    );
+    if (lights_point_storage_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create point light storage buffer: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    lights_point_transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "point lights",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = MAX_POINT_LIGHTS * sizeof(Light_Point)
+        }
+    );
+    if (lights_point_transfer_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create point light transfer buffer: %s", SDL_GetError());
         return SDL_APP_FAILURE;
     }
 
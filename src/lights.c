@@ -1,23 +1,20 @@
 #include "lights.h"
 #include "globals.h"
 
+#include <float.h>
+
+// lights whose copy in the storage buffers is out of date (see Lights_Upload)
+static bool lights_spot_dirty[MAX_SPOT_LIGHTS];
+static bool lights_point_dirty[MAX_POINT_LIGHTS];
+static size_t lights_spot_uploaded_count = 0;
+static size_t lights_point_uploaded_count = 0;
+
 bool Lights_Update()
 {
     // Spot ///////////////////////////////////////////////////////////////////
     
-    if (lights_storage_buffer) Lights_StorageBuffer_UpdateAndUpload();
-    
-    // current shadow casting only supports one shadow casting light
-    bool any_shadow_casters = false;
-    
-    foreach(light_spot, lights_spot)
-    {
-        if (light_spot.shadow_caster)
-        {
-            Lights_UpdateShadowMatrices_Spot(&light_spot);
-            any_shadow_casters = true;
-        }
-    }
+    // picks the tiles to redraw; a light whose tile moved is uploaded again (Lights_Upload)
+    Lights_UpdateSpotShadows();
 
     // Directional ////////////////////////////////////////////////////////////
 
@@ -38,8 +35,7 @@ bool Lights_Update()
 
     if (light_directional.shadow_caster)
     {
-        SDL_assert(!any_shadow_casters); // only one shadow caster supported currently
-        Lights_UpdateShadowMatrices_Directional(light_direction_world);
+        Lights_UpdateShadowCascades(light_direction_world);
     }
     
     // Hemisphere /////////////////////////////////////////////////////////////
@@ -71,131 +67,498 @@ bool Lights_LoadLights()
         .target = {-2.0f, 0.0f, -2.0f},
         .cutoff_inner = SDL_cosf(glm_rad(0.0f)),
         .cutoff_outer = SDL_cosf(glm_rad(10.0f)),
-        .shadow_caster = false,
+        .shadow_caster = true,
     };
     Array_Append(lights_spot, light_spot);
     return true;
 }
 
-// TODO if there are no lights, don't upload buffer
-// also need to make the light count available to the shader
-// (or just handle lights totally differently)
-bool Lights_StorageBuffer_UpdateAndUpload()
+// Writes the light as the shaders see it: world space, with its direction and its shadow tile
+static void Lights_WriteSpot(size_t index, Light_Spot* out)
+{
+    const Light_Spot* light = &lights_spot[index];
+    *out = *light;
+
+    vec3 direction;
+    glm_vec3_sub((float*)light->target, (float*)light->position, direction);
+    glm_vec3_normalize_to(direction, out->direction);
+
+    const Spot_Shadow* shadow = &spot_shadows[index];
+    out->shadow_caster = light->shadow_caster && shadow->tile_size > 0;
+    if (!out->shadow_caster) return;
+
+    glm_mat4_copy((vec4*)shadow->view.view_projection_matrix, out->shadow_world_to_clip);
+    // a perspective depth's slope at view depth w is near * far / ((far - near) * w^2)
+    out->shadow_bias_scale = SHADOW_BIAS * SPOT_SHADOW_NEAR * shadow->range / (shadow->range - SPOT_SHADOW_NEAR);
+    out->shadow_atlas_rect[0] = (float)shadow->tile_x / (float)SPOT_SHADOW_ATLAS_SIZE;
+    out->shadow_atlas_rect[1] = (float)shadow->tile_y / (float)SPOT_SHADOW_ATLAS_SIZE;
+    out->shadow_atlas_rect[2] = (float)shadow->tile_size / (float)SPOT_SHADOW_ATLAS_SIZE;
+    out->shadow_atlas_rect[3] = (float)shadow->tile_size / (float)SPOT_SHADOW_ATLAS_SIZE;
+}
+
+// One upload per run of consecutive dirty elements, which are already written at the same offsets in the transfer buffer
+// not cycled: the elements that aren't dirty have to stay
+static void Lights_UploadDirtyRuns(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, SDL_GPUBuffer* buffer, bool* dirty, size_t count, Uint32 element_size)
 {
-    SDL_GPUCommandBuffer* command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
+    size_t first = 0;
+    while (first < count)
+    {
+        if (!dirty[first])
+        {
+            first++;
+            continue;
+        }
+        size_t last = first;
+        while (last < count && dirty[last])
+        {
+            dirty[last] = false;
+            last++;
+        }
+        SDL_UploadToGPUBuffer
+        (
+            copy_pass,
+            &(SDL_GPUTransferBufferLocation){ .transfer_buffer = transfer_buffer, .offset = (Uint32)(first * element_size) },
+            &(SDL_GPUBufferRegion){ .buffer = buffer, .offset = (Uint32)(first * element_size), .size = (Uint32)((last - first) * element_size) },
+            false // cycle
+        );
+        first = last;
+    }
+}
+
+// Lights appended since the last upload are dirty; a shrunk array just has fewer lights for the clusters to read
+// (removing from the middle goes through Lights_Remove*, which marks the lights that moved)
+static bool Lights_HasDirty(bool* dirty, size_t* uploaded_count, size_t count)
+{
+    for (size_t i = *uploaded_count; i < count; i++) dirty[i] = true;
+    *uploaded_count = count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (dirty[i]) return true;
+    }
+    return false;
+}
+
+// Records the upload of every light marked dirty (Lights_MarkDirty_*) into the frame's copy pass; with no changes,
+// nothing is mapped or recorded
+// after Lights_Update, which may move spot lights' shadow tiles
+bool Lights_Upload(SDL_GPUCopyPass* copy_pass)
+{
+    size_t spot_count = SDL_min(Array_Len(lights_spot), MAX_SPOT_LIGHTS);
+    if (Lights_HasDirty(lights_spot_dirty, &lights_spot_uploaded_count, spot_count))
     {
         Light_Spot* lights_mapped = SDL_MapGPUTransferBuffer(gpu_device, lights_transfer_buffer, true);
-        if (!lights_mapped) 
+        if (!lights_mapped)
         {
             SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_MapGPUTransferBuffer failed: %s", SDL_GetError());
-            return false;
+            return false; // still dirty, so retried next frame
         }
-        
-        SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(command_buffer);
-        if (!copy_pass)
+        for (size_t i = 0; i < spot_count; i++)
         {
-            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_BeginGPUCopyPass failed: %s", SDL_GetError());
-            SDL_UnmapGPUTransferBuffer(gpu_device, lights_transfer_buffer);
-            return false;
+            if (lights_spot_dirty[i]) Lights_WriteSpot(i, &lights_mapped[i]);
         }
-        
-        int active_lights_count = Array_Len(lights_spot);
-        SDL_assert(active_lights_count <= MAX_TOTAL_LIGHTS);
+        SDL_UnmapGPUTransferBuffer(gpu_device, lights_transfer_buffer);
+        Lights_UploadDirtyRuns(copy_pass, lights_transfer_buffer, lights_storage_buffer, lights_spot_dirty, spot_count, sizeof(Light_Spot));
+    }
 
-        for (size_t i = 0; i < active_lights_count; i++)
+    size_t point_count = SDL_min(Array_Len(lights_point), MAX_POINT_LIGHTS);
+    if (Lights_HasDirty(lights_point_dirty, &lights_point_uploaded_count, point_count))
+    {
+        Light_Point* lights_mapped = SDL_MapGPUTransferBuffer(gpu_device, lights_point_transfer_buffer, true);
+        if (!lights_mapped)
         {
-            Light_Spot light = lights_spot[i];
-
-            vec3 light_direction_world;
-            glm_vec3_sub(light.target, light.position, light_direction_world);
-
-            vec4 light_position_world_4 = { light.position[0], light.position[1], light.position[2], 1.0f };
-            vec4 light_position_viewspace_4;
-            glm_mat4_mulv(camera_active->view_matrix, light_position_world_4, light_position_viewspace_4);
-            vec3 light_position_viewspace = { light_position_viewspace_4[0], light_position_viewspace_4[1], light_position_viewspace_4[2] };
-            
-            vec4 light_direction_world_4 = { light_direction_world[0], light_direction_world[1], light_direction_world[2], 0.0f };
-            vec4 light_direction_viewspace_4;
-            glm_mat4_mulv(camera_active->view_matrix, light_direction_world_4, light_direction_viewspace_4);
-            vec3 light_direction_viewspace = { light_direction_viewspace_4[0], light_direction_viewspace_4[1], light_direction_viewspace_4[2] };
-            glm_vec3_normalize(light_direction_viewspace);
-            
-            lights_mapped[i] = light;
-            glm_vec3_copy(light_position_viewspace, lights_mapped[i].position);
-            glm_vec3_copy(light_direction_viewspace, lights_mapped[i].direction);
+            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_MapGPUTransferBuffer failed: %s", SDL_GetError());
+            return false;
         }
-        
-        SDL_GPUTransferBufferLocation source = 
-        {
-            .transfer_buffer = lights_transfer_buffer,
-            .offset = 0
-        };
-        
-        SDL_GPUBufferRegion destination = 
+        for (size_t i = 0; i < point_count; i++)
         {
-            .buffer = lights_storage_buffer,
-            .offset = 0,
-            .size = active_lights_count * sizeof(Light_Spot)
-        };
-            
-        SDL_UploadToGPUBuffer(copy_pass, &source, &destination, true);
-        
-        SDL_UnmapGPUTransferBuffer(gpu_device, lights_transfer_buffer);
-        SDL_EndGPUCopyPass(copy_pass);
-        
+            if (lights_point_dirty[i]) lights_mapped[i] = lights_point[i];
+        }
+        SDL_UnmapGPUTransferBuffer(gpu_device, lights_point_transfer_buffer);
+        Lights_UploadDirtyRuns(copy_pass, lights_point_transfer_buffer, lights_point_storage_buffer, lights_point_dirty, point_count, sizeof(Light_Point));
     }
-    SDL_SubmitGPUCommandBuffer(command_buffer);
 
     return true;
 }
 
-// TODO I need to figure out a proper way to size these shadow maps
-void Lights_UpdateShadowMatrices_Directional(vec3 light_dir_world)
+// After changing lights_spot[index] or lights_point[index] in place; appended lights are picked up on their own
+void Lights_MarkDirty_Spot(size_t index)
+{
+    if (index < MAX_SPOT_LIGHTS) lights_spot_dirty[index] = true;
+}
+
+void Lights_MarkDirty_Point(size_t index)
+{
+    if (index < MAX_POINT_LIGHTS) lights_point_dirty[index] = true;
+}
+
+// Fits an orthographic box around the sphere, its center snapped to whole texels in light space
+static void Lights_PlaceCascade(Shadow_Cascade* cascade, vec3 center_world, float radius)
 {
-    // glm_vec3_normalize(light_dir_world);
+    float texel_size = 2.0f * radius / (float)SHADOW_MAP_SIZE;
+    vec3 center_light;
+    glm_mat4_mulv3(light_view_matrix, center_world, 1.0f, center_light);
+    center_light[0] = SDL_floorf(center_light[0] / texel_size) * texel_size;
+    center_light[1] = SDL_floorf(center_light[1] / texel_size) * texel_size;
+
+    // casters up to SHADOW_CASTER_DISTANCE towards the light still land in the box
+    mat4 projection;
+    glm_ortho
+    (
+        center_light[0] - radius, center_light[0] + radius,
+        center_light[1] - radius, center_light[1] + radius,
+        center_light[2] - radius - SHADOW_CASTER_DISTANCE, center_light[2] + radius,
+        projection
+    );
+    glm_mat4_copy(light_view_matrix, cascade->view.view_matrix);
+    glm_mat4_mul(projection, light_view_matrix, cascade->view.view_projection_matrix);
+    Frustum_FromMatrix(cascade->view.view_projection_matrix, false, &cascade->view.frustum);
+
+    // the view is a rotation, so its transpose takes the snapped center back
+    mat4 light_to_world;
+    glm_mat4_transpose_to(light_view_matrix, light_to_world);
+    glm_mat4_mulv3(light_to_world, center_light, 1.0f, cascade->center);
+    cascade->radius = radius;
+    cascade->depth_range = 2.0f * radius + SHADOW_CASTER_DISTANCE;
+}
+
+// Places this frame's cascades (see lights.h) and fills shadow_settings for the main pass
+// light_view_matrix is the light's rotation, shared by every cascade; light_viewproj_matrix is a box around all of them,
+// which is what models and the GPU culling test shadow casters against
+void Lights_UpdateShadowCascades(vec3 light_direction_world)
+{
+    vec3 direction;
+    glm_vec3_normalize_to(light_direction_world, direction);
+    vec3 up = { 0.0f, 1.0f, 0.0f };
+    if (SDL_fabsf(glm_vec3_dot(direction, up)) > 0.99f) glm_vec3_copy((vec3){ 0.0f, 0.0f, 1.0f }, up);
+
+    // the light looks down +z; turning it moves every cascade, cached or not
+    mat4 light_rotation;
+    glm_look(GLM_VEC3_ZERO, direction, up, light_rotation);
+    if (SDL_memcmp(light_rotation, light_view_matrix, sizeof(mat4)) != 0)
+    {
+        for (int i = 0; i < SHADOW_CASCADE_COUNT; i++) shadow_cascades[i].static_valid = false;
+        glm_mat4_copy(light_rotation, light_view_matrix);
+    }
 
     mat4 inverse_camera_view;
     glm_mat4_inv(camera_active->view_matrix, inverse_camera_view);
 
-    vec3 cam_pos = { inverse_camera_view[3][0], inverse_camera_view[3][1], inverse_camera_view[3][2] };
-    vec3 cam_fwd = { -inverse_camera_view[2][0], -inverse_camera_view[2][1], -inverse_camera_view[2][2] };
+    // squared slope of the camera frustum's corner rays; view space z is the distance along the view direction
+    float tan_half_x = 1.0f / camera_active->projection_matrix[0][0];
+    float tan_half_y = 1.0f / camera_active->projection_matrix[1][1];
+    float corner_slope_squared = tan_half_x * tan_half_x + tan_half_y * tan_half_y;
 
-    // Focus the shadow box around a point in front of the camera
-    vec3 focus;
-    glm_vec3_scale(cam_fwd, 25.0f, focus); // 25m ahead
-    glm_vec3_add(cam_pos, focus, focus);
+    // practical split scheme: a blend of logarithmic and uniform splits
+    float near_plane = camera_active->near_plane;
+    float far_plane = SDL_min(SHADOW_DISTANCE, camera_active->far_plane);
+    float splits[SHADOW_CASCADE_COUNT + 1];
+    for (int i = 0; i <= SHADOW_CASCADE_COUNT; i++)
+    {
+        float t = (float)i / (float)SHADOW_CASCADE_COUNT;
+        float split_logarithmic = near_plane * SDL_powf(far_plane / near_plane, t);
+        float split_uniform = near_plane + (far_plane - near_plane) * t;
+        splits[i] = SHADOW_CASCADE_SPLIT_LAMBDA * split_logarithmic + (1.0f - SHADOW_CASCADE_SPLIT_LAMBDA) * split_uniform;
+    }
 
-    // Place the light a bit "back" along its direction
-    vec3 light_pos;
-    vec3 back;
-    glm_vec3_scale(light_dir_world, -50.0f, back);
-    glm_vec3_add(focus, back, light_pos);
+    vec2 bounds_min = { FLT_MAX, FLT_MAX };
+    vec2 bounds_max = { -FLT_MAX, -FLT_MAX };
+    float bounds_near = FLT_MAX;
+    float bounds_far = -FLT_MAX;
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        Shadow_Cascade* cascade = &shadow_cascades[i];
 
-    vec3 up = { 0.0f, 1.0f, 0.0f };
-    glm_lookat(light_pos, focus, up, light_view_matrix);
+        // smallest sphere around the slice: its center is on the view axis, as far from the near corners as from the far ones
+        float slice_near = splits[i];
+        float slice_far = splits[i + 1];
+        float center_distance = SDL_min(slice_far, 0.5f * (slice_near + slice_far) * (1.0f + corner_slope_squared));
+        float offset = slice_far - center_distance;
+        float slice_radius = SDL_sqrtf(offset * offset + slice_far * slice_far * corner_slope_squared);
+        vec3 slice_center;
+        glm_mat4_mulv3(inverse_camera_view, (vec3){ 0.0f, 0.0f, center_distance }, 1.0f, slice_center);
 
-    // Ortho projection covering a box around the focus point
-    glm_ortho(-SHADOW_ORTHO_HALF_WIDTH, SHADOW_ORTHO_HALF_WIDTH,
-              -SHADOW_ORTHO_HALF_WIDTH, SHADOW_ORTHO_HALF_WIDTH,
-              SHADOW_NEAR, SHADOW_FAR, light_proj_matrix);
+        // rounded up, so it doesn't change size with floating point noise as the camera turns
+        if (i < SHADOW_CASCADE_FIRST_CACHED)
+        {
+            Lights_PlaceCascade(cascade, slice_center, SDL_ceilf(slice_radius * 16.0f) / 16.0f);
+        }
+        else
+        {
+            float radius = SDL_ceilf(slice_radius * (1.0f + SHADOW_CASCADE_CACHE_MARGIN) * 16.0f) / 16.0f;
+            bool covers_slice = cascade->static_valid && cascade->radius == radius &&
+                glm_vec3_distance(slice_center, cascade->center) + slice_radius <= radius;
+            if (!covers_slice)
+            {
+                Lights_PlaceCascade(cascade, slice_center, radius);
+                cascade->static_valid = false;
+            }
+        }
 
-    // Cache VP
+        vec3 center_light;
+        glm_mat4_mulv3(light_view_matrix, cascade->center, 1.0f, center_light);
+        bounds_min[0] = SDL_min(bounds_min[0], center_light[0] - cascade->radius);
+        bounds_min[1] = SDL_min(bounds_min[1], center_light[1] - cascade->radius);
+        bounds_max[0] = SDL_max(bounds_max[0], center_light[0] + cascade->radius);
+        bounds_max[1] = SDL_max(bounds_max[1], center_light[1] + cascade->radius);
+        bounds_near = SDL_min(bounds_near, center_light[2] - cascade->radius - SHADOW_CASTER_DISTANCE);
+        bounds_far = SDL_max(bounds_far, center_light[2] + cascade->radius);
+
+        glm_mat4_mul(cascade->view.view_projection_matrix, inverse_camera_view, shadow_settings.view_to_cascade[i]);
+        shadow_settings.cascade_bias[i] = SHADOW_BIAS / cascade->depth_range;
+    }
+
+    glm_ortho(bounds_min[0], bounds_max[0], bounds_min[1], bounds_max[1], bounds_near, bounds_far, light_proj_matrix);
     glm_mat4_mul(light_proj_matrix, light_view_matrix, light_viewproj_matrix);
-    SHADOW_FAR = 150.0f;
+
+    shadow_settings.texel_size[0] = 1.0f / (float)(2 * SHADOW_MAP_SIZE);
+    shadow_settings.texel_size[1] = 1.0f / (float)(2 * SHADOW_MAP_SIZE);
+    shadow_settings.pcf_radius = SHADOW_PCF_RADIUS;
+    shadow_settings.blur_reach = (settings_render & SETTINGS_RENDER_FILTERED_SHADOWS) ? 4.0f * SHADOW_MOMENTS_BLUR_STRIDE : 0.0f;
 }
 
-void Lights_UpdateShadowMatrices_Spot(Light_Spot* light)
+// the spot shadow atlas as a grid of SPOT_SHADOW_TILE_MIN cells; a tile n cells wide starts on a multiple of n,
+// so tiles of different sizes pack without gaps
+#define SPOT_SHADOW_GRID_SIZE (SPOT_SHADOW_ATLAS_SIZE / SPOT_SHADOW_TILE_MIN)
+static bool spot_shadow_cells[SPOT_SHADOW_GRID_SIZE][SPOT_SHADOW_GRID_SIZE]; // [y][x], in use
+
+static void Lights_MarkSpotShadowCells(int cell_x, int cell_y, int cell_count, bool used)
 {
-    vec3 up = { 0.0f, 1.0f, 0.0f };
-    glm_lookat(light->position, light->target, up, light_view_matrix);
+    for (int y = cell_y; y < cell_y + cell_count; y++)
+    {
+        for (int x = cell_x; x < cell_x + cell_count; x++)
+        {
+            spot_shadow_cells[y][x] = used;
+        }
+    }
+}
 
-    // 'cutoff_outer' is stored as cos(half_angle)
-    float fov = SDL_acosf(light->cutoff_outer) * 2.0f; // full cone angle in radians
+static void Lights_FreeSpotShadowTile(Spot_Shadow* shadow)
+{
+    if (shadow->tile_size == 0) return;
+    lights_spot_dirty[shadow - spot_shadows] = true;
+    Lights_MarkSpotShadowCells(shadow->tile_x / SPOT_SHADOW_TILE_MIN, shadow->tile_y / SPOT_SHADOW_TILE_MIN, shadow->tile_size / SPOT_SHADOW_TILE_MIN, false);
+    shadow->tile_size = 0;
+}
 
-    float aspect_ratio = 1.0f;
-    glm_perspective(fov, aspect_ratio, SHADOW_NEAR, SHADOW_FAR, light_proj_matrix);
+static bool Lights_AllocateSpotShadowTile(Spot_Shadow* shadow, Uint16 tile_size)
+{
+    int cell_count = tile_size / SPOT_SHADOW_TILE_MIN;
+    for (int cell_y = 0; cell_y + cell_count <= SPOT_SHADOW_GRID_SIZE; cell_y += cell_count)
+    {
+        for (int cell_x = 0; cell_x + cell_count <= SPOT_SHADOW_GRID_SIZE; cell_x += cell_count)
+        {
+            bool free = true;
+            for (int y = cell_y; free && y < cell_y + cell_count; y++)
+            {
+                for (int x = cell_x; free && x < cell_x + cell_count; x++)
+                {
+                    free = !spot_shadow_cells[y][x];
+                }
+            }
+            if (!free) continue;
 
-    // Cache VP
-    glm_mat4_mul(light_proj_matrix, light_view_matrix, light_viewproj_matrix);
-    SHADOW_FAR = 15.0f;
-}
\ No newline at end of file
+            Lights_MarkSpotShadowCells(cell_x, cell_y, cell_count, true);
+            shadow->tile_x = (Uint16)(cell_x * SPOT_SHADOW_TILE_MIN);
+            shadow->tile_y = (Uint16)(cell_y * SPOT_SHADOW_TILE_MIN);
+            shadow->tile_size = tile_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whenever the atlas is (re)created: every light needs a new tile
+void Lights_ResetSpotShadows(void)
+{
+    SDL_zeroa(spot_shadow_cells);
+    for (int i = 0; i < MAX_SPOT_LIGHTS; i++)
+    {
+        if (spot_shadows[i].tile_size > 0) lights_spot_dirty[i] = true;
+        spot_shadows[i].tile_size = 0;
+        spot_shadows[i].redraw = false;
+    }
+}
+
+// Removes lights_spot[index]; the lights after it move down one, taking their shadow tiles along, and are uploaded again
+bool Lights_RemoveSpot(size_t index)
+{
+    size_t count = Array_Len(lights_spot);
+    if (index >= count) return false;
+
+    if (index < MAX_SPOT_LIGHTS)
+    {
+        size_t shadow_count = SDL_min(count, MAX_SPOT_LIGHTS);
+        Lights_FreeSpotShadowTile(&spot_shadows[index]);
+        SDL_memmove(&spot_shadows[index], &spot_shadows[index + 1], sizeof(Spot_Shadow) * (shadow_count - index - 1));
+        SDL_zero(spot_shadows[shadow_count - 1]); // a light moving in from past MAX_SPOT_LIGHTS starts without a tile
+        for (size_t i = index; i < shadow_count; i++) lights_spot_dirty[i] = true;
+    }
+    return Array_DeleteShift(lights_spot, index);
+}
+
+// Removes lights_point[index]; the lights after it move down one and are uploaded again
+bool Lights_RemovePoint(size_t index)
+{
+    size_t count = Array_Len(lights_point);
+    if (index >= count) return false;
+
+    for (size_t i = index; i < SDL_min(count, MAX_POINT_LIGHTS); i++) lights_point_dirty[i] = true;
+    return Array_DeleteShift(lights_point, index);
+}
+
+// Where the light falls below 1/256 of its strength, at most SPOT_SHADOW_MAX_RANGE
+static float Lights_GetSpotRange(const Light_Spot* light)
+{
+    // 1 + linear * d + quadratic * d^2 = 256
+    float linear = light->attenuation_constant_linear;
+    float quadratic = light->attenuation_constant_quadratic;
+    float range = SPOT_SHADOW_MAX_RANGE;
+    if (quadratic > 0.0f) range = (-linear + SDL_sqrtf(linear * linear + 4.0f * quadratic * 255.0f)) / (2.0f * quadratic);
+    else if (linear > 0.0f) range = 255.0f / linear;
+    return SDL_clamp(range, SPOT_SHADOW_NEAR * 2.0f, SPOT_SHADOW_MAX_RANGE);
+}
+
+// The tile size that gives the cone about as many texels as it covers pixels on screen
+static Uint16 Lights_GetSpotShadowTileSize(const Light_Spot* light, float range)
+{
+    // a sphere around the cone: centered halfway along it, reaching the rim of its far end
+    vec3 direction;
+    glm_vec3_sub((float*)light->target, (float*)light->position, direction);
+    glm_vec3_normalize(direction);
+    vec3 center;
+    glm_vec3_scale(direction, 0.5f * range, center);
+    glm_vec3_add(center, (float*)light->position, center);
+    float sin_half_angle = SDL_sqrtf(SDL_max(0.0f, 1.0f - light->cutoff_outer * light->cutoff_outer));
+    float radius = SDL_sqrtf(0.25f * range * range + range * range * sin_half_angle * sin_half_angle);
+
+    // the sphere's diameter in pixels actually drawn (render_scale included), or the whole screen once the camera is inside it
+    float distance = glm_vec3_distance(center, camera_active->position);
+    float screen_fraction = distance > radius ? radius * camera_active->projection_matrix[1][1] / distance : 1.0f;
+    float pixels = screen_fraction * (float)render_height;
+
+    Uint16 tile_size = SPOT_SHADOW_TILE_MIN;
+    while (tile_size < SPOT_SHADOW_TILE_MAX && (float)tile_size < pixels) tile_size *= 2;
+    return tile_size;
+}
+
+// Takes a tile for the light (or a smaller one when the atlas is too full) and places its view in it
+static void Lights_PlaceSpotShadow(const Light_Spot* light, Spot_Shadow* shadow, Uint16 tile_size, float range)
+{
+    Lights_FreeSpotShadowTile(shadow);
+    while (tile_size >= SPOT_SHADOW_TILE_MIN && !Lights_AllocateSpotShadowTile(shadow, tile_size)) tile_size /= 2;
+    if (shadow->tile_size == 0)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Spot shadow atlas is full; a light is drawn without shadows");
+        return;
+    }
+
+    vec3 direction;
+    glm_vec3_sub((float*)light->target, (float*)light->position, direction);
+    glm_vec3_normalize(direction);
+    vec3 up = {0.0f, 1.0f, 0.0f};
+    if (SDL_fabsf(direction[1]) > 0.99f) glm_vec3_copy((vec3){0.0f, 0.0f, 1.0f}, up);
+
+    mat4 projection;
+    float field_of_view = SDL_min(2.0f * SDL_acosf(light->cutoff_outer), glm_rad(170.0f));
+    glm_look((float*)light->position, direction, up, shadow->view.view_matrix);
+    glm_perspective(field_of_view, 1.0f, SPOT_SHADOW_NEAR, range, projection);
+    glm_mat4_mul(projection, shadow->view.view_matrix, shadow->view.view_projection_matrix);
+    Frustum_FromMatrix(shadow->view.view_projection_matrix, false, &shadow->view.frustum);
+
+    glm_vec3_copy((float*)light->position, shadow->position);
+    glm_vec3_copy((float*)light->target, shadow->target);
+    shadow->cutoff_outer = light->cutoff_outer;
+    shadow->range = range;
+    shadow->static_generation = static_geometry_generation;
+    shadow->redraw = true;
+    lights_spot_dirty[shadow - spot_shadows] = true;
+}
+
+static bool Lights_SpotShadowHasDynamicCasters(const Spot_Shadow* shadow)
+{
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        const Model* model = &models_bone_animated[i].model;
+        if (Frustum_IntersectsAABB(&shadow->view.frustum, model->aabb_min, model->aabb_max)) return true;
+    }
+    return false;
+}
+
+// Picks this frame's spot shadow tile updates (see lights.h), at most SPOT_SHADOW_UPDATE_BUDGET of them
+// the others keep the tile and the view projection they were drawn with
+void Lights_UpdateSpotShadows(void)
+{
+    int candidates[MAX_SPOT_LIGHTS];
+    float priorities[MAX_SPOT_LIGHTS];
+    Uint16 tile_sizes[MAX_SPOT_LIGHTS];
+    float ranges[MAX_SPOT_LIGHTS];
+    int candidate_count = 0;
+
+    size_t light_count = SDL_min(Array_Len(lights_spot), MAX_SPOT_LIGHTS);
+    for (size_t i = light_count; i < MAX_SPOT_LIGHTS; i++)
+    {
+        Lights_FreeSpotShadowTile(&spot_shadows[i]);
+        spot_shadows[i].redraw = false;
+    }
+
+    for (size_t i = 0; i < light_count; i++)
+    {
+        const Light_Spot* light = &lights_spot[i];
+        Spot_Shadow* shadow = &spot_shadows[i];
+        shadow->redraw = false;
+        if (!light->shadow_caster)
+        {
+            Lights_FreeSpotShadowTile(shadow);
+            continue;
+        }
+        // nothing is drawn, so the tiles stay as they were last drawn
+        if (!(settings_render & SETTINGS_RENDER_ENABLE_SHADOWS)) continue;
+
+        ranges[i] = Lights_GetSpotRange(light);
+        tile_sizes[i] = Lights_GetSpotShadowTileSize(light, ranges[i]);
+
+        float priority = FLT_MAX; // no tile yet
+        if (shadow->tile_size > 0)
+        {
+            float change = 0.0f;
+            bool moved = 
+                !glm_vec3_eqv_eps((float*)light->position, shadow->position) || 
+                !glm_vec3_eqv_eps((float*)light->target, shadow->target) || 
+                light->cutoff_outer != shadow->cutoff_outer || 
+                ranges[i] != shadow->range;
+            if (moved) change += 4.0f;
+            if (shadow->static_generation != static_geometry_generation) change += 2.0f;
+            if (tile_sizes[i] != shadow->tile_size) change += 1.0f;
+            if (Lights_SpotShadowHasDynamicCasters(shadow)) change += 1.0f;
+            if (change == 0.0f)
+            {
+                shadow->frames_waiting = 0;
+                continue;
+            }
+
+            float distance = glm_vec3_distance((float*)light->position, camera_active->position);
+            priority = change * (float)(1 + shadow->frames_waiting) / (1.0f + distance);
+        }
+        shadow->frames_waiting++;
+
+        // insertion sort, highest priority first
+        int slot = candidate_count++;
+        while (slot > 0 && priorities[slot - 1] < priority)
+        {
+            candidates[slot] = candidates[slot - 1];
+            priorities[slot] = priorities[slot - 1];
+            slot--;
+        }
+        candidates[slot] = (int)i;
+        priorities[slot] = priority;
+    }
+
+    for (int i = 0; i < candidate_count && i < SPOT_SHADOW_UPDATE_BUDGET; i++)
+    {
+        int light_index = candidates[i];
+        Spot_Shadow* shadow = &spot_shadows[light_index];
+        Lights_PlaceSpotShadow(&lights_spot[light_index], shadow, tile_sizes[light_index], ranges[light_index]);
+        shadow->frames_waiting = 0;
+    }
+}
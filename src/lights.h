@@ -7,6 +7,7 @@
 #define CGLM_FORCE_LEFT_HANDED
 #include "../external/cglm/cglm.h"
 #include "helper.h"
+#include "frustum.h"
 
 // already a direction, so no need to calc `lightPosVS - input.PositionVS`
 // no need to calc attentuation - assumed to be none
@@ -18,6 +19,10 @@ Struct (Light_Directional)
     Uint32 shadow_caster;
 };
 
+// point and spot lights are kept, and uploaded, in world space; after changing one in place, mark it
+// (Lights_MarkDirty_Point, Lights_MarkDirty_Spot) so that Lights_Upload copies it again
+// append new lights to the arrays directly, but remove them with Lights_RemovePoint / Lights_RemoveSpot: the lights after
+// a removed one move down, and those keep their uploaded copies and spot shadow tiles in line with them
 Struct (Light_Point)
 {
     vec3 position;
@@ -36,7 +41,7 @@ Struct (Light_Spot)
     union
     {
         vec3 target; // used on the CPU side for convenience
-        vec3 direction; // calculated just before upload to GPU
+        vec3 direction; // normalized, written at upload
     };
 
     // these angles are saved as SDL_cosf(glm_rad(angle in degrees))
@@ -44,9 +49,14 @@ Struct (Light_Spot)
     float cutoff_inner;
     float cutoff_outer;
     
-    Uint32 shadow_caster;
+    Uint32 shadow_caster; // uploaded as whether the light has a tile in the spot shadow atlas
+
+    float shadow_bias_scale; // upload only: SHADOW_BIAS in the tile's depth units is shadow_bias_scale / w^2
+    float _padding;
 
-    float _padding[2]; // pad to vec4 size
+    // upload only, from the light's Spot_Shadow
+    mat4 shadow_world_to_clip; // the light's view projection as its tile was last drawn
+    vec4 shadow_atlas_rect;   // of the tile in uv: offset xy, size zw
 };
 
 // used in hemispheric (pseudo-IBL) lighting
@@ -60,17 +70,95 @@ Struct (Light_Hemisphere)
     float _padding3;
 };
 
+/*
+    Cascaded shadow maps
+    the directional light's shadows are split by view distance into SHADOW_CASCADE_COUNT cascades, tiles of a 2x2 atlas
+    (shadow_map_texture) of SHADOW_MAP_SIZE each; every cascade is an orthographic box around the bounding sphere
+    of its slice of the camera frustum, so it has the same size however the camera turns, and its center is snapped
+    to whole texels in light space, so moving the camera doesn't make its edges crawl
+    the main pass reads the first cascade a fragment is inside of
+    cascades from SHADOW_CASCADE_FIRST_CACHED on keep their static casters (unanimated and instanced models) in a layer
+    of their own (shadow_cache_textures) that is only redrawn when the cascade moves or static geometry changes
+    (static_geometry_generation); every frame it is written into the atlas (pipeline_shadow_composite) and only the
+    dynamic casters (bone animated models) are drawn over it. Their spheres are SHADOW_CASCADE_CACHE_MARGIN larger than the slice's, and they only
+    move once the slice's sphere would leave theirs
+    with SETTINGS_RENDER_FILTERED_SHADOWS the atlas is turned into exponential variance moments (shadow_moments_textures)
+    and blurred every frame, so the main pass resolves a soft shadow from one filtered sample instead of PCF taps
+*/
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_CASCADE_FIRST_CACHED 1 // cascades before it are redrawn in full every frame
+
+// what a shadow map tile is drawn with
+Struct (Shadow_View)
+{
+    mat4 view_matrix;            // world -> light view space; casters are sorted by depth in it
+    mat4 view_projection_matrix; // world -> the tile's clip space
+    Frustum frustum;             // of view_projection_matrix, without the near plane (casters are clamped onto it)
+};
+
+Struct (Shadow_Cascade)
+{
+    Shadow_View view;            // light_view_matrix, then an orthographic box
+    vec3 center;                 // world space, snapped to the cascade's texels
+    float radius;
+    float depth_range;           // of the orthographic box, in world units
+    Uint32 static_generation;    // static_geometry_generation the cached layer was drawn with
+    bool static_valid;           // the cached layer matches this placement; cleared when the cascade moves
+    Uint8 _padding[3];
+};
+
+// UBO_Main_Frag; the shaders' copy is in pbr_alphatest.frag
 Struct (Shadow_Settings) 
 {
-    vec2 texel_size; // 1/width, 1/height
-    float bias;
-    float pcf_radius; // in texels
+    mat4 view_to_cascade[SHADOW_CASCADE_COUNT]; // camera view space -> cascade clip space
+    vec4 cascade_bias;  // SHADOW_BIAS in each cascade's depth units
+    vec2 texel_size;    // of the atlas: 1/width, 1/height
+    float pcf_radius;   // in texels
+    float blur_reach;   // in texels: how far the moments blur spreads a tile's edge, 0 without filtered shadows
+};
+
+/*
+    Spot light shadows
+    every spot light that casts shadows gets a square tile of the spot shadow atlas (spot_shadow_atlas_texture), sized by
+    how much of the screen its cone covers: a power of two from SPOT_SHADOW_TILE_MIN to SPOT_SHADOW_TILE_MAX
+    a tile keeps what was drawn into it until its light is picked for an update, at most SPOT_SHADOW_UPDATE_BUDGET a frame:
+    lights without a tile first, then by what changed (the light moved, static geometry changed, its tile should be
+    another size, animated models are in its cone) over the distance to the camera, times how long they have waited
+    the main pass reads a tile with the view projection it was drawn with, so a light that waits stays consistent
+    a light that can't get a tile (the atlas is full) is unshadowed until one frees up
+*/
+#define SPOT_SHADOW_ATLAS_SIZE 2048
+#define SPOT_SHADOW_TILE_MIN 128
+#define SPOT_SHADOW_TILE_MAX 1024
+#define SPOT_SHADOW_UPDATE_BUDGET 4
+#define SPOT_SHADOW_NEAR 0.1f
+#define SPOT_SHADOW_MAX_RANGE 25.0f // far plane of lights without attenuation, and the most any light gets
+
+Struct (Spot_Shadow)
+{
+    Shadow_View view;         // as the tile was last drawn
+    vec3 position;            // of the light when the tile was drawn
+    float cutoff_outer;
+    vec3 target;
+    float range;              // far plane
+    Uint32 static_generation; // static_geometry_generation the tile was drawn with
+    Uint32 frames_waiting;    // since the light first needed an update
+    Uint16 tile_x;            // in texels
+    Uint16 tile_y;
+    Uint16 tile_size;         // 0 while the light has no tile
+    bool redraw;              // the tile is drawn this frame
+    Uint8 _padding;
 };
 
 bool Lights_Update();
 bool Lights_LoadLights();
-bool Lights_StorageBuffer_UpdateAndUpload();
-void Lights_UpdateShadowMatrices_Directional(vec3 light_dir_world);
-void Lights_UpdateShadowMatrices_Spot(Light_Spot* light);
+bool Lights_Upload(SDL_GPUCopyPass* copy_pass);
+void Lights_MarkDirty_Spot(size_t index);
+void Lights_MarkDirty_Point(size_t index);
+bool Lights_RemoveSpot(size_t index);
+bool Lights_RemovePoint(size_t index);
+void Lights_UpdateShadowCascades(vec3 light_direction_world);
+void Lights_UpdateSpotShadows(void);
+void Lights_ResetSpotShadows(void);
 
 #endif // LIGHTS_H
\ No newline at end of file
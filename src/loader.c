@@ -0,0 +1,759 @@
+#include "loader.h"
+#include "globals.h"
+#include "model.h"
+#include "hotreload.h"
+#include "streamer.h"
+#include "gpumemory.h"
+
+/*
+    A request moves through two queues:
+    loader_requests (main thread -> workers): a worker imports the scene into a Model_SceneData,
+    then pushes its work items onto loader_uploads (workers -> main thread) in the order they have to be applied:
+        COLLISION, one MESH per mesh, one MATERIAL per mesh (pushed as each mesh's textures finish decoding), COMPLETE
+    Loader_Update pops items until the frame budget is spent, copies them into a staging transfer buffer,
+    records every upload of the frame into one copy pass and submits it ahead of the frame's draw commands
+*/
+
+Enum (Uint8, Loader_UploadType)
+{
+    LOADER_UPLOAD_COLLISION, // colliders, occluders and triggers; no GPU work
+    LOADER_UPLOAD_MESH,      // vertex and index buffers; the model is drawn with material_loading from here on
+    LOADER_UPLOAD_MATERIAL,  // the three textures of a mesh
+    LOADER_UPLOAD_COMPLETE,  // fires the callback and frees the request
+};
+
+Struct (Loader_Request)
+{
+    char filename[MAXIMUM_URI_LENGTH];
+    Loader_Callback callback;
+    void* userdata;
+    Uint32 scene_id;
+    Model_SceneData scene;
+    Sint32* model_indices; // per scene mesh: index into models_unanimated, models_instanced or models_bone_animated once uploaded, -1 before
+    bool success;          // main thread only
+};
+
+Struct (Loader_Upload)
+{
+    Loader_Request* request;
+    Uint32 mesh_index;
+    Uint32 size;     // bytes needed in a transfer buffer
+    Loader_UploadType type;
+    bool success;    // false if the worker failed to prepare it
+};
+
+// an upload popped this frame; already copied into a transfer buffer, recorded once the staging buffer is unmapped
+Struct (Loader_PendingUpload)
+{
+    Loader_Upload upload;
+    SDL_GPUTransferBuffer* transfer_buffer; // NULL if there is nothing to record
+    Uint32 offset;
+    bool owns_transfer_buffer; // too big for the staging buffer
+};
+
+Struct (Loader_Staging)
+{
+    Uint8* mapped;
+    Uint32 used;
+};
+
+static SDL_Thread* loader_workers[LOADER_MAX_WORKERS];
+static int loader_worker_count = 0;
+static SDL_Mutex* loader_mutex = NULL;
+static SDL_Condition* loader_condition = NULL;
+static SDL_AtomicInt loader_quit;
+static Loader_Request* Array loader_requests = NULL; // waiting for a worker
+static Loader_Upload Array loader_uploads = NULL;    // ready for the main thread, in order
+static Uint32 loader_requests_in_flight = 0;         // main thread only
+static Uint32 loader_next_scene_id = 1;              // main thread only; 0 is never handed out
+static SDL_GPUTransferBuffer* loader_transfer_buffer = NULL;
+
+// Workers ////////////
+
+static void Loader_PushUpload(Loader_Request* request, Loader_UploadType type, Uint32 mesh_index, Uint32 size, bool success)
+{
+    Loader_Upload upload =
+    {
+        .request = request,
+        .mesh_index = mesh_index,
+        .size = size,
+        .type = type,
+        .success = success,
+    };
+
+    SDL_LockMutex(loader_mutex);
+    bool appended = Array_Append(loader_uploads, upload);
+    SDL_UnlockMutex(loader_mutex);
+
+    if (!appended)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to queue upload for %s; the request will never complete", request->filename);
+    }
+}
+
+static void Loader_PrepareScene(Loader_Request* request)
+{
+    if (!Model_LoadSceneData(request->filename, &request->scene))
+    {
+        Loader_PushUpload(request, LOADER_UPLOAD_COMPLETE, 0, 0, false);
+        return;
+    }
+
+    Uint32 mesh_count = (Uint32)Array_Len(request->scene.meshes);
+    request->model_indices = SDL_malloc(sizeof(Sint32) * SDL_max(mesh_count, 1));
+    if (request->model_indices == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate model indices: %s", request->filename);
+        Loader_PushUpload(request, LOADER_UPLOAD_COMPLETE, 0, 0, false);
+        return;
+    }
+    for (Uint32 i = 0; i < mesh_count; i++) request->model_indices[i] = -1;
+
+    // geometry goes out before any texture is decoded so the scene shows up (with the loading material) as early as possible
+    Loader_PushUpload(request, LOADER_UPLOAD_COLLISION, 0, 0, true);
+    for (Uint32 i = 0; i < mesh_count; i++)
+    {
+        Loader_PushUpload(request, LOADER_UPLOAD_MESH, i, Model_GetMeshTransferSize(&request->scene.meshes[i]), true);
+    }
+
+    // from here the main thread may read the geometry of request->scene.meshes, but only the worker writes the textures
+    bool success = true;
+    for (Uint32 i = 0; i < mesh_count; i++)
+    {
+        Model_MeshData* mesh_data = &request->scene.meshes[i];
+        bool loaded = !SDL_GetAtomicInt(&loader_quit) && Model_MeshData_LoadTextures(mesh_data);
+        Loader_PushUpload(request, LOADER_UPLOAD_MATERIAL, i, loaded ? Model_GetMaterialTransferSize(mesh_data) : 0, loaded);
+        success = success && loaded;
+    }
+
+    Loader_PushUpload(request, LOADER_UPLOAD_COMPLETE, 0, 0, success);
+}
+
+static int SDLCALL Loader_WorkerThread(void* data)
+{
+    (void)data;
+
+    for (;;)
+    {
+        SDL_LockMutex(loader_mutex);
+        while (!SDL_GetAtomicInt(&loader_quit) && Array_Len(loader_requests) == 0)
+        {
+            SDL_WaitCondition(loader_condition, loader_mutex);
+        }
+        if (SDL_GetAtomicInt(&loader_quit))
+        {
+            SDL_UnlockMutex(loader_mutex);
+            return 0;
+        }
+        Loader_Request* request = loader_requests[0];
+        Array_DeleteShift(loader_requests, 0);
+        SDL_UnlockMutex(loader_mutex);
+
+        Loader_PrepareScene(request);
+    }
+}
+
+// Main Thread ////////////
+
+static Mesh* Loader_GetMesh(Loader_Request* request, Uint32 mesh_index)
+{
+    Sint32 model_index = request->model_indices[mesh_index];
+    if (model_index < 0) return NULL;
+    if (request->scene.meshes[mesh_index].is_bone_animated)
+        return &models_bone_animated[model_index].model.mesh;
+    else if (request->scene.meshes[mesh_index].is_instanced)
+        return &models_instanced[model_index].mesh;
+    else
+        return &models_unanimated[model_index].mesh;
+}
+
+// Copies one item into the staging buffer, or into a dedicated transfer buffer if it would not fit
+static bool Loader_CopyToTransferBuffer(Loader_PendingUpload* pending, const Model_MeshData* mesh_data, void (*copy)(const Model_MeshData*, Uint8*), Loader_Staging* staging)
+{
+    Uint32 size = pending->upload.size;
+    Uint32 offset = (staging->used + 15) & ~15u; // keep every item block aligned
+
+    if (offset + size <= LOADER_FRAME_BUDGET_BYTES)
+    {
+        if (staging->mapped == NULL)
+        {
+            // cycled, since last frame's uploads may still be reading from it
+            staging->mapped = SDL_MapGPUTransferBuffer(gpu_device, loader_transfer_buffer, true);
+            if (staging->mapped == NULL)
+            {
+                SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map loader transfer buffer: %s", SDL_GetError());
+                return false;
+            }
+        }
+        copy(mesh_data, staging->mapped + offset);
+        staging->used = offset + size;
+        pending->transfer_buffer = loader_transfer_buffer;
+        pending->offset = offset;
+        return true;
+    }
+
+    SDL_GPUTransferBuffer* transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "loader",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = size
+        }
+    );
+    if (transfer_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+
+    Uint8* transfer_buffer_mapped = SDL_MapGPUTransferBuffer(gpu_device, transfer_buffer, false);
+    if (transfer_buffer_mapped == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map transfer buffer: %s", SDL_GetError());
+        GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+        return false;
+    }
+    copy(mesh_data, transfer_buffer_mapped);
+    SDL_UnmapGPUTransferBuffer(gpu_device, transfer_buffer);
+
+    pending->transfer_buffer = transfer_buffer;
+    pending->offset = 0;
+    pending->owns_transfer_buffer = true;
+    return true;
+}
+
+// CPU side of an item: creates its GPU objects, copies its data and makes it visible to the renderer
+static bool Loader_BeginUpload(Loader_PendingUpload* pending, Loader_Staging* staging)
+{
+    Loader_Request* request = pending->upload.request;
+    Uint32 mesh_index = pending->upload.mesh_index;
+
+    switch (pending->upload.type)
+    {
+        case LOADER_UPLOAD_COLLISION:
+        {
+            for (size_t i = 0; i < Array_Len(request->scene.colliders); i++)
+            {
+                request->scene.colliders[i].scene_id = request->scene_id;
+                if (!Array_Append(colliders, request->scene.colliders[i])) return false;
+            }
+            for (size_t i = 0; i < Array_Len(request->scene.occluders); i++)
+            {
+                request->scene.occluders[i].scene_id = request->scene_id;
+                if (!Array_Append(occluders, request->scene.occluders[i])) return false;
+            }
+            for (size_t i = 0; i < Array_Len(request->scene.triggers); i++)
+            {
+                request->scene.triggers[i].scene_id = request->scene_id;
+                if (!Array_Append(triggers, request->scene.triggers[i])) return false;
+            }
+            return true;
+        }
+        case LOADER_UPLOAD_MESH:
+        {
+            Model_MeshData* mesh_data = &request->scene.meshes[mesh_index];
+
+            Mesh mesh = {0};
+            if (!Model_CreateMeshBuffers(mesh_data, &mesh))
+            {
+                return false;
+            }
+            mesh.material = material_loading;
+
+            if (!Loader_CopyToTransferBuffer(pending, mesh_data, Model_CopyMeshToTransferBuffer, staging))
+            {
+                GPUMemory_ReleaseBuffer(mesh.vertex_buffer);
+                GPUMemory_ReleaseBuffer(mesh.index_buffer);
+                GPUMemory_ReleaseBuffer(mesh.instance_buffer);
+                return false;
+            }
+
+            Model new_model = {0};
+            glm_mat4_copy(mesh_data->model_matrix, new_model.model_matrix);
+            glm_vec3_copy(mesh_data->aabb_min, new_model.aabb_min);
+            glm_vec3_copy(mesh_data->aabb_max, new_model.aabb_max);
+            new_model.mesh = mesh;
+            new_model.scene_id = request->scene_id;
+
+            bool appended;
+            if (mesh_data->is_bone_animated)
+            {
+                Model_BoneAnimated model_bone_animated = {0};
+                model_bone_animated.model = new_model;
+                model_bone_animated.animation_rig = mesh_data->animation_rig;
+                request->model_indices[mesh_index] = (Sint32)Array_Len(models_bone_animated);
+                appended = Array_Append(models_bone_animated, model_bone_animated);
+                if (appended) SDL_zero(mesh_data->animation_rig); // ownership moved to the model
+            }
+            else if (mesh_data->is_instanced)
+            {
+                new_model.submeshes = mesh_data->submeshes;
+                request->model_indices[mesh_index] = (Sint32)Array_Len(models_instanced);
+                appended = Array_Append(models_instanced, new_model);
+                if (appended) mesh_data->submeshes = NULL; // ownership moved to the model
+            }
+            else
+            {
+                new_model.submeshes = mesh_data->submeshes;
+                request->model_indices[mesh_index] = (Sint32)Array_Len(models_unanimated);
+                appended = Array_Append(models_unanimated, new_model);
+                if (appended) mesh_data->submeshes = NULL; // ownership moved to the model
+            }
+
+            if (!appended)
+            {
+                request->model_indices[mesh_index] = -1;
+                GPUMemory_ReleaseBuffer(mesh.vertex_buffer);
+                GPUMemory_ReleaseBuffer(mesh.index_buffer);
+                GPUMemory_ReleaseBuffer(mesh.instance_buffer);
+                if (pending->owns_transfer_buffer) GPUMemory_ReleaseTransferBuffer(pending->transfer_buffer);
+                pending->transfer_buffer = NULL;
+                return false;
+            }
+            if (!mesh_data->is_bone_animated) static_geometry_generation++; // cached shadow layers draw it from now on
+            return true;
+        }
+        case LOADER_UPLOAD_MATERIAL:
+        {
+            Model_MeshData* mesh_data = &request->scene.meshes[mesh_index];
+            Mesh* mesh = Loader_GetMesh(request, mesh_index);
+            if (!pending->upload.success || mesh == NULL)
+            {
+                return false; // keeps drawing with material_loading
+            }
+
+            Material material;
+            if (!Model_CreateMaterial(mesh_data, &material))
+            {
+                return false;
+            }
+            if (!Loader_CopyToTransferBuffer(pending, mesh_data, Model_CopyMaterialToTransferBuffer, staging))
+            {
+                Model_FreeMaterial(&material);
+                return false;
+            }
+
+            mesh->material = material; // replaces material_loading, which is never released
+
+            HotReload_WatchTexture(mesh_data->texture_uris[0], TEXTURE_USAGE_ALBEDO, material.texture_diffuse);
+            HotReload_WatchTexture(mesh_data->texture_uris[1], TEXTURE_USAGE_METALLIC_ROUGHNESS, material.texture_metallic_roughness);
+            HotReload_WatchTexture(mesh_data->texture_uris[2], TEXTURE_USAGE_NORMAL, material.texture_normal);
+            return true;
+        }
+        case LOADER_UPLOAD_COMPLETE:
+            if (!pending->upload.success) request->success = false; // the worker already logged why
+            return true;
+    }
+
+    return false;
+}
+
+static void Loader_RecordUpload(SDL_GPUCopyPass* copy_pass, Loader_PendingUpload* pending)
+{
+    Loader_Request* request = pending->upload.request;
+    Uint32 mesh_index = pending->upload.mesh_index;
+    Mesh* mesh = Loader_GetMesh(request, mesh_index);
+
+    if (pending->upload.type == LOADER_UPLOAD_MESH)
+    {
+        Model_UploadMesh(copy_pass, pending->transfer_buffer, pending->offset, &request->scene.meshes[mesh_index], mesh);
+    }
+    else if (pending->upload.type == LOADER_UPLOAD_MATERIAL)
+    {
+        Model_UploadMaterial(copy_pass, pending->transfer_buffer, pending->offset, &request->scene.meshes[mesh_index], &mesh->material);
+    }
+}
+
+// Runs after the copy pass is submitted; frees CPU copies that are no longer needed and completes requests
+static void Loader_EndUpload(Loader_PendingUpload* pending)
+{
+    Loader_Request* request = pending->upload.request;
+
+    if (pending->owns_transfer_buffer)
+    {
+        GPUMemory_ReleaseTransferBuffer(pending->transfer_buffer);
+    }
+
+    switch (pending->upload.type)
+    {
+        case LOADER_UPLOAD_MESH:
+        {
+            // the worker may still be decoding textures into the same Model_MeshData, so only the geometry is touched
+            Model_MeshData* mesh_data = &request->scene.meshes[pending->upload.mesh_index];
+            SDL_free(mesh_data->vertices);
+            SDL_free(mesh_data->indices);
+            mesh_data->vertices = NULL;
+            mesh_data->indices = NULL;
+            break;
+        }
+        case LOADER_UPLOAD_MATERIAL:
+        {
+            // the levels that were not uploaded stay in RAM with the streamer
+            Model_MeshData* mesh_data = &request->scene.meshes[pending->upload.mesh_index];
+            Mesh* mesh = Loader_GetMesh(request, pending->upload.mesh_index);
+            if (pending->transfer_buffer && mesh)
+            {
+                Streamer_RegisterTexture(mesh->material.texture_diffuse, &mesh_data->textures[0]);
+                Streamer_RegisterTexture(mesh->material.texture_metallic_roughness, &mesh_data->textures[1]);
+                Streamer_RegisterTexture(mesh->material.texture_normal, &mesh_data->textures[2]);
+            }
+            for (int i = 0; i < 3; i++) Texture_Free(&mesh_data->textures[i]);
+            break;
+        }
+        case LOADER_UPLOAD_COMPLETE:
+        {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loaded scene %s%s", request->filename, request->success ? "" : " (with errors)");
+            if (request->callback) request->callback(request->filename, request->scene_id, request->success, request->userdata);
+            Model_FreeSceneData(&request->scene);
+            SDL_free(request->model_indices);
+            SDL_free(request);
+            loader_requests_in_flight--;
+            break;
+        }
+        default: break;
+    }
+}
+
+// Applies finished work until budget_ms has passed or the staging buffer is full; always makes progress on at least one item
+static bool Loader_Drain(double budget_ms)
+{
+    Uint64 start_counter = SDL_GetPerformanceCounter();
+
+    Loader_PendingUpload pending_uploads[LOADER_MAX_UPLOADS_PER_FRAME];
+    int pending_count = 0;
+    Loader_Staging staging = {0};
+    bool success = true;
+
+    while (pending_count < LOADER_MAX_UPLOADS_PER_FRAME)
+    {
+        if (pending_count > 0)
+        {
+            double elapsed_ms = (double)(SDL_GetPerformanceCounter() - start_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+            if (elapsed_ms >= budget_ms) break;
+        }
+
+        SDL_LockMutex(loader_mutex);
+        bool has_upload = Array_Len(loader_uploads) > 0;
+        Loader_Upload upload = has_upload ? loader_uploads[0] : (Loader_Upload){0};
+        // items that don't fit wait for next frame's staging buffer; an oversized item goes alone, in its own transfer buffer
+        bool fits = has_upload && (pending_count == 0 || ((staging.used + 15) & ~15u) + upload.size <= LOADER_FRAME_BUDGET_BYTES);
+        if (fits) Array_DeleteShift(loader_uploads, 0);
+        SDL_UnlockMutex(loader_mutex);
+        if (!fits) break;
+
+        Loader_PendingUpload* pending = &pending_uploads[pending_count++];
+        *pending = (Loader_PendingUpload){ .upload = upload };
+        if (!Loader_BeginUpload(pending, &staging))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load part %d (mesh %u) of scene %s", upload.type, upload.mesh_index, upload.request->filename);
+            upload.request->success = false;
+            success = false;
+        }
+    }
+
+    if (staging.mapped)
+    {
+        SDL_UnmapGPUTransferBuffer(gpu_device, loader_transfer_buffer);
+    }
+
+    bool has_gpu_work = false;
+    for (int i = 0; i < pending_count; i++)
+    {
+        has_gpu_work = has_gpu_work || pending_uploads[i].transfer_buffer != NULL;
+    }
+
+    if (has_gpu_work)
+    {
+        SDL_GPUCommandBuffer* upload_command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
+        if (upload_command_buffer == NULL)
+        {
+            SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to acquire upload command buffer: %s", SDL_GetError());
+            success = false;
+        }
+        else
+        {
+            SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(upload_command_buffer);
+            for (int i = 0; i < pending_count; i++)
+            {
+                if (pending_uploads[i].transfer_buffer) Loader_RecordUpload(copy_pass, &pending_uploads[i]);
+            }
+            SDL_EndGPUCopyPass(copy_pass);
+            SDL_SubmitGPUCommandBuffer(upload_command_buffer);
+        }
+    }
+
+    for (int i = 0; i < pending_count; i++)
+    {
+        Loader_EndUpload(&pending_uploads[i]);
+    }
+
+    return success;
+}
+
+// 1x1 placeholders: mid grey albedo, fully rough dielectric, flat normal
+static bool Loader_CreateLoadingMaterial(void)
+{
+    static const Uint8 pixels[3][4] =
+    {
+        { 128, 128, 128, 255 },
+        { 0, 255, 0, 255 }, // roughness in g, metallic in b
+        { 128, 128, 255, 255 },
+    };
+    const SDL_GPUTextureFormat formats[3] =
+    {
+        SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB,
+        SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
+        SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
+    };
+    MaterialPool_Texture* textures[3] =
+    {
+        &material_loading.texture_diffuse,
+        &material_loading.texture_metallic_roughness,
+        &material_loading.texture_normal,
+    };
+
+    Texture_Data texture_datas[3];
+    for (int i = 0; i < 3; i++)
+    {
+        texture_datas[i] = (Texture_Data)
+        {
+            .format = formats[i],
+            .width = 1,
+            .height = 1,
+            .level_count = 1,
+            .level_offsets = { 0 },
+            .level_sizes = { sizeof(pixels[i]) },
+            .data = pixels[i],
+        };
+        *textures[i] = MaterialPool_Allocate(&texture_datas[i]);
+        if (*textures[i] == MATERIALPOOL_TEXTURE_NONE)
+        {
+            SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to allocate loading texture");
+            return false;
+        }
+    }
+
+    SDL_GPUTransferBuffer* transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "loader",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = sizeof(pixels)
+        }
+    );
+    if (transfer_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create loading texture transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+
+    Uint8* transfer_buffer_mapped = SDL_MapGPUTransferBuffer(gpu_device, transfer_buffer, false);
+    if (transfer_buffer_mapped == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map loading texture transfer buffer: %s", SDL_GetError());
+        GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+        return false;
+    }
+    SDL_memcpy(transfer_buffer_mapped, pixels, sizeof(pixels));
+    SDL_UnmapGPUTransferBuffer(gpu_device, transfer_buffer);
+
+    SDL_GPUCommandBuffer* upload_command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
+    if (upload_command_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to acquire upload command buffer: %s", SDL_GetError());
+        GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+        return false;
+    }
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(upload_command_buffer);
+    for (int i = 0; i < 3; i++)
+    {
+        MaterialPool_Upload(copy_pass, transfer_buffer, (Uint32)(i * sizeof(pixels[i])), &texture_datas[i], *textures[i]);
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_SubmitGPUCommandBuffer(upload_command_buffer);
+
+    GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+
+    return true;
+}
+
+bool Loader_Init(void)
+{
+    SDL_SetAtomicInt(&loader_quit, 0);
+
+    loader_mutex = SDL_CreateMutex();
+    loader_condition = SDL_CreateCondition();
+    if (loader_mutex == NULL || loader_condition == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to create loader mutex: %s", SDL_GetError());
+        return false;
+    }
+
+    Array_Init(loader_requests, 16);
+    Array_Init(loader_uploads, 256);
+    if (loader_requests == NULL || loader_uploads == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate loader queues");
+        return false;
+    }
+
+    loader_transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "loader",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = LOADER_FRAME_BUDGET_BYTES
+        }
+    );
+    if (loader_transfer_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create loader transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+
+    if (!Loader_CreateLoadingMaterial())
+    {
+        return false;
+    }
+
+    // leave a core for the main thread; each worker also fans texture decoding out over its own threads
+    int worker_count = SDL_clamp(SDL_GetNumLogicalCPUCores() - 1, 1, LOADER_MAX_WORKERS);
+    for (int i = 0; i < worker_count; i++)
+    {
+        SDL_Thread* worker = SDL_CreateThread(Loader_WorkerThread, "Loader_Worker", NULL);
+        if (worker == NULL)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to create loader worker: %s", SDL_GetError());
+            continue;
+        }
+        loader_workers[loader_worker_count++] = worker;
+    }
+    if (loader_worker_count == 0)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "No loader workers could be created");
+        return false;
+    }
+
+    return true;
+}
+
+void Loader_Quit(void)
+{
+    if (loader_mutex)
+    {
+        SDL_LockMutex(loader_mutex);
+        SDL_SetAtomicInt(&loader_quit, 1);
+        SDL_BroadcastCondition(loader_condition);
+        SDL_UnlockMutex(loader_mutex);
+    }
+
+    for (int i = 0; i < loader_worker_count; i++)
+    {
+        SDL_WaitThread(loader_workers[i], NULL);
+    }
+    loader_worker_count = 0;
+
+    // every request a worker picked up has queued its COMPLETE by now; the rest were never started
+    if (loader_requests)
+    {
+        for (size_t i = 0; i < Array_Len(loader_requests); i++)
+        {
+            SDL_free(loader_requests[i]);
+        }
+        Array_Free(loader_requests);
+    }
+    if (loader_uploads)
+    {
+        for (size_t i = 0; i < Array_Len(loader_uploads); i++)
+        {
+            Loader_Request* request = loader_uploads[i].request;
+            if (loader_uploads[i].type != LOADER_UPLOAD_COMPLETE) continue;
+            Model_FreeSceneData(&request->scene);
+            SDL_free(request->model_indices);
+            SDL_free(request);
+        }
+        Array_Free(loader_uploads);
+    }
+    loader_requests_in_flight = 0;
+
+    if (loader_transfer_buffer) GPUMemory_ReleaseTransferBuffer(loader_transfer_buffer);
+    MaterialPool_Release(material_loading.texture_diffuse);
+    MaterialPool_Release(material_loading.texture_metallic_roughness);
+    MaterialPool_Release(material_loading.texture_normal);
+    SDL_zero(material_loading);
+    loader_transfer_buffer = NULL;
+
+    if (loader_condition) SDL_DestroyCondition(loader_condition);
+    if (loader_mutex) SDL_DestroyMutex(loader_mutex);
+    loader_condition = NULL;
+    loader_mutex = NULL;
+}
+
+// Queues a scene (a file in models/) for loading and returns immediately
+// everything it loads is stamped with the returned scene id (0 on failure), so it can be unloaded again with Model_UnloadScene
+Uint32 Loader_RequestScene(const char* filename, Loader_Callback callback, void* userdata)
+{
+    Loader_Request* request = SDL_calloc(1, sizeof(Loader_Request));
+    if (request == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate load request: %s", filename);
+        return 0;
+    }
+    SDL_strlcpy(request->filename, filename, sizeof(request->filename));
+    request->callback = callback;
+    request->userdata = userdata;
+    request->success = true;
+    request->scene_id = loader_next_scene_id;
+
+    SDL_LockMutex(loader_mutex);
+    bool appended = Array_Append(loader_requests, request);
+    if (appended) SDL_SignalCondition(loader_condition);
+    SDL_UnlockMutex(loader_mutex);
+
+    if (!appended)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to queue load request: %s", filename);
+        SDL_free(request);
+        return 0;
+    }
+
+    loader_next_scene_id++;
+    loader_requests_in_flight++;
+    return request->scene_id;
+}
+
+// Once per frame, before any draw commands are recorded
+bool Loader_Update(void)
+{
+    if (loader_requests_in_flight == 0) return true;
+    return Loader_Drain(LOADER_FRAME_BUDGET_MS);
+}
+
+// Blocks until every request so far has completed, uploading without a time budget
+bool Loader_Flush(void)
+{
+    bool success = true;
+    while (loader_requests_in_flight > 0)
+    {
+        SDL_LockMutex(loader_mutex);
+        bool has_upload = Array_Len(loader_uploads) > 0;
+        SDL_UnlockMutex(loader_mutex);
+
+        if (!has_upload)
+        {
+            SDL_Delay(1);
+            continue;
+        }
+
+        success = Loader_Drain(SDL_MAX_SINT32) && success;
+    }
+    return success;
+}
+
+bool Loader_IsIdle(void)
+{
+    return loader_requests_in_flight == 0;
+}
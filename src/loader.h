@@ -0,0 +1,28 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+
+// Asynchronous scene loading
+// workers parse, optimize and quantize meshes and decode textures; nothing on a worker touches the GPU or the global model arrays
+// the main thread drains finished work in Loader_Update, bounded per frame by bytes uploaded and time spent
+// meshes become visible as soon as their buffers are uploaded and are drawn with material_loading until their textures follow
+
+#define LOADER_MAX_WORKERS 4
+#define LOADER_FRAME_BUDGET_BYTES (8 * 1024 * 1024) // also the size of the staging transfer buffer
+#define LOADER_FRAME_BUDGET_MS 2.0
+#define LOADER_MAX_UPLOADS_PER_FRAME 64
+
+// called on the main thread (from Loader_Update or Loader_Flush) once everything of the request has been uploaded
+typedef void (*Loader_Callback)(const char* filename, Uint32 scene_id, bool success, void* userdata);
+
+bool Loader_Init(void);
+void Loader_Quit(void);
+Uint32 Loader_RequestScene(const char* filename, Loader_Callback callback, void* userdata);
+bool Loader_Update(void);
+bool Loader_Flush(void);
+bool Loader_IsIdle(void);
+
+#endif // LOADER_H
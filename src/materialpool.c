@@ -0,0 +1,255 @@
+#include "materialpool.h"
+#include "globals.h"
+#include "gpumemory.h"
+
+Struct (MaterialPool)
+{
+    SDL_GPUTexture* texture; // NULL while the slot is unused
+    SDL_GPUTextureFormat format;
+    Uint32 width;
+    Uint32 height;
+    Uint32 level_count;
+    Uint32 layer_capacity;
+    Uint32 layer_high_water;       // layers below this have been handed out at least once
+    Uint16 Array free_layers;      // released layers below layer_high_water
+};
+
+static MaterialPool Array materialpool_pools = NULL;
+
+bool MaterialPool_Init(void)
+{
+    Array_Init(materialpool_pools, 32);
+    if (materialpool_pools == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate material pools");
+        return false;
+    }
+    return true;
+}
+
+static void MaterialPool_Clear(MaterialPool* pool)
+{
+    if (pool->texture) GPUMemory_ReleaseTexture(pool->texture);
+    Array_Free(pool->free_layers);
+    SDL_zerop(pool);
+}
+
+// after every material is freed; anything still here is released with its pool
+void MaterialPool_Quit(void)
+{
+    if (materialpool_pools == NULL) return;
+
+    for (size_t i = 0; i < Array_Len(materialpool_pools); i++)
+    {
+        MaterialPool_Clear(&materialpool_pools[i]);
+    }
+    Array_Free(materialpool_pools);
+    materialpool_pools = NULL;
+}
+
+static MaterialPool* MaterialPool_Find(MaterialPool_Texture texture)
+{
+    Uint32 pool_index = texture >> 16;
+    if (texture == MATERIALPOOL_TEXTURE_NONE || materialpool_pools == NULL || pool_index > Array_Len(materialpool_pools)) return NULL;
+    MaterialPool* pool = &materialpool_pools[pool_index - 1];
+    return pool->texture ? pool : NULL;
+}
+
+static SDL_GPUTexture* MaterialPool_CreateArrayTexture(const MaterialPool* pool, Uint32 layer_capacity)
+{
+    char owner[GPUMEMORY_OWNER_LENGTH];
+    SDL_snprintf(owner, sizeof(owner), "material pool %ux%u, %u levels", pool->width, pool->height, pool->level_count);
+    return GPUMemory_CreateTexture(GPUMEMORY_CATEGORY_TEXTURE, owner, &(SDL_GPUTextureCreateInfo)
+    {
+        .type = SDL_GPU_TEXTURETYPE_2D_ARRAY,
+        .format = pool->format,
+        .width = pool->width,
+        .height = pool->height,
+        .layer_count_or_depth = layer_capacity,
+        .num_levels = pool->level_count,
+        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER
+    });
+}
+
+// Recreates the pool's texture with more or fewer layers (at least layer_high_water); the layers handed out so far are
+// copied over in their own submission, which runs before any upload recorded after this returns
+static bool MaterialPool_Resize(MaterialPool* pool, Uint32 layer_capacity)
+{
+    SDL_GPUTexture* texture = MaterialPool_CreateArrayTexture(pool, layer_capacity);
+    if (texture == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to resize material pool to %u layers: %s", layer_capacity, SDL_GetError());
+        return false;
+    }
+
+    SDL_GPUCommandBuffer* command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
+    if (command_buffer == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "SDL_AcquireGPUCommandBuffer failed: %s", SDL_GetError());
+        GPUMemory_ReleaseTexture(texture);
+        return false;
+    }
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    for (Uint32 layer = 0; layer < pool->layer_high_water; layer++)
+    {
+        for (Uint32 level = 0; level < pool->level_count; level++)
+        {
+            SDL_CopyGPUTextureToTexture
+            (
+                copy_pass,
+                &(SDL_GPUTextureLocation){ .texture = pool->texture, .mip_level = level, .layer = layer },
+                &(SDL_GPUTextureLocation){ .texture = texture, .mip_level = level, .layer = layer },
+                SDL_max(pool->width >> level, 1),
+                SDL_max(pool->height >> level, 1),
+                1, // depth
+                false // cycle
+            );
+        }
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_SubmitGPUCommandBuffer(command_buffer);
+
+    GPUMemory_ReleaseTexture(pool->texture);
+    pool->texture = texture;
+    pool->layer_capacity = layer_capacity;
+    return true;
+}
+
+// Hands out an (empty) layer for the GPU levels of texture_data; MATERIALPOOL_TEXTURE_NONE on failure
+MaterialPool_Texture MaterialPool_Allocate(const Texture_Data* texture_data)
+{
+    MaterialPool key =
+    {
+        .format = texture_data->format,
+        .width = SDL_max(texture_data->width >> texture_data->first_level, 1),
+        .height = SDL_max(texture_data->height >> texture_data->first_level, 1),
+        .level_count = Texture_GetGPULevelCount(texture_data),
+    };
+
+    // a pool of the same kind with room left, or else the first unused slot
+    MaterialPool* pool = NULL;
+    MaterialPool* unused = NULL;
+    for (size_t i = 0; i < Array_Len(materialpool_pools); i++)
+    {
+        MaterialPool* candidate = &materialpool_pools[i];
+        if (candidate->texture == NULL)
+        {
+            if (unused == NULL) unused = candidate;
+            continue;
+        }
+        if (candidate->format != key.format || candidate->width != key.width || candidate->height != key.height || candidate->level_count != key.level_count) continue;
+        if (Array_Len(candidate->free_layers) == 0 && candidate->layer_high_water == MATERIALPOOL_MAX_LAYERS) continue;
+        pool = candidate;
+        break;
+    }
+
+    if (pool == NULL)
+    {
+        if (unused == NULL)
+        {
+            if (Array_Len(materialpool_pools) == 0xFFFF || !Array_Append(materialpool_pools, key))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to add a material pool");
+                return MATERIALPOOL_TEXTURE_NONE;
+            }
+            unused = &materialpool_pools[Array_Len(materialpool_pools) - 1];
+        }
+        *unused = key;
+        Array_Init(unused->free_layers, 16);
+        unused->texture = MaterialPool_CreateArrayTexture(unused, MATERIALPOOL_INITIAL_LAYERS);
+        if (unused->free_layers == NULL || unused->texture == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create material pool: %s", SDL_GetError());
+            MaterialPool_Clear(unused);
+            return MATERIALPOOL_TEXTURE_NONE;
+        }
+        unused->layer_capacity = MATERIALPOOL_INITIAL_LAYERS;
+        pool = unused;
+    }
+
+    Uint32 layer;
+    if (Array_Len(pool->free_layers) > 0)
+    {
+        layer = *(Uint16*)Array_Pop(pool->free_layers);
+    }
+    else
+    {
+        if (pool->layer_high_water == pool->layer_capacity && !MaterialPool_Resize(pool, SDL_min(pool->layer_capacity * 2, MATERIALPOOL_MAX_LAYERS)))
+        {
+            return MATERIALPOOL_TEXTURE_NONE;
+        }
+        layer = pool->layer_high_water++;
+    }
+
+    return ((Uint32)(pool - materialpool_pools + 1) << 16) | layer;
+}
+
+// the layer may still be sampled by frames in flight; anything uploaded into it later is ordered after them
+void MaterialPool_Release(MaterialPool_Texture texture)
+{
+    MaterialPool* pool = MaterialPool_Find(texture);
+    if (pool == NULL) return;
+
+    Uint16 layer = (Uint16)(texture & 0xFFFF);
+    if (!Array_Append(pool->free_layers, layer))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to return a material pool layer; it stays allocated");
+        return;
+    }
+    if (Array_Len(pool->free_layers) == pool->layer_high_water)
+    {
+        MaterialPool_Clear(pool);
+        return;
+    }
+
+    // drop the released layers at the top, so they stop counting towards the pool's size
+    bool trimmed = true;
+    while (trimmed)
+    {
+        trimmed = false;
+        for (size_t i = 0; i < Array_Len(pool->free_layers); i++)
+        {
+            if (pool->free_layers[i] != pool->layer_high_water - 1) continue;
+            Array_DeleteSwap(pool->free_layers, i);
+            pool->layer_high_water--;
+            trimmed = true;
+            break;
+        }
+    }
+
+    // halving only once at most a quarter is used, so a pool at the edge doesn't shrink and grow every frame
+    Uint32 layer_capacity = pool->layer_capacity;
+    while (layer_capacity > MATERIALPOOL_INITIAL_LAYERS && pool->layer_high_water <= layer_capacity / 4)
+    {
+        layer_capacity /= 2;
+    }
+    if (layer_capacity < pool->layer_capacity && !MaterialPool_Resize(pool, layer_capacity))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to shrink a material pool; it keeps its layers");
+    }
+}
+
+void MaterialPool_Upload(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Texture_Data* texture_data, MaterialPool_Texture texture)
+{
+    MaterialPool* pool = MaterialPool_Find(texture);
+    if (pool == NULL) return;
+    Texture_Upload(copy_pass, transfer_buffer, offset, texture_data, pool->texture, MaterialPool_GetLayer(texture));
+}
+
+// only valid until the next MaterialPool_Allocate or MaterialPool_Release, which may recreate it
+SDL_GPUTexture* MaterialPool_GetArrayTexture(MaterialPool_Texture texture)
+{
+    MaterialPool* pool = MaterialPool_Find(texture);
+    return pool ? pool->texture : NULL;
+}
+
+// textures with the same pool bind the same array texture
+Uint32 MaterialPool_GetPool(MaterialPool_Texture texture)
+{
+    return texture >> 16;
+}
+
+Uint32 MaterialPool_GetLayer(MaterialPool_Texture texture)
+{
+    return texture & 0xFFFF;
+}
@@ -0,0 +1,41 @@
+#ifndef MATERIALPOOL_H
+#define MATERIALPOOL_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "array.h"
+#include "texture.h"
+
+/*
+    Material pools
+    every material texture is one layer of an SDL_GPU_TEXTURETYPE_2D_ARRAY texture (a pool) that holds textures of one
+    format, size and level count; materials whose textures share pools are drawn with the same sampler bindings
+    and only differ in the layers they sample (Material_Parameters, see Render_Models)
+    a material texture is a handle rather than an SDL_GPUTexture: a full pool is recreated with twice the layers
+    (the old layers are copied over on the GPU), and streaming a texture to a new size moves it into another pool
+    pools start with one layer, since streaming makes a kind of pool per level set; released layers at the top of a pool
+    are dropped, and a pool that uses a quarter of its layers or less is recreated with half as many; layers
+    released below the highest one in use stay allocated (handles can't move), so what a pool holds in VRAM is
+    what GPUMemory_GetCategoryBytes(GPUMEMORY_CATEGORY_TEXTURE) reports, not the sum of its layers in use
+    a pool whose last layer is released is released itself
+    main thread only
+*/
+
+#define MATERIALPOOL_INITIAL_LAYERS 1
+#define MATERIALPOOL_MAX_LAYERS 256 // minimum array size every backend supports; past it another pool of the same kind is made
+
+// pool index + 1 in the high 16 bits, layer in the low 16
+typedef Uint32 MaterialPool_Texture;
+#define MATERIALPOOL_TEXTURE_NONE 0u
+
+bool MaterialPool_Init(void);
+void MaterialPool_Quit(void);
+MaterialPool_Texture MaterialPool_Allocate(const Texture_Data* texture_data);
+void MaterialPool_Release(MaterialPool_Texture texture);
+void MaterialPool_Upload(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Texture_Data* texture_data, MaterialPool_Texture texture);
+SDL_GPUTexture* MaterialPool_GetArrayTexture(MaterialPool_Texture texture);
+Uint32 MaterialPool_GetPool(MaterialPool_Texture texture);
+Uint32 MaterialPool_GetLayer(MaterialPool_Texture texture);
+
+#endif // MATERIALPOOL_H
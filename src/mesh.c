@@ -0,0 +1,678 @@
+#include "mesh.h"
+#include "hash.h"
+#include "helper.h"
+
+#define MESH_INVALID_INDEX 0xFFFFFFFFu
+
+// Returns the number of unique vertices
+// indices are rewritten to point at the first copy of each vertex; duplicates become unreferenced
+// (Mesh_OptimizeVertexFetch compacts them away)
+Uint32 Mesh_RemapDuplicateVertices(Uint32* indices, Uint32 index_count, const void* vertices, Uint32 vertex_count, Uint32 vertex_size)
+{
+    const Uint8* vertex_bytes = vertices;
+
+    Uint32 table_size = 1;
+    while (table_size < vertex_count * 2)
+        table_size <<= 1;
+
+    Uint32* table = SDL_malloc(sizeof(Uint32) * table_size);
+    Uint32* remap = SDL_malloc(sizeof(Uint32) * vertex_count);
+    if (table == NULL || remap == NULL)
+    {
+        SDL_free(table);
+        SDL_free(remap);
+        return vertex_count;
+    }
+    SDL_memset(table, 0xFF, sizeof(Uint32) * table_size);
+
+    // open addressing on the raw vertex bytes
+    Uint32 unique_vertex_count = 0;
+    for (Uint32 v = 0; v < vertex_count; v++)
+    {
+        const Uint8* vertex = vertex_bytes + (size_t)v * vertex_size;
+        Uint32 slot = (Uint32)hash((char*)vertex, vertex_size) & (table_size - 1);
+        while (table[slot] != MESH_INVALID_INDEX && SDL_memcmp(vertex_bytes + (size_t)table[slot] * vertex_size, vertex, vertex_size) != 0)
+            slot = (slot + 1) & (table_size - 1);
+
+        if (table[slot] == MESH_INVALID_INDEX)
+        {
+            table[slot] = v;
+            unique_vertex_count++;
+        }
+        remap[v] = table[slot];
+    }
+
+    for (Uint32 i = 0; i < index_count; i++)
+        indices[i] = remap[indices[i]];
+
+    SDL_free(table);
+    SDL_free(remap);
+    return unique_vertex_count;
+}
+
+// Tipsify: Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007)
+// fans triangles around a vertex that is likely still in the cache, falling back to recently used vertices at dead ends
+bool Mesh_OptimizeVertexCache(Uint32* indices, Uint32 index_count, Uint32 vertex_count)
+{
+    Uint32 triangle_count = index_count / 3;
+    if (triangle_count == 0 || vertex_count == 0)
+        return true;
+
+    for (Uint32 i = 0; i < index_count; i++)
+    {
+        if (indices[i] >= vertex_count)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mesh index %u out of range (%u vertices)", indices[i], vertex_count);
+            return false;
+        }
+    }
+
+    Uint32* live_triangles    = SDL_calloc(vertex_count, sizeof(Uint32));
+    Uint32* adjacency_offsets = SDL_calloc(vertex_count + 1, sizeof(Uint32));
+    Uint32* adjacency         = SDL_malloc(sizeof(Uint32) * index_count);
+    Uint32* cache_timestamps  = SDL_calloc(vertex_count, sizeof(Uint32));
+    Uint32* dead_end_stack    = SDL_malloc(sizeof(Uint32) * index_count);
+    Uint32* candidates        = SDL_malloc(sizeof(Uint32) * index_count);
+    Uint32* output            = SDL_malloc(sizeof(Uint32) * index_count);
+    bool*   emitted           = SDL_calloc(triangle_count, sizeof(bool));
+
+    bool success = live_triangles && adjacency_offsets && adjacency && cache_timestamps && dead_end_stack && candidates && output && emitted;
+    if (success)
+    {
+        // vertex -> triangle adjacency
+        for (Uint32 i = 0; i < triangle_count * 3; i++)
+            live_triangles[indices[i]]++;
+        for (Uint32 v = 0; v < vertex_count; v++)
+            adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+        SDL_memcpy(cache_timestamps, adjacency_offsets, sizeof(Uint32) * vertex_count); // borrowed as fill cursors
+        for (Uint32 t = 0; t < triangle_count; t++)
+            for (int c = 0; c < 3; c++)
+                adjacency[cache_timestamps[indices[t * 3 + c]]++] = t;
+        SDL_memset(cache_timestamps, 0, sizeof(Uint32) * vertex_count);
+
+        Uint32 timestamp = MESH_VERTEX_CACHE_SIZE + 1;
+        Uint32 cursor = 1;
+        Uint32 output_count = 0;
+        Uint32 dead_end_count = 0;
+        Uint32 fanning_vertex = 0;
+
+        while (fanning_vertex != MESH_INVALID_INDEX)
+        {
+            Uint32 candidate_count = 0;
+            for (Uint32 a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; a++)
+            {
+                Uint32 t = adjacency[a];
+                if (emitted[t])
+                    continue;
+
+                for (int c = 0; c < 3; c++)
+                {
+                    Uint32 v = indices[t * 3 + c];
+                    output[output_count++] = v;
+                    dead_end_stack[dead_end_count++] = v;
+                    candidates[candidate_count++] = v;
+                    live_triangles[v]--;
+                    if (timestamp - cache_timestamps[v] > MESH_VERTEX_CACHE_SIZE)
+                        cache_timestamps[v] = timestamp++;
+                }
+                emitted[t] = true;
+            }
+
+            // prefer the candidate that has been in the cache longest but will still be there after its fan is emitted
+            Uint32 next_vertex = MESH_INVALID_INDEX;
+            Sint64 best_priority = -1;
+            for (Uint32 i = 0; i < candidate_count; i++)
+            {
+                Uint32 v = candidates[i];
+                if (live_triangles[v] == 0)
+                    continue;
+
+                Sint64 priority = 0;
+                if (timestamp - cache_timestamps[v] + 2 * live_triangles[v] <= MESH_VERTEX_CACHE_SIZE)
+                    priority = timestamp - cache_timestamps[v];
+                if (priority > best_priority)
+                {
+                    best_priority = priority;
+                    next_vertex = v;
+                }
+            }
+
+            // dead end: most recently referenced vertex with work left, otherwise the next unprocessed vertex
+            while (next_vertex == MESH_INVALID_INDEX && dead_end_count > 0)
+            {
+                Uint32 v = dead_end_stack[--dead_end_count];
+                if (live_triangles[v] > 0)
+                    next_vertex = v;
+            }
+            while (next_vertex == MESH_INVALID_INDEX && cursor < vertex_count)
+            {
+                if (live_triangles[cursor] > 0)
+                    next_vertex = cursor;
+                cursor++;
+            }
+
+            fanning_vertex = next_vertex;
+        }
+
+        SDL_assert(output_count == triangle_count * 3);
+        SDL_memcpy(indices, output, sizeof(Uint32) * triangle_count * 3);
+    }
+
+    SDL_free(live_triangles);
+    SDL_free(adjacency_offsets);
+    SDL_free(adjacency);
+    SDL_free(cache_timestamps);
+    SDL_free(dead_end_stack);
+    SDL_free(candidates);
+    SDL_free(output);
+    SDL_free(emitted);
+    return success;
+}
+
+// FIFO cache simulation using per-vertex insertion timestamps
+// a vertex is resident if it was inserted within the last cache_size misses
+static Uint32 Mesh_SimulateTriangle(const Uint32* triangle, Uint32* cache_timestamps, Uint32* time, Uint32 cache_size)
+{
+    Uint32 misses = 0;
+    for (int c = 0; c < 3; c++)
+    {
+        Uint32 v = triangle[c];
+        if (*time - cache_timestamps[v] > cache_size)
+        {
+            cache_timestamps[v] = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+float Mesh_CalculateACMR(const Uint32* indices, Uint32 index_count, Uint32 vertex_count, Uint32 cache_size)
+{
+    Uint32 triangle_count = index_count / 3;
+    if (triangle_count == 0)
+        return 0.0f;
+
+    Uint32* cache_timestamps = SDL_calloc(vertex_count, sizeof(Uint32));
+    if (cache_timestamps == NULL)
+        return 0.0f;
+
+    Uint32 time = cache_size + 1;
+    Uint32 misses = 0;
+    for (Uint32 t = 0; t < triangle_count; t++)
+        misses += Mesh_SimulateTriangle(&indices[t * 3], cache_timestamps, &time, cache_size);
+
+    SDL_free(cache_timestamps);
+    return (float)misses / (float)triangle_count;
+}
+
+Struct (Mesh_Cluster)
+{
+    Uint32 first_triangle;
+    Uint32 triangle_count;
+    float sort_key;
+};
+
+static int SDLCALL Mesh_CompareClusters(const void* a, const void* b)
+{
+    float key_a = ((const Mesh_Cluster*)a)->sort_key;
+    float key_b = ((const Mesh_Cluster*)b)->sort_key;
+    return (key_a < key_b) - (key_a > key_b); // descending
+}
+
+// Splits the (cache optimized) triangle order into clusters and draws outward facing clusters first,
+// so front-most surfaces tend to be drawn before the geometry they occlude
+// clusters end at cache flushes (hard) and wherever splitting costs less than threshold x the cluster's ACMR (soft)
+bool Mesh_OptimizeOverdraw(Uint32* indices, Uint32 index_count, const void* vertices, Uint32 vertex_count, Uint32 vertex_size, float threshold)
+{
+    Uint32 triangle_count = index_count / 3;
+    if (triangle_count < 2)
+        return true;
+
+    const Uint8* vertex_bytes = vertices;
+
+    Uint32* cache_timestamps = SDL_calloc(vertex_count, sizeof(Uint32));
+    Uint32* hard_boundaries = SDL_malloc(sizeof(Uint32) * (triangle_count + 1));
+    Mesh_Cluster* clusters = SDL_malloc(sizeof(Mesh_Cluster) * triangle_count);
+    Uint32* output = SDL_malloc(sizeof(Uint32) * triangle_count * 3);
+    if (!cache_timestamps || !hard_boundaries || !clusters || !output)
+    {
+        SDL_free(cache_timestamps);
+        SDL_free(hard_boundaries);
+        SDL_free(clusters);
+        SDL_free(output);
+        return false;
+    }
+
+    // hard boundaries: every vertex of the triangle missed, so the order before it doesn't matter
+    Uint32 hard_boundary_count = 0;
+    Uint32 time = MESH_VERTEX_CACHE_SIZE + 1;
+    for (Uint32 t = 0; t < triangle_count; t++)
+    {
+        Uint32 misses = Mesh_SimulateTriangle(&indices[t * 3], cache_timestamps, &time, MESH_VERTEX_CACHE_SIZE);
+        if (t == 0 || misses == 3)
+            hard_boundaries[hard_boundary_count++] = t;
+    }
+    hard_boundaries[hard_boundary_count] = triangle_count;
+
+    // soft boundaries
+    Uint32 cluster_count = 0;
+    for (Uint32 h = 0; h < hard_boundary_count; h++)
+    {
+        Uint32 start = hard_boundaries[h];
+        Uint32 end = hard_boundaries[h + 1];
+
+        time += MESH_VERTEX_CACHE_SIZE + 1; // flush
+        Uint32 cluster_misses = 0;
+        for (Uint32 t = start; t < end; t++)
+            cluster_misses += Mesh_SimulateTriangle(&indices[t * 3], cache_timestamps, &time, MESH_VERTEX_CACHE_SIZE);
+        float cluster_acmr = (float)cluster_misses / (float)(end - start);
+
+        time += MESH_VERTEX_CACHE_SIZE + 1;
+        Uint32 running_misses = 0;
+        Uint32 cluster_start = start;
+        for (Uint32 t = start; t < end; t++)
+        {
+            running_misses += Mesh_SimulateTriangle(&indices[t * 3], cache_timestamps, &time, MESH_VERTEX_CACHE_SIZE);
+            float running_acmr = (float)running_misses / (float)(t + 1 - cluster_start);
+            if (t + 1 == end || running_acmr <= cluster_acmr * threshold)
+            {
+                clusters[cluster_count++] = (Mesh_Cluster){ cluster_start, t + 1 - cluster_start, 0.0f };
+                cluster_start = t + 1;
+                running_misses = 0;
+                time += MESH_VERTEX_CACHE_SIZE + 1;
+            }
+        }
+    }
+
+    // sort key: how far the cluster sits along its own average normal, relative to the mesh centroid
+    float mesh_centroid[3] = {0};
+    float mesh_area = 0.0f;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (Uint32 c = 0; c < cluster_count; c++)
+        {
+            float centroid[3] = {0}, normal[3] = {0}, area = 0.0f;
+            for (Uint32 t = clusters[c].first_triangle; t < clusters[c].first_triangle + clusters[c].triangle_count; t++)
+            {
+                const float* p0 = (const float*)(vertex_bytes + (size_t)indices[t * 3 + 0] * vertex_size);
+                const float* p1 = (const float*)(vertex_bytes + (size_t)indices[t * 3 + 1] * vertex_size);
+                const float* p2 = (const float*)(vertex_bytes + (size_t)indices[t * 3 + 2] * vertex_size);
+                float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                float triangle_area = SDL_sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (int i = 0; i < 3; i++)
+                {
+                    centroid[i] += (p0[i] + p1[i] + p2[i]) * (1.0f / 3.0f) * triangle_area;
+                    normal[i] += n[i];
+                }
+                area += triangle_area;
+            }
+
+            if (pass == 0)
+            {
+                for (int i = 0; i < 3; i++) mesh_centroid[i] += centroid[i];
+                mesh_area += area;
+            }
+            else
+            {
+                float inverse_area = area > 0.0f ? 1.0f / area : 0.0f;
+                float normal_length = SDL_sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                float inverse_normal_length = normal_length > 0.0f ? 1.0f / normal_length : 0.0f;
+                float key = 0.0f;
+                for (int i = 0; i < 3; i++)
+                    key += (centroid[i] * inverse_area - mesh_centroid[i]) * normal[i] * inverse_normal_length;
+                clusters[c].sort_key = key;
+            }
+        }
+
+        if (pass == 0 && mesh_area > 0.0f)
+            for (int i = 0; i < 3; i++) mesh_centroid[i] /= mesh_area;
+    }
+
+    SDL_qsort(clusters, cluster_count, sizeof(Mesh_Cluster), Mesh_CompareClusters);
+
+    Uint32 output_count = 0;
+    for (Uint32 c = 0; c < cluster_count; c++)
+    {
+        SDL_memcpy(&output[output_count], &indices[clusters[c].first_triangle * 3], sizeof(Uint32) * clusters[c].triangle_count * 3);
+        output_count += clusters[c].triangle_count * 3;
+    }
+    SDL_memcpy(indices, output, sizeof(Uint32) * output_count);
+
+    SDL_free(cache_timestamps);
+    SDL_free(hard_boundaries);
+    SDL_free(clusters);
+    SDL_free(output);
+    return true;
+}
+
+// Reorders vertices by first use so fetches walk memory linearly, dropping unreferenced vertices
+// returns the new vertex count
+Uint32 Mesh_OptimizeVertexFetch(void* vertices, Uint32* indices, Uint32 index_count, Uint32 vertex_count, Uint32 vertex_size)
+{
+    Uint32* remap = SDL_malloc(sizeof(Uint32) * vertex_count);
+    Uint8* reordered = SDL_malloc((size_t)vertex_size * vertex_count);
+    if (remap == NULL || reordered == NULL)
+    {
+        SDL_free(remap);
+        SDL_free(reordered);
+        return vertex_count;
+    }
+    SDL_memset(remap, 0xFF, sizeof(Uint32) * vertex_count);
+
+    Uint32 next_vertex = 0;
+    for (Uint32 i = 0; i < index_count; i++)
+    {
+        Uint32 v = indices[i];
+        if (remap[v] == MESH_INVALID_INDEX)
+        {
+            remap[v] = next_vertex;
+            SDL_memcpy(reordered + (size_t)next_vertex * vertex_size, (Uint8*)vertices + (size_t)v * vertex_size, vertex_size);
+            next_vertex++;
+        }
+        indices[i] = remap[v];
+    }
+    SDL_memcpy(vertices, reordered, (size_t)next_vertex * vertex_size);
+
+    SDL_free(remap);
+    SDL_free(reordered);
+    return next_vertex;
+}
+
+// symmetric 4x4 error quadric (a00 a01 a02 a03 a11 a12 a13 a22 a23 a33), scaled by the area it was accumulated from
+Struct (Mesh_Quadric)
+{
+    double a[10];
+    double weight;
+};
+
+Struct (Mesh_Collapse)
+{
+    Uint32 source;
+    Uint32 target;
+    float cost;
+};
+
+static int SDLCALL Mesh_CompareCollapses(const void* a, const void* b)
+{
+    float cost_a = ((const Mesh_Collapse*)a)->cost;
+    float cost_b = ((const Mesh_Collapse*)b)->cost;
+    return (cost_a > cost_b) - (cost_a < cost_b); // ascending
+}
+
+static void Mesh_Quadric_AddPlane(Mesh_Quadric* quadric, const double plane[4], double weight)
+{
+    const double a = plane[0], b = plane[1], c = plane[2], d = plane[3];
+    quadric->a[0] += weight * a * a; quadric->a[1] += weight * a * b; quadric->a[2] += weight * a * c; quadric->a[3] += weight * a * d;
+    quadric->a[4] += weight * b * b; quadric->a[5] += weight * b * c; quadric->a[6] += weight * b * d;
+    quadric->a[7] += weight * c * c; quadric->a[8] += weight * c * d;
+    quadric->a[9] += weight * d * d;
+    quadric->weight += weight;
+}
+
+// area weighted mean squared distance from p to the planes of the quadrics
+static double Mesh_Quadric_Error(const Mesh_Quadric* q0, const Mesh_Quadric* q1, const float* p)
+{
+    double a[10];
+    for (int i = 0; i < 10; i++) a[i] = q0->a[i] + q1->a[i];
+    double weight = q0->weight + q1->weight;
+    const double x = p[0], y = p[1], z = p[2];
+    double error = a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+                 + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+                 + a[7] * z * z + 2.0 * a[8] * z
+                 + a[9];
+    return weight > 0.0 ? SDL_max(error, 0.0) / weight : 0.0;
+}
+
+static void Mesh_TriangleNormal(const float* p0, const float* p1, const float* p2, float* normal)
+{
+    float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics" (1997)
+// collapses edges in passes of independent, cheapest-first collapses until target_index_count is reached
+// or the next collapse would move the surface by more than target_error (in position units)
+// vertices are never moved or created, so the result indexes the same vertex buffer;
+// vertices on open borders and attribute seams (same position, different attributes) are kept in place
+// destination must hold index_count indices and may not alias indices; returns the new index count
+Uint32 Mesh_Simplify(Uint32* destination, const Uint32* indices, Uint32 index_count, const void* vertices, Uint32 vertex_count, Uint32 vertex_size, Uint32 target_index_count, float target_error, float* result_error)
+{
+    const Uint8* vertex_bytes = vertices;
+    #define MESH_POSITION(v) ((const float*)(vertex_bytes + (size_t)(v) * vertex_size))
+
+    SDL_memcpy(destination, indices, sizeof(Uint32) * index_count);
+    if (result_error) *result_error = 0.0f;
+    if (index_count <= target_index_count || vertex_count == 0)
+        return index_count;
+
+    Uint32 table_size = 1;
+    while (table_size < SDL_max(vertex_count, index_count) * 2)
+        table_size <<= 1;
+
+    Uint32* position_remap    = SDL_malloc(sizeof(Uint32) * vertex_count);   // first vertex with the same position
+    Uint32* position_copies   = SDL_calloc(vertex_count, sizeof(Uint32));    // referenced vertices per position
+    Uint32* table             = SDL_malloc(sizeof(Uint32) * table_size);
+    Uint64* edges             = SDL_malloc(sizeof(Uint64) * table_size);
+    bool*   is_locked         = SDL_calloc(vertex_count, sizeof(bool));      // per position
+    bool*   is_referenced     = SDL_calloc(vertex_count, sizeof(bool));
+    Mesh_Quadric* quadrics    = SDL_calloc(vertex_count, sizeof(Mesh_Quadric)); // per position
+    Uint32* collapse_remap    = SDL_malloc(sizeof(Uint32) * vertex_count);
+    Mesh_Collapse* collapses  = SDL_malloc(sizeof(Mesh_Collapse) * vertex_count);
+    bool*   is_touched        = SDL_calloc(vertex_count, sizeof(bool));      // per position, for the current pass
+    Uint32* adjacency_offsets = SDL_calloc(vertex_count + 1, sizeof(Uint32));
+    Uint32* adjacency_cursors = SDL_malloc(sizeof(Uint32) * vertex_count);
+    Uint32* adjacency         = SDL_malloc(sizeof(Uint32) * index_count);
+
+    if (!position_remap || !position_copies || !table || !edges || !is_locked || !is_referenced || !quadrics || 
+        !collapse_remap || !collapses || !is_touched || !adjacency_offsets || !adjacency_cursors || !adjacency)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for mesh simplification");
+        index_count = 0;
+        goto cleanup;
+    }
+
+    // weld positions, ignoring the other attributes
+    SDL_memset(table, 0xFF, sizeof(Uint32) * table_size);
+    for (Uint32 v = 0; v < vertex_count; v++)
+    {
+        Uint32 slot = (Uint32)hash((char*)MESH_POSITION(v), sizeof(float) * 3) & (table_size - 1);
+        while (table[slot] != MESH_INVALID_INDEX && SDL_memcmp(MESH_POSITION(table[slot]), MESH_POSITION(v), sizeof(float) * 3) != 0)
+            slot = (slot + 1) & (table_size - 1);
+        if (table[slot] == MESH_INVALID_INDEX)
+            table[slot] = v;
+        position_remap[v] = table[slot];
+    }
+
+    // seams: more than one referenced vertex at a position
+    for (Uint32 i = 0; i < index_count; i++)
+    {
+        Uint32 v = indices[i];
+        if (!is_referenced[v])
+        {
+            is_referenced[v] = true;
+            if (++position_copies[position_remap[v]] > 1)
+                is_locked[position_remap[v]] = true;
+        }
+    }
+
+    // open borders: a welded edge whose opposite half edge doesn't exist
+    SDL_memset(edges, 0xFF, sizeof(Uint64) * table_size);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (Uint32 i = 0; i < index_count; i++)
+        {
+            Uint32 a = position_remap[indices[i]];
+            Uint32 b = position_remap[indices[i - i % 3 + (i + 1) % 3]];
+            Uint64 key = pass == 0 ? ((Uint64)a << 32 | b) : ((Uint64)b << 32 | a);
+            Uint32 slot = (Uint32)((key * 0x9E3779B97F4A7C15ull) >> 32) & (table_size - 1);
+            while (edges[slot] != ~0ull && edges[slot] != key)
+                slot = (slot + 1) & (table_size - 1);
+
+            if (pass == 0)
+                edges[slot] = key;
+            else if (edges[slot] != key)
+                is_locked[a] = is_locked[b] = true;
+        }
+    }
+
+    // plane quadrics, area weighted
+    for (Uint32 t = 0; t < index_count / 3; t++)
+    {
+        const float* p0 = MESH_POSITION(indices[t * 3 + 0]);
+        float normal[3];
+        Mesh_TriangleNormal(p0, MESH_POSITION(indices[t * 3 + 1]), MESH_POSITION(indices[t * 3 + 2]), normal);
+        double length = SDL_sqrt((double)normal[0] * normal[0] + (double)normal[1] * normal[1] + (double)normal[2] * normal[2]);
+        if (length <= 0.0)
+            continue;
+
+        double plane[4] = { normal[0] / length, normal[1] / length, normal[2] / length, 0.0 };
+        plane[3] = -(plane[0] * p0[0] + plane[1] * p0[1] + plane[2] * p0[2]);
+        for (int c = 0; c < 3; c++)
+            Mesh_Quadric_AddPlane(&quadrics[position_remap[indices[t * 3 + c]]], plane, length * 0.5);
+    }
+
+    double max_error_squared = (double)target_error * target_error;
+    double worst_error_squared = 0.0;
+
+    while (index_count > target_index_count)
+    {
+        Uint32 triangle_count = index_count / 3;
+
+        // vertex -> triangle adjacency of the current triangles
+        SDL_memset(adjacency_offsets, 0, sizeof(Uint32) * (vertex_count + 1));
+        for (Uint32 i = 0; i < index_count; i++)
+            adjacency_offsets[destination[i] + 1]++;
+        for (Uint32 v = 0; v < vertex_count; v++)
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        SDL_memcpy(adjacency_cursors, adjacency_offsets, sizeof(Uint32) * vertex_count);
+        for (Uint32 i = 0; i < index_count; i++)
+            adjacency[adjacency_cursors[destination[i]]++] = i / 3;
+
+        // cheapest collapse per source vertex; only vertices alone at an unlocked position may move
+        SDL_memset(collapse_remap, 0xFF, sizeof(Uint32) * vertex_count);
+        Uint32 collapse_count = 0;
+        for (Uint32 i = 0; i < index_count; i++)
+        {
+            Uint32 source = destination[i];
+            Uint32 target = destination[i - i % 3 + (i + 1) % 3];
+            if (is_locked[position_remap[source]] || position_remap[source] == position_remap[target])
+                continue;
+
+            float cost = (float)Mesh_Quadric_Error(&quadrics[position_remap[source]], &quadrics[position_remap[target]], MESH_POSITION(target));
+            if (cost > max_error_squared)
+                continue;
+
+            // collapse_remap doubles as the per vertex slot in collapses during this scan
+            if (collapse_remap[source] == MESH_INVALID_INDEX)
+            {
+                collapse_remap[source] = collapse_count;
+                collapses[collapse_count++] = (Mesh_Collapse){ source, target, cost };
+            }
+            else if (cost < collapses[collapse_remap[source]].cost)
+            {
+                collapses[collapse_remap[source]].target = target;
+                collapses[collapse_remap[source]].cost = cost;
+            }
+        }
+        if (collapse_count == 0)
+            break;
+
+        SDL_qsort(collapses, collapse_count, sizeof(Mesh_Collapse), Mesh_CompareCollapses);
+        SDL_memset(collapse_remap, 0xFF, sizeof(Uint32) * vertex_count);
+        SDL_memset(is_touched, 0, sizeof(bool) * vertex_count);
+
+        // apply independent collapses, cheapest first, until enough triangles are gone
+        Uint32 removed_triangles = 0;
+        Uint32 applied = 0;
+        for (Uint32 c = 0; c < collapse_count && (triangle_count - removed_triangles) * 3 > target_index_count; c++)
+        {
+            Uint32 source = collapses[c].source;
+            Uint32 target = collapses[c].target;
+            if (is_touched[position_remap[source]] || is_touched[position_remap[target]])
+                continue;
+
+            // reject collapses that would flip a triangle that survives them
+            bool flips = false;
+            Uint32 collapsed_triangles = 0;
+            for (Uint32 a = adjacency_offsets[source]; a < adjacency_offsets[source + 1] && !flips; a++)
+            {
+                const Uint32* triangle = &destination[adjacency[a] * 3];
+                if (triangle[0] == target || triangle[1] == target || triangle[2] == target)
+                {
+                    collapsed_triangles++;
+                    continue;
+                }
+
+                float before[3], after[3];
+                const float* p[3] = { MESH_POSITION(triangle[0]), MESH_POSITION(triangle[1]), MESH_POSITION(triangle[2]) };
+                Mesh_TriangleNormal(p[0], p[1], p[2], before);
+                for (int k = 0; k < 3; k++)
+                    if (triangle[k] == source) p[k] = MESH_POSITION(target);
+                Mesh_TriangleNormal(p[0], p[1], p[2], after);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            // the one ring of source changes shape, so nothing in it may collapse again this pass
+            for (Uint32 a = adjacency_offsets[source]; a < adjacency_offsets[source + 1]; a++)
+                for (int k = 0; k < 3; k++)
+                    is_touched[position_remap[destination[adjacency[a] * 3 + k]]] = true;
+
+            collapse_remap[source] = target;
+            Mesh_Quadric* source_quadric = &quadrics[position_remap[source]];
+            Mesh_Quadric* target_quadric = &quadrics[position_remap[target]];
+            for (int k = 0; k < 10; k++) target_quadric->a[k] += source_quadric->a[k];
+            target_quadric->weight += source_quadric->weight;
+            worst_error_squared = SDL_max(worst_error_squared, (double)collapses[c].cost);
+            removed_triangles += collapsed_triangles;
+            applied++;
+        }
+        if (applied == 0)
+            break;
+
+        // remap and drop the triangles that became degenerate
+        Uint32 write = 0;
+        for (Uint32 t = 0; t < triangle_count; t++)
+        {
+            Uint32 triangle[3];
+            for (int k = 0; k < 3; k++)
+            {
+                Uint32 v = destination[t * 3 + k];
+                triangle[k] = collapse_remap[v] != MESH_INVALID_INDEX ? collapse_remap[v] : v;
+            }
+            if (position_remap[triangle[0]] == position_remap[triangle[1]] || 
+                position_remap[triangle[1]] == position_remap[triangle[2]] || 
+                position_remap[triangle[2]] == position_remap[triangle[0]])
+                continue;
+            destination[write++] = triangle[0];
+            destination[write++] = triangle[1];
+            destination[write++] = triangle[2];
+        }
+        index_count = write;
+    }
+
+    if (result_error) *result_error = (float)SDL_sqrt(worst_error_squared);
+
+cleanup:
+    SDL_free(position_remap);
+    SDL_free(position_copies);
+    SDL_free(table);
+    SDL_free(edges);
+    SDL_free(is_locked);
+    SDL_free(is_referenced);
+    SDL_free(quadrics);
+    SDL_free(collapse_remap);
+    SDL_free(collapses);
+    SDL_free(is_touched);
+    SDL_free(adjacency_offsets);
+    SDL_free(adjacency_cursors);
+    SDL_free(adjacency);
+    #undef MESH_POSITION
+    return index_count;
+}
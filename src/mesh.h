@@ -0,0 +1,21 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <SDL3/SDL.h>
+
+// Import-time optimization of indexed triangle lists
+// vertices may be any layout as long as it starts with float x, y, z
+// intended order: RemapDuplicateVertices -> OptimizeVertexCache -> OptimizeOverdraw -> OptimizeVertexFetch
+// Simplify builds lower detail index lists over the same vertices (LODs); run OptimizeVertexCache on its output
+
+#define MESH_VERTEX_CACHE_SIZE 16     // post-transform cache size assumed for ordering and ACMR reporting
+#define MESH_OVERDRAW_THRESHOLD 1.05f // how much ACMR may degrade to gain better overdraw ordering
+
+Uint32 Mesh_RemapDuplicateVertices(Uint32* indices, Uint32 index_count, const void* vertices, Uint32 vertex_count, Uint32 vertex_size);
+bool Mesh_OptimizeVertexCache(Uint32* indices, Uint32 index_count, Uint32 vertex_count);
+bool Mesh_OptimizeOverdraw(Uint32* indices, Uint32 index_count, const void* vertices, Uint32 vertex_count, Uint32 vertex_size, float threshold);
+Uint32 Mesh_OptimizeVertexFetch(void* vertices, Uint32* indices, Uint32 index_count, Uint32 vertex_count, Uint32 vertex_size);
+Uint32 Mesh_Simplify(Uint32* destination, const Uint32* indices, Uint32 index_count, const void* vertices, Uint32 vertex_count, Uint32 vertex_size, Uint32 target_index_count, float target_error, float* result_error);
+float Mesh_CalculateACMR(const Uint32* indices, Uint32 index_count, Uint32 vertex_count, Uint32 cache_size);
+
+#endif // MESH_H
@@ -2,6 +2,12 @@
 #include "globals.h"
 #include "texture.h"
 #include "physics.h"
+#include "mesh.h"
+#include "loader.h"
+#include "hotreload.h"
+#include "streamer.h"
+#include "frustum.h"
+#include "gpumemory.h"
 
 // TODO: remove other libc references from cgltf and replace with SDL versions
 #define CGLTF_IMPLEMENTATION
@@ -12,7 +18,17 @@
 #define CGLTF_ATOLL(str) SDL_strtoll(str, NULL, 10)
 #include "../external/cgltf.h"
 
-// TODO upload everything in one copy pass instead of a dedicated copy pass per model
+static void Model_OnSceneLoaded(const char* filename, Uint32 scene_id, bool success, void* userdata)
+{
+    if (!success)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load model: %s", filename);
+        *(bool*)userdata = false;
+    }
+}
+
+// Queues every scene in _models_list.txt on the loader and waits until all of them are uploaded
+// scenes are imported in parallel; use Loader_RequestScene directly to stream one in without waiting
 bool Model_Load_AllScenes(void)
 {   
     char path[MAXIMUM_URI_LENGTH];
@@ -25,6 +41,8 @@ bool Model_Load_AllScenes(void)
         return false;
     }
 
+    bool success = true;
+
     char* saveptr = NULL;
     char* line = SDL_strtok_r(models_list_txt, "\r\n", &saveptr);
 
@@ -37,23 +55,49 @@ bool Model_Load_AllScenes(void)
         // Skip empty lines
         if (*line != '\0')
         {
-            if (!Model_Load_Scene(line))
+            Uint32 scene_id = Loader_RequestScene(line, Model_OnSceneLoaded, &success);
+            if (scene_id == 0)
             {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load model: %s", line);
-                SDL_free(models_list_txt);
-                return false;
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to request model: %s", line);
+                success = false;
+                break;
             }
+            HotReload_WatchScene(line, scene_id);
         }
         
         line = SDL_strtok_r(NULL, "\r\n", &saveptr);
     }
     
     SDL_free(models_list_txt);
-    return true;
+
+    // anything already requested has to finish before success can be trusted
+    if (!Loader_Flush())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to upload models");
+        return false;
+    }
+
+    return success;
 }
 
-bool Model_Load_Scene(const char* filename)
+// Parses a glTF scene into CPU memory: meshes are read, optimized, batched and quantized; textures are not decoded yet
+// safe to call from any thread; on failure the scene is already freed
+bool Model_LoadSceneData(const char* filename, Model_SceneData* scene)
 {
+    SDL_zerop(scene);
+    Array_Init(scene->meshes, 8);
+    Array_Init(scene->colliders, 64);
+    Array_Init(scene->occluders, 64);
+    Array_Init(scene->triggers, 4);
+    Array_Init(scene->static_batches, 8);
+    Array_Init(scene->instanced_batches, 8);
+    if (!scene->meshes || !scene->colliders || !scene->occluders || !scene->triggers || !scene->static_batches || !scene->instanced_batches)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate scene data: %s", filename);
+        Model_FreeSceneData(scene);
+        return false;
+    }
+
     char model_path[MAXIMUM_URI_LENGTH];
     SDL_snprintf(model_path, sizeof(model_path), "%smodels/%s", base_path, filename);
     size_t gltf_file_buffer_size = 0;
@@ -61,6 +105,7 @@ bool Model_Load_Scene(const char* filename)
     if (!gltf_file_buffer)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load glTF model file: %s", SDL_GetError());
+        Model_FreeSceneData(scene);
         return false;
     }
     
@@ -70,6 +115,8 @@ bool Model_Load_Scene(const char* filename)
     if (result != cgltf_result_success)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "cgltf_parse_file failed: cgltf_result %d for %s", result, model_path);
+        SDL_free(gltf_file_buffer);
+        Model_FreeSceneData(scene);
         return false;
     }
 
@@ -78,6 +125,8 @@ bool Model_Load_Scene(const char* filename)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "cgltf_load_buffers failed: cgltf_result %d", result);
         cgltf_free(gltf_data);
+        SDL_free(gltf_file_buffer);
+        Model_FreeSceneData(scene);
         return false;
     }
 
@@ -88,857 +137,1808 @@ bool Model_Load_Scene(const char* filename)
         SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "cgltf_validate failed: cgltf_result %d (continuing anyway)", result);
     }
 
+    bool success = true;
+
 	// assume we only have the single default scene
     #define root_nodes gltf_data->scene->nodes
     if (!gltf_data->scene || !root_nodes)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "No nodes found in glTF scene.");
-        cgltf_free(gltf_data);
-        return false;
+        success = false;
     }
-	for (size_t i = 0; i < gltf_data->scene->nodes_count; i++)
+	for (size_t i = 0; success && i < gltf_data->scene->nodes_count; i++)
 	{
 		if (root_nodes[i]->name == NULL)
         {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Root Node %zu has no name; nodes MUST be named and prefixed with numerical Model_Type", i);
-            cgltf_free(gltf_data);
-            return false;
+            success = false;
         }
-        if (!Model_Load(gltf_data, root_nodes[i]))
+        else if (!Model_Load(gltf_data, root_nodes[i], scene))
         {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load model from node %zu: %s", i, root_nodes[i]->name);
-            cgltf_free(gltf_data);
-            return false;
+            success = false;
         }
 	}
-
-    cgltf_free(gltf_data); // maps to SDL_free
-
-    return true;
     #undef root_nodes
-}
 
-bool Model_Load(cgltf_data* gltf_data, cgltf_node* node)
-{
-    Model_Type model_type = (Model_Type)SDL_atoi(node->name);
+    cgltf_free(gltf_data); // maps to SDL_free
+    SDL_free(gltf_file_buffer);
 
-    switch (model_type)
+    if (success && !Model_BuildStaticBatches(scene))
     {
-        case MODEL_TYPE_INVALID:
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Node %s has unknown model type", node->name);
-            return false;
-        case MODEL_TYPE_DO_NOT_IMPORT:
-            return true;
-        case MODEL_TYPE_COLLIDER:
-            if (!Model_Load_Collider(gltf_data, node))
-            {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load collider model from node: %s", node->name);
-                return false;
-            }
-            else return true;
-        case MODEL_TYPE_TRIGGER:
-            if (!Model_Load_Trigger(gltf_data, node))
-            {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load trigger model from node: %s", node->name);
-                return false;
-            }
-            else return true;
-            break;
-        default: break;
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build static batches: %s", filename);
+        success = false;
     }
 
-    /**************** Animation / Rigging ****************/
+    if (success && !Model_BuildInstancedBatches(scene))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to build instanced batches: %s", filename);
+        success = false;
+    }
 
-    Animation_Rig animation_rig = {0};
-    if (model_type == MODEL_TYPE_BONE_ANIMATED_MIXAMO)
+    if (!success)
     {
-        /*
-            If this is a mixamo model...
+        Model_FreeSceneData(scene);
+    }
 
-            This armature node should have two children:
-            * A node with the skin and mesh
-            * The hip joint node (which is the root of the skeleton)
-            
-            This node will have its own rotation (up-direction fix) and scale.
-            This corrective matrix is applied at the start of the joint matrix calculations
-        */
+    return success;
+}
 
-        mat4 t_matrix, r_matrix, s_matrix;
-        
-        if (node->has_translation)
+void Model_FreeSceneData(Model_SceneData* scene)
+{
+    if (scene->meshes)
+    {
+        for (size_t i = 0; i < Array_Len(scene->meshes); i++)
         {
-            glm_translate_make(t_matrix, node->translation);
+            Model_MeshData_Free(&scene->meshes[i]);
         }
-        else
+    }
+    if (scene->static_batches)
+    {
+        for (size_t i = 0; i < Array_Len(scene->static_batches); i++)
         {
-            glm_mat4_identity(t_matrix);
+            Static_Batch* batch = &scene->static_batches[i];
+            for (int ii = 0; ii < 3; ii++) SDL_free(batch->texture_uris[ii]);
+            Array_Free(batch->vertices);
+            Array_Free(batch->indices);
+            for (int ii = 0; ii < MODEL_LOD_COUNT - 1; ii++) Array_Free(batch->lod_indices[ii]);
+            Array_Free(batch->submeshes);
         }
-        if (node->has_rotation)
+    }
+    if (scene->instanced_batches)
+    {
+        for (size_t i = 0; i < Array_Len(scene->instanced_batches); i++)
         {
-            glm_quat_mat4(node->rotation, r_matrix);
+            Model_MeshData_Free(&scene->instanced_batches[i].mesh_data);
         }
-        else
+    }
+    Array_Free(scene->meshes);
+    Array_Free(scene->colliders);
+    Array_Free(scene->occluders);
+    Array_Free(scene->triggers);
+    Array_Free(scene->static_batches);
+    Array_Free(scene->instanced_batches);
+}
+
+// Mesh Import ////////////
+
+// Reads one triangle primitive into CPU memory as Vertex_PBR (or Vertex_BoneAnimated) with 32 bit indices,
+// then optimizes it for the post-transform cache, overdraw and vertex fetch (see mesh.c)
+// on success the caller owns *vertices_out and *indices_out
+static bool Model_ReadPrimitive(cgltf_primitive* primitive, bool is_bone_animated, const char* name, Uint8** vertices_out, Uint32* vertex_count_out, Uint32** indices_out, Uint32* index_count_out)
+{
+    if (primitive->type != cgltf_primitive_type_triangles)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: gltf primitive has type %d, expected type %d (triangles).", primitive->type, cgltf_primitive_type_triangles);
+        return false;
+    }
+
+    cgltf_accessor* position_accessor = NULL;
+    cgltf_accessor* normal_accessor = NULL;
+    cgltf_accessor* texcoord_accessor = NULL;
+    cgltf_accessor* tangent_accessor = NULL;
+    cgltf_accessor* joint_ids_accessor = NULL;
+    cgltf_accessor* joint_weights_accessor = NULL;
+    
+    for (size_t i = 0; i < primitive->attributes_count; ++i)
+    {
+        cgltf_attribute* attr = &(primitive->attributes[i]);
+        if (attr->type == cgltf_attribute_type_position)
         {
-            glm_mat4_identity(r_matrix);
+            position_accessor = attr->data;
         }
-        if (node->has_scale)
+        else if (attr->type == cgltf_attribute_type_normal)
         {
-            glm_scale_make(s_matrix, node->scale);
+            normal_accessor = attr->data;
         }
-        else
+        else if (attr->type == cgltf_attribute_type_texcoord && attr->index == 0)
         {
-            glm_mat4_identity(s_matrix);
+            texcoord_accessor = attr->data;
         }
-        
-        glm_mat4_mul(t_matrix, r_matrix, animation_rig.armature_correction_matrix);
-        glm_mat4_mul(animation_rig.armature_correction_matrix, s_matrix, animation_rig.armature_correction_matrix);
-
-        cgltf_skin* skin = node->skin;
-        
-        if (skin)
+        else if (attr->type == cgltf_attribute_type_tangent)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Unexpected skin in armature root node: %s\nskin was expected to be in a child of this node", node->name);
-            return false;
+            tangent_accessor = attr->data;
         }
-        
-        // we don't assume the order of the children,
-        // we just know one of them should have the skin
-        for (size_t i = 0; i < node->children_count; ++i)
+        else if (attr->type == cgltf_attribute_type_joints && attr->index == 0)
         {
-            skin = node->children[i]->skin;
-            
-            if (skin)
-            {
-                node = node->children[i];
-                break;
-            }
+            joint_ids_accessor = attr->data;
+        }
+        else if (attr->type == cgltf_attribute_type_weights && attr->index == 0)
+        {
+            joint_weights_accessor = attr->data;
         }
+    }
 
-        if (!skin)
+    if (!position_accessor || !normal_accessor || !texcoord_accessor || !tangent_accessor)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing at least one attribute: POSITION, NORMAL, TEXCOORD, TANGENT.");
+        return false;
+    }
+
+    if (position_accessor->component_type != cgltf_component_type_r_32f ||
+        normal_accessor->component_type   != cgltf_component_type_r_32f ||
+        texcoord_accessor->component_type != cgltf_component_type_r_32f ||
+        tangent_accessor->component_type != cgltf_component_type_r_32f) 
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Expected POSITION, NORMAL, TEXCOORD, TANGENT to be Float32. Current gltf loader does not support automatic conversion.");
+        return false;
+    }
+
+    if (is_bone_animated)
+    {    
+        if (!joint_ids_accessor || !joint_weights_accessor)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Failed to load skin; node: %s", node->name);
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing at least one attribute: JOINTS, WEIGHTS.");
             return false;
         }
-
-        animation_rig.num_joints = (Uint8)node->skin->joints_count;
-        animation_rig.joints = (Joint*)SDL_malloc(sizeof(Joint) * animation_rig.num_joints);
-        if (animation_rig.joints == NULL)
+        if (joint_ids_accessor->component_type != cgltf_component_type_r_8u || joint_weights_accessor->component_type != cgltf_component_type_r_32f)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for joints for skin: %s", node->name);
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Expected JOINTS to be Uint8 and WEIGHTS to be Float32.");
             return false;
         }
+    }
 
-        /*
-            I want to reference joints by their index in the joint matrix array, but...
-            - gltf refers to them by their index in the gltf node array
-            - cgltf references them via `cgltf_node*`, not an index
+    Uint32 vertex_count = (Uint32)position_accessor->count;
+    Uint32 vertex_size;
+    if (is_bone_animated)
+        vertex_size = (Uint32)sizeof(Vertex_BoneAnimated);
+    else
+        vertex_size = (Uint32)sizeof(Vertex_PBR);
 
-            Hence the conversion via `cgltf_node_index` and then my own `gltf_index_to_joint_mat_index`
+    // any index component type is accepted; they are all unpacked to 32 bit below
+    cgltf_accessor* index_accessor = primitive->indices;
+    if (index_accessor == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing indices.");
+        return false;
+    }
 
-            This is a constant time lookup, and if the bone animated model is the only thing in the gltf file, 
-            the number of joints ~= the total number of nodes in the gltf file (it's ~ a perfect hash table)
-        */
-        Uint8 gltf_index_to_joint_mat_index[gltf_data->nodes_count];
+    Uint32 index_count = (Uint32)index_accessor->count;
 
-        #define gltf_joint_node skin->joints[i]
+    // using buffers directly myself because there is a bug which seems to stem from cgltf_accessor_read_uint,
+    // which is supposed to read (32 bit) unsigned ints. The joint IDs are stored as 8 bit uints
+    // You would think since there are conveniently 4 joint IDs per vertex, that reading them 
+    // as a single 32 bit uint would work, and yet for some reason it is broken.
+    // that approach is comment out below
 
-        for (size_t i = 0; i < animation_rig.num_joints; i++)
+    const uint8_t* pos_data_base = cgltf_buffer_view_data(position_accessor->buffer_view);
+    if (pos_data_base == NULL) 
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get position data buffer view.");
+        return false;
+    }
+    pos_data_base += position_accessor->offset;
+
+    const uint8_t* normal_data_base = cgltf_buffer_view_data(normal_accessor->buffer_view);
+    if (normal_data_base == NULL) 
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get normal data buffer view.");
+        return false; 
+    }
+    normal_data_base += normal_accessor->offset;
+
+    const uint8_t* texcoord_data_base = cgltf_buffer_view_data(texcoord_accessor->buffer_view);
+    if (texcoord_data_base == NULL) 
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get texcoord data buffer view.");
+        return false; 
+    }
+    texcoord_data_base += texcoord_accessor->offset;
+
+    const uint8_t* tangent_data_base = cgltf_buffer_view_data(tangent_accessor->buffer_view);
+    if (tangent_data_base == NULL) 
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get tangent data buffer view.");
+        return false; 
+    }
+    tangent_data_base += tangent_accessor->offset;
+
+    // vertices and indices are assembled on the CPU first so they can be optimized before upload
+    Uint8* vertices = SDL_malloc((size_t)vertex_size * vertex_count);
+    Uint32* indices = SDL_malloc(sizeof(Uint32) * index_count);
+    if (vertices == NULL || indices == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for mesh data: %s", name);
+        SDL_free(vertices);
+        SDL_free(indices);
+        return false;
+    }
+
+    if (is_bone_animated)
+    {
+        const uint8_t* joint_ids_data_base= cgltf_buffer_view_data(joint_ids_accessor->buffer_view);
+        if (joint_ids_data_base == NULL) 
         {
-            gltf_index_to_joint_mat_index[(Uint8)cgltf_node_index(gltf_data, gltf_joint_node)] = i;
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get joint IDs data buffer view.");
+            SDL_free(vertices);
+            SDL_free(indices);
+            return false; 
         }
+        joint_ids_data_base += joint_ids_accessor->offset;
 
-        for (size_t i = 0; i < animation_rig.num_joints; i++)
+        const uint8_t* joint_weights_data_base = cgltf_buffer_view_data(joint_weights_accessor->buffer_view);
+        if (joint_weights_data_base == NULL) 
         {
-            animation_rig.joints[i].num_children = gltf_joint_node->children_count;
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get joint weights data buffer view.");
+            SDL_free(vertices);
+            SDL_free(indices);
+            return false; 
+        }
+        joint_weights_data_base += joint_weights_accessor->offset;
 
-            for (size_t ii = 0; ii < gltf_joint_node->children_count && ii < MAX_CHILDREN_PER_JOINT; ii++)
-            {
-                animation_rig.joints[i].children[ii] = gltf_index_to_joint_mat_index[(Uint8)cgltf_node_index(gltf_data, gltf_joint_node->children[ii])];
-            }
+        for (size_t i = 0; i < position_accessor->count; i++)
+        {
+            Vertex_BoneAnimated* dest_vertex = &((Vertex_BoneAnimated*)vertices)[i];
 
-            // these vectors should put the skeleton in the default A/T Pose
-            
-            if (gltf_joint_node->has_translation)
-            {
-                glm_vec3_copy(gltf_joint_node->translation, animation_rig.joints[i].translation);
-            }
-            else
-            {
-                glm_vec3_zero(animation_rig.joints[i].translation);
-            }
-            if (gltf_joint_node->has_rotation)
-            {
-                glm_quat_copy(gltf_joint_node->rotation, animation_rig.joints[i].rotation);
-            }
-            else
-            {
-                glm_quat_identity(animation_rig.joints[i].rotation);
-            }
-            if (gltf_joint_node->has_scale)
-            {
-                glm_vec3_copy(gltf_joint_node->scale, animation_rig.joints[i].scale);
-            }
-            else
-            {
-                glm_vec3_one(animation_rig.joints[i].scale);
-            }
-        }
+            const void* src_pos = pos_data_base + i * position_accessor->stride;
+            memcpy(&dest_vertex->x, src_pos, sizeof(float) * 3);
 
-        #undef gltf_joint_node
+            const void* src_normal = normal_data_base + i * normal_accessor->stride;
+            memcpy(&dest_vertex->nx, src_normal, sizeof(float) * 3);
 
-        mat4 inverse_bind_matrices[animation_rig.num_joints];
+            const void* src_texcoord = texcoord_data_base + i * texcoord_accessor->stride;
+            memcpy(&dest_vertex->u, src_texcoord, sizeof(float) * 2);
 
-        cgltf_accessor_unpack_floats(skin->inverse_bind_matrices, (float*)inverse_bind_matrices, 16 * animation_rig.num_joints); 
-        
-        // populate the joints with inverse bind matrices
-        for (size_t i = 0; i < animation_rig.num_joints; ++i)
-        {
-            SDL_memcpy(animation_rig.joints[i].inverse_bind_matrix, inverse_bind_matrices[i], sizeof(mat4));        
-        }
+            const void* src_tangent = tangent_data_base + i * tangent_accessor->stride;
+            memcpy(&dest_vertex->tx, src_tangent, sizeof(float) * 4);
 
-        // load animations
+            const void* src_joint_ids = joint_ids_data_base + i * joint_ids_accessor->stride;
+            memcpy(dest_vertex->joint_ids, src_joint_ids, sizeof(uint8_t) * MAX_JOINTS_PER_VERTEX);
 
-        animation_rig.num_skeletal_animations = (Uint8)gltf_data->animations_count;
-        animation_rig.skeletal_animations = (Animation_Skeletal*)SDL_malloc(sizeof(Animation_Skeletal) * animation_rig.num_skeletal_animations);
-        if (animation_rig.skeletal_animations == NULL)
-        {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for skeletal animations for skin: %s", node->name);
-            return false;
+            const void* src_weights = joint_weights_data_base + i * joint_weights_accessor->stride;
+            memcpy(dest_vertex->weights, src_weights, sizeof(float) * MAX_JOINTS_PER_VERTEX);
         }
-
-        for (size_t i = 0; i < animation_rig.num_skeletal_animations; ++i)
+    }
+    else
+    {
+        for (size_t i = 0; i < position_accessor->count; i++)
         {
-            animation_rig.skeletal_animations[i].animation_id = (Animation_Skeletal_ID)SDL_atoi(gltf_data->animations[i].name);
-            animation_rig.skeletal_animations[i].num_key_frames = (Uint16)gltf_data->animations[i].samplers[0].input->count;
-            animation_rig.skeletal_animations[i].num_joint_updates_per_frame = (Uint16)gltf_data->animations[i].channels_count;
-            animation_rig.skeletal_animations[i].key_frame_times = (float*)SDL_malloc(sizeof(float) * animation_rig.skeletal_animations[i].num_key_frames);
-            animation_rig.skeletal_animations[i].joint_updates = (Joint_Update*)SDL_malloc(sizeof(Joint_Update) * animation_rig.skeletal_animations[i].num_joint_updates_per_frame * animation_rig.skeletal_animations[i].num_key_frames);
-            if (animation_rig.skeletal_animations[i].key_frame_times == NULL || animation_rig.skeletal_animations[i].joint_updates == NULL)
-            {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for key frame times or joint updates for skeletal animation %zu in skin: %s", i, node->name);
-                SDL_free(animation_rig.skeletal_animations[i].key_frame_times);
-                SDL_free(animation_rig.skeletal_animations[i].joint_updates);
-                return false;
-            }
-            cgltf_animation* animation = &gltf_data->animations[i];
+            Vertex_PBR* dest_vertex = &((Vertex_PBR*)vertices)[i];
 
-            // Copy key frame times
-            // we assume each channel uses the same input accessor for the key frame times
-            cgltf_accessor* input_accessor = animation->samplers[0].input;
-            cgltf_accessor_unpack_floats(input_accessor, animation_rig.skeletal_animations[i].key_frame_times, animation_rig.skeletal_animations[i].num_key_frames);
+            const void* src_pos = pos_data_base + i * position_accessor->stride;
+            memcpy(&dest_vertex->x, src_pos, sizeof(float) * 3);
 
-            // Copy joint updates
-            // gltf is structured such that each channel tracks how a single joint is updated over time
-            // I want to invert this so that each key frame has all joint updates for that frame adjacent in memory
-            for (size_t j = 0; j < animation_rig.skeletal_animations[i].num_key_frames; ++j)
-            {
-                for (size_t k = 0; k < animation_rig.skeletal_animations[i].num_joint_updates_per_frame; ++k)
-                {
-                    Joint_Update* joint_update = &animation_rig.skeletal_animations[i].joint_updates[j * animation_rig.skeletal_animations[i].num_joint_updates_per_frame + k];
-                    cgltf_animation_channel* channel = &animation->channels[k];
-                    cgltf_accessor* output_accessor = channel->sampler->output;
-                    joint_update->joint_index = gltf_index_to_joint_mat_index[(Uint8)cgltf_node_index(gltf_data, channel->target_node)];
-            
-                    // Read joint update data
-                    switch (channel->target_path)
-                    {
-                        case cgltf_animation_path_type_translation:
-                            joint_update->joint_update_type = JOINT_UPDATE_TYPE_TRANSLATION;
-                            cgltf_accessor_read_float(output_accessor, j, joint_update->translation, 3);
-                            break;
-                        case cgltf_animation_path_type_rotation:
-                            joint_update->joint_update_type = JOINT_UPDATE_TYPE_ROTATION;
-                            cgltf_accessor_read_float(output_accessor, j, joint_update->rotation, 4);
-                            break;
-                        case cgltf_animation_path_type_scale:
-                            joint_update->joint_update_type = JOINT_UPDATE_TYPE_SCALE;
-                            cgltf_accessor_read_float(output_accessor, j, joint_update->scale, 3);
-                            break;
-                        default:
-                            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unsupported animation path type: %d", channel->target_path);
-                            return false;
-                    }
-                }
-            }
+            const void* src_normal = normal_data_base + i * normal_accessor->stride;
+            memcpy(&dest_vertex->nx, src_normal, sizeof(float) * 3);
+
+            const void* src_texcoord = texcoord_data_base + i * texcoord_accessor->stride;
+            memcpy(&dest_vertex->u, src_texcoord, sizeof(float) * 2);
+
+            const void* src_tangent = tangent_data_base + i * tangent_accessor->stride;
+            memcpy(&dest_vertex->tx, src_tangent, sizeof(float) * 4);
         }
     }
+    // for (size_t i = 0; i < position_accessor->count; ++i)
+    // {
+    //     if (!cgltf_accessor_read_float(position_accessor, i, &transfer_buffer_mapped[i].x, 3))
+    //     {
+    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read position for vertex %zu", i);
+    //         return false;
+    //     }
+    //     if (!cgltf_accessor_read_float(normal_accessor, i, &transfer_buffer_mapped[i].nx, 3))
+    //     {
+    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read normal for vertex %zu", i);
+    //         return false;
+    //     }
+    //     if (!cgltf_accessor_read_float(texcoord_accessor, i, &transfer_buffer_mapped[i].u, 2))
+    //     {
+    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read texcoord for vertex %zu", i);
+    //         return false;
+    //     }
+    //     if (!cgltf_accessor_read_uint(joint_ids_accessor, i, (cgltf_uint*)&transfer_buffer_mapped[i].joint_ids, 4))
+    //     {
+    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read joint IDs for vertex %zu", i);
+    //         return false;
+    //     }
+    //     if (!cgltf_accessor_read_float(joint_weights_accessor, i, &transfer_buffer_mapped[i].weights, 4))
+    //     {
+    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read joint weights for vertex %zu", i);
+    //         return false;
+    //     }
+    // }
 
-    /**************** Mesh ****************/
-
-    if (node->mesh->primitives_count != 1)
+    size_t unpacked_indices_count = cgltf_accessor_unpack_indices(index_accessor, indices, sizeof(Uint32), index_count);
+    if (unpacked_indices_count != index_count)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: Expected mesh with one primitive. Found %zu primitives in node: %s.", node->mesh->primitives_count, node->name);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error unpacking gltf primitive indices: unexpected index_count (unpacked %zu, expected %u).", unpacked_indices_count, index_count);
+        SDL_free(vertices);
+        SDL_free(indices);
         return false;
     }
 
-    cgltf_primitive* primitive = node->mesh->primitives;
-    if (primitive->type != cgltf_primitive_type_triangles)
+    // Mesh optimization: merge duplicates, reorder for the post-transform cache and overdraw, then for fetch locality
+    float acmr_before = Mesh_CalculateACMR(indices, index_count, vertex_count, MESH_VERTEX_CACHE_SIZE);
+    Uint32 vertex_count_before = vertex_count;
+    Mesh_RemapDuplicateVertices(indices, index_count, vertices, vertex_count, vertex_size);
+    if (!Mesh_OptimizeVertexCache(indices, index_count, vertex_count))
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: gltf primitive has type %d, expected type %d (triangles).", primitive->type, cgltf_primitive_type_triangles);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to optimize mesh: %s", name);
+        SDL_free(vertices);
+        SDL_free(indices);
         return false;
     }
+    Mesh_OptimizeOverdraw(indices, index_count, vertices, vertex_count, vertex_size, MESH_OVERDRAW_THRESHOLD);
+    vertex_count = Mesh_OptimizeVertexFetch(vertices, indices, index_count, vertex_count, vertex_size);
+    float acmr_after = Mesh_CalculateACMR(indices, index_count, vertex_count, MESH_VERTEX_CACHE_SIZE);
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Optimized mesh %s: ACMR %.3f -> %.3f, vertices %u -> %u", 
+        name, acmr_before, acmr_after, vertex_count_before, vertex_count);
 
-    cgltf_accessor* position_accessor = NULL;
-    cgltf_accessor* normal_accessor = NULL;
-    cgltf_accessor* texcoord_accessor = NULL;
-    cgltf_accessor* tangent_accessor = NULL;
-    cgltf_accessor* joint_ids_accessor = NULL;
-    cgltf_accessor* joint_weights_accessor = NULL;
-    
-    for (size_t i = 0; i < primitive->attributes_count; ++i)
+    *vertices_out = vertices;
+    *vertex_count_out = vertex_count;
+    *indices_out = indices;
+    *index_count_out = index_count;
+    return true;
+}
+
+// Vertex Quantization ////////////
+
+static Uint16 Model_FloatToHalf(float value)
+{
+    Uint32 bits;
+    SDL_memcpy(&bits, &value, sizeof(bits));
+
+    Uint32 sign = (bits >> 16) & 0x8000;
+    Sint32 exponent = (Sint32)((bits >> 23) & 0xFF) - 127 + 15;
+    Uint32 mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31) // overflow (and NaN) saturate to infinity
+        return (Uint16)(sign | 0x7C00);
+
+    if (exponent <= 0) // denormal or zero
     {
-        cgltf_attribute* attr = &(primitive->attributes[i]);
-        if (attr->type == cgltf_attribute_type_position)
-        {
-            position_accessor = attr->data;
-        }
-        else if (attr->type == cgltf_attribute_type_normal)
-        {
-            normal_accessor = attr->data;
-        }
-        else if (attr->type == cgltf_attribute_type_texcoord && attr->index == 0)
-        {
-            texcoord_accessor = attr->data;
-        }
-        else if (attr->type == cgltf_attribute_type_tangent)
-        {
-            tangent_accessor = attr->data;
-        }
-        else if (attr->type == cgltf_attribute_type_joints && attr->index == 0)
-        {
-            joint_ids_accessor = attr->data;
-        }
-        else if (attr->type == cgltf_attribute_type_weights && attr->index == 0)
-        {
-            joint_weights_accessor = attr->data;
-        }
+        if (exponent < -10) return (Uint16)sign;
+        mantissa |= 0x800000;
+        Uint32 shift = (Uint32)(14 - exponent);
+        Uint32 half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) half++;
+        return (Uint16)(sign | half);
     }
 
-    if (!position_accessor || !normal_accessor || !texcoord_accessor || !tangent_accessor)
+    Uint32 half = sign | ((Uint32)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) half++; // round to nearest; a carry into the exponent is still correct
+    return (Uint16)half;
+}
+
+static Sint16 Model_FloatToSnorm16(float value)
+{
+    value = SDL_clamp(value, -1.0f, 1.0f) * 32767.0f;
+    return (Sint16)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+}
+
+// octahedral mapping of a direction onto [-1, 1]^2; decoded by Vertex_DecodeOctahedral in shaders/vertex.h
+static void Model_EncodeOctahedral(const float* direction, Sint16* encoded)
+{
+    float l1_norm = SDL_fabsf(direction[0]) + SDL_fabsf(direction[1]) + SDL_fabsf(direction[2]);
+    if (l1_norm == 0.0f)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing at least one attribute: POSITION, NORMAL, TEXCOORD, TANGENT.");
-        return false;
+        encoded[0] = encoded[1] = 0;
+        return;
     }
 
-    if (position_accessor->component_type != cgltf_component_type_r_32f ||
-        normal_accessor->component_type   != cgltf_component_type_r_32f ||
-        texcoord_accessor->component_type != cgltf_component_type_r_32f ||
-        tangent_accessor->component_type != cgltf_component_type_r_32f) 
+    float x = direction[0] / l1_norm;
+    float y = direction[1] / l1_norm;
+    if (direction[2] < 0.0f)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Expected POSITION, NORMAL, TEXCOORD, TANGENT to be Float32. Current gltf loader does not support automatic conversion.");
-        return false;
+        float folded_x = (1.0f - SDL_fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float folded_y = (1.0f - SDL_fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+        y = folded_y;
     }
 
-    if (model_type == MODEL_TYPE_BONE_ANIMATED_MIXAMO || model_type == MODEL_TYPE_BONE_ANIMATED)
-    {    
-        if (!joint_ids_accessor || !joint_weights_accessor)
-        {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing at least one attribute: JOINTS, WEIGHTS.");
-            return false;
-        }
-        if (joint_ids_accessor->component_type != cgltf_component_type_r_8u || joint_weights_accessor->component_type != cgltf_component_type_r_32f)
-        {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Expected JOINTS to be Uint8 and WEIGHTS to be Float32.");
-            return false;
-        }
-    }
+    encoded[0] = Model_FloatToSnorm16(x);
+    encoded[1] = Model_FloatToSnorm16(y);
+}
 
-    Uint32 vertex_data_size;
-    if (model_type == MODEL_TYPE_BONE_ANIMATED_MIXAMO || model_type == MODEL_TYPE_BONE_ANIMATED)
-        vertex_data_size = (Uint32)(sizeof(Vertex_BoneAnimated) * position_accessor->count);
-    else
-        vertex_data_size = (Uint32)(sizeof(Vertex_PBR) * position_accessor->count);
+// Converts Vertex_PBR / Vertex_BoneAnimated into the matching quantized GPU layout (see model.h)
+// position_offset/scale receive what the vertex shader needs to reconstruct the positions
+// positions are rounded to the nearest point of a grid aligned to the origin, whose step is a power of two, so a position
+// two meshes share (e.g. neighbouring static batches) is rounded the same way in both and never cracks
+// bounds_min and bounds_max receive the bounds of the positions
+static void Model_QuantizeVertices(const void* vertices, Uint32 vertex_count, bool is_bone_animated, void* quantized_vertices, vec4 position_offset, vec4 position_scale, vec3 bounds_min, vec3 bounds_max)
+{
+    Uint32 vertex_size = is_bone_animated ? (Uint32)sizeof(Vertex_BoneAnimated) : (Uint32)sizeof(Vertex_PBR);
+    Uint32 quantized_vertex_size = is_bone_animated ? (Uint32)sizeof(Vertex_BoneAnimated_Quantized) : (Uint32)sizeof(Vertex_PBR_Quantized);
 
-    Mesh mesh = {0};
-    mesh.vertex_buffer = SDL_CreateGPUBuffer
-    (
-        gpu_device,
-        &(SDL_GPUBufferCreateInfo)
-        {
-            .usage = SDL_GPU_BUFFERUSAGE_VERTEX,
-            .size = vertex_data_size
-        }
-    );
-    if (mesh.vertex_buffer == NULL)
+    vec3 aabb_min = {FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3 aabb_max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (Uint32 i = 0; i < vertex_count; i++)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create vertex buffer: %s", SDL_GetError());
-        return false;
+        // both import layouts start with the same position, normal, uv and tangent as Vertex_PBR
+        const Vertex_PBR* vertex = (const Vertex_PBR*)((const Uint8*)vertices + (size_t)i * vertex_size);
+        vec3 position = {vertex->x, vertex->y, vertex->z};
+        glm_vec3_minv(aabb_min, position, aabb_min);
+        glm_vec3_maxv(aabb_max, position, aabb_max);
+    }
+    if (vertex_count == 0)
+    {
+        glm_vec3_zero(aabb_min);
+        glm_vec3_zero(aabb_max);
     }
+    glm_vec3_copy(aabb_min, bounds_min);
+    glm_vec3_copy(aabb_max, bounds_max);
 
-    cgltf_accessor* index_accessor = primitive->indices;
-    if (index_accessor == NULL)
+#if VERTEX_QUANTIZE_POSITIONS
+    // VERTEX_POSITION_STEP unless the mesh spans more than 65535 of them; doubling keeps the finer grid's points
+    double step = VERTEX_POSITION_STEP;
+    double first_step[3];
+    bool fits = false;
+    while (!fits)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing indices.");
-        return false;
+        fits = true;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            first_step[axis] = SDL_floor(aabb_min[axis] / step);
+            fits = fits && SDL_floor(aabb_max[axis] / step + 0.5) - first_step[axis] <= 65535.0;
+        }
+        if (!fits) step *= 2.0;
     }
-    if (index_accessor->component_type != cgltf_component_type_r_16u)
+    for (int axis = 0; axis < 3; axis++)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Expected index component type to be Uint16, got %d", index_accessor->component_type);
-        return false;
+        position_offset[axis] = (float)(first_step[axis] * step);
+        position_scale[axis] = (float)(65535.0 * step);
     }
+    position_offset[3] = 0.0f;
+    position_scale[3] = 1.0f;
+#else
+    glm_vec4_zero(position_offset);
+    glm_vec4_one(position_scale);
+#endif
 
-    mesh.index_count = index_accessor->count;
+    for (Uint32 i = 0; i < vertex_count; i++)
+    {
+        const Vertex_PBR* vertex = (const Vertex_PBR*)((const Uint8*)vertices + (size_t)i * vertex_size);
+        Vertex_PBR_Quantized* quantized = (Vertex_PBR_Quantized*)((Uint8*)quantized_vertices + (size_t)i * quantized_vertex_size);
 
-    Uint32 index_data_size = (Uint32)(sizeof(Uint16) * mesh.index_count);
-    mesh.index_buffer = SDL_CreateGPUBuffer
-    (
-        gpu_device,
-        &(SDL_GPUBufferCreateInfo)
+        const float* position = &vertex->x;
+        for (int axis = 0; axis < 3; axis++)
         {
-            .usage = SDL_GPU_BUFFERUSAGE_INDEX,
-            .size = index_data_size
+#if VERTEX_QUANTIZE_POSITIONS
+            double grid_step = SDL_floor(position[axis] / step + 0.5) - first_step[axis];
+            quantized->position[axis] = (Uint16)SDL_clamp(grid_step, 0.0, 65535.0);
+#else
+            quantized->position[axis] = position[axis];
+#endif
         }
-    );
-    if (mesh.index_buffer == NULL)
-    {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create index buffer: %s", SDL_GetError());
-        return false;
-    }
+#if VERTEX_QUANTIZE_POSITIONS
+        quantized->position[3] = vertex->tw < 0.0f ? 0 : 0xFFFF;
+#else
+        quantized->position[3] = vertex->tw < 0.0f ? 0.0f : 1.0f;
+#endif
 
-    Uint32 combined_data_size = vertex_data_size + index_data_size;
+        Model_EncodeOctahedral(&vertex->nx, &quantized->normal_tangent[0]);
+        Model_EncodeOctahedral(&vertex->tx, &quantized->normal_tangent[2]);
 
-    SDL_GPUTransferBuffer* transfer_buffer = SDL_CreateGPUTransferBuffer
-    (
-        gpu_device,
-        &(SDL_GPUTransferBufferCreateInfo)
+        quantized->uv[0] = Model_FloatToHalf(vertex->u);
+        quantized->uv[1] = Model_FloatToHalf(vertex->v);
+
+        if (is_bone_animated)
         {
-            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-            .size = combined_data_size
-        }
-    );
-    if (transfer_buffer == NULL)
-    {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create vertex/index transfer buffer: %s", SDL_GetError());
-        return false;
-    }
+            const Vertex_BoneAnimated* vertex_animated = (const Vertex_BoneAnimated*)vertex;
+            Vertex_BoneAnimated_Quantized* quantized_animated = (Vertex_BoneAnimated_Quantized*)quantized;
 
-    uint8_t* transfer_buffer_mapped = SDL_MapGPUTransferBuffer(gpu_device, transfer_buffer, false);
-    if (transfer_buffer_mapped == NULL)
+            SDL_memcpy(quantized_animated->joint_ids, vertex_animated->joint_ids, sizeof(quantized_animated->joint_ids));
+
+            // round each weight, then give the rounding error to the largest one so skinning stays affine
+            int weight_sum = 0;
+            int largest = 0;
+            for (int j = 0; j < MAX_JOINTS_PER_VERTEX; j++)
+            {
+                float weight = SDL_clamp(vertex_animated->weights[j], 0.0f, 1.0f);
+                quantized_animated->weights[j] = (Uint8)(weight * 255.0f + 0.5f);
+                weight_sum += quantized_animated->weights[j];
+                if (vertex_animated->weights[j] > vertex_animated->weights[largest]) largest = j;
+            }
+            int corrected = quantized_animated->weights[largest] + (255 - weight_sum);
+            quantized_animated->weights[largest] = (Uint8)SDL_clamp(corrected, 0, 255);
+        }
+    }
+}
+
+// Diffuse, metallic-roughness and normal texture file names of a primitive's material
+static void Model_GetTextureURIs(cgltf_primitive* primitive, const char* texture_uris[3])
+{
+    // TODO emissive maps
+    // (use SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM for non-color maps)
+    const char* texture_diffuse_uri = NULL;
+    const char* texture_metallic_roughness_uri = NULL;
+    const char* texture_normal_uri = NULL;
+    if (primitive->material && primitive->material->has_pbr_metallic_roughness)
+    {
+        cgltf_texture* base_color_texture = primitive->material->pbr_metallic_roughness.base_color_texture.texture;
+        if (base_color_texture && base_color_texture->image && base_color_texture->image->uri)
+        {
+            texture_diffuse_uri = base_color_texture->image->uri;
+        }
+        cgltf_texture* metallic_roughness_texture = primitive->material->pbr_metallic_roughness.metallic_roughness_texture.texture;
+        if (metallic_roughness_texture && metallic_roughness_texture->image && metallic_roughness_texture->image->uri)
+        {
+            texture_metallic_roughness_uri = metallic_roughness_texture->image->uri;
+        }
+    }
+    if (primitive->material && primitive->material->normal_texture.texture)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map vertex/index transfer buffer: %s", SDL_GetError());
+        cgltf_texture* normal_texture = primitive->material->normal_texture.texture;
+        if (normal_texture && normal_texture->image && normal_texture->image->uri)
+        {
+            texture_normal_uri = normal_texture->image->uri;
+        }
+    }
+
+    // texture_diffuse_uri = "white.png";
+    texture_metallic_roughness_uri = "orange.png";
+    texture_normal_uri = "default_normal.png";
+
+    texture_uris[0] = texture_diffuse_uri;
+    texture_uris[1] = texture_metallic_roughness_uri;
+    texture_uris[2] = texture_normal_uri;
+}
+
+// Fills mesh_data from Vertex_PBR or Vertex_BoneAnimated vertices; they are quantized into a new allocation
+// indices must already be in the width given by index_element_size and are copied
+static bool Model_MeshData_Init(Model_MeshData* mesh_data, const void* vertices, Uint32 vertex_count, bool is_bone_animated, const void* indices, Uint32 index_count, SDL_GPUIndexElementSize index_element_size, const char* const texture_uris[3])
+{
+    SDL_zerop(mesh_data);
+    mesh_data->is_bone_animated = is_bone_animated;
+    mesh_data->index_count = index_count;
+    mesh_data->index_element_size = index_element_size;
+
+    Uint32 vertex_size = is_bone_animated ? (Uint32)sizeof(Vertex_BoneAnimated_Quantized) : (Uint32)sizeof(Vertex_PBR_Quantized);
+    Uint32 index_size = index_element_size == SDL_GPU_INDEXELEMENTSIZE_32BIT ? sizeof(Uint32) : sizeof(Uint16);
+    mesh_data->vertex_data_size = vertex_size * vertex_count;
+    mesh_data->index_data_size = index_size * index_count;
+
+    mesh_data->vertices = SDL_malloc(mesh_data->vertex_data_size);
+    mesh_data->indices = SDL_malloc(mesh_data->index_data_size);
+    if (mesh_data->vertices == NULL || mesh_data->indices == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for mesh data");
+        Model_MeshData_Free(mesh_data);
         return false;
     }
 
-    // using buffers directly myself because there is a bug which seems to stem from cgltf_accessor_read_uint,
-    // which is supposed to read (32 bit) unsigned ints. The joint IDs are stored as 8 bit uints
-    // You would think since there are conveniently 4 joint IDs per vertex, that reading them 
-    // as a single 32 bit uint would work, and yet for some reason it is broken.
-    // that approach is comment out below
+    // in the vertices' space; Model_Load moves the bounds of models with their own transform into world space
+    glm_mat4_identity(mesh_data->model_matrix);
+    Model_QuantizeVertices(vertices, vertex_count, is_bone_animated, mesh_data->vertices, mesh_data->position_offset, mesh_data->position_scale, mesh_data->aabb_min, mesh_data->aabb_max);
+    SDL_memcpy(mesh_data->indices, indices, mesh_data->index_data_size);
 
-    const uint8_t* pos_data_base = cgltf_buffer_view_data(position_accessor->buffer_view);
-    if (pos_data_base == NULL) 
+    for (int i = 0; i < 3; i++)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get position data buffer view.");
+        mesh_data->texture_uris[i] = texture_uris[i] ? SDL_strdup(texture_uris[i]) : NULL;
+    }
+
+    return true;
+}
+
+// Decodes the three textures of a mesh (in parallel); safe to call from any thread
+bool Model_MeshData_LoadTextures(Model_MeshData* mesh_data)
+{
+    const Texture_Usage texture_usages[3] = { TEXTURE_USAGE_ALBEDO, TEXTURE_USAGE_METALLIC_ROUGHNESS, TEXTURE_USAGE_NORMAL };
+    if (!Texture_LoadMultiple((const char**)mesh_data->texture_uris, texture_usages, mesh_data->textures, 3))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load textures: %s, %s, %s", mesh_data->texture_uris[0], mesh_data->texture_uris[1], mesh_data->texture_uris[2]);
+        for (int i = 0; i < 3; i++) Texture_Free(&mesh_data->textures[i]);
         return false;
     }
-    pos_data_base += position_accessor->offset;
+    // only the coarse levels go to the GPU for now; the streamer uploads the rest when they are needed
+    for (int i = 0; i < 3; i++) mesh_data->textures[i].first_level = Streamer_GetInitialLevel(&mesh_data->textures[i]);
+    return true;
+}
 
-    const uint8_t* normal_data_base = cgltf_buffer_view_data(normal_accessor->buffer_view);
-    if (normal_data_base == NULL) 
+void Model_MeshData_Free(Model_MeshData* mesh_data)
+{
+    SDL_free(mesh_data->vertices);
+    SDL_free(mesh_data->indices);
+    for (int i = 0; i < 3; i++)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get normal data buffer view.");
-        return false; 
+        SDL_free(mesh_data->texture_uris[i]);
+        Texture_Free(&mesh_data->textures[i]);
     }
-    normal_data_base += normal_accessor->offset;
+    if (mesh_data->submeshes) Array_Free(mesh_data->submeshes);
+    if (mesh_data->instances) Array_Free(mesh_data->instances);
+    if (mesh_data->is_bone_animated)
+    {
+        SDL_free(mesh_data->animation_rig.joints);
+        for (size_t i = 0; mesh_data->animation_rig.skeletal_animations && i < mesh_data->animation_rig.num_skeletal_animations; ++i)
+        {
+            SDL_free(mesh_data->animation_rig.skeletal_animations[i].key_frame_times);
+            SDL_free(mesh_data->animation_rig.skeletal_animations[i].joint_updates);
+        }
+        SDL_free(mesh_data->animation_rig.skeletal_animations);
+    }
+    SDL_zerop(mesh_data);
+}
 
-    const uint8_t* texcoord_data_base = cgltf_buffer_view_data(texcoord_accessor->buffer_view);
-    if (texcoord_data_base == NULL) 
+// GPU Upload ////////////
+
+// Creates the (empty) vertex and index buffers of a mesh, and the instance buffer of an instanced one; the material is left alone
+bool Model_CreateMeshBuffers(const Model_MeshData* mesh_data, Mesh* mesh)
+{
+    mesh->index_count = mesh_data->index_count;
+    mesh->instance_count = mesh_data->is_instanced ? (Uint32)Array_Len(mesh_data->instances) : 0;
+    mesh->index_element_size = mesh_data->index_element_size;
+    glm_vec4_copy((float*)mesh_data->position_offset, mesh->position_offset);
+    glm_vec4_copy((float*)mesh_data->position_scale, mesh->position_scale);
+
+    mesh->vertex_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_MESH,
+        mesh_data->texture_uris[0],
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_VERTEX,
+            .size = mesh_data->vertex_data_size
+        }
+    );
+    if (mesh->vertex_buffer == NULL)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get texcoord data buffer view.");
-        return false; 
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create vertex buffer: %s", SDL_GetError());
+        return false;
     }
-    texcoord_data_base += texcoord_accessor->offset;
 
-    const uint8_t* tangent_data_base = cgltf_buffer_view_data(tangent_accessor->buffer_view);
-    if (tangent_data_base == NULL) 
+    mesh->index_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_MESH,
+        mesh_data->texture_uris[0],
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_INDEX,
+            .size = mesh_data->index_data_size
+        }
+    );
+    if (mesh->index_buffer == NULL)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get tangent data buffer view.");
-        return false; 
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create index buffer: %s", SDL_GetError());
+        GPUMemory_ReleaseBuffer(mesh->vertex_buffer);
+        mesh->vertex_buffer = NULL;
+        return false;
     }
-    tangent_data_base += tangent_accessor->offset;
 
-    if (model_type == MODEL_TYPE_BONE_ANIMATED_MIXAMO || model_type == MODEL_TYPE_BONE_ANIMATED)
+    if (mesh->instance_count > 0)
     {
-        const uint8_t* joint_ids_data_base= cgltf_buffer_view_data(joint_ids_accessor->buffer_view);
-        if (joint_ids_data_base == NULL) 
+        mesh->instance_buffer = GPUMemory_CreateBuffer
+        (
+            GPUMEMORY_CATEGORY_BUFFER,
+            mesh_data->texture_uris[0],
+            &(SDL_GPUBufferCreateInfo)
+            {
+                .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+                .size = sizeof(Model_Instance) * mesh->instance_count
+            }
+        );
+        if (mesh->instance_buffer == NULL)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get joint IDs data buffer view.");
-            return false; 
+            SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create instance buffer: %s", SDL_GetError());
+            GPUMemory_ReleaseBuffer(mesh->vertex_buffer);
+            GPUMemory_ReleaseBuffer(mesh->index_buffer);
+            mesh->vertex_buffer = NULL;
+            mesh->index_buffer = NULL;
+            return false;
         }
-        joint_ids_data_base += joint_ids_accessor->offset;
+    }
 
-        const uint8_t* joint_weights_data_base = cgltf_buffer_view_data(joint_weights_accessor->buffer_view);
-        if (joint_weights_data_base == NULL) 
+    return true;
+}
+
+static Uint32 Model_GetInstanceDataSize(const Model_MeshData* mesh_data)
+{
+    return mesh_data->is_instanced ? (Uint32)(sizeof(Model_Instance) * Array_Len(mesh_data->instances)) : 0;
+}
+
+Uint32 Model_GetMeshTransferSize(const Model_MeshData* mesh_data)
+{
+    return mesh_data->vertex_data_size + mesh_data->index_data_size + Model_GetInstanceDataSize(mesh_data);
+}
+
+// vertices followed by indices, then instances
+void Model_CopyMeshToTransferBuffer(const Model_MeshData* mesh_data, Uint8* transfer_buffer_mapped)
+{
+    SDL_memcpy(transfer_buffer_mapped, mesh_data->vertices, mesh_data->vertex_data_size);
+    SDL_memcpy(transfer_buffer_mapped + mesh_data->vertex_data_size, mesh_data->indices, mesh_data->index_data_size);
+    if (mesh_data->is_instanced)
+    {
+        SDL_memcpy(transfer_buffer_mapped + mesh_data->vertex_data_size + mesh_data->index_data_size, mesh_data->instances, Model_GetInstanceDataSize(mesh_data));
+    }
+}
+
+void Model_UploadMesh(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Model_MeshData* mesh_data, const Mesh* mesh)
+{
+    SDL_UploadToGPUBuffer
+    (
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation)
+        { 
+            .transfer_buffer = transfer_buffer, 
+            .offset = offset 
+        },
+        &(SDL_GPUBufferRegion)
+        { 
+            .buffer = mesh->vertex_buffer, 
+            .offset = 0, 
+            .size = mesh_data->vertex_data_size 
+        },
+        false
+    );
+
+    SDL_UploadToGPUBuffer
+    (
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get joint weights data buffer view.");
-            return false; 
-        }
-        joint_weights_data_base += joint_weights_accessor->offset;
+            .transfer_buffer = transfer_buffer,
+            .offset = offset + mesh_data->vertex_data_size // Offset after vertex data
+        },
+        &(SDL_GPUBufferRegion)
+        {
+            .buffer = mesh->index_buffer,
+            .offset = 0,
+            .size = mesh_data->index_data_size
+        },
+        false
+    );
 
-        for (size_t i = 0; i < position_accessor->count; i++)
+    if (mesh->instance_buffer == NULL) return;
+
+    SDL_UploadToGPUBuffer
+    (
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation)
+        {
+            .transfer_buffer = transfer_buffer,
+            .offset = offset + mesh_data->vertex_data_size + mesh_data->index_data_size // Offset after index data
+        },
+        &(SDL_GPUBufferRegion)
         {
-            Vertex_BoneAnimated* dest_vertex = &((Vertex_BoneAnimated*)transfer_buffer_mapped)[i];
+            .buffer = mesh->instance_buffer,
+            .offset = 0,
+            .size = Model_GetInstanceDataSize(mesh_data)
+        },
+        false
+    );
+}
 
-            const void* src_pos = pos_data_base + i * position_accessor->stride;
-            memcpy(&dest_vertex->x, src_pos, sizeof(float) * 3);
+// Allocates the (empty) pool layers of a mesh's material; mesh_data->textures must be loaded
+bool Model_CreateMaterial(const Model_MeshData* mesh_data, Material* material)
+{
+    SDL_zerop(material);
 
-            const void* src_normal = normal_data_base + i * normal_accessor->stride;
-            memcpy(&dest_vertex->nx, src_normal, sizeof(float) * 3);
+    material->texture_diffuse = MaterialPool_Allocate(&mesh_data->textures[0]);
+    if (material->texture_diffuse == MATERIALPOOL_TEXTURE_NONE)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to allocate main texture: %s", mesh_data->texture_uris[0] ? mesh_data->texture_uris[0] : "(none)");
+        Model_FreeMaterial(material);
+        return false;
+    }
+    material->texture_metallic_roughness = MaterialPool_Allocate(&mesh_data->textures[1]);
+    if (material->texture_metallic_roughness == MATERIALPOOL_TEXTURE_NONE)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to allocate metallic-roughness texture: %s", mesh_data->texture_uris[1] ? mesh_data->texture_uris[1] : "(none)");
+        Model_FreeMaterial(material);
+        return false;
+    }
+    material->texture_normal = MaterialPool_Allocate(&mesh_data->textures[2]);
+    if (material->texture_normal == MATERIALPOOL_TEXTURE_NONE)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to allocate normal texture: %s", mesh_data->texture_uris[2] ? mesh_data->texture_uris[2] : "(none)");
+        Model_FreeMaterial(material);
+        return false;
+    }
 
-            const void* src_texcoord = texcoord_data_base + i * texcoord_accessor->stride;
-            memcpy(&dest_vertex->u, src_texcoord, sizeof(float) * 2);
+    return true;
+}
 
-            const void* src_tangent = tangent_data_base + i * tangent_accessor->stride;
-            memcpy(&dest_vertex->tx, src_tangent, sizeof(float) * 4);
+Uint32 Model_GetMaterialTransferSize(const Model_MeshData* mesh_data)
+{
+    return Texture_GetTransferSize(&mesh_data->textures[0]) + 
+           Texture_GetTransferSize(&mesh_data->textures[1]) + 
+           Texture_GetTransferSize(&mesh_data->textures[2]);
+}
 
-            const void* src_joint_ids = joint_ids_data_base + i * joint_ids_accessor->stride;
-            memcpy(dest_vertex->joint_ids, src_joint_ids, sizeof(uint8_t) * MAX_JOINTS_PER_VERTEX);
+// diffuse, metallic-roughness and normal, back to back
+void Model_CopyMaterialToTransferBuffer(const Model_MeshData* mesh_data, Uint8* transfer_buffer_mapped)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        Texture_CopyToTransferBuffer(&mesh_data->textures[i], transfer_buffer_mapped);
+        transfer_buffer_mapped += Texture_GetTransferSize(&mesh_data->textures[i]);
+    }
+}
 
-            const void* src_weights = joint_weights_data_base + i * joint_weights_accessor->stride;
-            memcpy(dest_vertex->weights, src_weights, sizeof(float) * MAX_JOINTS_PER_VERTEX);
-        }
+void Model_UploadMaterial(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Model_MeshData* mesh_data, const Material* material)
+{
+    Uint32 texture_diffuse_data_size = Texture_GetTransferSize(&mesh_data->textures[0]);
+    Uint32 texture_metallic_roughness_data_size = Texture_GetTransferSize(&mesh_data->textures[1]);
+
+    MaterialPool_Upload(copy_pass, transfer_buffer, offset, &mesh_data->textures[0], material->texture_diffuse);
+    MaterialPool_Upload(copy_pass, transfer_buffer, offset + texture_diffuse_data_size, &mesh_data->textures[1], material->texture_metallic_roughness);
+    MaterialPool_Upload(copy_pass, transfer_buffer, offset + texture_diffuse_data_size + texture_metallic_roughness_data_size, &mesh_data->textures[2], material->texture_normal);
+}
+
+// the shared loading material (see loader.c) is never released here
+void Model_FreeMaterial(Material* material)
+{
+    HotReload_ForgetTexture(material->texture_diffuse);
+    HotReload_ForgetTexture(material->texture_metallic_roughness);
+    HotReload_ForgetTexture(material->texture_normal);
+    Streamer_ForgetTexture(material->texture_diffuse);
+    Streamer_ForgetTexture(material->texture_metallic_roughness);
+    Streamer_ForgetTexture(material->texture_normal);
+
+    if (material->texture_diffuse != material_loading.texture_diffuse) 
+        MaterialPool_Release(material->texture_diffuse);
+    if (material->texture_metallic_roughness != material_loading.texture_metallic_roughness) 
+        MaterialPool_Release(material->texture_metallic_roughness);
+    if (material->texture_normal != material_loading.texture_normal) 
+        MaterialPool_Release(material->texture_normal);
+    SDL_zerop(material);
+}
+
+// Points every material that samples old_texture at new_texture; the caller releases old_texture
+void Model_ReplaceTexture(MaterialPool_Texture old_texture, MaterialPool_Texture new_texture)
+{
+    size_t unanimated_count = Array_Len(models_unanimated);
+    size_t instanced_count = Array_Len(models_instanced);
+    for (size_t i = 0; i < unanimated_count + instanced_count + Array_Len(models_bone_animated); i++)
+    {
+        Material* material = 
+            i < unanimated_count ? &models_unanimated[i].mesh.material : 
+            i < unanimated_count + instanced_count ? &models_instanced[i - unanimated_count].mesh.material : 
+            &models_bone_animated[i - unanimated_count - instanced_count].model.mesh.material;
+        if (material->texture_diffuse == old_texture) material->texture_diffuse = new_texture;
+        if (material->texture_metallic_roughness == old_texture) material->texture_metallic_roughness = new_texture;
+        if (material->texture_normal == old_texture) material->texture_normal = new_texture;
+    }
+    HotReload_ReplaceTexture(old_texture, new_texture);
+}
+
+// Static Batching ////////////
+
+/*
+    Unanimated geometry never moves, so every primitive that shares a material is
+    pre-transformed into world space and appended to one vertex/index buffer pair.
+    Each source primitive keeps its index range and world space bounds (Submesh) so it can still be culled.
+    A batch spans at most VERTEX_POSITION_MAX_EXTENT on each axis, so its positions quantize to VERTEX_POSITION_STEP;
+    a primitive that would make it larger starts another batch of the same material
+    Batches are collected per scene and turned into Model_MeshData by Model_BuildStaticBatches
+*/
+
+static bool Model_TextureURIsMatch(const char* a, const char* b)
+{
+    if (a == NULL || b == NULL) return a == b;
+    return SDL_strcmp(a, b) == 0;
+}
+
+static bool Model_StaticBatch_Fits(const Static_Batch* batch, const vec3 aabb_min, const vec3 aabb_max)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (SDL_max(batch->aabb_max[axis], aabb_max[axis]) - SDL_min(batch->aabb_min[axis], aabb_min[axis]) > VERTEX_POSITION_MAX_EXTENT) return false;
     }
-    else
+    return true;
+}
+
+// The batch of the material with room for the (world space) bounds, or a new one
+static Static_Batch* Model_StaticBatch_Get(Model_SceneData* scene, const char* texture_uris[3], const vec3 aabb_min, const vec3 aabb_max)
+{
+    for (size_t i = 0; i < Array_Len(scene->static_batches); i++)
     {
-        for (size_t i = 0; i < position_accessor->count; i++)
+        Static_Batch* batch = &scene->static_batches[i];
+        if (Model_TextureURIsMatch(batch->texture_uris[0], texture_uris[0]) &&
+            Model_TextureURIsMatch(batch->texture_uris[1], texture_uris[1]) &&
+            Model_TextureURIsMatch(batch->texture_uris[2], texture_uris[2]) &&
+            Model_StaticBatch_Fits(batch, aabb_min, aabb_max))
         {
-            Vertex_PBR* dest_vertex = &((Vertex_PBR*)transfer_buffer_mapped)[i];
-
-            const void* src_pos = pos_data_base + i * position_accessor->stride;
-            memcpy(&dest_vertex->x, src_pos, sizeof(float) * 3);
+            return batch;
+        }
+    }
 
-            const void* src_normal = normal_data_base + i * normal_accessor->stride;
-            memcpy(&dest_vertex->nx, src_normal, sizeof(float) * 3);
+    Static_Batch new_batch = 
+    {
+        .aabb_min = {FLT_MAX, FLT_MAX, FLT_MAX},
+        .aabb_max = {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+    };
+    for (int i = 0; i < 3; i++)
+    {
+        new_batch.texture_uris[i] = texture_uris[i] ? SDL_strdup(texture_uris[i]) : NULL;
+    }
+    Array_Init(new_batch.vertices, 1024);
+    Array_Init(new_batch.indices, 1024);
+    Array_Init(new_batch.submeshes, 16);
+    bool lod_indices_allocated = true;
+    for (int i = 0; i < MODEL_LOD_COUNT - 1; i++)
+    {
+        Array_Init(new_batch.lod_indices[i], 512);
+        lod_indices_allocated = lod_indices_allocated && new_batch.lod_indices[i];
+    }
+    if (!new_batch.vertices || !new_batch.indices || !new_batch.submeshes || !lod_indices_allocated || !Array_Append(scene->static_batches, new_batch))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate static batch");
+        for (int i = 0; i < 3; i++) SDL_free(new_batch.texture_uris[i]);
+        Array_Free(new_batch.vertices);
+        Array_Free(new_batch.indices);
+        for (int i = 0; i < MODEL_LOD_COUNT - 1; i++) Array_Free(new_batch.lod_indices[i]);
+        Array_Free(new_batch.submeshes);
+        return NULL;
+    }
 
-            const void* src_texcoord = texcoord_data_base + i * texcoord_accessor->stride;
-            memcpy(&dest_vertex->u, src_texcoord, sizeof(float) * 2);
+    return &scene->static_batches[Array_Len(scene->static_batches) - 1];
+}
 
-            const void* src_tangent = tangent_data_base + i * tangent_accessor->stride;
-            memcpy(&dest_vertex->tx, src_tangent, sizeof(float) * 4);
+static bool Model_StaticBatch_AppendIndices(Uint32 Array* batch_indices, const Uint32* indices, Uint32 index_count, Uint32 base_vertex)
+{
+    for (Uint32 i = 0; i < index_count; i++)
+    {
+        Uint32 index = base_vertex + indices[i];
+        if (!Array_Append(*batch_indices, index))
+        {
+            return false;
         }
     }
-    // for (size_t i = 0; i < position_accessor->count; ++i)
-    // {
-    //     if (!cgltf_accessor_read_float(position_accessor, i, &transfer_buffer_mapped[i].x, 3))
-    //     {
-    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read position for vertex %zu", i);
-    //         return false;
-    //     }
-    //     if (!cgltf_accessor_read_float(normal_accessor, i, &transfer_buffer_mapped[i].nx, 3))
-    //     {
-    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read normal for vertex %zu", i);
-    //         return false;
-    //     }
-    //     if (!cgltf_accessor_read_float(texcoord_accessor, i, &transfer_buffer_mapped[i].u, 2))
-    //     {
-    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read texcoord for vertex %zu", i);
-    //         return false;
-    //     }
-    //     if (!cgltf_accessor_read_uint(joint_ids_accessor, i, (cgltf_uint*)&transfer_buffer_mapped[i].joint_ids, 4))
-    //     {
-    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read joint IDs for vertex %zu", i);
-    //         return false;
-    //     }
-    //     if (!cgltf_accessor_read_float(joint_weights_accessor, i, &transfer_buffer_mapped[i].weights, 4))
-    //     {
-    //         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read joint weights for vertex %zu", i);
-    //         return false;
-    //     }
-    // }
+    return true;
+}
+
+// Simplifies one primitive level by level, each from the previous one, until MODEL_LOD_COUNT levels
+// exist or simplification stops paying off; errors add up, so a level's error bounds its distance from LOD 0
+// level L goes to the end of lod_indices[L - 1] (offset by base_vertex), and lods[L].first_index is relative to that list
+// radius is of the primitive's bounding sphere, in the space of its vertices
+static bool Model_GenerateLODs(Uint32 Array lod_indices_by_level[MODEL_LOD_COUNT - 1], Submesh* submesh, const Vertex_PBR* vertices, Uint32 vertex_count, const Uint32* indices, Uint32 index_count, Uint32 base_vertex, float radius)
+{
+    Uint32* buffers[2] = { SDL_malloc(sizeof(Uint32) * index_count), SDL_malloc(sizeof(Uint32) * index_count) };
+    if (buffers[0] == NULL || buffers[1] == NULL)
+    {
+        SDL_free(buffers[0]);
+        SDL_free(buffers[1]);
+        return false;
+    }
+
+    bool success = true;
+    const Uint32* source = indices;
+    Uint32 source_count = index_count;
+    float error = 0.0f;
+
+    for (int level = 1; level < MODEL_LOD_COUNT; level++)
+    {
+        Uint32* lod_indices = buffers[level & 1];
+        Uint32 target_count = (Uint32)((float)source_count * MODEL_LOD_REDUCTION) / 3 * 3;
+        float level_error = 0.0f;
+        Uint32 lod_index_count = Mesh_Simplify(lod_indices, source, source_count, vertices, vertex_count, sizeof(Vertex_PBR), target_count, radius * MODEL_LOD_MAX_ERROR, &level_error);
+        if (lod_index_count == 0 || (float)lod_index_count > (float)source_count * MODEL_LOD_MIN_REDUCTION)
+        {
+            break;
+        }
+        Mesh_OptimizeVertexCache(lod_indices, lod_index_count, vertex_count);
+
+        error += level_error;
+        submesh->lods[level] = (Submesh_LOD)
+        {
+            .first_index = (Uint32)Array_Len(lod_indices_by_level[level - 1]), // relative to its level until the mesh is built
+            .index_count = lod_index_count,
+            .error = error,
+        };
+        if (!Model_StaticBatch_AppendIndices(&lod_indices_by_level[level - 1], lod_indices, lod_index_count, base_vertex))
+        {
+            success = false;
+            break;
+        }
+        submesh->lod_count++;
 
-    size_t unpacked_indices_count = cgltf_accessor_unpack_indices(index_accessor, transfer_buffer_mapped + vertex_data_size, sizeof(Uint16), mesh.index_count);
-    if (unpacked_indices_count != mesh.index_count)
+        source = lod_indices;
+        source_count = lod_index_count;
+    }
+
+    SDL_free(buffers[0]);
+    SDL_free(buffers[1]);
+    return success;
+}
+
+// Pre-transforms one primitive of node into world space and appends it to the batch for its material
+static bool Model_StaticBatch_AddPrimitive(Model_SceneData* scene, cgltf_node* node, cgltf_primitive* primitive)
+{
+    const char* name = node->name ? node->name : "(unnamed)";
+
+    Uint8* vertices = NULL;
+    Uint32* indices = NULL;
+    Uint32 vertex_count = 0;
+    Uint32 index_count = 0;
+    if (!Model_ReadPrimitive(primitive, false, name, &vertices, &vertex_count, &indices, &index_count))
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error unpacking gltf primitive indices: unexpected index_count (unpacked %zu, expected %u).", unpacked_indices_count, mesh.index_count);
         return false;
     }
 
-    SDL_UnmapGPUTransferBuffer(gpu_device, transfer_buffer);
+    // glTF and cglm matrices are both column major
+    mat4 world_matrix;
+    cgltf_node_transform_world(node, (float*)world_matrix);
+    
+    mat3 linear_matrix, normal_matrix;
+    glm_mat4_pick3(world_matrix, linear_matrix);
+    glm_mat3_inv(linear_matrix, normal_matrix);
+    glm_mat3_transpose(normal_matrix);
+
+    // a mirroring transform flips both the triangle winding and the bitangent
+    bool is_mirrored = glm_mat3_det(linear_matrix) < 0.0f;
+
+    Submesh submesh = 
+    {
+        .aabb_min = {FLT_MAX, FLT_MAX, FLT_MAX},
+        .aabb_max = {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+        .lod_count = 1,
+    };
+
+    // transformed in place first, since the bounds pick the batch
+    for (Uint32 i = 0; i < vertex_count; i++)
+    {
+        Vertex_PBR* vertex = &((Vertex_PBR*)vertices)[i];
+
+        vec3 position = {vertex->x, vertex->y, vertex->z};
+        vec3 normal = {vertex->nx, vertex->ny, vertex->nz};
+        vec3 tangent = {vertex->tx, vertex->ty, vertex->tz};
+
+        glm_mat4_mulv3(world_matrix, position, 1.0f, position);
+        glm_mat3_mulv(normal_matrix, normal, normal);
+        glm_vec3_normalize(normal);
+        glm_mat3_mulv(linear_matrix, tangent, tangent);
+        glm_vec3_normalize(tangent);
+
+        vertex->x = position[0]; vertex->y = position[1]; vertex->z = position[2];
+        vertex->nx = normal[0]; vertex->ny = normal[1]; vertex->nz = normal[2];
+        vertex->tx = tangent[0]; vertex->ty = tangent[1]; vertex->tz = tangent[2];
+        if (is_mirrored) vertex->tw = -vertex->tw;
+
+        glm_vec3_minv(submesh.aabb_min, position, submesh.aabb_min);
+        glm_vec3_maxv(submesh.aabb_max, position, submesh.aabb_max);
+    }
+
+    const char* texture_uris[3];
+    Model_GetTextureURIs(primitive, texture_uris);
+    Static_Batch* batch = Model_StaticBatch_Get(scene, texture_uris, submesh.aabb_min, submesh.aabb_max);
+    if (batch == NULL)
+    {
+        SDL_free(vertices);
+        SDL_free(indices);
+        return false;
+    }
+
+    Uint32 base_vertex = (Uint32)Array_Len(batch->vertices);
+    submesh.lods[0] = (Submesh_LOD){ .first_index = (Uint32)Array_Len(batch->indices), .index_count = index_count };
+    for (Uint32 i = 0; i < vertex_count; i++)
+    {
+        if (!Array_Append(batch->vertices, ((Vertex_PBR*)vertices)[i]))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow static batch vertices: %s", name);
+            SDL_free(vertices);
+            SDL_free(indices);
+            return false;
+        }
+    }
+    glm_vec3_minv(batch->aabb_min, submesh.aabb_min, batch->aabb_min);
+    glm_vec3_maxv(batch->aabb_max, submesh.aabb_max, batch->aabb_max);
+
+    if (is_mirrored)
+    {
+        for (Uint32 i = 0; i + 2 < index_count; i += 3)
+        {
+            Uint32 swap = indices[i + 1];
+            indices[i + 1] = indices[i + 2];
+            indices[i + 2] = swap;
+        }
+    }
+
+    if (!Model_StaticBatch_AppendIndices(&batch->indices, indices, index_count, base_vertex))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow static batch indices: %s", name);
+        SDL_free(vertices);
+        SDL_free(indices);
+        return false;
+    }
+
+    float radius = 0.5f * glm_vec3_distance(submesh.aabb_min, submesh.aabb_max);
+    if (!Model_GenerateLODs(batch->lod_indices, &submesh, &batch->vertices[base_vertex], vertex_count, indices, index_count, base_vertex, radius))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to generate LODs: %s", name);
+        SDL_free(vertices);
+        SDL_free(indices);
+        return false;
+    }
+
+    SDL_free(vertices);
+    SDL_free(indices);
+
+    if (!Array_Append(batch->submeshes, submesh))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow static batch submeshes: %s", name);
+        return false;
+    }
+
+    return true;
+}
+
+// Adds every primitive of node and its descendants
+static bool Model_StaticBatch_AddNode(Model_SceneData* scene, cgltf_node* node)
+{
+    if (node->mesh)
+    {
+        for (size_t i = 0; i < node->mesh->primitives_count; i++)
+        {
+            if (!Model_StaticBatch_AddPrimitive(scene, node, &node->mesh->primitives[i]))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to batch primitive %zu of node: %s", i, node->name);
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < node->children_count; i++)
+    {
+        if (!Model_StaticBatch_AddNode(scene, node->children[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Turns every batch of the scene into one mesh (one draw per pass) with 32 bit indices
+bool Model_BuildStaticBatches(Model_SceneData* scene)
+{
+    bool success = true;
+
+    for (size_t i = 0; i < Array_Len(scene->static_batches); i++)
+    {
+        Static_Batch* batch = &scene->static_batches[i];
+        Uint32 lod0_index_count = (Uint32)Array_Len(batch->indices);
+
+        if (success)
+        {
+            // LOD 1 and up go after LOD 0, one level after the other
+            for (int level = 1; level < MODEL_LOD_COUNT && success; level++)
+            {
+                Uint32 level_first_index = (Uint32)Array_Len(batch->indices);
+                if (!Model_StaticBatch_AppendIndices(&batch->indices, batch->lod_indices[level - 1], (Uint32)Array_Len(batch->lod_indices[level - 1]), 0))
+                {
+                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow static batch indices: %s", batch->texture_uris[0]);
+                    success = false;
+                }
+                for (size_t ii = 0; ii < Array_Len(batch->submeshes); ii++)
+                {
+                    if (batch->submeshes[ii].lod_count > level) batch->submeshes[ii].lods[level].first_index += level_first_index;
+                }
+            }
+        }
+
+        if (success)
+        {
+            Uint32 vertex_count = (Uint32)Array_Len(batch->vertices);
+            Uint32 index_count = (Uint32)Array_Len(batch->indices);
+
+            Model_MeshData mesh_data;
+            if (!Model_MeshData_Init(&mesh_data, batch->vertices, vertex_count, false, batch->indices, index_count, SDL_GPU_INDEXELEMENTSIZE_32BIT, (const char* const*)batch->texture_uris))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create static batch for material: %s", batch->texture_uris[0]);
+                success = false;
+            }
+            else
+            {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Static batch %s: %zu submeshes, %u vertices, %u indices (%u in LOD 0)", 
+                    batch->texture_uris[0], Array_Len(batch->submeshes), vertex_count, index_count, lod0_index_count);
+                mesh_data.submeshes = batch->submeshes; // ownership moves to the mesh
+                batch->submeshes = NULL;
+                if (!Array_Append(scene->meshes, mesh_data))
+                {
+                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow scene meshes");
+                    Model_MeshData_Free(&mesh_data);
+                    success = false;
+                }
+            }
+        }
+
+        for (int ii = 0; ii < 3; ii++) SDL_free(batch->texture_uris[ii]);
+        Array_Free(batch->vertices);
+        Array_Free(batch->indices);
+        for (int ii = 0; ii < MODEL_LOD_COUNT - 1; ii++) Array_Free(batch->lod_indices[ii]);
+        if (batch->submeshes) Array_Free(batch->submeshes);
+    }
+
+    Array_Free(scene->static_batches);
+
+    return success;
+}
+
+// Instancing ////////////
+
+static Instanced_Batch* Model_InstancedBatch_Get(Model_SceneData* scene, cgltf_primitive* primitive, bool is_mirrored, const char* name)
+{
+    for (size_t i = 0; i < Array_Len(scene->instanced_batches); i++)
+    {
+        Instanced_Batch* batch = &scene->instanced_batches[i];
+        if (batch->primitive == primitive && batch->is_mirrored == is_mirrored)
+        {
+            return batch;
+        }
+    }
+
+    // first placement: the primitive is read once, in its own space
+    Uint8* vertices = NULL;
+    Uint32* indices = NULL;
+    Uint32 vertex_count = 0;
+    Uint32 index_count = 0;
+    if (!Model_ReadPrimitive(primitive, false, name, &vertices, &vertex_count, &indices, &index_count))
+    {
+        return NULL;
+    }
+
+    if (is_mirrored)
+    {
+        for (Uint32 i = 0; i < vertex_count; i++) ((Vertex_PBR*)vertices)[i].tw *= -1.0f;
+        for (Uint32 i = 0; i + 2 < index_count; i += 3)
+        {
+            Uint32 swap = indices[i + 1];
+            indices[i + 1] = indices[i + 2];
+            indices[i + 2] = swap;
+        }
+    }
+
+    // levels of detail go after LOD 0 in the same index buffer; one submesh covers the mesh, so every instance
+    // draws the level picked for the model (see Model_SelectLODs)
+    Submesh submesh = { .lods[0] = { .first_index = 0, .index_count = index_count }, .lod_count = 1 };
+    vec3 local_min = {FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3 local_max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (Uint32 i = 0; i < vertex_count; i++)
+    {
+        glm_vec3_minv(local_min, &((Vertex_PBR*)vertices)[i].x, local_min);
+        glm_vec3_maxv(local_max, &((Vertex_PBR*)vertices)[i].x, local_max);
+    }
+    Uint32 Array lod_indices[MODEL_LOD_COUNT - 1] = {0};
+    bool lods_generated = true;
+    for (int level = 1; level < MODEL_LOD_COUNT; level++)
+    {
+        Array_Init(lod_indices[level - 1], 256);
+        lods_generated = lods_generated && lod_indices[level - 1];
+    }
+    lods_generated = lods_generated && (vertex_count == 0 || Model_GenerateLODs(lod_indices, &submesh, (const Vertex_PBR*)vertices, vertex_count, indices, index_count, 0, 0.5f * glm_vec3_distance(local_min, local_max)));
+    Uint32 lod_index_count = 0;
+    for (int level = 1; lods_generated && level < submesh.lod_count; level++)
+    {
+        lod_index_count += (Uint32)Array_Len(lod_indices[level - 1]);
+    }
+    Uint32* all_indices = lod_index_count > 0 ? SDL_realloc(indices, sizeof(Uint32) * (index_count + lod_index_count)) : NULL;
+    if (all_indices)
+    {
+        indices = all_indices;
+        for (int level = 1; level < submesh.lod_count; level++)
+        {
+            Uint32 level_index_count = (Uint32)Array_Len(lod_indices[level - 1]);
+            SDL_memcpy(&indices[index_count], lod_indices[level - 1], sizeof(Uint32) * level_index_count);
+            submesh.lods[level].first_index = index_count;
+            index_count += level_index_count;
+        }
+    }
+    else
+    {
+        if (lod_index_count > 0 || !lods_generated) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to generate LODs; drawn in full: %s", name);
+        submesh.lod_count = 1;
+    }
+    for (int level = 1; level < MODEL_LOD_COUNT; level++)
+    {
+        if (lod_indices[level - 1]) Array_Free(lod_indices[level - 1]);
+    }
+
+    SDL_GPUIndexElementSize index_element_size = SDL_GPU_INDEXELEMENTSIZE_32BIT;
+    if (vertex_count <= 0xFFFF)
+    {
+        // narrowed in place; the 16 bit values fit in the first half of the allocation
+        Uint16* indices_16 = (Uint16*)indices;
+        for (Uint32 i = 0; i < index_count; i++)
+            indices_16[i] = (Uint16)indices[i];
+        index_element_size = SDL_GPU_INDEXELEMENTSIZE_16BIT;
+    }
+
+    const char* texture_uris[3];
+    Model_GetTextureURIs(primitive, texture_uris);
+
+    Instanced_Batch new_batch = { .primitive = primitive, .is_mirrored = is_mirrored };
+    bool created = Model_MeshData_Init(&new_batch.mesh_data, vertices, vertex_count, false, indices, index_count, index_element_size, texture_uris);
+    SDL_free(vertices);
+    SDL_free(indices);
+    if (!created)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create instanced mesh: %s", name);
+        return NULL;
+    }
+    new_batch.mesh_data.is_instanced = true;
+    Array_Init(new_batch.mesh_data.instances, 16);
+    bool submesh_added = true;
+    if (submesh.lod_count > 1)
+    {
+        Array_Init(new_batch.mesh_data.submeshes, 1);
+        submesh_added = new_batch.mesh_data.submeshes && Array_Append(new_batch.mesh_data.submeshes, submesh);
+    }
+    if (!new_batch.mesh_data.instances || !submesh_added || !Array_Append(scene->instanced_batches, new_batch))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate instanced batch: %s", name);
+        Model_MeshData_Free(&new_batch.mesh_data);
+        return NULL;
+    }
+
+    return &scene->instanced_batches[Array_Len(scene->instanced_batches) - 1];
+}
+
+// Adds one instance, at node's world transform, of every primitive of node and its descendants
+static bool Model_Instanced_AddNode(Model_SceneData* scene, cgltf_node* node)
+{
+    if (node->mesh)
+    {
+        const char* name = node->name ? node->name : "(unnamed)";
+
+        Model_Instance instance;
+        cgltf_node_transform_world(node, (float*)instance.model_matrix);
+
+        mat3 linear_matrix;
+        glm_mat4_pick3(instance.model_matrix, linear_matrix);
+        bool is_mirrored = glm_mat3_det(linear_matrix) < 0.0f;
+
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+        mat3 normal_matrix;
+        glm_mat3_inv(linear_matrix, normal_matrix);
+        glm_mat3_transpose(normal_matrix);
+        glm_mat4_identity(instance.normal_matrix);
+        glm_mat4_ins3(normal_matrix, instance.normal_matrix);
+#endif
+
+        for (size_t i = 0; i < node->mesh->primitives_count; i++)
+        {
+            Instanced_Batch* batch = Model_InstancedBatch_Get(scene, &node->mesh->primitives[i], is_mirrored, name);
+            if (batch == NULL || !Array_Append(batch->mesh_data.instances, instance))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to instance primitive %zu of node: %s", i, name);
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < node->children_count; i++)
+    {
+        if (!Model_Instanced_AddNode(scene, node->children[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Moves every instanced batch into the scene's meshes, bounded by the union of its instances
+bool Model_BuildInstancedBatches(Model_SceneData* scene)
+{
+    bool success = true;
+
+    for (size_t i = 0; i < Array_Len(scene->instanced_batches); i++)
+    {
+        Model_MeshData* mesh_data = &scene->instanced_batches[i].mesh_data;
+        if (!success)
+        {
+            Model_MeshData_Free(mesh_data);
+            continue;
+        }
+
+        vec3 local_min, local_max;
+        glm_vec3_copy(mesh_data->aabb_min, local_min);
+        glm_vec3_copy(mesh_data->aabb_max, local_max);
+        glm_vec3_fill(mesh_data->aabb_min, FLT_MAX);
+        glm_vec3_fill(mesh_data->aabb_max, -FLT_MAX);
+        float max_scale = 0.0f;
+        for (size_t ii = 0; ii < Array_Len(mesh_data->instances); ii++)
+        {
+            vec3 instance_min, instance_max;
+            Frustum_TransformAABB(mesh_data->instances[ii].model_matrix, local_min, local_max, instance_min, instance_max);
+            glm_vec3_minv(mesh_data->aabb_min, instance_min, mesh_data->aabb_min);
+            glm_vec3_maxv(mesh_data->aabb_max, instance_max, mesh_data->aabb_max);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                max_scale = SDL_max(max_scale, glm_vec3_norm(mesh_data->instances[ii].model_matrix[axis]));
+            }
+        }
+
+        // the level picked for the model holds for every instance: bounded by all of them, with the largest one's error
+        if (mesh_data->submeshes)
+        {
+            Submesh* submesh = &mesh_data->submeshes[0];
+            glm_vec3_copy(mesh_data->aabb_min, submesh->aabb_min);
+            glm_vec3_copy(mesh_data->aabb_max, submesh->aabb_max);
+            for (int level = 1; level < submesh->lod_count; level++) submesh->lods[level].error *= max_scale;
+        }
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Instanced mesh %s: %zu instances, %u indices", 
+            mesh_data->texture_uris[0], Array_Len(mesh_data->instances), mesh_data->index_count);
+        if (!Array_Append(scene->meshes, *mesh_data))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow scene meshes");
+            Model_MeshData_Free(mesh_data);
+            success = false;
+        }
+    }
+
+    Array_Free(scene->instanced_batches); // ownership of the mesh data moved to scene->meshes
+
+    return success;
+}
+
+bool Model_Load(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene)
+{
+    Model_Type model_type = (Model_Type)SDL_atoi(node->name);
+
+    switch (model_type)
+    {
+        case MODEL_TYPE_INVALID:
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Node %s has unknown model type", node->name);
+            return false;
+        case MODEL_TYPE_DO_NOT_IMPORT:
+            return true;
+        case MODEL_TYPE_COLLIDER:
+            if (!Model_Load_Collider(gltf_data, node, scene))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load collider model from node: %s", node->name);
+                return false;
+            }
+            else return true;
+        case MODEL_TYPE_TRIGGER:
+            if (!Model_Load_Trigger(gltf_data, node, scene))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load trigger model from node: %s", node->name);
+                return false;
+            }
+            else return true;
+            break;
+        case MODEL_TYPE_OCCLUDER:
+            if (!Model_Load_Occluder(gltf_data, node, scene))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load occluder model from node: %s", node->name);
+                return false;
+            }
+            else return true;
+        default: break;
+    }
+
+    /**************** Transform ****************/
+
+    // a mixamo armature's own transform reaches the vertices through the joints (armature_correction_matrix),
+    // so only its parents' transforms make up the model matrix
+    mat4 model_matrix = GLM_MAT4_IDENTITY_INIT;
+    if (model_type != MODEL_TYPE_BONE_ANIMATED_MIXAMO)
+    {
+        cgltf_node_transform_world(node, (float*)model_matrix);
+    }
+    else if (node->parent)
+    {
+        cgltf_node_transform_world(node->parent, (float*)model_matrix);
+    }
+
+    /**************** Animation / Rigging ****************/
+
+    Animation_Rig animation_rig = {0};
+    glm_mat4_identity(animation_rig.armature_correction_matrix);
+    if (model_type == MODEL_TYPE_BONE_ANIMATED_MIXAMO)
+    {
+        /*
+            If this is a mixamo model...
+
+            This armature node should have two children:
+            * A node with the skin and mesh
+            * The hip joint node (which is the root of the skeleton)
+            
+            This node will have its own rotation (up-direction fix) and scale.
+            This corrective matrix is applied at the start of the joint matrix calculations
+        */
+
+        mat4 t_matrix, r_matrix, s_matrix;
+        
+        if (node->has_translation)
+        {
+            glm_translate_make(t_matrix, node->translation);
+        }
+        else
+        {
+            glm_mat4_identity(t_matrix);
+        }
+        if (node->has_rotation)
+        {
+            glm_quat_mat4(node->rotation, r_matrix);
+        }
+        else
+        {
+            glm_mat4_identity(r_matrix);
+        }
+        if (node->has_scale)
+        {
+            glm_scale_make(s_matrix, node->scale);
+        }
+        else
+        {
+            glm_mat4_identity(s_matrix);
+        }
+        
+        glm_mat4_mul(t_matrix, r_matrix, animation_rig.armature_correction_matrix);
+        glm_mat4_mul(animation_rig.armature_correction_matrix, s_matrix, animation_rig.armature_correction_matrix);
+
+        cgltf_skin* skin = node->skin;
+        
+        if (skin)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Unexpected skin in armature root node: %s\nskin was expected to be in a child of this node", node->name);
+            return false;
+        }
+        
+        // we don't assume the order of the children,
+        // we just know one of them should have the skin
+        for (size_t i = 0; i < node->children_count; ++i)
+        {
+            skin = node->children[i]->skin;
+            
+            if (skin)
+            {
+                node = node->children[i];
+                break;
+            }
+        }
+
+        if (!skin)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Failed to load skin; node: %s", node->name);
+            return false;
+        }
+
+        animation_rig.num_joints = (Uint8)node->skin->joints_count;
+        animation_rig.joints = (Joint*)SDL_malloc(sizeof(Joint) * animation_rig.num_joints);
+        if (animation_rig.joints == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for joints for skin: %s", node->name);
+            return false;
+        }
+
+        /*
+            I want to reference joints by their index in the joint matrix array, but...
+            - gltf refers to them by their index in the gltf node array
+            - cgltf references them via `cgltf_node*`, not an index
+
+            Hence the conversion via `cgltf_node_index` and then my own `gltf_index_to_joint_mat_index`
+
+            This is a constant time lookup, and if the bone animated model is the only thing in the gltf file, 
+            the number of joints ~= the total number of nodes in the gltf file (it's ~ a perfect hash table)
+        */
+        Uint8 gltf_index_to_joint_mat_index[gltf_data->nodes_count];
+
+        #define gltf_joint_node skin->joints[i]
+
+        for (size_t i = 0; i < animation_rig.num_joints; i++)
+        {
+            gltf_index_to_joint_mat_index[(Uint8)cgltf_node_index(gltf_data, gltf_joint_node)] = i;
+        }
+
+        for (size_t i = 0; i < animation_rig.num_joints; i++)
+        {
+            animation_rig.joints[i].num_children = gltf_joint_node->children_count;
+
+            for (size_t ii = 0; ii < gltf_joint_node->children_count && ii < MAX_CHILDREN_PER_JOINT; ii++)
+            {
+                animation_rig.joints[i].children[ii] = gltf_index_to_joint_mat_index[(Uint8)cgltf_node_index(gltf_data, gltf_joint_node->children[ii])];
+            }
+
+            // these vectors should put the skeleton in the default A/T Pose
+            
+            if (gltf_joint_node->has_translation)
+            {
+                glm_vec3_copy(gltf_joint_node->translation, animation_rig.joints[i].translation);
+            }
+            else
+            {
+                glm_vec3_zero(animation_rig.joints[i].translation);
+            }
+            if (gltf_joint_node->has_rotation)
+            {
+                glm_quat_copy(gltf_joint_node->rotation, animation_rig.joints[i].rotation);
+            }
+            else
+            {
+                glm_quat_identity(animation_rig.joints[i].rotation);
+            }
+            if (gltf_joint_node->has_scale)
+            {
+                glm_vec3_copy(gltf_joint_node->scale, animation_rig.joints[i].scale);
+            }
+            else
+            {
+                glm_vec3_one(animation_rig.joints[i].scale);
+            }
+        }
+
+        #undef gltf_joint_node
+
+        mat4 inverse_bind_matrices[animation_rig.num_joints];
+
+        cgltf_accessor_unpack_floats(skin->inverse_bind_matrices, (float*)inverse_bind_matrices, 16 * animation_rig.num_joints); 
+        
+        // populate the joints with inverse bind matrices
+        for (size_t i = 0; i < animation_rig.num_joints; ++i)
+        {
+            SDL_memcpy(animation_rig.joints[i].inverse_bind_matrix, inverse_bind_matrices[i], sizeof(mat4));        
+        }
+
+        // load animations
+
+        animation_rig.num_skeletal_animations = (Uint8)gltf_data->animations_count;
+        animation_rig.skeletal_animations = (Animation_Skeletal*)SDL_malloc(sizeof(Animation_Skeletal) * animation_rig.num_skeletal_animations);
+        if (animation_rig.skeletal_animations == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for skeletal animations for skin: %s", node->name);
+            return false;
+        }
+
+        for (size_t i = 0; i < animation_rig.num_skeletal_animations; ++i)
+        {
+            animation_rig.skeletal_animations[i].animation_id = (Animation_Skeletal_ID)SDL_atoi(gltf_data->animations[i].name);
+            animation_rig.skeletal_animations[i].num_key_frames = (Uint16)gltf_data->animations[i].samplers[0].input->count;
+            animation_rig.skeletal_animations[i].num_joint_updates_per_frame = (Uint16)gltf_data->animations[i].channels_count;
+            animation_rig.skeletal_animations[i].key_frame_times = (float*)SDL_malloc(sizeof(float) * animation_rig.skeletal_animations[i].num_key_frames);
+            animation_rig.skeletal_animations[i].joint_updates = (Joint_Update*)SDL_malloc(sizeof(Joint_Update) * animation_rig.skeletal_animations[i].num_joint_updates_per_frame * animation_rig.skeletal_animations[i].num_key_frames);
+            if (animation_rig.skeletal_animations[i].key_frame_times == NULL || animation_rig.skeletal_animations[i].joint_updates == NULL)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for key frame times or joint updates for skeletal animation %zu in skin: %s", i, node->name);
+                SDL_free(animation_rig.skeletal_animations[i].key_frame_times);
+                SDL_free(animation_rig.skeletal_animations[i].joint_updates);
+                return false;
+            }
+            cgltf_animation* animation = &gltf_data->animations[i];
+
+            // Copy key frame times
+            // we assume each channel uses the same input accessor for the key frame times
+            cgltf_accessor* input_accessor = animation->samplers[0].input;
+            cgltf_accessor_unpack_floats(input_accessor, animation_rig.skeletal_animations[i].key_frame_times, animation_rig.skeletal_animations[i].num_key_frames);
+
+            // Copy joint updates
+            // gltf is structured such that each channel tracks how a single joint is updated over time
+            // I want to invert this so that each key frame has all joint updates for that frame adjacent in memory
+            for (size_t j = 0; j < animation_rig.skeletal_animations[i].num_key_frames; ++j)
+            {
+                for (size_t k = 0; k < animation_rig.skeletal_animations[i].num_joint_updates_per_frame; ++k)
+                {
+                    Joint_Update* joint_update = &animation_rig.skeletal_animations[i].joint_updates[j * animation_rig.skeletal_animations[i].num_joint_updates_per_frame + k];
+                    cgltf_animation_channel* channel = &animation->channels[k];
+                    cgltf_accessor* output_accessor = channel->sampler->output;
+                    joint_update->joint_index = gltf_index_to_joint_mat_index[(Uint8)cgltf_node_index(gltf_data, channel->target_node)];
+            
+                    // Read joint update data
+                    switch (channel->target_path)
+                    {
+                        case cgltf_animation_path_type_translation:
+                            joint_update->joint_update_type = JOINT_UPDATE_TYPE_TRANSLATION;
+                            cgltf_accessor_read_float(output_accessor, j, joint_update->translation, 3);
+                            break;
+                        case cgltf_animation_path_type_rotation:
+                            joint_update->joint_update_type = JOINT_UPDATE_TYPE_ROTATION;
+                            cgltf_accessor_read_float(output_accessor, j, joint_update->rotation, 4);
+                            break;
+                        case cgltf_animation_path_type_scale:
+                            joint_update->joint_update_type = JOINT_UPDATE_TYPE_SCALE;
+                            cgltf_accessor_read_float(output_accessor, j, joint_update->scale, 3);
+                            break;
+                        default:
+                            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unsupported animation path type: %d", channel->target_path);
+                            return false;
+                    }
+                }
+            }
+        }
+    }
+
+    /**************** Mesh ****************/
 
-    // TODO emissive maps
-    // (use SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM for non-color maps)
-    char* texture_diffuse_uri = NULL;
-    char* texture_metallic_roughness_uri = NULL;
-    char* texture_normal_uri = NULL;
-    if (primitive->material && primitive->material->has_pbr_metallic_roughness)
-    {
-        cgltf_texture* base_color_texture = primitive->material->pbr_metallic_roughness.base_color_texture.texture;
-        if (base_color_texture && base_color_texture->image && base_color_texture->image->uri)
-        {
-            texture_diffuse_uri = base_color_texture->image->uri;
-        }
-        cgltf_texture* metallic_roughness_texture = primitive->material->pbr_metallic_roughness.metallic_roughness_texture.texture;
-        if (metallic_roughness_texture && metallic_roughness_texture->image && metallic_roughness_texture->image->uri)
-        {
-            texture_metallic_roughness_uri = metallic_roughness_texture->image->uri;
-        }
-    }
-    if (primitive->material && primitive->material->normal_texture.texture)
+    if (model_type == MODEL_TYPE_INSTANCED)
     {
-        cgltf_texture* normal_texture = primitive->material->normal_texture.texture;
-        if (normal_texture && normal_texture->image && normal_texture->image->uri)
+        if (!Model_Instanced_AddNode(scene, node))
         {
-            texture_normal_uri = normal_texture->image->uri;
+            return false;
         }
+        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Successfully instanced model: %s", node->name);
+        return true;
     }
 
-    // texture_diffuse_uri = "white.png";
-    texture_metallic_roughness_uri = "orange.png";
-    texture_normal_uri = "default_normal.png";
-
-    SDL_Surface* texture_diffuse_surface = LoadImage(texture_diffuse_uri);
-    if (!texture_diffuse_surface)
+    if (model_type != MODEL_TYPE_BONE_ANIMATED && model_type != MODEL_TYPE_BONE_ANIMATED_MIXAMO)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load diffuse texture from URI: %s", texture_diffuse_uri);
-        return false;
-    }
-    SDL_Surface* texture_metallic_roughness_surface = LoadImage(texture_metallic_roughness_uri);
-    if (!texture_metallic_roughness_surface)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load metallic roughness texture from URI: %s", texture_metallic_roughness_uri);
-        return false;
-    }
-    SDL_Surface* texture_normal_surface = NULL;
-    if (texture_normal_uri)
-    {
-        texture_normal_surface = LoadImage(texture_normal_uri);
-        if (!texture_normal_surface)
+        // TODO rigid animated models will need their own path once they are implemented
+        if (!Model_StaticBatch_AddNode(scene, node))
         {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load normal texture from URI: %s", texture_normal_uri);
             return false;
         }
-    }
-    mesh.material.texture_diffuse = SDL_CreateGPUTexture(gpu_device, &(SDL_GPUTextureCreateInfo)
-    {
-        .type = SDL_GPU_TEXTURETYPE_2D,
-        .format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB,
-        .width = (Uint32)texture_diffuse_surface->w,
-        .height = (Uint32)texture_diffuse_surface->h,
-        .layer_count_or_depth = 1,
-        .num_levels = n_mipmap_levels, 
-        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COLOR_TARGET // COLOR_TARGET is needed for mipmap generation
-    });
-    if (mesh.material.texture_diffuse == NULL)
-    {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create main texture: %s", SDL_GetError());
-        return false;
-    }
-    mesh.material.texture_metallic_roughness = SDL_CreateGPUTexture(gpu_device, &(SDL_GPUTextureCreateInfo)
-    {
-        .type = SDL_GPU_TEXTURETYPE_2D,
-        .format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
-        .width = (Uint32)texture_metallic_roughness_surface->w,
-        .height = (Uint32)texture_metallic_roughness_surface->h,
-        .layer_count_or_depth = 1,
-        .num_levels = n_mipmap_levels, 
-        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COLOR_TARGET 
-    });
-    if (mesh.material.texture_metallic_roughness == NULL)
-    {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create metallic-roughness texture: %s", SDL_GetError());
-        return false;
-    }
-    mesh.material.texture_normal = SDL_CreateGPUTexture(gpu_device, &(SDL_GPUTextureCreateInfo)
-    {
-        .type = SDL_GPU_TEXTURETYPE_2D,
-        .format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
-        .width = (Uint32)texture_normal_surface->w,
-        .height = (Uint32)texture_normal_surface->h,
-        .layer_count_or_depth = 1,
-        .num_levels = n_mipmap_levels, 
-        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COLOR_TARGET 
-    });
-    if (mesh.material.texture_normal == NULL)
-    {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create normal texture: %s", SDL_GetError());
-        return false;
+        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Successfully batched model: %s", node->name);
+        return true;
     }
 
-    // LoadImage() guarantees the surface is SDL_PIXELFORMAT_RGBA32
-    Uint32 texture_diffuse_data_size = 
-        (Uint32)texture_diffuse_surface->w * texture_diffuse_surface->h * 4;
-    Uint32 texture_metallic_roughness_data_size = 
-        (Uint32)texture_metallic_roughness_surface->w * texture_metallic_roughness_surface->h * 4;
-    Uint32 texture_normal_data_size =
-        (Uint32)texture_normal_surface->w * texture_normal_surface->h * 4;
-    Uint32 texture_data_size = texture_diffuse_data_size + texture_metallic_roughness_data_size + texture_normal_data_size;
-    
-    SDL_GPUTransferBuffer* texture_transfer_buffer = SDL_CreateGPUTransferBuffer
-    (
-        gpu_device,
-        &(SDL_GPUTransferBufferCreateInfo)
-        {
-            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-            .size = texture_data_size
-        }
-    );
-    if (texture_transfer_buffer == NULL)
+    // skinned meshes are drawn individually, so they keep a single primitive and 16 bit indices
+    if (node->mesh->primitives_count != 1)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create texture transfer buffer: %s", SDL_GetError());
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: Expected skinned mesh with one primitive. Found %zu primitives in node: %s.", node->mesh->primitives_count, node->name);
         return false;
     }
 
-    Uint8* texture_transfer_mapped = SDL_MapGPUTransferBuffer(gpu_device, texture_transfer_buffer, false);
-    if (texture_transfer_mapped == NULL)
+    Uint8* vertices = NULL;
+    Uint32* indices = NULL;
+    Uint32 vertex_count = 0;
+    Uint32 index_count = 0;
+    if (!Model_ReadPrimitive(node->mesh->primitives, true, node->name, &vertices, &vertex_count, &indices, &index_count))
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map texture transfer buffer: %s", SDL_GetError());
         return false;
     }
 
-    SDL_memcpy(texture_transfer_mapped, texture_diffuse_surface->pixels, texture_diffuse_data_size);
-    SDL_memcpy(texture_transfer_mapped + texture_diffuse_data_size, texture_metallic_roughness_surface->pixels, texture_metallic_roughness_data_size);
-    SDL_memcpy(texture_transfer_mapped + texture_diffuse_data_size + texture_metallic_roughness_data_size, texture_normal_surface->pixels, texture_normal_data_size);
-    
-    SDL_UnmapGPUTransferBuffer(gpu_device, texture_transfer_buffer);
-
-    SDL_GPUCommandBuffer* upload_command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
-    if (upload_command_buffer == NULL)
+    if (vertex_count > 0xFFFF)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to acquire upload command buffer: %s", SDL_GetError());
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Skinned mesh %s has %u vertices; at most 65535 are supported", node->name, vertex_count);
+        SDL_free(vertices);
+        SDL_free(indices);
         return false;
     }
 
-    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(upload_command_buffer);
-
-    SDL_UploadToGPUBuffer
-    (
-        copy_pass,
-        &(SDL_GPUTransferBufferLocation)
-        { 
-            .transfer_buffer = transfer_buffer, 
-            .offset = 0 
-        },
-        &(SDL_GPUBufferRegion)
-        { 
-            .buffer = mesh.vertex_buffer, 
-            .offset = 0, 
-            .size = vertex_data_size 
-        },
-        false
-    );
+    // narrowed in place; the 16 bit values fit in the first half of the allocation
+    Uint16* indices_16 = (Uint16*)indices;
+    for (Uint32 i = 0; i < index_count; i++)
+        indices_16[i] = (Uint16)indices[i];
 
-    SDL_UploadToGPUBuffer
-    (
-        copy_pass,
-        &(SDL_GPUTransferBufferLocation)
-        {
-            .transfer_buffer = transfer_buffer,
-            .offset = vertex_data_size // Offset after vertex data
-        },
-        &(SDL_GPUBufferRegion)
-        {
-            .buffer = mesh.index_buffer,
-            .offset = 0,
-            .size = index_data_size
-        },
-        false
-    );
-    
-    SDL_UploadToGPUTexture
-    (
-        copy_pass,
-        &(SDL_GPUTextureTransferInfo)
-        {
-            .transfer_buffer = texture_transfer_buffer,
-            .offset = 0,
-            .pixels_per_row = (Uint32)texture_diffuse_surface->w,
-            .rows_per_layer = (Uint32)texture_diffuse_surface->h
-        },
-        &(SDL_GPUTextureRegion)
-        {
-            .texture = mesh.material.texture_diffuse,
-            .mip_level = 0,
-            .layer = 0,
-            .x = 0, .y = 0, .z = 0,
-            .w = (Uint32)texture_diffuse_surface->w,
-            .h = (Uint32)texture_diffuse_surface->h,
-            .d = 1
-        },
-        false
-    );
-    SDL_UploadToGPUTexture
-    (
-        copy_pass,
-        &(SDL_GPUTextureTransferInfo)
-        {
-            .transfer_buffer = texture_transfer_buffer,
-            .offset = texture_diffuse_data_size,
-            .pixels_per_row = (Uint32)texture_metallic_roughness_surface->w,
-            .rows_per_layer = (Uint32)texture_metallic_roughness_surface->h
-        },
-        &(SDL_GPUTextureRegion)
-        {
-            .texture = mesh.material.texture_metallic_roughness,
-            .mip_level = 0,
-            .layer = 0,
-            .x = 0, .y = 0, .z = 0,
-            .w = (Uint32)texture_metallic_roughness_surface->w,
-            .h = (Uint32)texture_metallic_roughness_surface->h,
-            .d = 1
-        },
-        false
-    );
-    SDL_UploadToGPUTexture
-    (
-        copy_pass,
-        &(SDL_GPUTextureTransferInfo)
-        {
-            .transfer_buffer = texture_transfer_buffer,
-            .offset = texture_diffuse_data_size + texture_metallic_roughness_data_size,
-            .pixels_per_row = (Uint32)texture_normal_surface->w,
-            .rows_per_layer = (Uint32)texture_normal_surface->h
-        },
-        &(SDL_GPUTextureRegion)
-        {
-            .texture = mesh.material.texture_normal,
-            .mip_level = 0,
-            .layer = 0,
-            .x = 0, .y = 0, .z = 0,
-            .w = (Uint32)texture_normal_surface->w,
-            .h = (Uint32)texture_normal_surface->h,
-            .d = 1
-        },
-        false
-    );
+    const char* texture_uris[3];
+    Model_GetTextureURIs(node->mesh->primitives, texture_uris);
 
-    SDL_EndGPUCopyPass(copy_pass);
-    
-    if (n_mipmap_levels > 1) 
+    Model_MeshData mesh_data;
+    bool created = Model_MeshData_Init(&mesh_data, vertices, vertex_count, true, indices_16, index_count, SDL_GPU_INDEXELEMENTSIZE_16BIT, texture_uris);
+    SDL_free(vertices);
+    SDL_free(indices);
+    if (!created)
     {
-        SDL_GenerateMipmapsForGPUTexture(upload_command_buffer, mesh.material.texture_diffuse);
-        SDL_GenerateMipmapsForGPUTexture(upload_command_buffer, mesh.material.texture_metallic_roughness);
-        SDL_GenerateMipmapsForGPUTexture(upload_command_buffer, mesh.material.texture_normal);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create mesh: %s", node->name);
+        return false;
     }
-    
-    SDL_SubmitGPUCommandBuffer(upload_command_buffer);
 
-    SDL_ReleaseGPUTransferBuffer(gpu_device, transfer_buffer);
-    SDL_ReleaseGPUTransferBuffer(gpu_device, texture_transfer_buffer);
-    SDL_DestroySurface(texture_diffuse_surface);
-    SDL_DestroySurface(texture_metallic_roughness_surface);
-    SDL_DestroySurface(texture_normal_surface);
+    // bind pose bounds in world space, padded for how far animation may move the limbs
+    mat4 bind_pose_to_world;
+    glm_mat4_mul(model_matrix, animation_rig.armature_correction_matrix, bind_pose_to_world);
+    Frustum_TransformAABB(bind_pose_to_world, mesh_data.aabb_min, mesh_data.aabb_max, mesh_data.aabb_min, mesh_data.aabb_max);
+    vec3 extent;
+    glm_vec3_sub(mesh_data.aabb_max, mesh_data.aabb_min, extent);
+    float padding = glm_vec3_max(extent) * MODEL_SKINNED_BOUNDS_PADDING;
+    glm_vec3_subs(mesh_data.aabb_min, padding, mesh_data.aabb_min);
+    glm_vec3_adds(mesh_data.aabb_max, padding, mesh_data.aabb_max);
+    glm_mat4_copy(model_matrix, mesh_data.model_matrix);
 
-    if (model_type == MODEL_TYPE_BONE_ANIMATED || model_type == MODEL_TYPE_BONE_ANIMATED_MIXAMO)
-    {
-        Model_BoneAnimated model_bone_animated = {0};
-        glm_mat4_identity(model_bone_animated.model.model_matrix);
-        model_bone_animated.model.mesh = mesh;
-        model_bone_animated.animation_rig = animation_rig;
-        Array_Append(models_bone_animated, model_bone_animated);
-    }
-    else
+    mesh_data.animation_rig = animation_rig; // ownership moves to the mesh
+    if (!Array_Append(scene->meshes, mesh_data))
     {
-        Model new_model = {0};
-        glm_mat4_identity(new_model.model_matrix);
-        new_model.mesh = mesh;
-        Array_Append(models_unanimated, new_model);
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow scene meshes: %s", node->name);
+        Model_MeshData_Free(&mesh_data);
+        return false;
     }
+    
     SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Successfully loaded model: %s", node->name);
 
     return true;
 }
 
-bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node)
+bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene)
 {
     if (node->mesh->primitives_count != 1)
     {
@@ -982,14 +1982,13 @@ bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node)
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing indices.");
         return false;
     }
-    if (index_accessor->component_type != cgltf_component_type_r_16u)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Expected index component type to be Uint16, got %d", index_accessor->component_type);
-        return false;
-    }
 
     int index_count = (int)index_accessor->count;
 
+    // render geometry is pre-transformed by static batching, so physics has to match it
+    mat4 world_matrix;
+    cgltf_node_transform_world(node, (float*)world_matrix);
+
     const uint8_t* pos_data_base = cgltf_buffer_view_data(position_accessor->buffer_view);
     if (pos_data_base == NULL) 
     {
@@ -998,12 +1997,18 @@ bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node)
     }
     pos_data_base += position_accessor->offset;
 
-    Uint16 indices[index_count];
+    Uint32* indices = SDL_malloc(sizeof(Uint32) * index_count);
+    if (indices == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for indices: %s", node->name);
+        return false;
+    }
 
-    size_t unpacked_indices_count = cgltf_accessor_unpack_indices(index_accessor, indices, sizeof(Uint16), index_count);
+    size_t unpacked_indices_count = cgltf_accessor_unpack_indices(index_accessor, indices, sizeof(Uint32), index_count);
     if (unpacked_indices_count != index_count)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error unpacking gltf primitive indices: unexpected index_count (unpacked %zu, expected %u).", unpacked_indices_count, index_count);
+        SDL_free(indices);
         return false;
     }
 
@@ -1022,7 +2027,7 @@ bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node)
     {        
         float* raw = (float*)(pos_data_base + indices[i] * position_accessor->stride);
         vec3 triangle;
-        glm_vec3_copy(raw, triangle);
+        glm_mat4_mulv3(world_matrix, raw, 1.0f, triangle);
         trigger.aabb[0][0] = glm_min(trigger.aabb[0][0], triangle[0]);
         trigger.aabb[0][1] = glm_min(trigger.aabb[0][1], triangle[1]);
         trigger.aabb[0][2] = glm_min(trigger.aabb[0][2], triangle[2]);
@@ -1030,25 +2035,29 @@ bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node)
         trigger.aabb[1][1] = glm_max(trigger.aabb[1][1], triangle[1]);
         trigger.aabb[1][2] = glm_max(trigger.aabb[1][2], triangle[2]);
     }
+
+    SDL_free(indices);
     
-    Array_Append(triggers, trigger);
+    Array_Append(scene->triggers, trigger);
 
     return true;
 }
 
-bool Model_Load_Collider(cgltf_data* gltf_data, cgltf_node* node)
+// Reads the node's single triangle primitive as world space triangles (render geometry is pre-transformed by static batching,
+// so physics and occlusion have to match it); the caller owns the returned array, NULL on failure
+static Tri* Model_LoadWorldTriangles(cgltf_node* node, size_t* triangle_count)
 {
-    if (node->mesh->primitives_count != 1)
+    if (node->mesh == NULL || node->mesh->primitives_count != 1)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: Expected mesh with one primitive. Found %zu primitives in node: %s.", node->mesh->primitives_count, node->name);
-        return false;
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: Expected mesh with one primitive. Found %zu primitives in node: %s.", node->mesh ? node->mesh->primitives_count : 0, node->name);
+        return NULL;
     }
 
     cgltf_primitive* primitive = node->mesh->primitives;
     if (primitive->type != cgltf_primitive_type_triangles)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error: gltf primitive has type %d, expected type %d (triangles).", primitive->type, cgltf_primitive_type_triangles);
-        return false;
+        return NULL;
     }
 
     cgltf_accessor* position_accessor = NULL;
@@ -1065,60 +2074,86 @@ bool Model_Load_Collider(cgltf_data* gltf_data, cgltf_node* node)
     if (!position_accessor)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing attribute: POSITION.");
-        return false;
+        return NULL;
     }
 
     if (position_accessor->component_type != cgltf_component_type_r_32f) 
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "ERROR: Expected POSITION to be Float32. Current gltf loader does not support automatic conversion.");
-        return false;
+        return NULL;
     }
 
     cgltf_accessor* index_accessor = primitive->indices;
     if (index_accessor == NULL)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Primitive is missing indices.");
-        return false;
-    }
-    if (index_accessor->component_type != cgltf_component_type_r_16u)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Expected index component type to be Uint16, got %d", index_accessor->component_type);
-        return false;
+        return NULL;
     }
 
     int index_count = (int)index_accessor->count;
 
+    mat4 world_matrix;
+    cgltf_node_transform_world(node, (float*)world_matrix);
+
     const uint8_t* pos_data_base = cgltf_buffer_view_data(position_accessor->buffer_view);
     if (pos_data_base == NULL) 
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get position data buffer view.");
-        return false;
+        return NULL;
     }
     pos_data_base += position_accessor->offset;
 
-    Uint16 indices[index_count];
+    Uint32* indices = SDL_malloc(sizeof(Uint32) * index_count);
+    Tri* triangles = SDL_malloc(sizeof(Tri) * (index_count / 3 + 1));
+    if (indices == NULL || triangles == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate memory for triangles: %s", node->name);
+        SDL_free(indices);
+        SDL_free(triangles);
+        return NULL;
+    }
 
-    size_t unpacked_indices_count = cgltf_accessor_unpack_indices(index_accessor, indices, sizeof(Uint16), index_count);
+    size_t unpacked_indices_count = cgltf_accessor_unpack_indices(index_accessor, indices, sizeof(Uint32), index_count);
     if (unpacked_indices_count != index_count)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error unpacking gltf primitive indices: unexpected index_count (unpacked %zu, expected %u).", unpacked_indices_count, index_count);
-        return false;
+        SDL_free(indices);
+        SDL_free(triangles);
+        return NULL;
     }
 
-    for (int i = 0; i < index_count; i +=3)
+    *triangle_count = 0;
+    for (int i = 0; i + 2 < index_count; i += 3)
     {
-        Uint16 index0 = indices[i];
-        Uint16 index1 = indices[i + 1];
-        Uint16 index2 = indices[i + 2];
+        Tri* tri = &triangles[(*triangle_count)++];
+
+        const void* src_pos0 = pos_data_base + indices[i] * position_accessor->stride;
+        memcpy(&tri->a, src_pos0, sizeof(float) * 3);
+        const void* src_pos1 = pos_data_base + indices[i + 1] * position_accessor->stride;
+        memcpy(&tri->b, src_pos1, sizeof(float) * 3);
+        const void* src_pos2 = pos_data_base + indices[i + 2] * position_accessor->stride;
+        memcpy(&tri->c, src_pos2, sizeof(float) * 3);
+
+        glm_mat4_mulv3(world_matrix, tri->a, 1.0f, tri->a);
+        glm_mat4_mulv3(world_matrix, tri->b, 1.0f, tri->b);
+        glm_mat4_mulv3(world_matrix, tri->c, 1.0f, tri->c);
+    }
+
+    SDL_free(indices);
+
+    return triangles;
+}
+
+bool Model_Load_Collider(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene)
+{
+    size_t triangle_count = 0;
+    Tri* triangles = Model_LoadWorldTriangles(node, &triangle_count);
+    if (triangles == NULL) return false;
 
+    for (size_t i = 0; i < triangle_count; i++)
+    {
         Collider collider;
-        
-        const void* src_pos0 = pos_data_base + index0 * position_accessor->stride;
-        memcpy(&collider.tri.a, src_pos0, sizeof(float) * 3);
-        const void* src_pos1 = pos_data_base + index1 * position_accessor->stride;
-        memcpy(&collider.tri.b, src_pos1, sizeof(float) * 3);
-        const void* src_pos2 = pos_data_base + index2 * position_accessor->stride;
-        memcpy(&collider.tri.c, src_pos2, sizeof(float) * 3);
+        collider.tri = triangles[i];
 
         AABBFromTri(collider.tri, collider.aabb);
         
@@ -1130,27 +2165,111 @@ bool Model_Load_Collider(cgltf_data* gltf_data, cgltf_node* node)
         glm_vec3_cross(ba, ca, n_raw);
         glm_vec3_normalize_to(n_raw, collider.normal);
         
-        Array_Append(colliders, collider);
+        Array_Append(scene->colliders, collider);
     }
 
+    SDL_free(triangles);
+
     return true;
 }
 
+// Occluder nodes are never drawn; their triangles only hide what is behind them from the CPU occlusion culler (see occlusion.h)
+bool Model_Load_Occluder(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene)
+{
+    size_t triangle_count = 0;
+    Tri* triangles = Model_LoadWorldTriangles(node, &triangle_count);
+    if (triangles == NULL) return false;
+
+    bool success = true;
+    for (size_t i = 0; i < triangle_count && success; i++)
+    {
+        Occluder occluder = { .tri = triangles[i] };
+        success = Array_Append(scene->occluders, occluder);
+    }
+
+    SDL_free(triangles);
+
+    if (!success) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow scene occluders: %s", node->name);
+    return success;
+}
+
 // TODO modularize free funtions for mesh, material, animation rig, model, etc.
 
 void Model_Free(Model* model)
 {
-    SDL_ReleaseGPUBuffer(gpu_device, model->mesh.vertex_buffer);
-    SDL_ReleaseGPUBuffer(gpu_device, model->mesh.index_buffer);
-    SDL_ReleaseGPUTexture(gpu_device, model->mesh.material.texture_diffuse);
+    GPUMemory_ReleaseBuffer(model->mesh.vertex_buffer);
+    GPUMemory_ReleaseBuffer(model->mesh.index_buffer);
+    GPUMemory_ReleaseBuffer(model->mesh.instance_buffer);
+    Model_FreeMaterial(&model->mesh.material);
+    if (model->submeshes) Array_Free(model->submeshes);
     SDL_memset(model, 0, sizeof(Model));
 }
 
+// Frees everything that came from one Loader_RequestScene
+// the loader holds indices into the model arrays, so this is only allowed while it is idle
+bool Model_UnloadScene(Uint32 scene_id)
+{
+    if (!Loader_IsIdle())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Can't unload scene %u while the loader is busy", scene_id);
+        return false;
+    }
+
+    // compacted in place, which keeps the order (and draw order) of everything else
+    size_t kept = 0;
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        if (models_unanimated[i].scene_id == scene_id) Model_Free(&models_unanimated[i]);
+        else models_unanimated[kept++] = models_unanimated[i];
+    }
+    Array_Len(models_unanimated) = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+    {
+        if (models_instanced[i].scene_id == scene_id) Model_Free(&models_instanced[i]);
+        else models_instanced[kept++] = models_instanced[i];
+    }
+    Array_Len(models_instanced) = kept;
+    static_geometry_generation++;
+
+    kept = 0;
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        if (models_bone_animated[i].model.scene_id == scene_id) Model_BoneAnimated_Free(&models_bone_animated[i]);
+        else models_bone_animated[kept++] = models_bone_animated[i];
+    }
+    Array_Len(models_bone_animated) = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < Array_Len(colliders); i++)
+    {
+        if (colliders[i].scene_id != scene_id) colliders[kept++] = colliders[i];
+    }
+    Array_Len(colliders) = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < Array_Len(occluders); i++)
+    {
+        if (occluders[i].scene_id != scene_id) occluders[kept++] = occluders[i];
+    }
+    Array_Len(occluders) = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < Array_Len(triggers); i++)
+    {
+        if (triggers[i].scene_id != scene_id) triggers[kept++] = triggers[i];
+    }
+    Array_Len(triggers) = kept;
+
+    return true;
+}
+
 void Model_BoneAnimated_Free(Model_BoneAnimated* model)
 {
-    SDL_ReleaseGPUBuffer(gpu_device, model->model.mesh.vertex_buffer);
-    SDL_ReleaseGPUBuffer(gpu_device, model->model.mesh.index_buffer);
-    SDL_ReleaseGPUTexture(gpu_device, model->model.mesh.material.texture_diffuse);
+    GPUMemory_ReleaseBuffer(model->model.mesh.vertex_buffer);
+    GPUMemory_ReleaseBuffer(model->model.mesh.index_buffer);
+    Model_FreeMaterial(&model->model.mesh.material);
     SDL_free(model->animation_rig.joints);
     for (size_t i = 0; i < model->animation_rig.num_skeletal_animations; ++i)
     {
@@ -1161,6 +2280,159 @@ void Model_BoneAnimated_Free(Model_BoneAnimated* model)
     SDL_memset(model, 0, sizeof(Model_BoneAnimated));
 }
 
+// Picks the level of detail of every static batch submesh, and of every instanced model, for this frame
+// every pass draws what is picked here, so the depth prepass and the main pass rasterize identical triangles
+void Model_SelectLODs(Camera* camera, float viewport_height)
+{
+    // pixels covered by one world unit at a distance of one unit
+    float pixels_per_unit = camera->projection_matrix[1][1] * 0.5f * viewport_height;
+
+    size_t unanimated_count = Array_Len(models_unanimated);
+    for (size_t i = 0; i < unanimated_count + Array_Len(models_instanced); i++)
+    {
+        Submesh Array submeshes = i < unanimated_count ? models_unanimated[i].submeshes : models_instanced[i - unanimated_count].submeshes;
+        if (submeshes == NULL) continue;
+
+        for (size_t ii = 0; ii < Array_Len(submeshes); ii++)
+        {
+            Submesh* submesh = &submeshes[ii];
+            if (submesh->lod_count <= 1) continue;
+
+            vec3 center;
+            glm_vec3_center(submesh->aabb_min, submesh->aabb_max, center);
+            float radius = 0.5f * glm_vec3_distance(submesh->aabb_min, submesh->aabb_max);
+            float distance = glm_vec3_distance(camera->position, center) - radius; // to the nearest point of the bounding sphere
+            if (distance <= camera->near_plane)
+            {
+                submesh->lod = 0;
+                continue;
+            }
+
+            // a level's error shrinks on screen along with the projected bounding sphere
+            float pixels_per_error = pixels_per_unit / distance;
+            Uint8 lod = SDL_min(submesh->lod, submesh->lod_count - 1);
+            while (lod > 0 && submesh->lods[lod].error * pixels_per_error > MODEL_LOD_ERROR_PIXELS)
+            {
+                lod--;
+            }
+            while (lod + 1 < submesh->lod_count && submesh->lods[lod + 1].error * pixels_per_error <= MODEL_LOD_ERROR_PIXELS * (1.0f - MODEL_LOD_HYSTERESIS))
+            {
+                lod++;
+            }
+            submesh->lod = lod;
+        }
+    }
+}
+
+// Sets visibility_bit on every model whose bounds intersect the frustum of view_projection; clears it on the rest
+// the submeshes of static batches are culled on the GPU (GPUCull_Update), which also does occlusion
+static void Model_CullAgainstFrustum(mat4 view_projection, bool include_near_plane, Uint8 visibility_bit)
+{
+    Frustum frustum;
+    Frustum_FromMatrix(view_projection, include_near_plane, &frustum);
+
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        if (Frustum_IntersectsAABB(&frustum, model->aabb_min, model->aabb_max)) model->visibility |= visibility_bit;
+        else model->visibility &= ~visibility_bit;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+    {
+        Model* model = &models_instanced[i];
+        if (Frustum_IntersectsAABB(&frustum, model->aabb_min, model->aabb_max)) model->visibility |= visibility_bit;
+        else model->visibility &= ~visibility_bit;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        Model* model = &models_bone_animated[i].model;
+        if (Frustum_IntersectsAABB(&frustum, model->aabb_min, model->aabb_max)) model->visibility |= visibility_bit;
+        else model->visibility &= ~visibility_bit;
+    }
+}
+
+// Clears MODEL_VISIBLE_CAMERA on every camera visible model hidden behind the occluders (Occlusion_Update)
+static void Model_CullOccluded(void)
+{
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        if ((model->visibility & MODEL_VISIBLE_CAMERA) && Occlusion_IsOccluded(model->aabb_min, model->aabb_max)) model->visibility &= ~MODEL_VISIBLE_CAMERA;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+    {
+        Model* model = &models_instanced[i];
+        if ((model->visibility & MODEL_VISIBLE_CAMERA) && Occlusion_IsOccluded(model->aabb_min, model->aabb_max)) model->visibility &= ~MODEL_VISIBLE_CAMERA;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        Model* model = &models_bone_animated[i].model;
+        if ((model->visibility & MODEL_VISIBLE_CAMERA) && Occlusion_IsOccluded(model->aabb_min, model->aabb_max)) model->visibility &= ~MODEL_VISIBLE_CAMERA;
+    }
+}
+
+static bool Model_InAnyFrustum(const Model* model, const Frustum* const* frusta, int frustum_count)
+{
+    for (int i = 0; i < frustum_count; i++)
+    {
+        if (Frustum_IntersectsAABB(frusta[i], model->aabb_min, model->aabb_max)) return true;
+    }
+    return false;
+}
+
+// Sets MODEL_VISIBLE_SPOT_SHADOW on every model inside a spot light whose tile is drawn this frame; clears it on the rest
+static void Model_CullAgainstSpotShadows(void)
+{
+    const Frustum* frusta[SPOT_SHADOW_UPDATE_BUDGET];
+    int frustum_count = 0;
+    for (size_t i = 0; i < Array_Len(lights_spot) && i < MAX_SPOT_LIGHTS && frustum_count < SPOT_SHADOW_UPDATE_BUDGET; i++)
+    {
+        if (spot_shadows[i].redraw) frusta[frustum_count++] = &spot_shadows[i].view.frustum;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        if (Model_InAnyFrustum(model, frusta, frustum_count)) model->visibility |= MODEL_VISIBLE_SPOT_SHADOW;
+        else model->visibility &= ~MODEL_VISIBLE_SPOT_SHADOW;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+    {
+        Model* model = &models_instanced[i];
+        if (Model_InAnyFrustum(model, frusta, frustum_count)) model->visibility |= MODEL_VISIBLE_SPOT_SHADOW;
+        else model->visibility &= ~MODEL_VISIBLE_SPOT_SHADOW;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        Model* model = &models_bone_animated[i].model;
+        if (Model_InAnyFrustum(model, frusta, frustum_count)) model->visibility |= MODEL_VISIBLE_SPOT_SHADOW;
+        else model->visibility &= ~MODEL_VISIBLE_SPOT_SHADOW;
+    }
+}
+
+// Once per frame, after the camera and the lights have moved and before anything is drawn
+// light_view_projection is the box around the directional light's cascades (Lights_UpdateShadowCascades);
+// the spot lights' are the ones Lights_UpdateSpotShadows picked
+void Model_UpdateVisibility(Camera* camera, mat4 light_view_projection)
+{
+    Model_CullAgainstFrustum(camera->view_projection_matrix, true, MODEL_VISIBLE_CAMERA);
+    Model_CullAgainstFrustum(light_view_projection, false, MODEL_VISIBLE_SHADOW);
+    Model_CullAgainstSpotShadows();
+
+    // occluders only hide things from the camera; the shadow map still sees whatever is behind them
+    if ((settings_render & SETTINGS_RENDER_CPU_OCCLUSION_CULLING) &&
+        Occlusion_Update(occluders, Array_Len(occluders), camera->view_projection_matrix))
+    {
+        Model_CullOccluded();
+    }
+}
+
 static void Model_CalculateJointMatrices(Joint* joint, mat4 parent_global_transform, Uint8* joint_matrices_out, Joint* root_joint) 
 {
     mat4 local_transform;
@@ -9,6 +9,12 @@
 #include "../external/cgltf.h"
 
 #include "helper.h"
+#include "array.h"
+#include "camera.h"
+#include "physics.h"
+#include "occlusion.h"
+#include "texture.h"
+#include "materialpool.h"
 
 Enum (Uint8, Model_Type)
 {
@@ -21,13 +27,19 @@ Enum (Uint8, Model_Type)
 	MODEL_TYPE_INSTANCED,
 	MODEL_TYPE_COLLIDER,
 	MODEL_TYPE_TRIGGER,
+	MODEL_TYPE_OCCLUDER, // invisible, simplified stand-in that hides what is behind it (see occlusion.h)
 };
 
-Struct (TransformsUBO)
+// One element of the frame's transform storage buffer (Render_UpdateTransforms), indexed by Model.transform_index
+// computed once per frame and shared by the shadow pass, the prepass and the main pass
+// M is the identity for instanced models; their vertex shaders apply the instance's model matrix first (see Instancing)
+Struct (Model_Transforms)
 {
     mat4 mvp; // VP * M
     mat4 mv;  // V * M
-	mat4 mvp_light; // light VP * M
+	mat4 model; // M; the shadow passes apply the view projection of the cascade they draw (UBO_Shadow)
+	vec4 position_offset; // dequantizes vertex positions: xyz * position_scale + position_offset
+	vec4 position_scale;
 #ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
 	mat4 normal; // upper-left 3x3 is the normal matrix, rest identity
 #endif
@@ -70,12 +82,65 @@ Struct (Vertex_BoneAnimated)
 	float weights[MAX_JOINTS_PER_VERTEX];
 };
 
+/*
+    Vertex_PBR and Vertex_BoneAnimated are the import layouts (mesh optimization, static batching);
+    what actually lives in GPU memory are the quantized layouts below, built when the mesh is uploaded
+    * position: unorm16 steps of a grid aligned to the origin (see Mesh.position_offset/scale), w = bitangent sign (0 -> -1, 1 -> +1)
+      the grid is VERTEX_POSITION_STEP apart unless a single mesh spans more than VERTEX_POSITION_MAX_EXTENT, when it doubles
+      until the mesh fits; static batches are split so they don't (see Static Batching in model.c), so vertices that
+      neighbouring batches share land on the same grid point and don't crack
+    * normal_tangent: octahedral encoded normal (xy) and tangent (zw), snorm16
+    * uv: half floats, since texture coordinates may tile outside [0, 1]
+    * weights: unorm8, summing to exactly 255
+    Vertex_PBR_Quantized is 20 bytes (48 unquantized), Vertex_BoneAnimated_Quantized is 28 bytes (68 unquantized)
+*/
+
+// set to 0 to keep float positions (e.g. to compare against); the shaders decode both the same way
+#define VERTEX_QUANTIZE_POSITIONS 1
+#define VERTEX_POSITION_STEP (1.0f / 1024.0f)                     // world units, so about a millimeter
+#define VERTEX_POSITION_MAX_EXTENT (VERTEX_POSITION_STEP * 65535.0f) // about 64 world units per axis
+
+#if VERTEX_QUANTIZE_POSITIONS
+typedef Uint16 Vertex_PositionComponent;
+#define VERTEX_POSITION_FORMAT SDL_GPU_VERTEXELEMENTFORMAT_USHORT4_NORM
+#else
+typedef float Vertex_PositionComponent;
+#define VERTEX_POSITION_FORMAT SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4
+#endif
+
+Struct (Vertex_PBR_Quantized)
+{
+	Vertex_PositionComponent position[4];
+	Sint16 normal_tangent[4];
+	Uint16 uv[2];
+};
+
+Struct (Vertex_BoneAnimated_Quantized)
+{
+	Vertex_PositionComponent position[4];
+	Sint16 normal_tangent[4];
+	Uint16 uv[2];
+	Uint8 joint_ids[MAX_JOINTS_PER_VERTEX];
+	Uint8 weights[MAX_JOINTS_PER_VERTEX];
+};
+
 // in the future may add emission, masks and blends
+// each texture is a layer of a material pool (see materialpool.h)
 Struct (Material)
 {
-	SDL_GPUTexture* texture_diffuse;
-	SDL_GPUTexture* texture_normal;
-	SDL_GPUTexture* texture_metallic_roughness;
+	MaterialPool_Texture texture_diffuse;
+	MaterialPool_Texture texture_normal;
+	MaterialPool_Texture texture_metallic_roughness;
+};
+
+// One element of the frame's material parameter storage buffer, next to Model_Transforms at the same index;
+// tells the fragment shaders which layer of each bound pool the draw samples
+Struct (Material_Parameters)
+{
+	Uint32 layer_diffuse;
+	Uint32 layer_metallic_roughness;
+	Uint32 layer_normal;
+	Uint32 _padding;
 };
 
 // Mesh is equivalent to a GLTF "Primitive"
@@ -85,7 +150,65 @@ Struct (Mesh)
 	SDL_GPUBuffer* vertex_buffer;
 	SDL_GPUBuffer* index_buffer;
 	Material material;
+	Uint32 index_count; // of the whole index buffer; static batches draw ranges of it (see Submesh)
+	SDL_GPUIndexElementSize index_element_size; // 32 bit for static batches, 16 bit otherwise (if the vertices fit)
+	vec4 position_offset; // first point of the quantization grid at or below the AABB min
+	vec4 position_scale;  // 65535 grid steps
+	SDL_GPUBuffer* instance_buffer; // instanced models only; one Model_Instance per instance (see Instancing)
+	Uint32 instance_count;
+};
+
+/*
+    Instancing
+    every primitive under a MODEL_TYPE_INSTANCED node is imported once, in its own local space,
+    and every node (across the whole scene) that references the same glTF mesh becomes one instance of it;
+    instances live in a storage buffer that the instanced vertex shaders index with SV_InstanceID,
+    so a mesh is one draw per pass no matter how many times it is placed
+    mirrored placements flip the winding, so they get their own copy of the mesh with the triangles reversed
+*/
+
+// GPU layout of one element of Mesh.instance_buffer; must match the instanced vertex shaders
+Struct (Model_Instance)
+{
+	mat4 model_matrix;
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+	mat4 normal_matrix; // upper-left 3x3 is the inverse-transpose of the model matrix, rest identity
+#endif
+};
+
+/*
+    Levels of detail
+    every primitive of a static batch is simplified at import (Mesh_Simplify) into up to MODEL_LOD_COUNT - 1 coarser index lists
+    over the same vertices; the index buffer holds all of LOD 0, then all of LOD 1, etc., each in submesh order,
+    so neighbouring submeshes at the same level still draw as one range
+    an instanced mesh gets its levels the same way, as a single submesh bounding every instance (error scaled by the
+    largest one), so all of its instances draw one level, picked from their common bounds
+    bone animated meshes have no levels
+    a level is used while its simplification error, projected with the submesh's bounding sphere, stays under MODEL_LOD_ERROR_PIXELS
+*/
+#define MODEL_LOD_COUNT 4            // including the full resolution level
+#define MODEL_LOD_REDUCTION 0.5f     // each level aims for this fraction of the previous level's triangles
+#define MODEL_LOD_MIN_REDUCTION 0.8f // a level that keeps more than this fraction of the previous one isn't worth storing
+#define MODEL_LOD_MAX_ERROR 0.05f    // per level simplification error limit, relative to the submesh bounding radius
+#define MODEL_LOD_ERROR_PIXELS 1.0f  // how far (in virtual screen pixels) a level may move the surface
+#define MODEL_LOD_HYSTERESIS 0.25f   // a coarser level must beat MODEL_LOD_ERROR_PIXELS by this fraction before switching to it
+
+Struct (Submesh_LOD)
+{
+	Uint32 first_index;
 	Uint32 index_count;
+	float error; // world space distance the surface may have moved, relative to LOD 0
+};
+
+// Range of a static batch's index buffer that came from one glTF primitive
+// bounds are in world space since batched vertices are pre-transformed
+Struct (Submesh)
+{
+	vec3 aabb_min;
+	vec3 aabb_max;
+	Submesh_LOD lods[MODEL_LOD_COUNT];
+	Uint8 lod_count;
+	Uint8 lod; // selected for the current frame (Model_SelectLODs); culled on the GPU (see gpucull.h)
 };
 
 Struct (Node)
@@ -104,10 +227,31 @@ Struct (Entity)
 	versor rotation;
 };
 
+/*
+    Visibility
+    every model has world space bounds: static batches the union of their submeshes (vertices are already in world space),
+    bone animated models their bind pose bounds, padded by MODEL_SKINNED_BOUNDS_PADDING for what animation may reach,
+    instanced models the union of their instances' bounds (instances aren't culled individually)
+    each frame Model_UpdateVisibility tests them (and every submesh) against the view frusta and passes skip what fails
+    shadow casters are tested without the light's near plane; the shadow pipeline clamps their depth instead of clipping them
+*/
+#define MODEL_VISIBLE_CAMERA (1 << 0)
+#define MODEL_VISIBLE_SHADOW (1 << 1) // inside the box around every shadow cascade; the shadow passes test each cascade themselves
+#define MODEL_VISIBLE_SPOT_SHADOW (1 << 2) // inside a spot light whose shadow tile is drawn this frame; tested per tile again
+#define MODEL_SKINNED_BOUNDS_PADDING 0.25f // of the largest bind pose extent, on every side
+
 Struct (Model)
 {
 	mat4 model_matrix;
 	Mesh mesh;
+	Submesh Array submeshes; // static batches, and the single one of an instanced mesh with levels of detail; NULL otherwise
+	vec3 aabb_min;           // world space
+	vec3 aabb_max;
+	Uint32 scene_id;         // the load it came from (see Loader_RequestScene)
+	Uint32 transform_index;  // into the frame's transform storage buffer; only valid while visibility is not 0
+	Uint32 cull_first_command; // unanimated only; the frame's indirect draws of the submeshes, or the mesh (GPUCull_Update)
+	Uint32 cull_command_count; // 0 when there are none this frame
+	Uint8 visibility;        // MODEL_VISIBLE_* bits for the current frame
 };
 
 // TODO morph targets?
@@ -184,13 +328,97 @@ Struct (Model_BoneAnimated)
 	Animation_Rig animation_rig;
 };
 
+// Scene Import ////////////
+
+/*
+    Importing is split so that everything except GPU object creation can run on a loader worker (see loader.c):
+    Model_LoadSceneData parses a glTF scene into a Model_SceneData on the CPU (nothing global is touched),
+    Model_MeshData_LoadTextures decodes a mesh's textures,
+    and the main thread creates and uploads the GPU objects with the Model_*Mesh* / Model_*Material* functions
+*/
+
+// CPU side contents of one mesh, ready to be copied into a transfer buffer
+Struct (Model_MeshData)
+{
+	void* vertices; // quantized; Vertex_PBR_Quantized or Vertex_BoneAnimated_Quantized
+	void* indices;  // in the width given by index_element_size
+	Uint32 vertex_data_size;
+	Uint32 index_data_size;
+	Uint32 index_count;
+	SDL_GPUIndexElementSize index_element_size;
+	vec4 position_offset;
+	vec4 position_scale;
+	mat4 model_matrix;            // identity for static batches
+	vec3 aabb_min;                // world space (see Visibility)
+	vec3 aabb_max;
+	char* texture_uris[3];        // owned; diffuse, metallic-roughness, normal
+	Texture_Data textures[3];     // filled by Model_MeshData_LoadTextures
+	Submesh Array submeshes;      // static batches and instanced meshes with levels of detail; ownership moves to the Model
+	Animation_Rig animation_rig;  // bone animated only; ownership moves to the Model_BoneAnimated
+	Model_Instance Array instances; // instanced only; uploaded into Mesh.instance_buffer
+	bool is_bone_animated;
+	bool is_instanced;
+};
+
+// Primitives that share a material, pre-transformed into world space (see Static Batching in model.c)
+Struct (Static_Batch)
+{
+	char* texture_uris[3]; // owned copies; the material key
+	vec3 aabb_min;         // of the vertices so far; at most VERTEX_POSITION_MAX_EXTENT across unless one primitive is larger
+	vec3 aabb_max;
+	Vertex_PBR Array vertices;
+	Uint32 Array indices;
+	Uint32 Array lod_indices[MODEL_LOD_COUNT - 1]; // LOD 1 and up; appended to indices by Model_BuildStaticBatches
+	Submesh Array submeshes;
+};
+
+// Every placement of one glTF primitive under MODEL_TYPE_INSTANCED nodes (see Instancing)
+Struct (Instanced_Batch)
+{
+	cgltf_primitive* primitive; // the key, together with is_mirrored; only valid while importing
+	Model_MeshData mesh_data;         // in the primitive's local space
+	bool is_mirrored;
+};
+
+Struct (Model_SceneData)
+{
+	Model_MeshData Array meshes;
+	Collider Array colliders;
+	Occluder Array occluders;
+	Trigger Array triggers;
+	Static_Batch Array static_batches;       // only used while importing
+	Instanced_Batch Array instanced_batches; // only used while importing
+};
+
 bool Model_Load_AllScenes(void);
-bool Model_Load_Scene(const char* filename);
-bool Model_Load(cgltf_data* gltf_data, cgltf_node* node);
+bool Model_LoadSceneData(const char* filename, Model_SceneData* scene);
+void Model_FreeSceneData(Model_SceneData* scene);
+bool Model_Load(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene);
+bool Model_BuildStaticBatches(Model_SceneData* scene);
+bool Model_BuildInstancedBatches(Model_SceneData* scene);
+bool Model_Load_Collider(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene);
+bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene);
+bool Model_Load_Occluder(cgltf_data* gltf_data, cgltf_node* node, Model_SceneData* scene);
+bool Model_MeshData_LoadTextures(Model_MeshData* mesh_data);
+void Model_MeshData_Free(Model_MeshData* mesh_data);
+
+// main thread only
+bool Model_CreateMeshBuffers(const Model_MeshData* mesh_data, Mesh* mesh);
+Uint32 Model_GetMeshTransferSize(const Model_MeshData* mesh_data);
+void Model_CopyMeshToTransferBuffer(const Model_MeshData* mesh_data, Uint8* transfer_buffer_mapped);
+void Model_UploadMesh(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Model_MeshData* mesh_data, const Mesh* mesh);
+bool Model_CreateMaterial(const Model_MeshData* mesh_data, Material* material);
+Uint32 Model_GetMaterialTransferSize(const Model_MeshData* mesh_data);
+void Model_CopyMaterialToTransferBuffer(const Model_MeshData* mesh_data, Uint8* transfer_buffer_mapped);
+void Model_UploadMaterial(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Model_MeshData* mesh_data, const Material* material);
+void Model_FreeMaterial(Material* material);
+void Model_ReplaceTexture(MaterialPool_Texture old_texture, MaterialPool_Texture new_texture);
+bool Model_UnloadScene(Uint32 scene_id);
+
 void Model_Free(Model* model);
 void Model_BoneAnimated_Free(Model_BoneAnimated* model);
+void Model_SelectLODs(Camera* camera, float viewport_height);
+void Model_UpdateVisibility(Camera* camera, mat4 light_view_projection);
 bool Model_JointMat_UpdateAndUpload();
-bool Model_Load_Collider(cgltf_data* gltf_data, cgltf_node* node);
-bool Model_Load_Trigger(cgltf_data* gltf_data, cgltf_node* node);
 
 #endif // MODEL_H
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "occlusion.h"
+
+#include <float.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_NEAR_W 1e-3f // occluders are clipped to w >= this; boxes that reach below it are never occluded
+
+// A triangle in buffer pixels; the edge functions and 1/w are planes a * x + b * y + c
+// a pixel is inside when all three edge functions are non-negative at its center
+Struct (Occlusion_Triangle)
+{
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float depth_a;  // 1/w; larger is nearer
+    float depth_b;
+    float depth_c;
+    int min_x;      // inclusive, clamped to the buffer
+    int max_x;
+    int min_y;
+    int max_y;
+};
+
+Struct (Occlusion_Band)
+{
+    int first_row; // a multiple of OCCLUSION_TILE_SIZE
+    int end_row;
+    SDL_Semaphore* start; // NULL for the bands the calling thread rasterizes
+    SDL_Thread* thread;
+};
+
+static float occlusion_depth[OCCLUSION_WIDTH * OCCLUSION_HEIGHT];         // 1/w of the nearest occluder, 0 where there is none
+static float occlusion_tile_min[OCCLUSION_TILES_X * OCCLUSION_TILES_Y];   // the farthest pixel of each tile
+static Occlusion_Triangle Array occlusion_triangles = NULL;
+static Occlusion_Band occlusion_bands[OCCLUSION_MAX_THREADS];
+static int occlusion_band_count = 0;
+static SDL_Semaphore* occlusion_done = NULL;
+static SDL_AtomicInt occlusion_quit;
+static mat4 occlusion_view_projection;
+static bool occlusion_valid = false; // the buffer holds the occluders of the last Occlusion_Update
+
+static void Occlusion_RasterizeBand(const Occlusion_Band* band)
+{
+    SDL_memset(&occlusion_depth[band->first_row * OCCLUSION_WIDTH], 0, sizeof(float) * OCCLUSION_WIDTH * (band->end_row - band->first_row));
+
+    for (size_t i = 0; i < Array_Len(occlusion_triangles); i++)
+    {
+        const Occlusion_Triangle* triangle = &occlusion_triangles[i];
+        int y_begin = SDL_max(triangle->min_y, band->first_row);
+        int y_end = SDL_min(triangle->max_y + 1, band->end_row);
+        int x_begin = triangle->min_x & ~3; // 4 pixels at a time; the width is a multiple of 4
+        int x_end = triangle->max_x + 1;
+
+        for (int y = y_begin; y < y_end; y++)
+        {
+            float center_y = (float)y + 0.5f;
+            float* row = &occlusion_depth[y * OCCLUSION_WIDTH];
+            float edge_row[3];
+            for (int ii = 0; ii < 3; ii++)
+            {
+                edge_row[ii] = triangle->edge_b[ii] * center_y + triangle->edge_c[ii];
+            }
+            float depth_row = triangle->depth_b * center_y + triangle->depth_c;
+
+#if defined(__SSE2__)
+            __m128 lane_x = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            __m128 zero = _mm_setzero_ps();
+            for (int x = x_begin; x < x_end; x += 4)
+            {
+                __m128 center_x = _mm_add_ps(_mm_set1_ps((float)x), lane_x);
+                __m128 edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle->edge_a[0]), center_x), _mm_set1_ps(edge_row[0]));
+                __m128 edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle->edge_a[1]), center_x), _mm_set1_ps(edge_row[1]));
+                __m128 edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle->edge_a[2]), center_x), _mm_set1_ps(edge_row[2]));
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+                __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle->depth_a), center_x), _mm_set1_ps(depth_row));
+                __m128 previous = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_max_ps(previous, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+            }
+#elif defined(__ARM_NEON)
+            static const float lane_offsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+            float32x4_t lane_x = vld1q_f32(lane_offsets);
+            float32x4_t zero = vdupq_n_f32(0.0f);
+            for (int x = x_begin; x < x_end; x += 4)
+            {
+                float32x4_t center_x = vaddq_f32(vdupq_n_f32((float)x), lane_x);
+                float32x4_t edge0 = vmlaq_f32(vdupq_n_f32(edge_row[0]), vdupq_n_f32(triangle->edge_a[0]), center_x);
+                float32x4_t edge1 = vmlaq_f32(vdupq_n_f32(edge_row[1]), vdupq_n_f32(triangle->edge_a[1]), center_x);
+                float32x4_t edge2 = vmlaq_f32(vdupq_n_f32(edge_row[2]), vdupq_n_f32(triangle->edge_a[2]), center_x);
+                uint32x4_t inside = vandq_u32(vandq_u32(vcgeq_f32(edge0, zero), vcgeq_f32(edge1, zero)), vcgeq_f32(edge2, zero));
+                float32x4_t depth = vmlaq_f32(vdupq_n_f32(depth_row), vdupq_n_f32(triangle->depth_a), center_x);
+                float32x4_t previous = vld1q_f32(row + x);
+                vst1q_f32(row + x, vbslq_f32(inside, vmaxq_f32(previous, depth), previous));
+            }
+#else
+            for (int x = x_begin; x < x_end; x++)
+            {
+                float center_x = (float)x + 0.5f;
+                if (triangle->edge_a[0] * center_x + edge_row[0] < 0.0f) continue;
+                if (triangle->edge_a[1] * center_x + edge_row[1] < 0.0f) continue;
+                if (triangle->edge_a[2] * center_x + edge_row[2] < 0.0f) continue;
+                row[x] = SDL_max(row[x], triangle->depth_a * center_x + depth_row);
+            }
+#endif
+        }
+    }
+
+    for (int tile_y = band->first_row / OCCLUSION_TILE_SIZE; tile_y < band->end_row / OCCLUSION_TILE_SIZE; tile_y++)
+    {
+        for (int tile_x = 0; tile_x < OCCLUSION_TILES_X; tile_x++)
+        {
+            float farthest = FLT_MAX;
+            for (int y = tile_y * OCCLUSION_TILE_SIZE; y < (tile_y + 1) * OCCLUSION_TILE_SIZE; y++)
+            {
+                const float* row = &occlusion_depth[y * OCCLUSION_WIDTH + tile_x * OCCLUSION_TILE_SIZE];
+                for (int x = 0; x < OCCLUSION_TILE_SIZE; x++)
+                {
+                    farthest = SDL_min(farthest, row[x]);
+                }
+            }
+            occlusion_tile_min[tile_y * OCCLUSION_TILES_X + tile_x] = farthest;
+        }
+    }
+}
+
+static int SDLCALL Occlusion_WorkerThread(void* data)
+{
+    Occlusion_Band* band = data;
+    for (;;)
+    {
+        SDL_WaitSemaphore(band->start);
+        if (SDL_GetAtomicInt(&occlusion_quit)) break;
+        Occlusion_RasterizeBand(band);
+        SDL_SignalSemaphore(occlusion_done);
+    }
+    return 0;
+}
+
+bool Occlusion_Init(void)
+{
+    SDL_SetAtomicInt(&occlusion_quit, 0);
+
+    Array_Init(occlusion_triangles, 1024);
+    occlusion_done = SDL_CreateSemaphore(0);
+    if (occlusion_triangles == NULL || occlusion_done == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize occlusion culling: %s", SDL_GetError());
+        return false;
+    }
+
+    // the calling thread takes the first band; a band whose worker can't be created is rasterized there too
+    occlusion_band_count = SDL_clamp(SDL_GetNumLogicalCPUCores() - 1, 1, OCCLUSION_MAX_THREADS);
+    for (int i = 0; i < occlusion_band_count; i++)
+    {
+        Occlusion_Band* band = &occlusion_bands[i];
+        band->first_row = OCCLUSION_TILES_Y * i / occlusion_band_count * OCCLUSION_TILE_SIZE;
+        band->end_row = OCCLUSION_TILES_Y * (i + 1) / occlusion_band_count * OCCLUSION_TILE_SIZE;
+        if (i == 0) continue;
+
+        band->start = SDL_CreateSemaphore(0);
+        band->thread = band->start ? SDL_CreateThread(Occlusion_WorkerThread, "Occlusion_Worker", band) : NULL;
+        if (band->thread == NULL)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to create occlusion worker: %s", SDL_GetError());
+            if (band->start) SDL_DestroySemaphore(band->start);
+            band->start = NULL;
+        }
+    }
+    return true;
+}
+
+void Occlusion_Quit(void)
+{
+    SDL_SetAtomicInt(&occlusion_quit, 1);
+    for (int i = 0; i < occlusion_band_count; i++)
+    {
+        Occlusion_Band* band = &occlusion_bands[i];
+        if (band->thread == NULL) continue;
+        SDL_SignalSemaphore(band->start);
+        SDL_WaitThread(band->thread, NULL);
+        SDL_DestroySemaphore(band->start);
+        SDL_zerop(band);
+    }
+    occlusion_band_count = 0;
+    if (occlusion_done) SDL_DestroySemaphore(occlusion_done);
+    occlusion_done = NULL;
+    Array_Free(occlusion_triangles);
+    occlusion_triangles = NULL;
+    occlusion_valid = false;
+}
+
+// clip is in clip space with w >= OCCLUSION_NEAR_W at every vertex
+static bool Occlusion_SetupTriangle(vec4 clip0, vec4 clip1, vec4 clip2)
+{
+    float* clip[3] = { clip0, clip1, clip2 };
+    float x[3], y[3], inverse_w[3];
+    for (int i = 0; i < 3; i++)
+    {
+        inverse_w[i] = 1.0f / clip[i][3];
+        x[i] = (clip[i][0] * inverse_w[i] * 0.5f + 0.5f) * (float)OCCLUSION_WIDTH;
+        y[i] = (0.5f - clip[i][1] * inverse_w[i] * 0.5f) * (float)OCCLUSION_HEIGHT;
+    }
+
+    float min_x = SDL_min(x[0], SDL_min(x[1], x[2]));
+    float max_x = SDL_max(x[0], SDL_max(x[1], x[2]));
+    float min_y = SDL_min(y[0], SDL_min(y[1], y[2]));
+    float max_y = SDL_max(y[0], SDL_max(y[1], y[2]));
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= (float)OCCLUSION_WIDTH || min_y >= (float)OCCLUSION_HEIGHT) return true;
+
+    // either winding; occluders are drawn double sided
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (!(SDL_fabsf(area) > 1e-6f)) return true; // also catches NaN
+    if (area < 0.0f)
+    {
+        float swap;
+        swap = x[1]; x[1] = x[2]; x[2] = swap;
+        swap = y[1]; y[1] = y[2]; y[2] = swap;
+        swap = inverse_w[1]; inverse_w[1] = inverse_w[2]; inverse_w[2] = swap;
+        area = -area;
+    }
+
+    Occlusion_Triangle triangle =
+    {
+        .min_x = (int)SDL_max(min_x, 0.0f),
+        .max_x = (int)SDL_min(max_x, (float)(OCCLUSION_WIDTH - 1)),
+        .min_y = (int)SDL_max(min_y, 0.0f),
+        .max_y = (int)SDL_min(max_y, (float)(OCCLUSION_HEIGHT - 1)),
+    };
+
+    // edge i is opposite vertex i, and is area at it; divided by area it is vertex i's barycentric weight
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1) % 3;
+        int k = (i + 2) % 3;
+        triangle.edge_a[i] = y[j] - y[k];
+        triangle.edge_b[i] = x[k] - x[j];
+        triangle.edge_c[i] = (y[k] - y[j]) * x[j] - (x[k] - x[j]) * y[j];
+        triangle.depth_a += inverse_w[i] * triangle.edge_a[i] / area;
+        triangle.depth_b += inverse_w[i] * triangle.edge_b[i] / area;
+        triangle.depth_c += inverse_w[i] * triangle.edge_c[i] / area;
+    }
+
+    return Array_Append(occlusion_triangles, triangle);
+}
+
+// Clips against w >= OCCLUSION_NEAR_W (one plane turns a triangle into at most a quad) and sets up what is left
+static bool Occlusion_AddTriangle(vec4 clip[3])
+{
+    vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        float* current = clip[i];
+        float* next = clip[(i + 1) % 3];
+        bool current_inside = current[3] >= OCCLUSION_NEAR_W;
+        bool next_inside = next[3] >= OCCLUSION_NEAR_W;
+        if (current_inside)
+        {
+            glm_vec4_copy(current, polygon[count++]);
+        }
+        if (current_inside != next_inside)
+        {
+            float t = (OCCLUSION_NEAR_W - current[3]) / (next[3] - current[3]);
+            glm_vec4_lerp(current, next, t, polygon[count++]);
+        }
+    }
+
+    if (count < 3) return true;
+    if (!Occlusion_SetupTriangle(polygon[0], polygon[1], polygon[2])) return false;
+    if (count == 4 && !Occlusion_SetupTriangle(polygon[0], polygon[2], polygon[3])) return false;
+    return true;
+}
+
+// Rasterizes the occluders as seen through view_projection; until the next call, boxes are tested against them
+// false if there was nothing to rasterize, or it failed (then nothing is occluded)
+bool Occlusion_Update(const Occluder* occluders, size_t occluder_count, mat4 view_projection)
+{
+    occlusion_valid = false;
+    if (occlusion_triangles == NULL || occluder_count == 0) return false;
+
+    Array_Len(occlusion_triangles) = 0;
+    for (size_t i = 0; i < occluder_count; i++)
+    {
+        const Tri* tri = &occluders[i].tri;
+        vec4 clip[3];
+        glm_mat4_mulv(view_projection, (vec4){ tri->a[0], tri->a[1], tri->a[2], 1.0f }, clip[0]);
+        glm_mat4_mulv(view_projection, (vec4){ tri->b[0], tri->b[1], tri->b[2], 1.0f }, clip[1]);
+        glm_mat4_mulv(view_projection, (vec4){ tri->c[0], tri->c[1], tri->c[2], 1.0f }, clip[2]);
+        if (!Occlusion_AddTriangle(clip))
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to grow occluder triangles");
+            return false;
+        }
+    }
+
+    int threaded_band_count = 0;
+    for (int i = 0; i < occlusion_band_count; i++)
+    {
+        if (occlusion_bands[i].thread)
+        {
+            SDL_SignalSemaphore(occlusion_bands[i].start);
+            threaded_band_count++;
+        }
+    }
+    for (int i = 0; i < occlusion_band_count; i++)
+    {
+        if (occlusion_bands[i].thread == NULL) Occlusion_RasterizeBand(&occlusion_bands[i]);
+    }
+    for (int i = 0; i < threaded_band_count; i++)
+    {
+        SDL_WaitSemaphore(occlusion_done);
+    }
+
+    glm_mat4_copy(view_projection, occlusion_view_projection);
+    occlusion_valid = true;
+    return true;
+}
+
+// Whether the box is hidden behind the occluders of the last Occlusion_Update; never for a box that reaches behind the camera
+bool Occlusion_IsOccluded(const vec3 aabb_min, const vec3 aabb_max)
+{
+    if (!occlusion_valid) return false;
+
+    float min_x = FLT_MAX, min_y = FLT_MAX;
+    float max_x = -FLT_MAX, max_y = -FLT_MAX;
+    float nearest = 0.0f; // 1/w of the nearest corner
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 corner =
+        {
+            (i & 1) ? aabb_max[0] : aabb_min[0],
+            (i & 2) ? aabb_max[1] : aabb_min[1],
+            (i & 4) ? aabb_max[2] : aabb_min[2],
+            1.0f
+        };
+        vec4 clip;
+        glm_mat4_mulv(occlusion_view_projection, corner, clip);
+        if (clip[3] < OCCLUSION_NEAR_W) return false;
+
+        float inverse_w = 1.0f / clip[3];
+        float x = (clip[0] * inverse_w * 0.5f + 0.5f) * (float)OCCLUSION_WIDTH;
+        float y = (0.5f - clip[1] * inverse_w * 0.5f) * (float)OCCLUSION_HEIGHT;
+        min_x = SDL_min(min_x, x);
+        max_x = SDL_max(max_x, x);
+        min_y = SDL_min(min_y, y);
+        max_y = SDL_max(max_y, y);
+        nearest = SDL_max(nearest, inverse_w);
+    }
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= (float)OCCLUSION_WIDTH || min_y >= (float)OCCLUSION_HEIGHT) return false;
+
+    int pixel_min_x = (int)SDL_max(min_x, 0.0f);
+    int pixel_max_x = (int)SDL_min(max_x, (float)(OCCLUSION_WIDTH - 1));
+    int pixel_min_y = (int)SDL_max(min_y, 0.0f);
+    int pixel_max_y = (int)SDL_min(max_y, (float)(OCCLUSION_HEIGHT - 1));
+
+    for (int tile_y = pixel_min_y / OCCLUSION_TILE_SIZE; tile_y <= pixel_max_y / OCCLUSION_TILE_SIZE; tile_y++)
+    {
+        for (int tile_x = pixel_min_x / OCCLUSION_TILE_SIZE; tile_x <= pixel_max_x / OCCLUSION_TILE_SIZE; tile_x++)
+        {
+            // every pixel of the tile is nearer than the box
+            if (occlusion_tile_min[tile_y * OCCLUSION_TILES_X + tile_x] > nearest) continue;
+
+            // otherwise only the pixels under the box decide
+            int x_begin = SDL_max(pixel_min_x, tile_x * OCCLUSION_TILE_SIZE);
+            int x_end = SDL_min(pixel_max_x, tile_x * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+            int y_begin = SDL_max(pixel_min_y, tile_y * OCCLUSION_TILE_SIZE);
+            int y_end = SDL_min(pixel_max_y, tile_y * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+            for (int y = y_begin; y <= y_end; y++)
+            {
+                for (int x = x_begin; x <= x_end; x++)
+                {
+                    if (occlusion_depth[y * OCCLUSION_WIDTH + x] <= nearest) return false;
+                }
+            }
+        }
+    }
+    return true;
+}
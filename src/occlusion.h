@@ -0,0 +1,37 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "array.h"
+#include "physics.h"
+
+/*
+    CPU occlusion culling
+    the triangles of MODEL_TYPE_OCCLUDER nodes (simplified, invisible stand-ins for big solid geometry) are rasterized
+    into a small 1/w buffer, one band of rows per worker thread, and model bounds are tested against it
+    before anything is recorded, so an occluded model costs neither submission nor GPU time
+    occluders are rasterized at pixel centers and boxes are tested against every pixel they touch; a box is occluded
+    when its nearest corner is behind the farthest occluder under it
+    independent of the GPU: give it triangles and a matrix, ask about boxes
+    main thread only (the workers only run inside Occlusion_Update)
+*/
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_SIZE 8   // rows per band are a multiple of it; each tile keeps its farthest depth
+#define OCCLUSION_MAX_THREADS 4 // including the calling thread
+
+Struct (Occluder)
+{
+    Tri tri;         // world space
+    Uint32 scene_id; // the load it came from (see Loader_RequestScene)
+};
+
+bool Occlusion_Init(void);
+void Occlusion_Quit(void);
+bool Occlusion_Update(const Occluder* occluders, size_t occluder_count, mat4 view_projection);
+bool Occlusion_IsOccluded(const vec3 aabb_min, const vec3 aabb_max);
+
+#endif // OCCLUSION_H
@@ -34,6 +34,7 @@ Struct (Collider)
     Tri tri;
     vec3 aabb[2];
     vec3 normal; // precomputed face normal
+    Uint32 scene_id; // the load it came from (see Loader_RequestScene)
 };
 
 typedef bool (*Trigger_Callback)(void);
@@ -45,6 +46,7 @@ Struct (Trigger)
     vec3 aabb[2];
     Trigger_Callback callback_enter;
     // Trigger_Callback callback_exit;
+    Uint32 scene_id; // the load it came from (see Loader_RequestScene)
 };
 
 Struct (Capsule) 
@@ -35,6 +35,16 @@ bool Pipeline_Init()
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize unanimated PBR pipeline!");
         return false;
     }
+    if (!Pipeline_Prepass_Instanced_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize prepass instanced pipeline!");
+        return false;
+    }
+    if (!Pipeline_Instanced_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize instanced PBR pipeline!");
+        return false;
+    }
     if (!Pipeline_PBR_Animated_Init())
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize bone animated pipeline!");
@@ -60,6 +70,26 @@ bool Pipeline_Init()
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize shadow depth pipeline!");
         return false;
     }
+    if (!Pipeline_ShadowDepth_Instanced_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize instanced shadow depth pipeline!");
+        return false;
+    }
+    if (!Pipeline_ShadowDepth_BoneAnimated_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize bone animated shadow depth pipeline!");
+        return false;
+    }
+    if (!Pipeline_ShadowComposite_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize shadow composite pipeline!");
+        return false;
+    }
+    if (!Pipeline_ShadowClear_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize shadow clear pipeline!");
+        return false;
+    }
     if (!Pipeline_Fog_Init())
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize fog pipeline!");
@@ -97,6 +127,135 @@ bool Pipeline_Init()
         return false;
     }
 #endif
+    if (!Pipeline_Cull_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize cull compute pipeline!");
+        return false;
+    }
+    if (!Pipeline_HiZBuild_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize Hi-Z build compute pipeline!");
+        return false;
+    }
+    if (!Pipeline_ClusterLights_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize light cluster compute pipeline!");
+        return false;
+    }
+    if (!Pipeline_ShadowMoments_Init())
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize shadow moments compute pipeline!");
+        return false;
+    }
+    return true;
+}
+
+// Shader Dependencies ////////////
+
+// Which shaders each live pipeline is built from, so a changed shader only rebuilds the pipelines that use it
+// unlit and blinn-phong are left out: they write pipeline_unanimated too, and PBR (created last) is the one in use
+Struct (Pipeline_Source)
+{
+    bool (*init)(void);
+    const char* shader_filenames[2]; // compute pipelines only have one
+};
+
+static const Pipeline_Source pipeline_sources[] =
+{
+    { Pipeline_Prepass_Unanimated_Init, { "prepass_unanimated.vert", "prepass.frag" } },
+    { Pipeline_SSAO_Init,               { "fullscreen_quad.vert", "ssao.frag" } },
+    { Pipeline_PBR_Unanimated_Init,     { "pbr_unanimated.vert", "pbr_alphatest.frag" } },
+    { Pipeline_Prepass_Instanced_Init,  { "prepass_instanced.vert", "prepass.frag" } },
+    { Pipeline_Instanced_Init,          { "pbr_instanced.vert", "pbr_alphatest.frag" } },
+    { Pipeline_PBR_Animated_Init,       { "pbr_animated.vert", "pbr_alphatest.frag" } },
+    { Pipeline_Text_Init,               { "text.vert", "text.frag" } },
+    { Pipeline_Swapchain_Init,          { "fullscreen_quad.vert", "swapchain.frag" } },
+    { Pipeline_Sprite_Init,             { "sprite.vert", "unlit_alphatest.frag" } },
+    { Pipeline_ShadowDepth_Init,        { "shadow_unanimated.vert", "shadow.frag" } },
+    { Pipeline_ShadowDepth_Instanced_Init, { "shadow_instanced.vert", "shadow.frag" } },
+    { Pipeline_ShadowDepth_BoneAnimated_Init, { "shadow_animated.vert", "shadow.frag" } },
+    { Pipeline_ShadowComposite_Init,    { "fullscreen_quad.vert", "shadow_composite.frag" } },
+    { Pipeline_ShadowClear_Init,        { "fullscreen_quad.vert", "shadow_clear.frag" } },
+    { Pipeline_Fog_Init,                { "fullscreen_quad.vert", "fog.frag" } },
+    { Pipeline_PrepassDownsample_Init,  { "prepass_downsample.comp" } },
+    { Pipeline_SSAOUpsample_Init,       { "ssao_upsample.comp" } },
+    { Pipeline_GaussianBlur_Init,       { "gaussian_blur.comp" } },
+    { Pipeline_Bloom_Threshold_Init,    { "bloom_threshold.comp" } },
+#if DUAL_KAWASE_BLOOM
+    { Pipeline_Bloom_Downsample_Init,   { "bloom_downsample.comp" } },
+    { Pipeline_Bloom_Upsample_Init,     { "bloom_upsample.comp" } },
+#endif
+    { Pipeline_Cull_Init,               { "cull.comp" } },
+    { Pipeline_HiZBuild_Init,           { "hiz_build.comp" } },
+    { Pipeline_ClusterLights_Init,      { "cluster_lights.comp" } },
+    { Pipeline_ShadowMoments_Init,      { "shadow_moments.comp" } },
+};
+
+// Rebuilds every pipeline that uses shader_filename (e.g. "fog.frag"); everything else stays as it is
+// the inits only replace their pipeline once the new one is created, so a shader that fails to load or link keeps the old one
+bool Pipeline_ReloadShader(const char* shader_filename)
+{
+    bool success = true;
+    int reloaded = 0;
+    for (size_t i = 0; i < SDL_arraysize(pipeline_sources); i++)
+    {
+        const Pipeline_Source* source = &pipeline_sources[i];
+        bool uses_shader = false;
+        for (int ii = 0; ii < 2; ii++)
+        {
+            if (source->shader_filenames[ii] && SDL_strcmp(source->shader_filenames[ii], shader_filename) == 0)
+                uses_shader = true;
+        }
+        if (!uses_shader) continue;
+
+        if (!source->init())
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to rebuild pipeline %zu after %s changed", i, shader_filename);
+            success = false;
+        }
+        reloaded++;
+    }
+    SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Reloaded %s: %d pipeline(s) rebuilt", shader_filename, reloaded);
+    return success;
+}
+
+// Writes the unique shader file names of every pipeline to shader_filenames; returns how many there are
+int Pipeline_GetShaderFilenames(const char** shader_filenames, int max_count)
+{
+    int count = 0;
+    for (size_t i = 0; i < SDL_arraysize(pipeline_sources); i++)
+    {
+        for (int ii = 0; ii < 2; ii++)
+        {
+            const char* shader_filename = pipeline_sources[i].shader_filenames[ii];
+            if (shader_filename == NULL) continue;
+
+            bool is_duplicate = false;
+            for (int iii = 0; iii < count && iii < max_count; iii++)
+            {
+                if (SDL_strcmp(shader_filenames[iii], shader_filename) == 0) is_duplicate = true;
+            }
+            if (is_duplicate) continue;
+
+            if (count < max_count) shader_filenames[count] = shader_filename;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Path of the compiled shader for this device's backend (the same file Shader_Load reads)
+bool Pipeline_GetShaderPath(const char* shader_filename, char* path, size_t path_size)
+{
+    SDL_GPUShaderFormat supported_shader_formats = SDL_GetGPUShaderFormats(gpu_device);
+    if (supported_shader_formats & SDL_GPU_SHADERFORMAT_SPIRV) 
+        SDL_snprintf(path, path_size, "%sshaders/%s.spv", base_path, shader_filename);
+    else if (supported_shader_formats & SDL_GPU_SHADERFORMAT_MSL) 
+        SDL_snprintf(path, path_size, "%sshaders/%s.msl", base_path, shader_filename);
+    else if (supported_shader_formats & SDL_GPU_SHADERFORMAT_DXIL) 
+        SDL_snprintf(path, path_size, "%sshaders/%s.dxil", base_path, shader_filename);
+    else
+        return false;
     return true;
 }
 
@@ -121,6 +280,7 @@ bool Pipeline_Prepass_Unanimated_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -169,36 +329,29 @@ bool Pipeline_Prepass_Unanimated_Init()
                 {
                     .slot = 0,
                     .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                    .pitch = sizeof(Vertex_PBR) // MUST MATCH LOADED VERTEX DATA
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
                 }
             },  
-            .num_vertex_attributes = 4,
+            .num_vertex_attributes = 3,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {
-                {   // position: TEXCOORD0
+                {   // position + handedness: TEXCOORD0
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = VERTEX_POSITION_FORMAT,
                     .location = 0,
-                    .offset = offsetof(Vertex_PBR, x)
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
                 },
-                {   // normal: TEXCOORD1
+                {   // octahedral normal + tangent: TEXCOORD1
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
                     .location = 1,
-                    .offset = offsetof(Vertex_PBR, nx)
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
                 },
                 {   // texture coordinate: TEXCOORD2
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
                     .location = 2,
-                    .offset = offsetof(Vertex_PBR, u)
-                },
-                {
-                    // tangent: TEXCOORD3
-                    .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-                    .location = 3,
-                    .offset = offsetof(Vertex_PBR, tx)
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
                 }
             }
         },
@@ -207,20 +360,132 @@ bool Pipeline_Prepass_Unanimated_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_prepass_unanimated)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
+    }
+    if (pipeline_prepass_unanimated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_prepass_unanimated);
+    pipeline_prepass_unanimated = pipeline;
+
+    return true;
+}
+
+// same state as the unanimated pipeline; only the vertex shader differs (instances come from a storage buffer)
+bool Pipeline_Prepass_Instanced_Init()
+{
+    SDL_GPUShader* vertex_shader = Shader_Load
+    (
+        gpu_device,
+        "prepass_instanced.vert"
+    );
+    if (vertex_shader == NULL)
     {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_prepass_unanimated);
-        pipeline_prepass_unanimated = NULL;
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load vertex shader!");
+        return false;
     }
-    pipeline_prepass_unanimated = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_prepass_unanimated == NULL)
+
+    SDL_GPUShader* fragment_shader = Shader_Load
+    (
+        gpu_device,
+        "prepass.frag"
+    );
+    if (fragment_shader == NULL)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_create_info =
+    {
+        .target_info =
+        {
+            .num_color_targets = 1,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R16G16B16A16_FLOAT,
+                .blend_state = (SDL_GPUColorTargetBlendState)
+                {
+                    .enable_blend = false,
+                    // .color_blend_op = SDL_GPU_BLENDOP_ADD,
+                    // .src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                    // .dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                    // .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+                    // .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                    // .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                    // .color_write_mask = SDL_GPU_COLORCOMPONENT_R | SDL_GPU_COLORCOMPONENT_G | SDL_GPU_COLORCOMPONENT_B | SDL_GPU_COLORCOMPONENT_A,
+                    .enable_color_write_mask = false
+                }
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = depth_sample_texture_format
+        },
+        .depth_stencil_state = (SDL_GPUDepthStencilState)
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .enable_stencil_test = false,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state = (SDL_GPURasterizerState)
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK,
+            .fill_mode = SDL_GPU_FILLMODE_FILL,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE
+        },
+        .vertex_input_state = (SDL_GPUVertexInputState)
+        {
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {
+                {
+                    .slot = 0,
+                    .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
+                }
+            },  
+            .num_vertex_attributes = 3,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {
+                {   // position + handedness: TEXCOORD0
+                    .buffer_slot = 0,
+                    .format = VERTEX_POSITION_FORMAT,
+                    .location = 0,
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
+                },
+                {   // octahedral normal + tangent: TEXCOORD1
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+                    .location = 1,
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
+                },
+                {   // texture coordinate: TEXCOORD2
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
+                    .location = 2,
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
+                }
+            }
+        },
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
+    };
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
     SDL_ReleaseGPUShader(gpu_device, vertex_shader);
     SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
+    }
+    if (pipeline_prepass_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_prepass_instanced);
+    pipeline_prepass_instanced = pipeline;
 
     return true;
 }
@@ -245,6 +510,7 @@ bool Pipeline_SSAO_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -283,20 +549,16 @@ bool Pipeline_SSAO_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
     };
-    if (pipeline_ssao)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_ssao);
-        pipeline_ssao = NULL;
-    }
-    pipeline_ssao = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_ssao == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_ssao) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_ssao);
+    pipeline_ssao = pipeline;
 
     return true;
 }
@@ -322,6 +584,7 @@ bool Pipeline_Unlit_Unanimated_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -395,20 +658,16 @@ bool Pipeline_Unlit_Unanimated_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_unanimated)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
-        pipeline_unanimated = NULL;
-    }
-    pipeline_unanimated = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_unanimated == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_unanimated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
+    pipeline_unanimated = pipeline;
 
     return true;
 }
@@ -434,6 +693,7 @@ bool Pipeline_BlinnPhong_Unanimated_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -482,36 +742,29 @@ bool Pipeline_BlinnPhong_Unanimated_Init()
                 {
                     .slot = 0,
                     .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                    .pitch = sizeof(Vertex_PBR) // MUST MATCH LOADED VERTEX DATA
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
                 }
             },  
-            .num_vertex_attributes = 4,
+            .num_vertex_attributes = 3,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {
-                {   // position: TEXCOORD0
+                {   // position + handedness: TEXCOORD0
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = VERTEX_POSITION_FORMAT,
                     .location = 0,
-                    .offset = offsetof(Vertex_PBR, x)
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
                 },
-                {   // normal: TEXCOORD1
+                {   // octahedral normal + tangent: TEXCOORD1
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
                     .location = 1,
-                    .offset = offsetof(Vertex_PBR, nx)
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
                 },
                 {   // texture coordinate: TEXCOORD2
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
                     .location = 2,
-                    .offset = offsetof(Vertex_PBR, u)
-                },
-                {
-                    // tangent: TEXCOORD3
-                    .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-                    .location = 3,
-                    .offset = offsetof(Vertex_PBR, tx)
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
                 }
             }
         },
@@ -520,20 +773,16 @@ bool Pipeline_BlinnPhong_Unanimated_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_unanimated)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
-        pipeline_unanimated = NULL;
-    }
-    pipeline_unanimated = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_unanimated == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_unanimated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
+    pipeline_unanimated = pipeline;
 
     return true;
 }
@@ -559,6 +808,7 @@ bool Pipeline_PBR_Unanimated_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -607,36 +857,29 @@ bool Pipeline_PBR_Unanimated_Init()
                 {
                     .slot = 0,
                     .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                    .pitch = sizeof(Vertex_PBR) // MUST MATCH LOADED VERTEX DATA
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
                 }
             },  
-            .num_vertex_attributes = 4,
+            .num_vertex_attributes = 3,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {
-                {   // position: TEXCOORD0
+                {   // position + handedness: TEXCOORD0
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = VERTEX_POSITION_FORMAT,
                     .location = 0,
-                    .offset = offsetof(Vertex_PBR, x)
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
                 },
-                {   // normal: TEXCOORD1
+                {   // octahedral normal + tangent: TEXCOORD1
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
                     .location = 1,
-                    .offset = offsetof(Vertex_PBR, nx)
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
                 },
                 {   // texture coordinate: TEXCOORD2
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
                     .location = 2,
-                    .offset = offsetof(Vertex_PBR, u)
-                },
-                {
-                    // tangent: TEXCOORD3
-                    .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-                    .location = 3,
-                    .offset = offsetof(Vertex_PBR, tx)
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
                 }
             }
         },
@@ -645,30 +888,27 @@ bool Pipeline_PBR_Unanimated_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_unanimated)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
-        pipeline_unanimated = NULL;
-    }
-    pipeline_unanimated = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_unanimated == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_unanimated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_unanimated);
+    pipeline_unanimated = pipeline;
 
     return true;
 }
 
-bool Pipeline_PBR_Animated_Init()
+// same state as the unanimated PBR pipeline; only the vertex shader differs (instances come from a storage buffer)
+bool Pipeline_Instanced_Init()
 {
     SDL_GPUShader* vertex_shader = Shader_Load
     (
         gpu_device,
-        "pbr_animated.vert"
+        "pbr_instanced.vert"
     );
     if (vertex_shader == NULL)
     {
@@ -684,6 +924,7 @@ bool Pipeline_PBR_Animated_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -732,48 +973,29 @@ bool Pipeline_PBR_Animated_Init()
                 {
                     .slot = 0,
                     .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                    .pitch = sizeof(Vertex_BoneAnimated) // MUST MATCH LOADED VERTEX DATA
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
                 }
             },  
-            .num_vertex_attributes = 6,
+            .num_vertex_attributes = 3,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {
-                {   // position
-                    .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                    .location = 0, // TEXCOORD0 in HLSL
-                    .offset = offsetof(Vertex_BoneAnimated, x)
-                },
-                {   // normal
-                    .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                    .location = 1, // TEXCOORD1 in HLSL
-                    .offset = offsetof(Vertex_BoneAnimated, nx)
-                },
-                {   // texture coordinate
-                    .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-                    .location = 2, // TEXCOORD2 in HLSL
-                    .offset = offsetof(Vertex_BoneAnimated, u)
-                },
-                {
-                    // tangent: TEXCOORD3
+                {   // position + handedness: TEXCOORD0
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-                    .location = 3,
-                    .offset = offsetof(Vertex_BoneAnimated, tx)
+                    .format = VERTEX_POSITION_FORMAT,
+                    .location = 0,
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
                 },
-                {   // joint IDs
+                {   // octahedral normal + tangent: TEXCOORD1
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT, // in the shader this is interpreted as Uint8[4]
-                    .location = 4, // TEXCOORD4 in HLSL
-                    .offset = offsetof(Vertex_BoneAnimated, joint_ids)
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+                    .location = 1,
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
                 },
-                {   // joint weights
+                {   // texture coordinate: TEXCOORD2
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, // vec4 Float32
-                    .location = 5, // TEXCOORD5 in HLSL
-                    .offset = offsetof(Vertex_BoneAnimated, weights)
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
+                    .location = 2,
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
                 }
             }
         },
@@ -782,42 +1004,26 @@ bool Pipeline_PBR_Animated_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_bone_animated)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_bone_animated);
-        pipeline_bone_animated = NULL;
-    }
-    pipeline_bone_animated = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_bone_animated == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_instanced);
+    pipeline_instanced = pipeline;
 
     return true;
 }
 
-// bool Pipeline_RigidAnimated_Init()
-// {
-//     // TODO
-//     return false;
-// }
-
-// bool Pipeline_Instanced_Init()
-// {
-//     // TODO
-//     return false;
-// }
-
-bool Pipeline_Text_Init()
+bool Pipeline_PBR_Animated_Init()
 {
     SDL_GPUShader* vertex_shader = Shader_Load
     (
         gpu_device,
-        "text.vert"
+        "pbr_animated.vert"
     );
     if (vertex_shader == NULL)
     {
@@ -828,11 +1034,12 @@ bool Pipeline_Text_Init()
     SDL_GPUShader* fragment_shader = Shader_Load
     (
         gpu_device,
-        "text.frag"
+        "pbr_alphatest.frag"
     );
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -851,7 +1058,140 @@ bool Pipeline_Text_Init()
                     .src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
                     .dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
                     .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
-                    .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+                    .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                    .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                    .color_write_mask = SDL_GPU_COLORCOMPONENT_R | SDL_GPU_COLORCOMPONENT_G | SDL_GPU_COLORCOMPONENT_B | SDL_GPU_COLORCOMPONENT_A,
+                    .enable_color_write_mask = true
+                }
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = depth_texture_format
+        },
+        .depth_stencil_state = (SDL_GPUDepthStencilState)
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = false,
+            .enable_stencil_test = false,
+            .compare_op = SDL_GPU_COMPAREOP_EQUAL,
+        },
+        .rasterizer_state = (SDL_GPURasterizerState)
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK,
+            .fill_mode = SDL_GPU_FILLMODE_FILL,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE
+        },
+        .vertex_input_state = (SDL_GPUVertexInputState)
+        {
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {
+                {
+                    .slot = 0,
+                    .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                    .pitch = sizeof(Vertex_BoneAnimated_Quantized) // MUST MATCH LOADED VERTEX DATA
+                }
+            },  
+            .num_vertex_attributes = 5,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {
+                {   // position + handedness
+                    .buffer_slot = 0,
+                    .format = VERTEX_POSITION_FORMAT,
+                    .location = 0, // TEXCOORD0 in HLSL
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, position)
+                },
+                {   // octahedral normal + tangent
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+                    .location = 1, // TEXCOORD1 in HLSL
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, normal_tangent)
+                },
+                {   // texture coordinate
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
+                    .location = 2, // TEXCOORD2 in HLSL
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, uv)
+                },
+                {
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT, // in the shader this is interpreted as Uint8[4]
+                    .location = 3, // TEXCOORD3 in HLSL
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, joint_ids)
+                },
+                {
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_UBYTE4_NORM, // unorm8 weights
+                    .location = 4, // TEXCOORD4 in HLSL
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, weights)
+                }
+            }
+        },
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
+    };
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
+    }
+    if (pipeline_bone_animated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_bone_animated);
+    pipeline_bone_animated = pipeline;
+
+    return true;
+}
+
+// bool Pipeline_RigidAnimated_Init()
+// {
+//     // TODO
+//     return false;
+// }
+
+bool Pipeline_Text_Init()
+{
+    SDL_GPUShader* vertex_shader = Shader_Load
+    (
+        gpu_device,
+        "text.vert"
+    );
+    if (vertex_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load vertex shader!");
+        return false;
+    }
+
+    SDL_GPUShader* fragment_shader = Shader_Load
+    (
+        gpu_device,
+        "text.frag"
+    );
+    if (fragment_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+        return false;
+    }
+
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_create_info =
+    {
+        .target_info =
+        {
+            .num_color_targets = 1,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R16G16B16A16_FLOAT,
+                .blend_state = (SDL_GPUColorTargetBlendState)
+                {
+                    .enable_blend = true,
+                    .color_blend_op = SDL_GPU_BLENDOP_ADD,
+                    .src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                    .dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                    .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+                    .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
                     .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
                     .color_write_mask = SDL_GPU_COLORCOMPONENT_R | SDL_GPU_COLORCOMPONENT_G | SDL_GPU_COLORCOMPONENT_B | SDL_GPU_COLORCOMPONENT_A,
                     .enable_color_write_mask = true
@@ -906,20 +1246,16 @@ bool Pipeline_Text_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_text)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_text);
-        pipeline_text = NULL;
-    }
-    pipeline_text = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_text == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_text) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_text);
+    pipeline_text = pipeline;
 
     return true;
 }
@@ -946,6 +1282,7 @@ bool Pipeline_Swapchain_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -983,20 +1320,16 @@ bool Pipeline_Swapchain_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
     };
-    if (pipeline_swapchain)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_swapchain);
-        pipeline_swapchain = NULL;
-    }
-    pipeline_swapchain = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_swapchain == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_swapchain) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_swapchain);
+    pipeline_swapchain = pipeline;
 
     return true;
 }
@@ -1022,6 +1355,7 @@ bool Pipeline_Sprite_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -1067,30 +1401,132 @@ bool Pipeline_Sprite_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = msaa_level }
     };
-    if (pipeline_sprite)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_sprite);
-        pipeline_sprite = NULL;
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
     }
-    pipeline_sprite = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_sprite == NULL)
+    if (pipeline_sprite) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_sprite);
+    pipeline_sprite = pipeline;
+
+    return true;
+}
+
+bool Pipeline_ShadowDepth_Init()
+{
+    SDL_GPUShader* vertex_shader = Shader_Load
+    (
+        gpu_device,
+        "shadow_unanimated.vert"
+    );
+    if (vertex_shader == NULL)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load vertex shader!");
         return false;
     }
 
+    // TODO fragment shader cannot be NULL, need to create a minimal shader that matches the input of the vertex shader
+    SDL_GPUShader* fragment_shader = Shader_Load
+    (
+        gpu_device,
+        "shadow.frag"
+    );
+    if (fragment_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+        return false;
+    }
+
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_create_info =
+    {
+        .target_info =
+        {
+            .num_color_targets = 0,
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = depth_sample_texture_format
+        },
+        .depth_stencil_state = (SDL_GPUDepthStencilState)
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .enable_stencil_test = false,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state = (SDL_GPURasterizerState)
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK, // TODO consider front face culling for shadow maps if peter panning becomes an issue
+            .fill_mode = SDL_GPU_FILLMODE_FILL,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE,
+            .depth_bias_constant_factor = 0.0f, // 1.25f,
+            .depth_bias_clamp = 0.0f,
+            .depth_bias_slope_factor = 1.75f,
+            .enable_depth_bias = true,
+            .enable_depth_clip = false // casters in front of the light's near plane are clamped onto it (see Model_UpdateVisibility)
+        },
+        .vertex_input_state = (SDL_GPUVertexInputState)
+        {
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {
+                {
+                    .slot = 0,
+                    .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
+                }
+            },  
+            .num_vertex_attributes = 3,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {
+                {   // position + handedness: TEXCOORD0
+                    .buffer_slot = 0,
+                    .format = VERTEX_POSITION_FORMAT,
+                    .location = 0,
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
+                },
+                {   // octahedral normal + tangent: TEXCOORD1
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+                    .location = 1,
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
+                },
+                {   // texture coordinate: TEXCOORD2
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
+                    .location = 2,
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
+                }
+            }
+        },
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
+    };
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
     SDL_ReleaseGPUShader(gpu_device, vertex_shader);
     SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
+    }
+    if (pipeline_shadow_depth) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_depth);
+    pipeline_shadow_depth = pipeline;
 
     return true;
 }
 
-bool Pipeline_ShadowDepth_Init()
+// same state as the unanimated shadow pipeline; only the vertex shader differs (instances come from a storage buffer)
+bool Pipeline_ShadowDepth_Instanced_Init()
 {
     SDL_GPUShader* vertex_shader = Shader_Load
     (
         gpu_device,
-        "shadow_unanimated.vert"
+        "shadow_instanced.vert"
     );
     if (vertex_shader == NULL)
     {
@@ -1107,6 +1543,7 @@ bool Pipeline_ShadowDepth_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -1134,7 +1571,7 @@ bool Pipeline_ShadowDepth_Init()
             .depth_bias_clamp = 0.0f,
             .depth_bias_slope_factor = 1.75f,
             .enable_depth_bias = true,
-            .enable_depth_clip = true
+            .enable_depth_clip = false // casters in front of the light's near plane are clamped onto it (see Model_UpdateVisibility)
         },
         .vertex_input_state = (SDL_GPUVertexInputState)
         {
@@ -1144,36 +1581,146 @@ bool Pipeline_ShadowDepth_Init()
                 {
                     .slot = 0,
                     .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                    .pitch = sizeof(Vertex_PBR) // MUST MATCH LOADED VERTEX DATA
+                    .pitch = sizeof(Vertex_PBR_Quantized) // MUST MATCH LOADED VERTEX DATA
                 }
             },  
-            .num_vertex_attributes = 4,
+            .num_vertex_attributes = 3,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {
-                {   // position: TEXCOORD0
+                {   // position + handedness: TEXCOORD0
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = VERTEX_POSITION_FORMAT,
                     .location = 0,
-                    .offset = offsetof(Vertex_PBR, x)
+                    .offset = offsetof(Vertex_PBR_Quantized, position)
                 },
-                {   // normal: TEXCOORD1
+                {   // octahedral normal + tangent: TEXCOORD1
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
                     .location = 1,
-                    .offset = offsetof(Vertex_PBR, nx)
+                    .offset = offsetof(Vertex_PBR_Quantized, normal_tangent)
                 },
                 {   // texture coordinate: TEXCOORD2
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
                     .location = 2,
-                    .offset = offsetof(Vertex_PBR, u)
-                },
+                    .offset = offsetof(Vertex_PBR_Quantized, uv)
+                }
+            }
+        },
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
+    };
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
+    }
+    if (pipeline_shadow_depth_instanced) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_depth_instanced);
+    pipeline_shadow_depth_instanced = pipeline;
+
+    return true;
+}
+
+// same state as the unanimated shadow pipeline; the vertex shader skins like pbr_animated.vert
+bool Pipeline_ShadowDepth_BoneAnimated_Init()
+{
+    SDL_GPUShader* vertex_shader = Shader_Load
+    (
+        gpu_device,
+        "shadow_animated.vert"
+    );
+    if (vertex_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load vertex shader!");
+        return false;
+    }
+
+    SDL_GPUShader* fragment_shader = Shader_Load
+    (
+        gpu_device,
+        "shadow.frag"
+    );
+    if (fragment_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+        return false;
+    }
+
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_create_info =
+    {
+        .target_info =
+        {
+            .num_color_targets = 0,
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = depth_sample_texture_format
+        },
+        .depth_stencil_state = (SDL_GPUDepthStencilState)
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .enable_stencil_test = false,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state = (SDL_GPURasterizerState)
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK,
+            .fill_mode = SDL_GPU_FILLMODE_FILL,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE,
+            .depth_bias_constant_factor = 0.0f,
+            .depth_bias_clamp = 0.0f,
+            .depth_bias_slope_factor = 1.75f,
+            .enable_depth_bias = true,
+            .enable_depth_clip = false // casters in front of the light's near plane are clamped onto it (see Model_UpdateVisibility)
+        },
+        .vertex_input_state = (SDL_GPUVertexInputState)
+        {
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {
                 {
-                    // tangent: TEXCOORD3
+                    .slot = 0,
+                    .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                    .pitch = sizeof(Vertex_BoneAnimated_Quantized) // MUST MATCH LOADED VERTEX DATA
+                }
+            },  
+            .num_vertex_attributes = 5,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {
+                {   // position + handedness: TEXCOORD0
                     .buffer_slot = 0,
-                    .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
+                    .format = VERTEX_POSITION_FORMAT,
+                    .location = 0,
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, position)
+                },
+                {   // octahedral normal + tangent: TEXCOORD1
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+                    .location = 1,
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, normal_tangent)
+                },
+                {   // texture coordinate: TEXCOORD2
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_HALF2,
+                    .location = 2,
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, uv)
+                },
+                {   // joint indices: TEXCOORD3
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT, // in the shader this is interpreted as Uint8[4]
                     .location = 3,
-                    .offset = offsetof(Vertex_PBR, tx)
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, joint_ids)
+                },
+                {   // joint weights: TEXCOORD4
+                    .buffer_slot = 0,
+                    .format = SDL_GPU_VERTEXELEMENTFORMAT_UBYTE4_NORM,
+                    .location = 4,
+                    .offset = offsetof(Vertex_BoneAnimated_Quantized, weights)
                 }
             }
         },
@@ -1182,19 +1729,146 @@ bool Pipeline_ShadowDepth_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
     };
-    if (pipeline_shadow_depth)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_depth);
-        pipeline_shadow_depth = NULL;
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
     }
-    pipeline_shadow_depth = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_shadow_depth == NULL)
+    if (pipeline_shadow_depth_bone_animated) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_depth_bone_animated);
+    pipeline_shadow_depth_bone_animated = pipeline;
+
+    return true;
+}
+
+// writes a cascade's cached static layer into its tile of the shadow atlas as is (see lights.h)
+bool Pipeline_ShadowComposite_Init()
+{
+    SDL_GPUShader* vertex_shader = Shader_Load
+    (
+        gpu_device,
+        "fullscreen_quad.vert"
+    );
+    if (vertex_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load vertex shader!");
+        return false;
+    }
+    SDL_GPUShader* fragment_shader = Shader_Load
+    (
+        gpu_device,
+        "shadow_composite.frag"
+    );
+    if (fragment_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+        return false;
+    }
+
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_create_info =
+    {
+        .target_info =
+        {
+            .num_color_targets = 0,
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = depth_sample_texture_format
+        },
+        .depth_stencil_state = (SDL_GPUDepthStencilState)
+        {
+            .enable_depth_test = true, // depth writes need the test enabled
+            .enable_depth_write = true,
+            .enable_stencil_test = false,
+            .compare_op = SDL_GPU_COMPAREOP_ALWAYS,
+        },
+        .rasterizer_state = (SDL_GPURasterizerState)
+        {
+            .cull_mode = SDL_GPU_CULLMODE_NONE,
+            .fill_mode = SDL_GPU_FILLMODE_FILL,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE
+        },
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
+    };
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
+    if (pipeline_shadow_composite) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_composite);
+    pipeline_shadow_composite = pipeline;
+
+    return true;
+}
 
+// clears one tile of the spot shadow atlas to the far plane; the load op can only clear all of them
+bool Pipeline_ShadowClear_Init()
+{
+    SDL_GPUShader* vertex_shader = Shader_Load
+    (
+        gpu_device,
+        "fullscreen_quad.vert"
+    );
+    if (vertex_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load vertex shader!");
+        return false;
+    }
+    SDL_GPUShader* fragment_shader = Shader_Load
+    (
+        gpu_device,
+        "shadow_clear.frag"
+    );
+    if (fragment_shader == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+        return false;
+    }
+
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_create_info =
+    {
+        .target_info =
+        {
+            .num_color_targets = 0,
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = depth_sample_texture_format
+        },
+        .depth_stencil_state = (SDL_GPUDepthStencilState)
+        {
+            .enable_depth_test = true, // depth writes need the test enabled
+            .enable_depth_write = true,
+            .enable_stencil_test = false,
+            .compare_op = SDL_GPU_COMPAREOP_ALWAYS,
+        },
+        .rasterizer_state = (SDL_GPURasterizerState)
+        {
+            .cull_mode = SDL_GPU_CULLMODE_NONE,
+            .fill_mode = SDL_GPU_FILLMODE_FILL,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE
+        },
+        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
+    };
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
     SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
+        return false;
+    }
+    if (pipeline_shadow_clear) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_shadow_clear);
+    pipeline_shadow_clear = pipeline;
 
     return true;
 }
@@ -1219,6 +1893,7 @@ bool Pipeline_Fog_Init()
     if (fragment_shader == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to load fragment shader!");
+        SDL_ReleaseGPUShader(gpu_device, vertex_shader);
         return false;
     }
 
@@ -1257,135 +1932,177 @@ bool Pipeline_Fog_Init()
         .fragment_shader = fragment_shader,
         .multisample_state = (SDL_GPUMultisampleState) { .sample_count = SDL_GPU_SAMPLECOUNT_1 }
     };
-    if (pipeline_fog)
-    {
-        SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_fog);
-        pipeline_fog = NULL;
-    }
-    pipeline_fog = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
-    if (pipeline_fog == NULL)
+    SDL_GPUGraphicsPipeline* pipeline = SDL_CreateGPUGraphicsPipeline(gpu_device, &pipeline_create_info);
+    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
+    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline: %s", SDL_GetError());
         return false;
     }
-
-    SDL_ReleaseGPUShader(gpu_device, vertex_shader);
-    SDL_ReleaseGPUShader(gpu_device, fragment_shader);
+    if (pipeline_fog) SDL_ReleaseGPUGraphicsPipeline(gpu_device, pipeline_fog);
+    pipeline_fog = pipeline;
 
     return true;
 }
 
 bool Pipeline_PrepassDownsample_Init()
 {
-    if (pipeline_prepass_downsample)
-    {
-        SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_prepass_downsample);
-        pipeline_prepass_downsample = NULL;
-    }
-    pipeline_prepass_downsample = Pipeline_Compute_Init
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
     (
-        gpu_device,"prepass_downsample.comp"
+        gpu_device, "prepass_downsample.comp"
     );
-    if (pipeline_prepass_downsample == NULL)
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize prepass downsample compute pipeline!");
         return false;
     }
+    if (pipeline_prepass_downsample) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_prepass_downsample);
+    pipeline_prepass_downsample = pipeline;
     return true;
 }
 
 bool Pipeline_SSAOUpsample_Init()
 {
-    if (pipeline_ssao_upsample)
-    {
-        SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_ssao_upsample);
-        pipeline_ssao_upsample = NULL;
-    }
-    pipeline_ssao_upsample = Pipeline_Compute_Init
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
     (
-        gpu_device,"ssao_upsample.comp"
+        gpu_device, "ssao_upsample.comp"
     );
-    if (pipeline_ssao_upsample == NULL)
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize SSAO upsample compute pipeline!");
         return false;
     }
+    if (pipeline_ssao_upsample) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_ssao_upsample);
+    pipeline_ssao_upsample = pipeline;
     return true;
 }
 
 bool Pipeline_GaussianBlur_Init()
 {
-    if (pipeline_gaussian_blur)
-    {
-        SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_gaussian_blur);
-        pipeline_gaussian_blur = NULL;
-    }
-    pipeline_gaussian_blur = Pipeline_Compute_Init
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
     (
-        gpu_device,"gaussian_blur.comp"
+        gpu_device, "gaussian_blur.comp"
     );
-    if (pipeline_gaussian_blur == NULL)
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize gaussian blur compute pipeline!");
         return false;
     }
+    if (pipeline_gaussian_blur) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_gaussian_blur);
+    pipeline_gaussian_blur = pipeline;
     return true;
 }
 
 bool Pipeline_Bloom_Threshold_Init()
 {
-    if (pipeline_bloom_threshold)
-    {
-        SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_bloom_threshold);
-        pipeline_bloom_threshold = NULL;
-    }
-    pipeline_bloom_threshold = Pipeline_Compute_Init
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
     (
-        gpu_device,"bloom_threshold.comp"
+        gpu_device, "bloom_threshold.comp"
     );
-    if (pipeline_bloom_threshold == NULL)
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize bloom threshold compute pipeline!");
         return false;
     }
+    if (pipeline_bloom_threshold) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_bloom_threshold);
+    pipeline_bloom_threshold = pipeline;
     return true;
 }
 
 bool Pipeline_Bloom_Downsample_Init()
 {
-    if (pipeline_bloom_downsample)
-    {
-        SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_bloom_downsample);
-        pipeline_bloom_downsample = NULL;
-    }
-    pipeline_bloom_downsample = Pipeline_Compute_Init
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
     (
-        gpu_device,"bloom_downsample.comp"
+        gpu_device, "bloom_downsample.comp"
     );
-    if (pipeline_bloom_downsample == NULL)
+    if (pipeline == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize bloom downsample compute pipeline!");
         return false;
     }
+    if (pipeline_bloom_downsample) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_bloom_downsample);
+    pipeline_bloom_downsample = pipeline;
     return true;
 }
 
 bool Pipeline_Bloom_Upsample_Init()
 {
-    if (pipeline_bloom_upsample)
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
+    (
+        gpu_device, "bloom_upsample.comp"
+    );
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize bloom upsample compute pipeline!");
+        return false;
+    }
+    if (pipeline_bloom_upsample) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_bloom_upsample);
+    pipeline_bloom_upsample = pipeline;
+    return true;
+}
+
+bool Pipeline_Cull_Init()
+{
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
+    (
+        gpu_device, "cull.comp"
+    );
+    if (pipeline == NULL)
     {
-        SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_bloom_upsample);
-        pipeline_bloom_upsample = NULL;
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize cull compute pipeline!");
+        return false;
     }
-    pipeline_bloom_upsample = Pipeline_Compute_Init
+    if (pipeline_cull) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_cull);
+    pipeline_cull = pipeline;
+    return true;
+}
+
+bool Pipeline_HiZBuild_Init()
+{
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
     (
-        gpu_device,"bloom_upsample.comp"
+        gpu_device, "hiz_build.comp"
     );
-    if (pipeline_bloom_upsample == NULL)
+    if (pipeline == NULL)
     {
-        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize bloom upsample compute pipeline!");
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize Hi-Z build compute pipeline!");
+        return false;
+    }
+    if (pipeline_hiz_build) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_hiz_build);
+    pipeline_hiz_build = pipeline;
+    return true;
+}
+
+bool Pipeline_ClusterLights_Init()
+{
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
+    (
+        gpu_device, "cluster_lights.comp"
+    );
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize light cluster compute pipeline!");
+        return false;
+    }
+    if (pipeline_cluster_lights) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_cluster_lights);
+    pipeline_cluster_lights = pipeline;
+    return true;
+}
+
+bool Pipeline_ShadowMoments_Init()
+{
+    SDL_GPUComputePipeline* pipeline = Pipeline_Compute_Init
+    (
+        gpu_device, "shadow_moments.comp"
+    );
+    if (pipeline == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to initialize shadow moments compute pipeline!");
         return false;
     }
+    if (pipeline_shadow_moments) SDL_ReleaseGPUComputePipeline(gpu_device, pipeline_shadow_moments);
+    pipeline_shadow_moments = pipeline;
     return true;
 }
 
@@ -5,6 +5,7 @@
 
 bool Pipeline_Init();
 bool Pipeline_Prepass_Unanimated_Init();
+bool Pipeline_Prepass_Instanced_Init();
 bool Pipeline_SSAO_Init();
 bool Pipeline_Unlit_Unanimated_Init();
 bool Pipeline_BlinnPhong_Unanimated_Init();
@@ -16,6 +17,10 @@ bool Pipeline_Text_Init();
 bool Pipeline_Swapchain_Init();
 bool Pipeline_Sprite_Init();
 bool Pipeline_ShadowDepth_Init();
+bool Pipeline_ShadowDepth_Instanced_Init();
+bool Pipeline_ShadowDepth_BoneAnimated_Init();
+bool Pipeline_ShadowComposite_Init();
+bool Pipeline_ShadowClear_Init();
 bool Pipeline_Fog_Init();
 bool Pipeline_PrepassDownsample_Init();
 bool Pipeline_SSAOUpsample_Init();
@@ -23,5 +28,13 @@ bool Pipeline_GaussianBlur_Init();
 bool Pipeline_Bloom_Threshold_Init();
 bool Pipeline_Bloom_Downsample_Init();
 bool Pipeline_Bloom_Upsample_Init();
+bool Pipeline_Cull_Init();
+bool Pipeline_HiZBuild_Init();
+bool Pipeline_ClusterLights_Init();
+bool Pipeline_ShadowMoments_Init();
+
+bool Pipeline_ReloadShader(const char* shader_filename);
+bool Pipeline_GetShaderPath(const char* shader_filename, char* path, size_t path_size);
+int Pipeline_GetShaderFilenames(const char** shader_filenames, int max_count);
 
 #endif // PIPELINE_H
\ No newline at end of file
@@ -4,6 +4,21 @@
 #include "sampler.h"
 #include "pipeline.h"
 #include "lights.h"
+#include "loader.h"
+#include "hotreload.h"
+#include "streamer.h"
+#include "gpumemory.h"
+#include "renderqueue.h"
+#include "gpucull.h"
+#include "clusters.h"
+
+static RenderQueue render_queue; // shared by the model passes (see Render_Models), which are recorded one after the other
+
+// one Model_Transforms and one Material_Parameters per visible model, rewritten every frame (see Render_UpdateTransforms)
+static SDL_GPUBuffer* transform_storage_buffer = NULL;
+static SDL_GPUBuffer* material_storage_buffer = NULL;
+static SDL_GPUTransferBuffer* transform_transfer_buffer = NULL; // transforms, then material parameters
+static Uint32 transform_capacity = 0;
 
 // INITIALIZATION /////////////////////////////////////////////////////////////
 
@@ -72,10 +87,47 @@ bool Render_LoadRenderSettings()
                 else
                     Bit_Clear(settings_render, SETTINGS_RENDER_USE_LINEAR_FILTERING);
             }
+            else if (SDL_strcmp(setting_name, "cpu_occlusion_culling") == 0)
+            {
+                if (SDL_strtol(setting_value, NULL, 10))
+                    Bit_Set(settings_render, SETTINGS_RENDER_CPU_OCCLUSION_CULLING);
+                else
+                    Bit_Clear(settings_render, SETTINGS_RENDER_CPU_OCCLUSION_CULLING);
+            }
+            else if (SDL_strcmp(setting_name, "dynamic_resolution") == 0)
+            {
+                if (SDL_strtol(setting_value, NULL, 10))
+                    Bit_Set(settings_render, SETTINGS_RENDER_DYNAMIC_RESOLUTION);
+                else
+                    Bit_Clear(settings_render, SETTINGS_RENDER_DYNAMIC_RESOLUTION);
+            }
+            else if (SDL_strcmp(setting_name, "dynamic_resolution_min_scale") == 0)
+            {
+                dynamic_resolution_min_scale = SDL_clamp((float)SDL_strtod(setting_value, NULL), 0.25f, 1.0f);
+            }
+            else if (SDL_strcmp(setting_name, "dynamic_resolution_target_frame_rate") == 0)
+            {
+                long frame_rate = SDL_strtol(setting_value, NULL, 10);
+                if (frame_rate >= 1 && frame_rate <= 1000)
+                    dynamic_resolution_target_frame_time = 1.0 / (double)frame_rate;
+                else
+                    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Invalid dynamic resolution target frame rate %ld in settings.txt, keeping %.0f", frame_rate, 1.0 / dynamic_resolution_target_frame_time);
+            }
+            else if (SDL_strcmp(setting_name, "filtered_shadows") == 0)
+            {
+                if (SDL_strtol(setting_value, NULL, 10))
+                    Bit_Set(settings_render, SETTINGS_RENDER_FILTERED_SHADOWS);
+                else
+                    Bit_Clear(settings_render, SETTINGS_RENDER_FILTERED_SHADOWS);
+            }
             else if (SDL_strcmp(setting_name, "n_mipmap_levels") == 0)
             {
                 n_mipmap_levels = (Uint32)SDL_strtoul(setting_value, NULL, 10);
             }
+            else if (SDL_strcmp(setting_name, "gpu_memory_budget_mb") == 0)
+            {
+                gpu_memory_budget_bytes = (Uint64)SDL_strtoull(setting_value, NULL, 10) * 1024 * 1024;
+            }
             else if (SDL_strcmp(setting_name, "vsync") == 0)
             {
                 int vsync = SDL_strtol(setting_value, NULL, 10);
@@ -113,11 +165,12 @@ bool Render_InitRenderTargets()
     
     if (virtual_screen_texture)
     {
-        SDL_ReleaseGPUTexture(gpu_device, virtual_screen_texture);
+        GPUMemory_ReleaseTexture(virtual_screen_texture);
     }
-    virtual_screen_texture = SDL_CreateGPUTexture
+    virtual_screen_texture = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "virtual screen",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -138,11 +191,12 @@ bool Render_InitRenderTargets()
 
     if (prepass_texture)
     {
-        SDL_ReleaseGPUTexture(gpu_device, prepass_texture);
+        GPUMemory_ReleaseTexture(prepass_texture);
     }
-    prepass_texture = SDL_CreateGPUTexture
+    prepass_texture = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "prepass",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -163,11 +217,12 @@ bool Render_InitRenderTargets()
 
     if (prepass_texture_half)
     {
-        SDL_ReleaseGPUTexture(gpu_device, prepass_texture_half);
+        GPUMemory_ReleaseTexture(prepass_texture_half);
     }
-    prepass_texture_half = SDL_CreateGPUTexture
+    prepass_texture_half = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "prepass half",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -188,11 +243,12 @@ bool Render_InitRenderTargets()
 
     if (ssao_texture)
     {
-        SDL_ReleaseGPUTexture(gpu_device, ssao_texture);
+        GPUMemory_ReleaseTexture(ssao_texture);
     }
-    ssao_texture = SDL_CreateGPUTexture
+    ssao_texture = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "SSAO",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -213,11 +269,12 @@ bool Render_InitRenderTargets()
 
     if (ssao_texture_upsampled)
     {
-        SDL_ReleaseGPUTexture(gpu_device, ssao_texture_upsampled);
+        GPUMemory_ReleaseTexture(ssao_texture_upsampled);
     }
-    ssao_texture_upsampled = SDL_CreateGPUTexture
+    ssao_texture_upsampled = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "SSAO upsampled",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -238,11 +295,12 @@ bool Render_InitRenderTargets()
 
     if (fog_texture)
     {
-        SDL_ReleaseGPUTexture(gpu_device, fog_texture);
+        GPUMemory_ReleaseTexture(fog_texture);
     }
-    fog_texture = SDL_CreateGPUTexture
+    fog_texture = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "fog",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -266,15 +324,16 @@ bool Render_InitRenderTargets()
     {
         for (int i = 0; i < MAX_BLOOM_LEVELS; i++)
         {
-            SDL_ReleaseGPUTexture(gpu_device, bloom_textures_downsampled[i]);
+            GPUMemory_ReleaseTexture(bloom_textures_downsampled[i]);
             bloom_textures_downsampled[i] = NULL;
         }
     }
     for (int i = 0; i < MAX_BLOOM_LEVELS; i++)
     {
-        bloom_textures_downsampled[i] = SDL_CreateGPUTexture
+        bloom_textures_downsampled[i] = GPUMemory_CreateTexture
         (
-            gpu_device,
+            GPUMEMORY_CATEGORY_RENDER_TARGET,
+            "bloom downsampled",
             &(SDL_GPUTextureCreateInfo)
             {
                 .type = SDL_GPU_TEXTURETYPE_2D,
@@ -298,15 +357,16 @@ bool Render_InitRenderTargets()
     {
         for (int i = 0; i < MAX_BLOOM_LEVELS; i++)
         {
-            SDL_ReleaseGPUTexture(gpu_device, bloom_textures_upsampled[i]);
+            GPUMemory_ReleaseTexture(bloom_textures_upsampled[i]);
             bloom_textures_upsampled[i] = NULL;
         }
     }
     for (int i = 0; i < MAX_BLOOM_LEVELS; i++)
     {
-        bloom_textures_upsampled[i] = SDL_CreateGPUTexture
+        bloom_textures_upsampled[i] = GPUMemory_CreateTexture
         (
-            gpu_device,
+            GPUMEMORY_CATEGORY_RENDER_TARGET,
+            "bloom upsampled",
             &(SDL_GPUTextureCreateInfo)
             {
                 .type = SDL_GPU_TEXTURETYPE_2D,
@@ -331,15 +391,16 @@ bool Render_InitRenderTargets()
     {
         for (int i = 0; i < 2; i++)
         {
-            SDL_ReleaseGPUTexture(gpu_device, bloom_textures[i]);
+            GPUMemory_ReleaseTexture(bloom_textures[i]);
             bloom_textures[i] = NULL;
         }
     }
     for (int i = 0; i < 2; i++)
     {
-        bloom_textures[i] = SDL_CreateGPUTexture
+        bloom_textures[i] = GPUMemory_CreateTexture
         (
-            gpu_device,
+            GPUMEMORY_CATEGORY_RENDER_TARGET,
+            "bloom",
             &(SDL_GPUTextureCreateInfo)
             {
                 .type = SDL_GPU_TEXTURETYPE_2D,
@@ -361,11 +422,12 @@ bool Render_InitRenderTargets()
 
 	if (depth_texture)
 	{
-		SDL_ReleaseGPUTexture(gpu_device, depth_texture);
+		GPUMemory_ReleaseTexture(depth_texture);
 	}
-	depth_texture = SDL_CreateGPUTexture
+	depth_texture = GPUMemory_CreateTexture
 	(
-		gpu_device,
+		GPUMEMORY_CATEGORY_RENDER_TARGET,
+		"depth",
 		&(SDL_GPUTextureCreateInfo)
 		{
 			.type = SDL_GPU_TEXTURETYPE_2D,
@@ -386,18 +448,20 @@ bool Render_InitRenderTargets()
 
     if (shadow_map_texture)
     {
-        SDL_ReleaseGPUTexture(gpu_device, shadow_map_texture);
+        GPUMemory_ReleaseTexture(shadow_map_texture);
     }
-    shadow_map_texture = SDL_CreateGPUTexture
+    // a 2x2 atlas, one tile per cascade
+    shadow_map_texture = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "shadow map",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
             .format = depth_sample_texture_format,
             .usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER,
-            .width = SHADOW_MAP_SIZE,
-            .height = SHADOW_MAP_SIZE,
+            .width = 2 * SHADOW_MAP_SIZE,
+            .height = 2 * SHADOW_MAP_SIZE,
             .layer_count_or_depth = 1,
             .num_levels = 1,
             .sample_count = SDL_GPU_SAMPLECOUNT_1,
@@ -408,15 +472,105 @@ bool Render_InitRenderTargets()
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create shadow map texture: %s", SDL_GetError());
         return false;
     }
-    shadow_settings = (Shadow_Settings){.texel_size = {1.0f / (float)SHADOW_MAP_SIZE, 1.0f / (float)SHADOW_MAP_SIZE}, .bias = SHADOW_BIAS, .pcf_radius = SHADOW_PCF_RADIUS};
+
+    for (int i = SHADOW_CASCADE_FIRST_CACHED; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        if (shadow_cache_textures[i])
+        {
+            GPUMemory_ReleaseTexture(shadow_cache_textures[i]);
+        }
+        shadow_cache_textures[i] = GPUMemory_CreateTexture
+        (
+            GPUMEMORY_CATEGORY_RENDER_TARGET,
+            "shadow cache",
+            &(SDL_GPUTextureCreateInfo)
+            {
+                .type = SDL_GPU_TEXTURETYPE_2D,
+                .format = depth_sample_texture_format,
+                .usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER,
+                .width = SHADOW_MAP_SIZE,
+                .height = SHADOW_MAP_SIZE,
+                .layer_count_or_depth = 1,
+                .num_levels = 1,
+                .sample_count = SDL_GPU_SAMPLECOUNT_1,
+            }
+        );
+        if (shadow_cache_textures[i] == NULL)
+        {
+            SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create shadow cache texture: %s", SDL_GetError());
+            return false;
+        }
+        shadow_cascades[i].static_valid = false;
+    }
+
+    if (spot_shadow_atlas_texture)
+    {
+        GPUMemory_ReleaseTexture(spot_shadow_atlas_texture);
+    }
+    spot_shadow_atlas_texture = GPUMemory_CreateTexture
+    (
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "spot shadow atlas",
+        &(SDL_GPUTextureCreateInfo)
+        {
+            .type = SDL_GPU_TEXTURETYPE_2D,
+            .format = depth_sample_texture_format,
+            .usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER,
+            .width = SPOT_SHADOW_ATLAS_SIZE,
+            .height = SPOT_SHADOW_ATLAS_SIZE,
+            .layer_count_or_depth = 1,
+            .num_levels = 1,
+            .sample_count = SDL_GPU_SAMPLECOUNT_1,
+        }
+    );
+    if (spot_shadow_atlas_texture == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create spot shadow atlas texture: %s", SDL_GetError());
+        return false;
+    }
+    Lights_ResetSpotShadows(); // the tiles are gone with the old atlas
+
+    // exponential variance moments of the cascade atlas, and a second one to blur through
+    for (int i = 0; i < 2; i++)
+    {
+        if (shadow_moments_textures[i])
+        {
+            GPUMemory_ReleaseTexture(shadow_moments_textures[i]);
+            shadow_moments_textures[i] = NULL;
+        }
+        if (!(settings_render & SETTINGS_RENDER_FILTERED_SHADOWS)) continue;
+
+        shadow_moments_textures[i] = GPUMemory_CreateTexture
+        (
+            GPUMEMORY_CATEGORY_RENDER_TARGET,
+            "shadow moments",
+            &(SDL_GPUTextureCreateInfo)
+            {
+                .type = SDL_GPU_TEXTURETYPE_2D,
+                .format = SDL_GPU_TEXTUREFORMAT_R16G16B16A16_FLOAT,
+                .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE,
+                .width = 2 * SHADOW_MAP_SIZE,
+                .height = 2 * SHADOW_MAP_SIZE,
+                .layer_count_or_depth = 1,
+                .num_levels = 1,
+                .sample_count = SDL_GPU_SAMPLECOUNT_1,
+            }
+        );
+        if (shadow_moments_textures[i] == NULL)
+        {
+            SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create shadow moments texture %d: %s", i, SDL_GetError());
+            return false;
+        }
+    }
     
     if (msaa_texture)
     {
-        SDL_ReleaseGPUTexture(gpu_device, msaa_texture);
+        GPUMemory_ReleaseTexture(msaa_texture);
     }
-    msaa_texture = SDL_CreateGPUTexture
+    msaa_texture = GPUMemory_CreateTexture
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_RENDER_TARGET,
+        "MSAA",
         &(SDL_GPUTextureCreateInfo)
         {
             .type = SDL_GPU_TEXTURETYPE_2D,
@@ -438,6 +592,52 @@ bool Render_InitRenderTargets()
 	return true;
 }
 
+// at shutdown, before GPUMemory_Quit
+void Render_Quit()
+{
+    Render_ReleaseRenderTargets();
+    RenderQueue_Free(&render_queue);
+    GPUMemory_ReleaseBuffer(transform_storage_buffer);
+    GPUMemory_ReleaseBuffer(material_storage_buffer);
+    GPUMemory_ReleaseTransferBuffer(transform_transfer_buffer);
+    transform_storage_buffer = NULL;
+    material_storage_buffer = NULL;
+    transform_transfer_buffer = NULL;
+    transform_capacity = 0;
+    GPUCull_Quit();
+    Clusters_Quit();
+}
+
+// at shutdown; Render_InitRenderTargets releases the previous set itself
+void Render_ReleaseRenderTargets()
+{
+    SDL_GPUTexture** render_targets[] =
+    {
+        &virtual_screen_texture, &prepass_texture, &prepass_texture_half, &ssao_texture, &ssao_texture_upsampled,
+        &fog_texture, &bloom_textures[0], &bloom_textures[1], &depth_texture, &shadow_map_texture, &msaa_texture,
+        &spot_shadow_atlas_texture, &shadow_moments_textures[0], &shadow_moments_textures[1],
+    };
+    for (size_t i = 0; i < SDL_arraysize(render_targets); i++)
+    {
+        GPUMemory_ReleaseTexture(*render_targets[i]);
+        *render_targets[i] = NULL;
+    }
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        GPUMemory_ReleaseTexture(shadow_cache_textures[i]);
+        shadow_cache_textures[i] = NULL;
+    }
+#if DUAL_KAWASE_BLOOM
+    for (int i = 0; i < MAX_BLOOM_LEVELS; i++)
+    {
+        GPUMemory_ReleaseTexture(bloom_textures_downsampled[i]);
+        GPUMemory_ReleaseTexture(bloom_textures_upsampled[i]);
+        bloom_textures_downsampled[i] = NULL;
+        bloom_textures_upsampled[i] = NULL;
+    }
+#endif
+}
+
 bool Render_Init()
 {
     SDL_WaitForGPUIdle(gpu_device);
@@ -500,359 +700,718 @@ bool Render_Init()
 
 // FRAME RENDERING ////////////////////////////////////////////////////////////
 
-static void Render_Unanimated_Shadow(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer* command_buffer)
+// Draws the submeshes at the level of detail picked by Model_SelectLODs, for when GPU culling has no commands for the model
+// with a frustum (the shadow passes), submeshes outside of it are skipped on the CPU instead
+// levels are laid out in submesh order, so neighbours at the same level merge into one draw
+static void Render_DrawSubmeshes(SDL_GPURenderPass* render_pass, const Model* model, const Frustum* frustum)
 {
-    if (!Array_Len(models_unanimated)) return;
+    if (model->submeshes == NULL)
+    {
+        SDL_DrawGPUIndexedPrimitives(render_pass, model->mesh.index_count, 1, 0, 0, 0);
+        return;
+    }
 
-    SDL_BindGPUGraphicsPipeline(render_pass, pipeline_shadow_depth);
+    Uint32 first_index = 0;
+    Uint32 index_count = 0;
+    for (size_t i = 0; i < Array_Len(model->submeshes); i++)
+    {
+        const Submesh* submesh = &model->submeshes[i];
+        if (frustum && !Frustum_IntersectsAABB(frustum, submesh->aabb_min, submesh->aabb_max)) continue;
+        const Submesh_LOD* lod = &submesh->lods[submesh->lod];
+        if (index_count > 0 && lod->first_index == first_index + index_count)
+        {
+            index_count += lod->index_count;
+            continue;
+        }
+        if (index_count > 0)
+        {
+            SDL_DrawGPUIndexedPrimitives(render_pass, index_count, 1, first_index, 0, 0);
+        }
+        first_index = lod->first_index;
+        index_count = lod->index_count;
+    }
+    if (index_count > 0)
+    {
+        SDL_DrawGPUIndexedPrimitives(render_pass, index_count, 1, first_index, 0, 0);
+    }
+}
 
-    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+Enum (Uint8, Render_ModelPass)
+{
+    RENDER_MODEL_PASS_SHADOW,         // every caster of one cascade
+    RENDER_MODEL_PASS_SHADOW_STATIC,  // unanimated and instanced casters, into a cached layer
+    RENDER_MODEL_PASS_SHADOW_DYNAMIC, // bone animated casters, over a cached layer
+    RENDER_MODEL_PASS_SHADOW_SPOT,    // every caster of one spot light's tile
+    RENDER_MODEL_PASS_PREPASS,
+    RENDER_MODEL_PASS_PREPASS_LATE, // what the previous frame's Hi-Z pyramid hid but this frame's doesn't (see gpucull.h)
+    RENDER_MODEL_PASS_MAIN,
+};
+
+// View space distance to the nearest point of the model's bounding sphere
+static float Render_GetViewDepth(mat4 view_matrix, const Model* model)
+{
+    vec3 center, center_viewspace;
+    glm_vec3_center((float*)model->aabb_min, (float*)model->aabb_max, center);
+    glm_mat4_mulv3(view_matrix, center, 1.0f, center_viewspace);
+    return center_viewspace[2] - 0.5f * glm_vec3_distance((float*)model->aabb_min, (float*)model->aabb_max);
+}
+
+// grows the transform buffers to hold at least count transforms; the old contents are not kept
+static bool Render_ReserveTransforms(Uint32 count)
+{
+    if (count <= transform_capacity) return true;
+
+    Uint32 capacity = SDL_max(count, SDL_max(transform_capacity * 2, 256u));
+    GPUMemory_ReleaseBuffer(transform_storage_buffer);
+    GPUMemory_ReleaseBuffer(material_storage_buffer);
+    GPUMemory_ReleaseTransferBuffer(transform_transfer_buffer);
+    transform_storage_buffer = NULL;
+    material_storage_buffer = NULL;
+    transform_transfer_buffer = NULL;
+    transform_capacity = 0;
+
+    transform_storage_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_BUFFER,
+        "model transforms",
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+            .size = capacity * sizeof(Model_Transforms)
+        }
+    );
+    if (transform_storage_buffer == NULL)
     {
-        // TODO implement model matrix per model
-        mat4 model_matrix;
-        glm_mat4_identity(model_matrix);
-        
-        mat4 light_mvp_matrix;
-        glm_mat4_mul(light_viewproj_matrix, model_matrix, light_mvp_matrix);
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create transform storage buffer: %s", SDL_GetError());
+        return false;
+    }
 
-        SDL_PushGPUVertexUniformData
-        (
-            command_buffer, 
-            0, // uniform buffer slot
-            &light_mvp_matrix, 
-            sizeof(mat4)
-        );
-        
-        SDL_BindGPUVertexBuffers
-        (
-            render_pass, 
-            0, // vertex buffer slot
-            (SDL_GPUBufferBinding[])
-            {
-                { 
-                    .buffer = models_unanimated[i].mesh.vertex_buffer, 
-                    .offset = 0 
-                },
-            }, 
-            1 // vertex buffer count
-        );            
-        
-        SDL_BindGPUIndexBuffer
-        (
-            render_pass, 
-            &(SDL_GPUBufferBinding)
-            { 
-                .buffer = models_unanimated[i].mesh.index_buffer, 
-                .offset = 0 
-            }, 
-            SDL_GPU_INDEXELEMENTSIZE_16BIT
-        );
+    material_storage_buffer = GPUMemory_CreateBuffer
+    (
+        GPUMEMORY_CATEGORY_BUFFER,
+        "material parameters",
+        &(SDL_GPUBufferCreateInfo)
+        {
+            .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+            .size = capacity * sizeof(Material_Parameters)
+        }
+    );
+    if (material_storage_buffer == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create material parameter storage buffer: %s", SDL_GetError());
+        return false;
+    }
 
-        SDL_DrawGPUIndexedPrimitives
-        (
-            render_pass,
-            (Uint32)models_unanimated[i].mesh.index_count, // num_indices
-            1,  // num_instances
-            0,  // first_index
-            0,  // vertex_offset
-            0   // first_instance
-        );
+    transform_transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "model transforms",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = capacity * (sizeof(Model_Transforms) + sizeof(Material_Parameters))
+        }
+    );
+    if (transform_transfer_buffer == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create transform transfer buffer: %s", SDL_GetError());
+        return false;
     }
+
+    transform_capacity = capacity;
+    return true;
+}
+
+static void Render_CalculateDrawData(const Model* model, Model_Transforms* transforms, Material_Parameters* material)
+{
+    *material = (Material_Parameters)
+    {
+        .layer_diffuse = MaterialPool_GetLayer(model->mesh.material.texture_diffuse),
+        .layer_metallic_roughness = MaterialPool_GetLayer(model->mesh.material.texture_metallic_roughness),
+        .layer_normal = MaterialPool_GetLayer(model->mesh.material.texture_normal),
+    };
+
+    mat4 mv_matrix;
+    glm_mat4_mul(camera_active->view_matrix, (vec4*)model->model_matrix, mv_matrix);
+
+    glm_mat4_mul(camera_active->view_projection_matrix, (vec4*)model->model_matrix, transforms->mvp);
+    glm_mat4_copy(mv_matrix, transforms->mv);
+    glm_mat4_copy((vec4*)model->model_matrix, transforms->model);
+    glm_vec4_copy((float*)model->mesh.position_offset, transforms->position_offset);
+    glm_vec4_copy((float*)model->mesh.position_scale, transforms->position_scale);
+
+#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
+    // normal matrix = inverse-transpose of the upper-left 3x3 of mv
+    mat3 mv3, normal3;
+    glm_mat4_pick3(mv_matrix, mv3);     // take upper-left 3x3
+    glm_mat3_inv(mv3, normal3);
+    glm_mat3_transpose(normal3);
+    glm_mat4_identity(transforms->normal);
+    glm_mat4_ins3(normal3, transforms->normal);
+#endif
 }
 
-static void Render_Unanimated_Prepass(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer* command_buffer)
+// Computes the transforms and material parameters of every model visible to any pass once per frame and uploads them in one copy;
+// the passes then only push each draw's Model.transform_index (UBO_Draw)
+// after Model_UpdateVisibility, which decides which models get a slot; recorded into the frame's upload copy pass
+static bool Render_UpdateTransforms(SDL_GPUCopyPass* copy_pass)
 {
-    if (!Array_Len(models_unanimated)) return;
+    Uint32 count = 0;
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+        if (models_unanimated[i].visibility) count++;
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+        if (models_instanced[i].visibility) count++;
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+        if (models_bone_animated[i].model.visibility) count++;
+
+    if (count == 0) return true;
 
-    SDL_BindGPUGraphicsPipeline(render_pass, pipeline_prepass_unanimated);
+    Model_Transforms* transforms = NULL;
+    if (Render_ReserveTransforms(count))
+    {
+        transforms = SDL_MapGPUTransferBuffer(gpu_device, transform_transfer_buffer, true);
+        if (transforms == NULL) SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_MapGPUTransferBuffer failed: %s", SDL_GetError());
+    }
+    if (transforms == NULL)
+    {
+        // without them nothing can be drawn this frame
+        for (size_t i = 0; i < Array_Len(models_unanimated); i++) models_unanimated[i].visibility = 0;
+        for (size_t i = 0; i < Array_Len(models_instanced); i++) models_instanced[i].visibility = 0;
+        for (size_t i = 0; i < Array_Len(models_bone_animated); i++) models_bone_animated[i].model.visibility = 0;
+        return false;
+    }
+    Material_Parameters* materials = (Material_Parameters*)(transforms + transform_capacity);
 
+    Uint32 index = 0;
     for (size_t i = 0; i < Array_Len(models_unanimated); i++)
     {
-        // TODO implement model matrix per model
-        mat4 model_matrix;
-        glm_mat4_identity(model_matrix);
+        Model* model = &models_unanimated[i];
+        if (!model->visibility) continue;
+        model->transform_index = index;
+        Render_CalculateDrawData(model, &transforms[index], &materials[index]);
+        index++;
+    }
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+    {
+        Model* model = &models_instanced[i];
+        if (!model->visibility) continue;
+        model->transform_index = index;
+        Render_CalculateDrawData(model, &transforms[index], &materials[index]);
+        index++;
+    }
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        Model* model = &models_bone_animated[i].model;
+        if (!model->visibility) continue;
+        model->transform_index = index;
+        Render_CalculateDrawData(model, &transforms[index], &materials[index]);
+        index++;
+    }
 
-        mat4 mv_matrix;
-        glm_mat4_mul(camera_active->view_matrix, model_matrix, mv_matrix);
-        
-        mat4 mvp_matrix;
-        glm_mat4_mul(camera_active->view_projection_matrix, model_matrix, mvp_matrix);
+    SDL_UnmapGPUTransferBuffer(gpu_device, transform_transfer_buffer);
 
-        // TODO light mvp not needed for prepass; make a separate UBO without it?
-        TransformsUBO transforms = {0};
-        glm_mat4_copy(mvp_matrix, transforms.mvp);
-        glm_mat4_copy(mv_matrix, transforms.mv);
+    SDL_UploadToGPUBuffer
+    (
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation){ .transfer_buffer = transform_transfer_buffer, .offset = 0 },
+        &(SDL_GPUBufferRegion){ .buffer = transform_storage_buffer, .offset = 0, .size = index * sizeof(Model_Transforms) },
+        true // cycle
+    );
+    SDL_UploadToGPUBuffer
+    (
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation){ .transfer_buffer = transform_transfer_buffer, .offset = transform_capacity * sizeof(Model_Transforms) },
+        &(SDL_GPUBufferRegion){ .buffer = material_storage_buffer, .offset = 0, .size = index * sizeof(Material_Parameters) },
+        true // cycle
+    );
 
-#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-        // normal matrix = inverse-transpose of the upper-left 3x3 of mv
-        mat3 mv3, normal3;
-        glm_mat4_pick3(mv_matrix, mv3);     // take upper-left 3x3
-        glm_mat3_inv(mv3, normal3);
-        glm_mat3_transpose(normal3);
-        glm_mat4_identity(transforms.normal);
-        glm_mat4_ins3(normal3, transforms.normal);
-#endif
+    return true;
+}
 
-        SDL_PushGPUVertexUniformData
-        (
-            command_buffer, 
-            0, // uniform buffer slot
-            &transforms, 
-            sizeof(transforms)
-        );
-        
-        SDL_BindGPUVertexBuffers
-        (
-            render_pass, 
-            0, // vertex buffer slot
-            (SDL_GPUBufferBinding[])
+// Draws every model the pass sees through the render queue (see renderqueue.h):
+// the depth only passes front to back, the main pass (depth EQUAL after the prepass, so order doesn't matter there) by state
+// bone animated models are only drawn by the main and shadow passes, and the late prepass only draws GPU culled models
+// the shadow passes draw one cascade or spot light tile, and skip what is outside of it
+static void Render_Models(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer* command_buffer, Render_ModelPass pass, const Shadow_View* shadow_view)
+{
+    if (render_queue.items == NULL && !RenderQueue_Init(&render_queue)) return;
+
+    SDL_GPUGraphicsPipeline* pipelines[RENDERQUEUE_KIND_COUNT] = {0};
+    Uint8 visibility = MODEL_VISIBLE_CAMERA;
+    vec4* view_matrix = camera_active->view_matrix;
+    int texture_count = 3; // diffuse, metallic-roughness, normal
+    int material_buffer_slot = -1; // fragment storage buffer slot of material_storage_buffer
+    GPUCull_View cull_view = GPUCULL_VIEW_MAIN;
+    switch (pass)
+    {
+        case RENDER_MODEL_PASS_SHADOW:
+        case RENDER_MODEL_PASS_SHADOW_STATIC:
+        case RENDER_MODEL_PASS_SHADOW_DYNAMIC:
+            if (pass != RENDER_MODEL_PASS_SHADOW_DYNAMIC)
+            {
+                pipelines[RENDERQUEUE_KIND_UNANIMATED] = pipeline_shadow_depth;
+                pipelines[RENDERQUEUE_KIND_INSTANCED] = pipeline_shadow_depth_instanced;
+            }
+            if (pass != RENDER_MODEL_PASS_SHADOW_STATIC)
+            {
+                pipelines[RENDERQUEUE_KIND_BONE_ANIMATED] = pipeline_shadow_depth_bone_animated;
+            }
+            visibility = MODEL_VISIBLE_SHADOW;
+            view_matrix = (vec4*)shadow_view->view_matrix;
+            texture_count = 0;
+            cull_view = GPUCULL_VIEW_SHADOW;
+            for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
             {
+                if (shadow_view == &shadow_cascades[i].view) cull_view = (GPUCull_View)(GPUCULL_VIEW_SHADOW + i);
+            }
+            RenderQueue_Begin(&render_queue, RENDERQUEUE_ORDER_FRONT_TO_BACK);
+            break;
+        case RENDER_MODEL_PASS_SHADOW_SPOT:
+            pipelines[RENDERQUEUE_KIND_UNANIMATED] = pipeline_shadow_depth;
+            pipelines[RENDERQUEUE_KIND_INSTANCED] = pipeline_shadow_depth_instanced;
+            pipelines[RENDERQUEUE_KIND_BONE_ANIMATED] = pipeline_shadow_depth_bone_animated;
+            visibility = MODEL_VISIBLE_SPOT_SHADOW;
+            view_matrix = (vec4*)shadow_view->view_matrix;
+            texture_count = 0;
+            cull_view = GPUCULL_VIEW_COUNT; // the GPU culling only knows the camera and the cascades
+            RenderQueue_Begin(&render_queue, RENDERQUEUE_ORDER_FRONT_TO_BACK);
+            break;
+        case RENDER_MODEL_PASS_PREPASS:
+            pipelines[RENDERQUEUE_KIND_UNANIMATED] = pipeline_prepass_unanimated;
+            pipelines[RENDERQUEUE_KIND_INSTANCED] = pipeline_prepass_instanced;
+            texture_count = 1; // diffuse, for alpha testing
+            material_buffer_slot = 0;
+            cull_view = GPUCULL_VIEW_PREPASS;
+            RenderQueue_Begin(&render_queue, RENDERQUEUE_ORDER_FRONT_TO_BACK);
+            break;
+        case RENDER_MODEL_PASS_PREPASS_LATE:
+            pipelines[RENDERQUEUE_KIND_UNANIMATED] = pipeline_prepass_unanimated;
+            texture_count = 1;
+            material_buffer_slot = 0;
+            cull_view = GPUCULL_VIEW_PREPASS_LATE;
+            RenderQueue_Begin(&render_queue, RENDERQUEUE_ORDER_FRONT_TO_BACK);
+            break;
+        case RENDER_MODEL_PASS_MAIN:
+            pipelines[RENDERQUEUE_KIND_UNANIMATED] = pipeline_unanimated;
+            pipelines[RENDERQUEUE_KIND_INSTANCED] = pipeline_instanced;
+            pipelines[RENDERQUEUE_KIND_BONE_ANIMATED] = pipeline_bone_animated;
+            material_buffer_slot = 3; // after the spot lights, point lights and light clusters
+            RenderQueue_Begin(&render_queue, RENDERQUEUE_ORDER_STATE);
+            break;
+    }
+
+    for (size_t i = 0; pipelines[RENDERQUEUE_KIND_UNANIMATED] && i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        if (!(model->visibility & visibility)) continue;
+        if (shadow_view && !Frustum_IntersectsAABB(&shadow_view->frustum, model->aabb_min, model->aabb_max)) continue;
+        if (pass == RENDER_MODEL_PASS_PREPASS_LATE && model->cull_command_count == 0) continue; // drawn in full by the prepass
+        RenderQueue_Push(&render_queue, RENDERQUEUE_KIND_UNANIMATED, model, Render_GetViewDepth(view_matrix, model), 0);
+    }
+    for (size_t i = 0; pipelines[RENDERQUEUE_KIND_INSTANCED] && i < Array_Len(models_instanced); i++)
+    {
+        Model* model = &models_instanced[i];
+        if (!(model->visibility & visibility)) continue;
+        if (shadow_view && !Frustum_IntersectsAABB(&shadow_view->frustum, model->aabb_min, model->aabb_max)) continue;
+        RenderQueue_Push(&render_queue, RENDERQUEUE_KIND_INSTANCED, model, Render_GetViewDepth(view_matrix, model), 0);
+    }
+    for (size_t i = 0; pipelines[RENDERQUEUE_KIND_BONE_ANIMATED] && i < Array_Len(models_bone_animated); i++)
+    {
+        Model* model = &models_bone_animated[i].model;
+        if (!(model->visibility & visibility)) continue;
+        if (shadow_view && !Frustum_IntersectsAABB(&shadow_view->frustum, model->aabb_min, model->aabb_max)) continue;
+        RenderQueue_Push(&render_queue, RENDERQUEUE_KIND_BONE_ANIMATED, model, Render_GetViewDepth(view_matrix, model), models_bone_animated[i].animation_rig.storage_buffer_offset_bytes);
+    }
+
+    if (!RenderQueue_Sort(&render_queue)) return;
+    if (Array_Len(render_queue.items) == 0) return;
+
+    // slot 0 is the same for every model; slot 1 is the instance or joint buffer
+    SDL_BindGPUVertexStorageBuffers(render_pass, 0, &transform_storage_buffer, 1);
+    if (material_buffer_slot >= 0) SDL_BindGPUFragmentStorageBuffers(render_pass, (Uint32)material_buffer_slot, &material_storage_buffer, 1);
+    if (shadow_view)
+    {
+        UBO_Shadow shadow;
+        glm_mat4_copy((vec4*)shadow_view->view_projection_matrix, shadow.view_projection);
+        SDL_PushGPUVertexUniformData(command_buffer, 1, &shadow, sizeof(shadow));
+    }
+
+    // what is bound right now; anything that matches the next item isn't bound again
+    SDL_GPUGraphicsPipeline* bound_pipeline = NULL;
+    SDL_GPUBuffer* bound_vertex_buffer = NULL;
+    SDL_GPUBuffer* bound_index_buffer = NULL;
+    SDL_GPUBuffer* bound_storage_buffer = NULL;
+    SDL_GPUTexture* bound_textures[3] = {0};
+
+    for (size_t i = 0; i < Array_Len(render_queue.items); i++)
+    {
+        const RenderQueue_Item* item = &render_queue.items[i];
+        Mesh* mesh = &item->model->mesh;
+
+        if (pipelines[item->kind] != bound_pipeline)
+        {
+            bound_pipeline = pipelines[item->kind];
+            SDL_BindGPUGraphicsPipeline(render_pass, bound_pipeline);
+        }
+
+        SDL_GPUBuffer* storage_buffer = 
+            item->kind == RENDERQUEUE_KIND_INSTANCED ? mesh->instance_buffer : 
+            item->kind == RENDERQUEUE_KIND_BONE_ANIMATED ? joint_matrix_storage_buffer : NULL;
+        if (storage_buffer && storage_buffer != bound_storage_buffer)
+        {
+            bound_storage_buffer = storage_buffer;
+            SDL_BindGPUVertexStorageBuffers
+            (
+                render_pass,
+                1, // storage buffer slot
+                &bound_storage_buffer,
+                1 // storage buffer count
+            );
+        }
+
+        UBO_Draw draw = { .transform_index = item->model->transform_index, .joint_offset_bytes = item->joint_offset_bytes };
+        SDL_PushGPUVertexUniformData(command_buffer, 0, &draw, sizeof(draw));
+
+        if (mesh->vertex_buffer != bound_vertex_buffer)
+        {
+            bound_vertex_buffer = mesh->vertex_buffer;
+            SDL_BindGPUVertexBuffers
+            (
+                render_pass, 
+                0, // vertex buffer slot
+                (SDL_GPUBufferBinding[])
+                {
+                    { 
+                        .buffer = bound_vertex_buffer, 
+                        .offset = 0 
+                    },
+                }, 
+                1 // vertex buffer count
+            );
+        }
+
+        if (mesh->index_buffer != bound_index_buffer)
+        {
+            bound_index_buffer = mesh->index_buffer;
+            SDL_BindGPUIndexBuffer
+            (
+                render_pass, 
+                &(SDL_GPUBufferBinding)
                 { 
-                    .buffer = models_unanimated[i].mesh.vertex_buffer, 
+                    .buffer = bound_index_buffer, 
                     .offset = 0 
-                },
-            }, 
-            1 // vertex buffer count
-        );            
-        
-        SDL_BindGPUIndexBuffer
-        (
-            render_pass, 
-            &(SDL_GPUBufferBinding)
-            { 
-                .buffer = models_unanimated[i].mesh.index_buffer, 
-                .offset = 0 
-            }, 
-            SDL_GPU_INDEXELEMENTSIZE_16BIT
-        );
+                }, 
+                mesh->index_element_size
+            );
+        }
 
-        // need to sample diffuse because of alpha testing, otherwise depth buffer will be incorrect
-        // if I get squeezed for performance, I could make a separate pipeline without alpha testing
-        SDL_GPUTexture* texture_albedo = models_unanimated[i].mesh.material.texture_diffuse;    
-        SDL_BindGPUFragmentSamplers
-        (
-            render_pass, 
-            0, // first slot
-            (SDL_GPUTextureSamplerBinding[])
+        // the pools' array textures; which layer each draw samples is in its Material_Parameters
+        SDL_GPUTexture* textures[3] = 
+        { 
+            MaterialPool_GetArrayTexture(mesh->material.texture_diffuse), 
+            MaterialPool_GetArrayTexture(mesh->material.texture_metallic_roughness), 
+            MaterialPool_GetArrayTexture(mesh->material.texture_normal) 
+        };
+        bool textures_changed = false;
+        for (int ii = 0; ii < texture_count; ii++)
+        {
+            textures_changed = textures_changed || textures[ii] != bound_textures[ii];
+        }
+        if (textures_changed)
+        {
+            SDL_GPUTextureSamplerBinding bindings[3];
+            for (int ii = 0; ii < texture_count; ii++)
             {
-                { .texture = texture_albedo,  .sampler = sampler_albedo },
-            },
-            1 // num_bindings
-        );
+                bindings[ii] = (SDL_GPUTextureSamplerBinding){ .texture = textures[ii], .sampler = sampler_albedo };
+                bound_textures[ii] = textures[ii];
+            }
+            SDL_BindGPUFragmentSamplers(render_pass, 0, bindings, texture_count);
+        }
 
-        SDL_DrawGPUIndexedPrimitives
-        (
-            render_pass,
-            (Uint32)models_unanimated[i].mesh.index_count, // num_indices
-            1,  // num_instances
-            0,  // first_index
-            0,  // vertex_offset
-            0   // first_instance
-        );
+        switch (item->kind)
+        {
+            case RENDERQUEUE_KIND_UNANIMATED:
+                if (cull_view == GPUCULL_VIEW_COUNT || !GPUCull_Draw(render_pass, item->model, cull_view))
+                {
+                    Render_DrawSubmeshes(render_pass, item->model, shadow_view ? &shadow_view->frustum : NULL);
+                }
+                break;
+            case RENDERQUEUE_KIND_INSTANCED:
+                if (item->model->submeshes)
+                {
+                    const Submesh* submesh = &item->model->submeshes[0];
+                    SDL_DrawGPUIndexedPrimitives(render_pass, submesh->lods[submesh->lod].index_count, mesh->instance_count, submesh->lods[submesh->lod].first_index, 0, 0);
+                }
+                else
+                {
+                    SDL_DrawGPUIndexedPrimitives(render_pass, mesh->index_count, mesh->instance_count, 0, 0, 0);
+                }
+                break;
+            case RENDERQUEUE_KIND_BONE_ANIMATED:
+                SDL_DrawGPUIndexedPrimitives(render_pass, mesh->index_count, 1, 0, 0, 0);
+                break;
+            default: break;
+        }
     }
 }
 
-static void Render_Unanimated(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer* command_buffer)
+// Redraws the cached static layers that are out of date, then every cascade into its tile of the atlas (see lights.h):
+// the cached ones are their layer with the dynamic casters drawn over it, the others all of their casters
+static bool Render_Shadows(SDL_GPUCommandBuffer* command_buffer)
 {
-    if (!Array_Len(models_unanimated)) return;
+    Uint32 redrawn = 0; // cascades whose cached layer is drawn this frame
+    for (int i = SHADOW_CASCADE_FIRST_CACHED; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        Shadow_Cascade* cascade = &shadow_cascades[i];
+        if (cascade->static_valid && cascade->static_generation == static_geometry_generation) continue;
 
-    SDL_BindGPUGraphicsPipeline(render_pass, pipeline_unanimated);
+        SDL_GPURenderPass* cache_pass = SDL_BeginGPURenderPass
+        (
+            command_buffer,
+            NULL,
+            0,
+            &(SDL_GPUDepthStencilTargetInfo)
+            {
+                .texture = shadow_cache_textures[i],
+                .clear_depth = 1.0f,
+                .load_op = SDL_GPU_LOADOP_CLEAR,
+                .store_op = SDL_GPU_STOREOP_STORE,
+                .stencil_load_op = SDL_GPU_LOADOP_DONT_CARE,
+                .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
+                .cycle = true
+            }
+        );
+        if (!cache_pass)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin shadow cache pass: %s", SDL_GetError());
+            return false;
+        }
 
-    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+        SDL_SetGPUViewport(cache_pass, &(SDL_GPUViewport)
+        {
+            .x = 0, .y = 0,
+            .w = (float)SHADOW_MAP_SIZE, .h = (float)SHADOW_MAP_SIZE,
+            .min_depth = 0.0f, .max_depth = 1.0f
+        });
+
+        Render_Models(cache_pass, command_buffer, RENDER_MODEL_PASS_SHADOW_STATIC, &cascade->view);
+
+        SDL_EndGPURenderPass(cache_pass);
+        redrawn |= 1u << i;
+    }
+
+    SDL_GPUDepthStencilTargetInfo shadow_target_info = 
     {
-        // TODO implement model matrix per model
-        mat4 model_matrix;
-        glm_mat4_identity(model_matrix);
+        .texture = shadow_map_texture,
+        .clear_depth = 1.0f,
+        .clear_stencil = 0,
+        .load_op = SDL_GPU_LOADOP_CLEAR,
+        .store_op = SDL_GPU_STOREOP_STORE,
+        .stencil_load_op = SDL_GPU_LOADOP_DONT_CARE,
+        .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
+        .cycle = true
+    };
 
-        mat4 mv_matrix;
-        glm_mat4_mul(camera_active->view_matrix, model_matrix, mv_matrix);
-        
-        mat4 mvp_matrix;
-        glm_mat4_mul(camera_active->view_projection_matrix, model_matrix, mvp_matrix);
+    SDL_GPURenderPass* shadow_pass = SDL_BeginGPURenderPass
+    (
+        command_buffer,
+        NULL, 
+        0,
+        &shadow_target_info
+    );
+    if (!shadow_pass)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin shadow pass: %s", SDL_GetError());
+        return false;
+    }
 
-        // TODO we already calculated this in shadow pass; cache it
-        mat4 light_mvp_model;
-        glm_mat4_mul(light_viewproj_matrix, model_matrix, light_mvp_model);
-        
-        TransformsUBO transforms = {0};
-        glm_mat4_copy(mvp_matrix, transforms.mvp);
-        glm_mat4_copy(mv_matrix, transforms.mv);
-        glm_mat4_copy(light_mvp_model, transforms.mvp_light);
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        Shadow_Cascade* cascade = &shadow_cascades[i];
+        Uint32 tile_x = (Uint32)(i & 1) * SHADOW_MAP_SIZE;
+        Uint32 tile_y = (Uint32)(i >> 1) * SHADOW_MAP_SIZE;
+
+        SDL_SetGPUViewport(shadow_pass, &(SDL_GPUViewport)
+        {
+            .x = (float)tile_x, .y = (float)tile_y,
+            .w = (float)SHADOW_MAP_SIZE, .h = (float)SHADOW_MAP_SIZE,
+            .min_depth = 0.0f, .max_depth = 1.0f
+        });
+        SDL_SetGPUScissor(shadow_pass, &(SDL_Rect){ (int)tile_x, (int)tile_y, (int)SHADOW_MAP_SIZE, (int)SHADOW_MAP_SIZE });
 
-#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-        // normal matrix = inverse-transpose of the upper-left 3x3 of mv
-        mat3 mv3, normal3;
-        glm_mat4_pick3(mv_matrix, mv3);     // take upper-left 3x3
-        glm_mat3_inv(mv3, normal3);
-        glm_mat3_transpose(normal3);
-        glm_mat4_identity(transforms.normal);
-        glm_mat4_ins3(normal3, transforms.normal);
-#endif
+        if (i < SHADOW_CASCADE_FIRST_CACHED)
+        {
+            Render_Models(shadow_pass, command_buffer, RENDER_MODEL_PASS_SHADOW, &cascade->view);
+            continue;
+        }
 
+        SDL_BindGPUGraphicsPipeline(shadow_pass, pipeline_shadow_composite);
+        int flipX = 0;
         SDL_PushGPUVertexUniformData
         (
             command_buffer, 
             0, // uniform buffer slot
-            &transforms, 
-            sizeof(transforms)
-        );
-        
-        SDL_BindGPUVertexBuffers
-        (
-            render_pass, 
-            0, // vertex buffer slot
-            (SDL_GPUBufferBinding[])
-            {
-                { 
-                    .buffer = models_unanimated[i].mesh.vertex_buffer, 
-                    .offset = 0 
-                },
-            }, 
-            1 // vertex buffer count
-        );            
-        
-        SDL_BindGPUIndexBuffer
-        (
-            render_pass, 
-            &(SDL_GPUBufferBinding)
-            { 
-                .buffer = models_unanimated[i].mesh.index_buffer, 
-                .offset = 0 
-            }, 
-            SDL_GPU_INDEXELEMENTSIZE_16BIT
+            &flipX, 
+            sizeof(int)
         );
-
-        SDL_GPUTexture* texture_diffuse = models_unanimated[i].mesh.material.texture_diffuse;    
-        SDL_GPUTexture* texture_metallic_roughness = models_unanimated[i].mesh.material.texture_metallic_roughness;
-        SDL_GPUTexture* texture_normal = models_unanimated[i].mesh.material.texture_normal;
-        
         SDL_BindGPUFragmentSamplers
         (
-            render_pass, 
+            shadow_pass,
             0, // first slot
-            (SDL_GPUTextureSamplerBinding[])
-            {
-                { .texture = texture_diffuse,  .sampler = sampler_albedo },
-                { .texture = texture_metallic_roughness, .sampler = sampler_albedo },
-                { .texture = texture_normal, .sampler = sampler_albedo }
-            },
-            3 // num_bindings
+            &(SDL_GPUTextureSamplerBinding){ .texture = shadow_cache_textures[i], .sampler = sampler_nearest_nomips },
+            1 // num_bindings
         );
+        SDL_DrawGPUPrimitives(shadow_pass, 6, 1, 0, 0);
 
-        SDL_DrawGPUIndexedPrimitives
-        (
-            render_pass,
-            (Uint32)models_unanimated[i].mesh.index_count, // num_indices
-            1,  // num_instances
-            0,  // first_index
-            0,  // vertex_offset
-            0   // first_instance
-        );
+        Render_Models(shadow_pass, command_buffer, RENDER_MODEL_PASS_SHADOW_DYNAMIC, &cascade->view);
+    }
+
+    SDL_EndGPURenderPass(shadow_pass);
+
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        if (!(redrawn & (1u << i))) continue;
+        shadow_cascades[i].static_valid = true;
+        shadow_cascades[i].static_generation = static_geometry_generation;
     }
+    return true;
 }
 
-static void Render_BoneAnimated(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer* command_buffer)
+// Draws the spot shadow tiles picked this frame (see Lights_UpdateSpotShadows); the rest of the atlas is kept as it is
+static bool Render_SpotShadows(SDL_GPUCommandBuffer* command_buffer)
 {
-    if (!Array_Len(models_bone_animated)) return;
+    bool any_redraw = false;
+    for (size_t i = 0; i < Array_Len(lights_spot) && i < MAX_SPOT_LIGHTS; i++)
+    {
+        any_redraw = any_redraw || spot_shadows[i].redraw;
+    }
+    if (!any_redraw) return true;
 
-    SDL_BindGPUGraphicsPipeline(render_pass, pipeline_bone_animated);
-    SDL_BindGPUVertexStorageBuffers
+    SDL_GPURenderPass* spot_shadow_pass = SDL_BeginGPURenderPass
     (
-        render_pass,
-        0, // storage buffer slot
-        &joint_matrix_storage_buffer,
-        1 // storage buffer count
+        command_buffer,
+        NULL,
+        0,
+        &(SDL_GPUDepthStencilTargetInfo)
+        {
+            .texture = spot_shadow_atlas_texture,
+            .load_op = SDL_GPU_LOADOP_LOAD,
+            .store_op = SDL_GPU_STOREOP_STORE,
+            .stencil_load_op = SDL_GPU_LOADOP_DONT_CARE,
+            .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
+            .cycle = false // the tiles that aren't redrawn are still read
+        }
     );
-
-    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    if (!spot_shadow_pass)
     {
-        // TODO implement model matrix per model
-        mat4 model_matrix;
-        glm_mat4_identity(model_matrix);
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin spot shadow pass: %s", SDL_GetError());
+        return false;
+    }
 
-        mat4 mv_matrix;
-        glm_mat4_mul(camera_active->view_matrix, model_matrix, mv_matrix);
-        
-        mat4 mvp_matrix;
-        glm_mat4_mul(camera_active->view_projection_matrix, model_matrix, mvp_matrix);
-        
-        TransformsUBO transforms = {0};
-        glm_mat4_copy(mvp_matrix, transforms.mvp);
-        glm_mat4_copy(mv_matrix, transforms.mv);
+    for (size_t i = 0; i < Array_Len(lights_spot) && i < MAX_SPOT_LIGHTS; i++)
+    {
+        Spot_Shadow* shadow = &spot_shadows[i];
+        if (!shadow->redraw) continue;
 
-#ifdef LIGHTING_HANDLES_NON_UNIFORM_SCALING
-        // normal matrix = inverse-transpose of the upper-left 3x3 of mv
-        mat3 mv3, normal3;
-        glm_mat4_pick3(mv_matrix, mv3);     // take upper-left 3x3
-        glm_mat3_inv(mv3, normal3);
-        glm_mat3_transpose(normal3);
-        glm_mat4_identity(transforms.normal);
-        glm_mat4_ins3(normal3, transforms.normal);
-#endif
+        SDL_SetGPUViewport(spot_shadow_pass, &(SDL_GPUViewport)
+        {
+            .x = (float)shadow->tile_x, .y = (float)shadow->tile_y,
+            .w = (float)shadow->tile_size, .h = (float)shadow->tile_size,
+            .min_depth = 0.0f, .max_depth = 1.0f
+        });
+        SDL_SetGPUScissor(spot_shadow_pass, &(SDL_Rect){ shadow->tile_x, shadow->tile_y, shadow->tile_size, shadow->tile_size });
 
+        // a load op can only clear the whole atlas
+        SDL_BindGPUGraphicsPipeline(spot_shadow_pass, pipeline_shadow_clear);
+        int flipX = 0;
         SDL_PushGPUVertexUniformData
         (
             command_buffer, 
-            0, 
-            &transforms, 
-            sizeof(transforms)
+            0, // uniform buffer slot
+            &flipX, 
+            sizeof(int)
         );
+        SDL_DrawGPUPrimitives(spot_shadow_pass, 6, 1, 0, 0);
 
-        SDL_PushGPUVertexUniformData
-        (
-            command_buffer, 
-            1, 
-            &models_bone_animated[i].animation_rig.storage_buffer_offset_bytes, 
-            sizeof(Uint32)
-        );
+        Render_Models(spot_shadow_pass, command_buffer, RENDER_MODEL_PASS_SHADOW_SPOT, &shadow->view);
+    }
 
-        SDL_BindGPUVertexBuffers
-        (
-            render_pass, 
-            0, // vertex buffer slot
-            (SDL_GPUBufferBinding[])
-            {
-                { 
-                    .buffer = models_bone_animated[i].model.mesh.vertex_buffer, 
-                    .offset = 0 
-                },
-            }, 
-            1 // vertex buffer count
-        );            
-        
-        SDL_BindGPUIndexBuffer
-        (
-            render_pass, 
-            &(SDL_GPUBufferBinding)
-            { 
-                .buffer = models_bone_animated[i].model.mesh.index_buffer, 
-                .offset = 0 
-            }, 
-            SDL_GPU_INDEXELEMENTSIZE_16BIT
-        );
-        
-        SDL_BindGPUFragmentSamplers
+    SDL_EndGPURenderPass(spot_shadow_pass);
+    return true;
+}
+
+// Turns the cascade atlas into exponential variance moments (shadow_moments_textures[0]), then blurs them
+// horizontally into [1] and back; the blur runs over the whole atlas, so the main pass keeps blur_reach from the tiles' edges
+static bool Render_ShadowMoments(SDL_GPUCommandBuffer* command_buffer)
+{
+    Uint32 groups = (2 * SHADOW_MAP_SIZE + 7) / 8;
+
+    SDL_GPUComputePass* moments_pass = SDL_BeginGPUComputePass
+    (
+        command_buffer,
+        (SDL_GPUStorageTextureReadWriteBinding[])
+        {{
+            .texture = shadow_moments_textures[0],
+            .cycle = true
+        }},
+        1,
+        NULL,
+        0
+    );
+    if (!moments_pass)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin shadow moments pass: %s", SDL_GetError());
+        return false;
+    }
+    SDL_BindGPUComputePipeline(moments_pass, pipeline_shadow_moments);
+    SDL_BindGPUComputeSamplers
+    (
+        moments_pass,
+        0, // first slot
+        &(SDL_GPUTextureSamplerBinding){ .texture = shadow_map_texture, .sampler = sampler_nearest_nomips },
+        1 // num_bindings
+    );
+    SDL_DispatchGPUCompute(moments_pass, groups, groups, 1);
+    SDL_EndGPUComputePass(moments_pass);
+
+    for (int i = 0; i < 2; i++)
+    {
+        Uint8 horizontal = (i == 0); // the texture written is the direction, as in the bloom blur
+        SDL_GPUComputePass* blur_pass = SDL_BeginGPUComputePass
         (
-            render_pass, 
-            0, // fragment sampler slot
-            (SDL_GPUTextureSamplerBinding[])
+            command_buffer,
+            (SDL_GPUStorageTextureReadWriteBinding[])
             {{
-                .texture = models_bone_animated[i].model.mesh.material.texture_diffuse, 
-                .sampler = sampler_albedo
-            }}, 
-            1 // num_bindings
+                .texture = shadow_moments_textures[horizontal],
+                .cycle = true
+            }},
+            1,
+            NULL,
+            0
         );
-
-        SDL_DrawGPUIndexedPrimitives
+        if (!blur_pass)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin shadow moments blur pass: %s", SDL_GetError());
+            return false;
+        }
+        SDL_BindGPUComputePipeline(blur_pass, pipeline_gaussian_blur);
+        SDL_BindGPUComputeSamplers
         (
-            render_pass,
-            (Uint32)models_bone_animated[i].model.mesh.index_count, // num_indices
-            1,  // num_instances
-            0,  // first_index
-            0,  // vertex_offset
-            0   // first_instance
+            blur_pass,
+            0, // first slot
+            &(SDL_GPUTextureSamplerBinding){ .texture = shadow_moments_textures[!horizontal], .sampler = sampler_linear_nomips },
+            1 // num_bindings
         );
+        UBO_Gaussian_Blur ubo_gaussian_blur = 
+        {
+            .horizontal = horizontal,
+            .stride = SHADOW_MOMENTS_BLUR_STRIDE,
+            .uv_max = { 1.0f, 1.0f }
+        };
+        SDL_PushGPUComputeUniformData(command_buffer, 0, &ubo_gaussian_blur, sizeof(ubo_gaussian_blur));
+        SDL_DispatchGPUCompute(blur_pass, groups, groups, 1);
+        SDL_EndGPUComputePass(blur_pass);
     }
+    return true;
 }
 
 static bool Render_Text(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer* command_buffer)
@@ -988,9 +1547,60 @@ static void Render_Sprite(SDL_GPURenderPass* render_pass, SDL_GPUCommandBuffer*
     }
 }
 
+// Dynamic resolution: the screen sized render targets keep their size, and every pass up to the swapchain draws into
+// the top left render_scale of them (render_width x render_height); the swapchain pass scales that up to the window
+#define DYNAMIC_RESOLUTION_SLACK 1.05           // a frame this much over the target still counts as on time
+#define DYNAMIC_RESOLUTION_STEP_DOWN_MAX 0.1f   // of the scale in one frame, so one hitch doesn't drop it to the minimum
+#define DYNAMIC_RESOLUTION_STEP_UP 0.01f        // a frame, once frames have been on time for a while
+#define DYNAMIC_RESOLUTION_SETTLE_FRAMES 30
+
+// Once a frame, with how long it took (without the frame limiter's wait); the next Render draws at the new scale
+void Render_UpdateDynamicResolution(double frame_time)
+{
+    static Uint32 frames_on_time = 0;
+    if (!(settings_render & SETTINGS_RENDER_DYNAMIC_RESOLUTION))
+    {
+        render_scale = 1.0f;
+        frames_on_time = 0;
+        return;
+    }
+
+    if (frame_time > dynamic_resolution_target_frame_time * DYNAMIC_RESOLUTION_SLACK)
+    {
+        // most of the frame goes with the pixel count, the square of the scale
+        float wanted = render_scale * SDL_sqrtf((float)(dynamic_resolution_target_frame_time / frame_time));
+        render_scale = SDL_max(wanted, render_scale - DYNAMIC_RESOLUTION_STEP_DOWN_MAX);
+        frames_on_time = 0;
+    }
+    else if (++frames_on_time >= DYNAMIC_RESOLUTION_SETTLE_FRAMES)
+    {
+        render_scale += DYNAMIC_RESOLUTION_STEP_UP;
+    }
+    render_scale = SDL_clamp(render_scale, dynamic_resolution_min_scale, 1.0f);
+}
+
+// at the start of a frame, so every pass agrees on the sub-rectangle
+static void Render_UpdateRenderSize(void)
+{
+    if (render_scale >= 1.0f)
+    {
+        render_width = virtual_screen_texture_width;
+        render_height = virtual_screen_texture_height;
+        return;
+    }
+    // even, so the half resolution passes cover exactly half of it
+    render_width = SDL_max((Uint32)((float)virtual_screen_texture_width * render_scale) & ~1u, 2);
+    render_height = SDL_max((Uint32)((float)virtual_screen_texture_height * render_scale) & ~1u, 2);
+}
+
 bool Render()
 {
-    // TODO break this up into separate states e.g. assets need reloaded, piplines need reloaded, etc.
+    // may set renderer_needs_to_be_reinitialized when settings.txt changed
+    if (!HotReload_Update())
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Some changed assets failed to reload");
+    }
+
     if (renderer_needs_to_be_reinitialized)
     {
         if (!Render_LoadRenderSettings())
@@ -998,37 +1608,7 @@ bool Render()
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load render settings");
             return false;
         }
-        // foreach(model, models_unanimated)
-        // {
-        //     Model_Free(&model);
-        // }
-        // Array_Len(models_unanimated) = 0;
-        // foreach(model_bone_animated, models_bone_animated)
-        // {
-        //     Model_BoneAnimated_Free(&model_bone_animated);
-        // }
-        // Array_Len(models_bone_animated) = 0;
-        // if (!Model_Load_AllScenes())
-        // {
-        //     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to reload models");
-        //     return false;
-        // }
-        // foreach(sprite, sprites)
-        // {
-        //     SDL_ReleaseGPUTexture(gpu_device, sprite.texture);
-        // }
-        // Array_Len(sprites) = 0;
-        // if (!Sprite_LoadSprites())
-        // {
-        //     SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to reload sprites");
-        //     return false;
-        // }
-        // Array_Len(lights_spot) = 0;
-        // if (!Lights_LoadLights())
-        // {
-        //     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to reload lights");
-        //     return false;
-        // }
+        // assets are not reloaded here; changed models, textures and shaders are picked up one by one in HotReload_Update
         if (!Render_Init())
         {
             return false;
@@ -1036,10 +1616,60 @@ bool Render()
         renderer_needs_to_be_reinitialized = false;
     }
 
+    Render_UpdateRenderSize();
+    // from the screen sized render targets' uv to the drawn sub-rectangle's, and the same for the half resolution ones
+    vec2 render_uv_scale = { (float)render_width / (float)virtual_screen_texture_width, (float)render_height / (float)virtual_screen_texture_height };
+    vec2 render_uv_scale_half = { (float)(render_width / 2) / (float)(virtual_screen_texture_width / 2), (float)(render_height / 2) / (float)(virtual_screen_texture_height / 2) };
+
+    // submitted before this frame's draws, so anything it makes visible is already uploaded
+    if (!Loader_Update())
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Some streamed assets failed to load");
+    }
+
+    if (!Streamer_Update())
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Some textures failed to stream");
+    }
+
+    // before any pass, so the shadow, prepass and main passes agree on the geometry
+    // against the pixels actually drawn, so a lower render_scale also coarsens the geometry
+    Model_SelectLODs(camera_active, (float)render_height);
+
     if (Array_Len(models_bone_animated)) Model_JointMat_UpdateAndUpload();
 
     Lights_Update();
 
+    // after the lights, which place the shadow frustum
+    Model_UpdateVisibility(camera_active, light_viewproj_matrix);
+
+    // the frame's buffer uploads share one copy pass, submitted before the draws that read them
+    SDL_GPUCommandBuffer* command_buffer_upload = SDL_AcquireGPUCommandBuffer(gpu_device);
+    if (command_buffer_upload == NULL)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "SDL_AcquireGPUCommandBuffer failed: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUCopyPass* upload_pass = SDL_BeginGPUCopyPass(command_buffer_upload);
+
+    if (!Lights_Upload(upload_pass))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Failed to upload lights; they are retried next frame");
+    }
+
+    if (!Render_UpdateTransforms(upload_pass))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Failed to upload model transforms; models are skipped this frame");
+    }
+
+    SDL_EndGPUCopyPass(upload_pass);
+    SDL_SubmitGPUCommandBuffer(command_buffer_upload);
+
+    if (!GPUCull_Update(camera_active))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "GPU culling failed; static batches are drawn without it this frame");
+    }
+
     SDL_GPUCommandBuffer* command_buffer_draw = SDL_AcquireGPUCommandBuffer(gpu_device);
     if (command_buffer_draw == NULL)
     {
@@ -1051,47 +1681,15 @@ bool Render()
     // Shadow Pass ////////////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////////////////////////
     
-    if (settings_render & SETTINGS_RENDER_ENABLE_SHADOWS)
+    if ((settings_render & SETTINGS_RENDER_ENABLE_SHADOWS) && (!Render_Shadows(command_buffer_draw) || !Render_SpotShadows(command_buffer_draw)))
     {
-        SDL_GPUDepthStencilTargetInfo shadow_target_info = 
-        {
-            .texture = shadow_map_texture,
-            .clear_depth = 1.0f,
-            .clear_stencil = 0,
-            .load_op = SDL_GPU_LOADOP_CLEAR,
-            .store_op = SDL_GPU_STOREOP_STORE,
-            .stencil_load_op = SDL_GPU_LOADOP_DONT_CARE,
-            .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
-            .cycle = true
-        };
-
-        SDL_GPURenderPass* shadow_pass = SDL_BeginGPURenderPass
-        (
-            command_buffer_draw,
-            NULL, 
-            0,
-            &shadow_target_info
-        );
-        if (!shadow_pass)
-        {
-            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin shadow pass: %s", SDL_GetError());
-            SDL_CancelGPUCommandBuffer(command_buffer_draw);
-            return true;
-        }
-        
-        SDL_SetGPUViewport(shadow_pass, &(SDL_GPUViewport)
-        {
-            .x = 0, .y = 0,
-            .w = (float)SHADOW_MAP_SIZE, .h = (float)SHADOW_MAP_SIZE,
-            .min_depth = 0.0f, .max_depth = 1.0f
-        });
-
-        Render_Unanimated_Shadow(shadow_pass, command_buffer_draw);
-
-        // TODO add bone animated shadow rendering (need a different vert shader)
-        // Render_BoneAnimated_Shadow(shadow_pass, command_buffer_draw);
-
-        SDL_EndGPURenderPass(shadow_pass);
+        SDL_CancelGPUCommandBuffer(command_buffer_draw);
+        return true;
+    }
+    if ((settings_render & SETTINGS_RENDER_ENABLE_SHADOWS) && (settings_render & SETTINGS_RENDER_FILTERED_SHADOWS) && !Render_ShadowMoments(command_buffer_draw))
+    {
+        SDL_CancelGPUCommandBuffer(command_buffer_draw);
+        return true;
     }
 
     ///////////////////////////////////////////////////////////////////////////
@@ -1146,16 +1744,60 @@ bool Render()
     { 
         .x = 0, 
         .y = 0,
-        .w = (int)virtual_screen_texture_width, 
-        .h = (int)virtual_screen_texture_height,
+        .w = (int)render_width, 
+        .h = (int)render_height,
         .min_depth = 0.0f, 
         .max_depth = 1.0f
     });
 
-    Render_Unanimated_Prepass(prepass_render_pass, command_buffer_draw);
+    Render_Models(prepass_render_pass, command_buffer_draw, RENDER_MODEL_PASS_PREPASS, NULL);
 
     SDL_EndGPURenderPass(prepass_render_pass);
 
+    ///////////////////////////////////////////////////////////////////////////
+    // Occlusion Culling //////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////
+
+    GPUCull_UpdateOcclusion(command_buffer_draw, prepass_texture);
+
+    // whatever came out from behind last frame's occluders, on top of the prepass
+    if (GPUCull_HasLateDraws())
+    {
+        prepass_target_info.load_op = SDL_GPU_LOADOP_LOAD;
+        prepass_target_info.cycle = false;
+        prepass_target_info.cycle_resolve_texture = false;
+        depth_stencil_target_info.load_op = SDL_GPU_LOADOP_LOAD;
+        depth_stencil_target_info.cycle = false;
+
+        SDL_GPURenderPass* prepass_late_render_pass = SDL_BeginGPURenderPass
+        (
+            command_buffer_draw,
+            &prepass_target_info,
+            1,
+            &depth_stencil_target_info
+        );
+        if (!prepass_late_render_pass)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Failed to begin late prepass render pass: %s", SDL_GetError());
+            SDL_CancelGPUCommandBuffer(command_buffer_draw);
+            return true;
+        }
+
+        SDL_SetGPUViewport(prepass_late_render_pass, &(SDL_GPUViewport)
+        { 
+            .x = 0, 
+            .y = 0,
+            .w = (int)render_width, 
+            .h = (int)render_height,
+            .min_depth = 0.0f, 
+            .max_depth = 1.0f
+        });
+
+        Render_Models(prepass_late_render_pass, command_buffer_draw, RENDER_MODEL_PASS_PREPASS_LATE, NULL);
+
+        SDL_EndGPURenderPass(prepass_late_render_pass);
+    }
+
     ///////////////////////////////////////////////////////////////////////////
     // Downsample Prepass /////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////////////////////////
@@ -1180,7 +1822,7 @@ bool Render()
         &prepass_texture,
         1 // num_bindings
     );
-    SDL_DispatchGPUCompute(prepass_downsample_pass, virtual_screen_texture_width / 8, virtual_screen_texture_height / 8, 1);
+    SDL_DispatchGPUCompute(prepass_downsample_pass, (render_width / 2 + 7) / 8, (render_height / 2 + 7) / 8, 1);
     SDL_EndGPUComputePass(prepass_downsample_pass);
     
     ///////////////////////////////////////////////////////////////////////////
@@ -1217,8 +1859,8 @@ bool Render()
         { 
             .x = 0, 
             .y = 0,
-            .w = (int)virtual_screen_texture_width / 2, 
-            .h = (int)virtual_screen_texture_height / 2,
+            .w = (int)render_width / 2, 
+            .h = (int)render_height / 2,
             .min_depth = 0.0f, 
             .max_depth = 1.0f
         });
@@ -1254,6 +1896,7 @@ bool Render()
             .intensity = 1.0f,
             .power = 1.0f,
             .kernel_size = 16.0f,
+            .uv_scale = { render_uv_scale_half[0], render_uv_scale_half[1] },
         };
 
         glm_mat4_copy(camera_active->projection_matrix, ubo_ssao.projection_matrix);
@@ -1304,10 +1947,20 @@ bool Render()
             .normal_power = 8.0f
         };
         SDL_PushGPUComputeUniformData(command_buffer_draw, 0, &ubo_ssao_upsample, sizeof(ubo_ssao_upsample));
-        SDL_DispatchGPUCompute(ssao_upsample_pass, virtual_screen_texture_width / 8, virtual_screen_texture_height / 8, 1);
+        SDL_DispatchGPUCompute(ssao_upsample_pass, (render_width + 7) / 8, (render_height + 7) / 8, 1);
         SDL_EndGPUComputePass(ssao_upsample_pass);
     }
 
+    ///////////////////////////////////////////////////////////////////////////
+    // Light Clusters /////////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////
+
+    if (!Clusters_Update(command_buffer_draw, camera_active))
+    {
+        SDL_CancelGPUCommandBuffer(command_buffer_draw);
+        return true;
+    }
+
     ///////////////////////////////////////////////////////////////////////////
     // Main Pass //////////////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////////////////////////
@@ -1360,14 +2013,20 @@ bool Render()
     { 
         .x = 0, 
         .y = 0,
-        .w = (int)virtual_screen_texture_width, 
-        .h = (int)virtual_screen_texture_height,
+        .w = (int)render_width, 
+        .h = (int)render_height,
         .min_depth = 0.0f, 
         .max_depth = 1.0f
     });
 
     // can't skip these bindings, even if shadows & ssao are disabled
     // would need a separate pipeline if I wanted this for performance
+    SDL_GPUTextureSamplerBinding shadow_binding = { .texture = shadow_map_texture, .sampler = sampler_nearest_nomips };
+    if (settings_render & SETTINGS_RENDER_FILTERED_SHADOWS)
+    {
+        shadow_binding.texture = shadow_moments_textures[0];
+        shadow_binding.sampler = sampler_linear_nomips;
+    }
     SDL_GPUTextureSamplerBinding ssao_binding;
     if (settings_render & SETTINGS_RENDER_UPSCALE_SSAO)
     {
@@ -1385,18 +2044,19 @@ bool Render()
         3, // we start at 3 because 0-2 are set per draw call
         (SDL_GPUTextureSamplerBinding[])
         {
-            { .texture = shadow_map_texture, .sampler = sampler_nearest_nomips },
-            ssao_binding
+            shadow_binding,
+            ssao_binding,
+            { .texture = spot_shadow_atlas_texture, .sampler = sampler_nearest_nomips },
         },
-        2 // num_bindings
+        3 // num_bindings
     );
 
     SDL_BindGPUFragmentStorageBuffers
     (
         virtual_render_pass,
         0, // storage buffer slot
-        &lights_storage_buffer,
-        1 // storage buffer count
+        (SDL_GPUBuffer*[]){ lights_storage_buffer, lights_point_storage_buffer, Clusters_GetBuffer() },
+        3 // storage buffer count
     );
 
     UBO_Main_Frag ubo_main_frag =
@@ -1410,14 +2070,16 @@ bool Render()
             1.0f / (float)(virtual_screen_texture_height)
         },
         .settings_render = settings_render,
-        ._padding = 0.0f
+        ._padding = 0.0f,
+        .cluster_tile_scale = { (float)CLUSTER_GRID_X / (float)render_width, (float)CLUSTER_GRID_Y / (float)render_height },
     };
+    Clusters_GetDepthSlicing(camera_active, &ubo_main_frag.cluster_depth_scale, &ubo_main_frag.cluster_depth_bias);
+    glm_mat4_copy(camera_active->view_matrix, ubo_main_frag.view_matrix);
+    glm_mat4_inv(camera_active->view_matrix, ubo_main_frag.inverse_view_matrix);
 
     SDL_PushGPUFragmentUniformData(command_buffer_draw, 0, &ubo_main_frag, sizeof(ubo_main_frag));
 
-    Render_Unanimated(virtual_render_pass, command_buffer_draw);
-
-    Render_BoneAnimated(virtual_render_pass, command_buffer_draw);
+    Render_Models(virtual_render_pass, command_buffer_draw, RENDER_MODEL_PASS_MAIN, NULL);
 
     SDL_EndGPURenderPass(virtual_render_pass);
 
@@ -1451,6 +2113,16 @@ bool Render()
             return true;
         }
 
+        SDL_SetGPUViewport(fog_render_pass, &(SDL_GPUViewport)
+        { 
+            .x = 0, 
+            .y = 0,
+            .w = (int)render_width, 
+            .h = (int)render_height,
+            .min_depth = 0.0f, 
+            .max_depth = 1.0f
+        });
+
         SDL_BindGPUGraphicsPipeline(fog_render_pass, pipeline_fog);
 
         int flipX = 0;
@@ -1485,6 +2157,7 @@ bool Render()
             .height_fog_enable = 0.0f,
             .fog_height = 0.0f,
             .height_falloff = 0.0f,
+            .uv_scale = { render_uv_scale[0], render_uv_scale[1] },
         };
         glm_mat4_inv(camera_active->projection_matrix, ubo_fog_frag.inv_proj_mat);
         glm_mat4_inv(camera_active->view_matrix, ubo_fog_frag.inv_view_mat);
@@ -1541,7 +2214,7 @@ bool Render()
             .exposure = 1.0f
         };
         SDL_PushGPUComputeUniformData(command_buffer_draw, 0, &ubo_bloom_threshold, sizeof(ubo_bloom_threshold));
-        SDL_DispatchGPUCompute(bloom_threshold_pass, virtual_screen_texture_width / 8, virtual_screen_texture_height / 8, 1);
+        SDL_DispatchGPUCompute(bloom_threshold_pass, (render_width / 2 + 7) / 8, (render_height / 2 + 7) / 8, 1);
         SDL_EndGPUComputePass(bloom_threshold_pass);
 
         // Gaussian Blur Passes ///////////////////////////////////////////////
@@ -1581,10 +2254,15 @@ bool Render()
             UBO_Gaussian_Blur ubo_gaussian_blur = 
             {
                 .horizontal = horizontal,
-                .stride = (float)i * bloom_spreadFactor
+                .stride = (float)i * bloom_spreadFactor,
+                .uv_max = // the last drawn texel's center; past it is left over from larger frames
+                {
+                    ((float)(render_width / 2) - 0.5f) / (float)(virtual_screen_texture_width >> 1),
+                    ((float)(render_height / 2) - 0.5f) / (float)(virtual_screen_texture_height >> 1)
+                }
             };
             SDL_PushGPUComputeUniformData(command_buffer_draw, 0, &ubo_gaussian_blur, sizeof(ubo_gaussian_blur));
-            SDL_DispatchGPUCompute(bloom_blur_pass, virtual_screen_texture_width / 8, virtual_screen_texture_height / 8, 1);
+            SDL_DispatchGPUCompute(bloom_blur_pass, (render_width / 2 + 7) / 8, (render_height / 2 + 7) / 8, 1);
             SDL_EndGPUComputePass(bloom_blur_pass);
 
             horizontal = !horizontal;
@@ -1631,8 +2309,8 @@ bool Render()
             SDL_DispatchGPUCompute
             (
                 bloom_downsample_pass,
-                ((virtual_screen_texture_width >> i) + 7) / 8,
-                ((virtual_screen_texture_height >> i) + 7) / 8,
+                ((render_width >> i) + 7) / 8,
+                ((render_height >> i) + 7) / 8,
                 1
             );
             SDL_EndGPUComputePass(bloom_downsample_pass);
@@ -1679,8 +2357,8 @@ bool Render()
             SDL_DispatchGPUCompute
             (
                 bloom_upsample_pass,
-                ((virtual_screen_texture_width >> i) + 7) / 8,
-                ((virtual_screen_texture_height >> i) + 7) / 8,
+                ((render_width >> i) + 7) / 8,
+                ((render_height >> i) + 7) / 8,
                 1
             );
             SDL_EndGPUComputePass(bloom_upsample_pass);
@@ -1820,7 +2498,11 @@ bool Render()
         sizeof(int)
     );
 
-    SDL_PushGPUFragmentUniformData(command_buffer_draw, 0, &settings_render, sizeof(settings_render));
+    UBO_Swapchain_Frag ubo_swapchain_frag =
+    {
+        .settings_render = settings_render,
+        .uv_scale = { render_uv_scale[0], render_uv_scale[1] },
+    };
 
     SDL_GPUTextureSamplerBinding fullscreen_texture_binding = 
     { 
@@ -1837,8 +2519,11 @@ bool Render()
     {
         fullscreen_texture_binding.texture = texture_ui;
         fullscreen_texture_binding.sampler = sampler_nearest_nomips;
+        ubo_swapchain_frag.uv_scale[0] = ubo_swapchain_frag.uv_scale[1] = 1.0f; // the UI is drawn at full size
     }
 
+    SDL_PushGPUFragmentUniformData(command_buffer_draw, 0, &ubo_swapchain_frag, sizeof(ubo_swapchain_frag));
+
     SDL_BindGPUFragmentSamplers
     (
         swapchain_render_pass, 
@@ -1864,9 +2549,9 @@ bool Render()
         sizeof(int)
     );
 
-    // disable post-processing effects for UI (e.g. bloom)
-    Uint32 settings_render_ui = 0;
-    SDL_PushGPUFragmentUniformData(command_buffer_draw, 0, &settings_render_ui, sizeof(settings_render_ui));
+    // disable post-processing effects for UI (e.g. bloom); the UI is drawn at full size
+    UBO_Swapchain_Frag ubo_swapchain_frag_ui = { .settings_render = 0, .uv_scale = { 1.0f, 1.0f } };
+    SDL_PushGPUFragmentUniformData(command_buffer_draw, 0, &ubo_swapchain_frag_ui, sizeof(ubo_swapchain_frag_ui));
 
     SDL_BindGPUFragmentSamplers
     (
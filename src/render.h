@@ -7,6 +7,20 @@
 #include "model.h"
 #include "lights.h"
 
+// pushed for every model draw; the rest of what the vertex shaders need is in the transform storage buffer
+Struct (UBO_Draw)
+{
+    Uint32 transform_index;    // Model.transform_index
+    Uint32 joint_offset_bytes; // bone animated only (Animation_Rig.storage_buffer_offset_bytes)
+    Uint32 _padding[2];
+};
+
+// pushed once per cascade or spot light tile by the shadow passes (see lights.h)
+Struct (UBO_Shadow)
+{
+    mat4 view_projection; // Shadow_View.view_projection_matrix
+};
+
 Struct (UBO_SSAO)
 {
     mat4 projection_matrix; // View -> Clip. LH, depth 0..1
@@ -17,6 +31,8 @@ Struct (UBO_SSAO)
     float intensity;
     float power;
     Uint32 kernel_size;
+    vec2 uv_scale; // of the drawn sub-rectangle (see Render_UpdateDynamicResolution)
+    float _padding[2];
 };
 
 Struct (UBO_Main_Frag)
@@ -27,6 +43,11 @@ Struct (UBO_Main_Frag)
     vec2 inverse_screen_resolution;
     Uint32 settings_render;
     float _padding;
+    float cluster_depth_scale; // see Clusters_GetDepthSlicing
+    float cluster_depth_bias;
+    vec2 cluster_tile_scale;   // clusters per pixel of the drawn sub-rectangle
+    mat4 view_matrix;          // the point and spot lights are in world space
+    mat4 inverse_view_matrix;  // view space -> world space, for the spot lights' shadow tiles
 };
 
 Struct (UBO_Fog_Frag)
@@ -47,6 +68,16 @@ Struct (UBO_Fog_Frag)
 
     mat4 inv_proj_mat;         // inverse projection (for view-ray)
     mat4 inv_view_mat;         // inverse view (view->world), for height fog
+
+    vec2 uv_scale;             // of the drawn sub-rectangle
+    float _padding1[2];
+};
+
+Struct (UBO_Swapchain_Frag)
+{
+    Uint32 settings_render;
+    float _padding;
+    vec2 uv_scale; // of the drawn sub-rectangle; 1 for the UI
 };
 
 Struct (UBO_SSAOUpsample)
@@ -61,7 +92,7 @@ Struct (UBO_Gaussian_Blur)
 {
     Uint32 horizontal;
     float stride;
-    float padding[2];
+    vec2 uv_max; // taps are clamped to it, to stay inside the drawn sub-rectangle
 };
 
 Struct (UBO_Bloom_Threshold)
@@ -81,6 +112,9 @@ Struct (UBO_Bloom_Sample)
 
 bool Render_LoadRenderSettings();
 bool Render_Init();
+void Render_ReleaseRenderTargets();
+void Render_Quit();
 bool Render();
+void Render_UpdateDynamicResolution(double frame_time);
 
 #endif // RENDER_H
\ No newline at end of file
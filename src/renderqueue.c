@@ -0,0 +1,127 @@
+#include "renderqueue.h"
+
+#define RENDERQUEUE_INITIAL_CAPACITY 256
+
+// Fibonacci hashing; the top bits of the product are the well mixed ones
+static Uint64 RenderQueue_Hash(Uint64 value, int bits)
+{
+    return (value * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+// non-negative floats order the same as their bit patterns
+static Uint64 RenderQueue_DepthBits(float depth)
+{
+    if (!(depth > 0.0f)) depth = 0.0f; // also catches NaN
+    Uint32 bits;
+    SDL_memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 16;
+}
+
+bool RenderQueue_Init(RenderQueue* queue)
+{
+    SDL_zerop(queue);
+    Array_Init(queue->items, RENDERQUEUE_INITIAL_CAPACITY);
+    if (!queue->items)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate render queue");
+        return false;
+    }
+    return true;
+}
+
+void RenderQueue_Free(RenderQueue* queue)
+{
+    Array_Free(queue->items);
+    SDL_free(queue->scratch);
+    SDL_zerop(queue);
+}
+
+void RenderQueue_Begin(RenderQueue* queue, RenderQueue_Order order)
+{
+    Array_Len(queue->items) = 0;
+    queue->order = order;
+}
+
+// depth is the view space distance of the model's nearest point (or anything that orders the same way)
+bool RenderQueue_Push(RenderQueue* queue, RenderQueue_Kind kind, Model* model, float depth, Uint32 joint_offset_bytes)
+{
+    Uint64 depth_bits = RenderQueue_DepthBits(depth);
+    const Material* material = &model->mesh.material;
+    Uint64 pools = ((Uint64)MaterialPool_GetPool(material->texture_diffuse) << 32) | 
+                   ((Uint64)MaterialPool_GetPool(material->texture_metallic_roughness) << 16) | 
+                   MaterialPool_GetPool(material->texture_normal);
+    Uint64 material_bits = RenderQueue_Hash(pools, 20);
+    Uint64 mesh_bits = RenderQueue_Hash((Uint64)(uintptr_t)model->mesh.vertex_buffer, 24);
+
+    RenderQueue_Item item =
+    {
+        .model = model,
+        .joint_offset_bytes = joint_offset_bytes,
+        .kind = kind,
+    };
+    if (queue->order == RENDERQUEUE_ORDER_FRONT_TO_BACK)
+        item.key = ((Uint64)kind << 60) | (depth_bits << 44) | (material_bits << 24) | mesh_bits;
+    else
+        item.key = ((Uint64)kind << 60) | (material_bits << 40) | (mesh_bits << 16) | depth_bits;
+
+    if (!Array_Append(queue->items, item))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to grow render queue");
+        return false;
+    }
+    return true;
+}
+
+// Stable LSD radix sort on the keys, one byte per pass; a byte that is the same in every key is skipped
+bool RenderQueue_Sort(RenderQueue* queue)
+{
+    size_t count = Array_Len(queue->items);
+    if (count < 2) return true;
+
+    if (queue->scratch_capacity < count)
+    {
+        size_t capacity = SDL_max(count, queue->scratch_capacity * 2);
+        RenderQueue_Item* scratch = SDL_realloc(queue->scratch, sizeof(RenderQueue_Item) * capacity);
+        if (scratch == NULL)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate render queue sort buffer");
+            return false;
+        }
+        queue->scratch = scratch;
+        queue->scratch_capacity = capacity;
+    }
+
+    RenderQueue_Item* source = queue->items;
+    RenderQueue_Item* destination = queue->scratch;
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = {0};
+        for (size_t i = 0; i < count; i++)
+        {
+            offsets[(source[i].key >> shift) & 0xFF]++;
+        }
+        if (offsets[(source[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t total = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            size_t bucket_count = offsets[i];
+            offsets[i] = total;
+            total += bucket_count;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            destination[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+
+        RenderQueue_Item* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    if (source != queue->items)
+    {
+        SDL_memcpy(queue->items, source, sizeof(RenderQueue_Item) * count);
+    }
+    return true;
+}
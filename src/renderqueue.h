@@ -0,0 +1,59 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "array.h"
+#include "model.h"
+
+/*
+    Render queue
+    a pass pushes one item per visible model with a packed 64 bit sort key, sorts the queue (LSD radix sort, 8 bits at a time)
+    and issues the items in key order, binding only what changed since the previous item (see Render_Models in render.c)
+    key layouts, most significant bits first:
+        RENDERQUEUE_ORDER_FRONT_TO_BACK  kind:4 | depth:16 | material:20 | mesh:24   depth only passes, for early-z
+        RENDERQUEUE_ORDER_STATE          kind:4 | material:20 | mesh:24 | depth:16   material heavy passes, for the fewest binds
+    kind picks the pipeline, so items of one pipeline are always together
+    depth is the top 16 bits of a non-negative float, so the buckets grow with distance along with the float's exponent
+    material is a hash of the material pools the textures are in (materials in the same pools share their binds),
+    mesh a hash of the vertex buffer; a collision only costs a redundant bind
+*/
+
+Enum (Uint8, RenderQueue_Kind)
+{
+    RENDERQUEUE_KIND_UNANIMATED,
+    RENDERQUEUE_KIND_INSTANCED,
+    RENDERQUEUE_KIND_BONE_ANIMATED,
+    RENDERQUEUE_KIND_COUNT
+};
+
+Enum (Uint8, RenderQueue_Order)
+{
+    RENDERQUEUE_ORDER_FRONT_TO_BACK,
+    RENDERQUEUE_ORDER_STATE,
+};
+
+Struct (RenderQueue_Item)
+{
+    Uint64 key;
+    Model* model;
+    Uint32 joint_offset_bytes; // bone animated only (Animation_Rig.storage_buffer_offset_bytes)
+    RenderQueue_Kind kind;
+};
+
+Struct (RenderQueue)
+{
+    RenderQueue_Item Array items;
+    RenderQueue_Item* scratch; // radix sort ping-pong buffer
+    size_t scratch_capacity;
+    RenderQueue_Order order;
+};
+
+bool RenderQueue_Init(RenderQueue* queue);
+void RenderQueue_Free(RenderQueue* queue);
+void RenderQueue_Begin(RenderQueue* queue, RenderQueue_Order order);
+bool RenderQueue_Push(RenderQueue* queue, RenderQueue_Kind kind, Model* model, float depth, Uint32 joint_offset_bytes);
+bool RenderQueue_Sort(RenderQueue* queue);
+
+#endif // RENDERQUEUE_H
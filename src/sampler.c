@@ -106,5 +106,34 @@ bool Sampler_Init()
         return false;
     }
 
+    // exact texel reads at an explicit level (the Hi-Z pyramid, see gpucull.h)
+    if (sampler_nearest_mips)
+    {
+        SDL_ReleaseGPUSampler(gpu_device, sampler_nearest_mips);
+        sampler_nearest_mips = NULL;
+    }
+    sampler_nearest_mips = SDL_CreateGPUSampler
+    (
+        gpu_device,
+        &(SDL_GPUSamplerCreateInfo)
+        {
+            .min_filter = SDL_GPU_FILTER_NEAREST,
+            .mag_filter = SDL_GPU_FILTER_NEAREST,
+            .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST,
+            .address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+            .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+            .address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+            .min_lod = 0.0f,
+            .max_lod = 16.0f,
+            .enable_anisotropy = false,
+            .enable_compare = false,
+        }
+    );
+    if (!sampler_nearest_mips)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create nearest mip sampler: %s", SDL_GetError());
+        return false;
+    }
+
     return true;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "sprite.h"
 #include "globals.h"
 #include "texture.h"
+#include "gpumemory.h"
 
 // TODO switch to sprite sheets, add UV coordinates to Sprite struct
 // (current implementation uses a dedicated texture for each sprite)
@@ -9,35 +10,26 @@
 
 static bool Sprite_Load(const char* sprite_name, Sprite* sprite)
 {
-    SDL_Surface* texture_surface = LoadImage(sprite_name);
-    if (!texture_surface)
+    Texture_Data texture_data;
+    if (!Texture_Load(sprite_name, TEXTURE_USAGE_ALBEDO, &texture_data))
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load texture from URI: %s", sprite_name);
         return false;
     }
-    sprite->texture = SDL_CreateGPUTexture(gpu_device, &(SDL_GPUTextureCreateInfo)
-    {
-        .type = SDL_GPU_TEXTURETYPE_2D,
-        .format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB,
-        .width = (Uint32)texture_surface->w,
-        .height = (Uint32)texture_surface->h,
-        .layer_count_or_depth = 1,
-        .num_levels = n_mipmap_levels, 
-        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_COLOR_TARGET // COLOR_TARGET is needed for mipmap generation
-    });
+    sprite->texture = Texture_CreateGPUTexture(&texture_data, sprite_name);
     if (sprite->texture == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create main texture: %s", SDL_GetError());
-        SDL_DestroySurface(texture_surface);
+        Texture_Free(&texture_data);
         return false;
     }
 
-    sprite->aspect_ratio = (float)texture_surface->w / (float)texture_surface->h;
+    sprite->aspect_ratio = (float)texture_data.width / (float)texture_data.height;
 
-    Uint32 texture_data_size = (Uint32)texture_surface->w * texture_surface->h * 4;
-    SDL_GPUTransferBuffer* texture_transfer_buffer = SDL_CreateGPUTransferBuffer
+    Uint32 texture_data_size = Texture_GetTransferSize(&texture_data);
+    SDL_GPUTransferBuffer* texture_transfer_buffer = GPUMemory_CreateTransferBuffer
     (
-        gpu_device,
+        sprite_name,
         &(SDL_GPUTransferBufferCreateInfo)
         {
             .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
@@ -47,8 +39,8 @@ static bool Sprite_Load(const char* sprite_name, Sprite* sprite)
     if (texture_transfer_buffer == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create texture transfer buffer: %s", SDL_GetError());
-        SDL_DestroySurface(texture_surface);
-        SDL_ReleaseGPUTexture(gpu_device, sprite->texture);
+        Texture_Free(&texture_data);
+        GPUMemory_ReleaseTexture(sprite->texture);
         return false;
     }
 
@@ -56,58 +48,35 @@ static bool Sprite_Load(const char* sprite_name, Sprite* sprite)
     if (texture_transfer_mapped == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map texture transfer buffer: %s", SDL_GetError());
-        SDL_DestroySurface(texture_surface);
-        SDL_ReleaseGPUTexture(gpu_device, sprite->texture);
-        SDL_ReleaseGPUTransferBuffer(gpu_device, texture_transfer_buffer);
+        Texture_Free(&texture_data);
+        GPUMemory_ReleaseTexture(sprite->texture);
+        GPUMemory_ReleaseTransferBuffer(texture_transfer_buffer);
         return false;
     }
 
-    SDL_memcpy(texture_transfer_mapped, texture_surface->pixels, texture_data_size);
+    Texture_CopyToTransferBuffer(&texture_data, texture_transfer_mapped);
     SDL_UnmapGPUTransferBuffer(gpu_device, texture_transfer_buffer);
 
     SDL_GPUCommandBuffer* upload_command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
     if (upload_command_buffer == NULL)
     {
         SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to acquire upload command buffer: %s", SDL_GetError());
-        SDL_DestroySurface(texture_surface);
-        SDL_ReleaseGPUTexture(gpu_device, sprite->texture);
-        SDL_ReleaseGPUTransferBuffer(gpu_device, texture_transfer_buffer);
+        Texture_Free(&texture_data);
+        GPUMemory_ReleaseTexture(sprite->texture);
+        GPUMemory_ReleaseTransferBuffer(texture_transfer_buffer);
         return false;
     }
 
     SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(upload_command_buffer);
     
-    SDL_UploadToGPUTexture
-    (
-        copy_pass,
-        &(SDL_GPUTextureTransferInfo)
-        {
-            .transfer_buffer = texture_transfer_buffer,
-            .offset = 0,
-            .pixels_per_row = (Uint32)texture_surface->w,
-            .rows_per_layer = (Uint32)texture_surface->h
-        },
-        &(SDL_GPUTextureRegion)
-        {
-            .texture = sprite->texture,
-            .mip_level = 0,
-            .layer = 0,
-            .x = 0, .y = 0, .z = 0,
-            .w = (Uint32)texture_surface->w,
-            .h = (Uint32)texture_surface->h,
-            .d = 1
-        },
-        false
-    );
+    Texture_Upload(copy_pass, texture_transfer_buffer, 0, &texture_data, sprite->texture, 0);
 
     SDL_EndGPUCopyPass(copy_pass);
 
-    if (n_mipmap_levels > 1) SDL_GenerateMipmapsForGPUTexture(upload_command_buffer, sprite->texture);
-
     SDL_SubmitGPUCommandBuffer(upload_command_buffer);
 
-    SDL_ReleaseGPUTransferBuffer(gpu_device, texture_transfer_buffer);
-    SDL_DestroySurface(texture_surface);
+    GPUMemory_ReleaseTransferBuffer(texture_transfer_buffer);
+    Texture_Free(&texture_data);
 
     SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Successfully loaded unanimated sprite: %s", sprite_name);
 
@@ -0,0 +1,486 @@
+#include "streamer.h"
+#include "globals.h"
+#include "model.h"
+#include "gpumemory.h"
+
+Struct (Streamer_Texture)
+{
+    MaterialPool_Texture texture; // holds data.first_level and the levels below it
+    Texture_Data data;        // every level, so finer ones never wait on the disk
+    Uint32 resident_size;     // bytes of the levels on the GPU
+    Uint32 wanted_level;      // this frame
+    Uint32 next_level;        // picked for this frame's changes; STREAMER_NO_CHANGE if none
+    float distance;           // to the nearest mesh using it, this frame
+    Uint64 last_needed_frame; // last frame its finest resident level was wanted; least recently needed is evicted first
+};
+
+Struct (Streamer_Change)
+{
+    Uint32 index;
+    Uint32 first_level;
+    Uint32 offset; // into the transfer buffer
+    Uint32 size;
+    MaterialPool_Texture texture;
+};
+
+#define STREAMER_NO_CHANGE 0xFFFFFFFFu
+
+static Streamer_Texture Array streamer_textures = NULL; // sorted by texture handle
+static SDL_GPUTransferBuffer* streamer_transfer_buffer = NULL;
+static Uint64 streamer_frame = 0;
+static Uint64 streamer_resident_bytes = 0;
+static Uint32 streamer_mip_bias = 0;
+
+bool Streamer_Init(void)
+{
+    Array_Init(streamer_textures, 256);
+    if (streamer_textures == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate streamed textures array");
+        return false;
+    }
+
+    streamer_transfer_buffer = GPUMemory_CreateTransferBuffer
+    (
+        "texture streaming",
+        &(SDL_GPUTransferBufferCreateInfo)
+        {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+            .size = STREAMER_FRAME_BUDGET_BYTES
+        }
+    );
+    if (streamer_transfer_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create streaming transfer buffer: %s", SDL_GetError());
+        Array_Free(streamer_textures);
+        return false;
+    }
+
+    return true;
+}
+
+// pool layers belong to their materials; only the CPU copies are freed here
+void Streamer_Quit(void)
+{
+    if (streamer_textures)
+    {
+        for (size_t i = 0; i < Array_Len(streamer_textures); i++)
+        {
+            Texture_Free(&streamer_textures[i].data);
+        }
+        Array_Free(streamer_textures);
+    }
+    if (streamer_transfer_buffer)
+    {
+        GPUMemory_ReleaseTransferBuffer(streamer_transfer_buffer);
+        streamer_transfer_buffer = NULL;
+    }
+    streamer_resident_bytes = 0;
+}
+
+Uint64 Streamer_GetResidentBytes(void)
+{
+    return streamer_resident_bytes;
+}
+
+// Level a texture is created with before anything asks for more; safe to call from any thread
+Uint32 Streamer_GetInitialLevel(const Texture_Data* texture_data)
+{
+    Uint32 level = 0;
+    while (level + 1 < texture_data->level_count && SDL_max(texture_data->width >> level, texture_data->height >> level) > STREAMER_INITIAL_MAX_SIZE)
+    {
+        level++;
+    }
+    return Texture_ClampFirstLevel(texture_data, level);
+}
+
+static Uint32 Streamer_GetSize(const Texture_Data* texture_data, Uint32 first_level)
+{
+    Texture_Data levels = *texture_data;
+    levels.first_level = first_level;
+    return Texture_GetTransferSize(&levels);
+}
+
+// index of texture, or of where it would be inserted
+static size_t Streamer_Search(MaterialPool_Texture texture)
+{
+    size_t low = 0;
+    size_t high = Array_Len(streamer_textures);
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (streamer_textures[middle].texture < texture)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static Streamer_Texture* Streamer_Find(MaterialPool_Texture texture)
+{
+    if (streamer_textures == NULL || texture == MATERIALPOOL_TEXTURE_NONE) return NULL;
+    size_t index = Streamer_Search(texture);
+    if (index < Array_Len(streamer_textures) && streamer_textures[index].texture == texture)
+        return &streamer_textures[index];
+    return NULL;
+}
+
+static int SDLCALL Streamer_CompareTextures(const void* a, const void* b)
+{
+    MaterialPool_Texture texture_a = ((const Streamer_Texture*)a)->texture;
+    MaterialPool_Texture texture_b = ((const Streamer_Texture*)b)->texture;
+    return (texture_a > texture_b) - (texture_a < texture_b);
+}
+
+// Takes ownership of texture_data, whose first_level must be what texture was created with
+// without a streamer (or on failure) the data is just freed and the texture keeps its levels
+void Streamer_RegisterTexture(MaterialPool_Texture texture, Texture_Data* texture_data)
+{
+    if (streamer_textures == NULL || texture == MATERIALPOOL_TEXTURE_NONE)
+    {
+        Texture_Free(texture_data);
+        return;
+    }
+
+    Streamer_Texture streamed =
+    {
+        .texture = texture,
+        .data = *texture_data,
+        .resident_size = Texture_GetTransferSize(texture_data),
+        .wanted_level = texture_data->first_level,
+        .next_level = STREAMER_NO_CHANGE,
+        .distance = FLT_MAX,
+        .last_needed_frame = streamer_frame,
+    };
+    SDL_zerop(texture_data);
+
+    if (!Array_Insert(streamer_textures, Streamer_Search(texture), streamed))
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to register texture for streaming; it keeps its current levels");
+        Texture_Free(&streamed.data);
+        return;
+    }
+    streamer_resident_bytes += streamed.resident_size;
+}
+
+// called whenever a material texture is released
+void Streamer_ForgetTexture(MaterialPool_Texture texture)
+{
+    Streamer_Texture* streamed = Streamer_Find(texture);
+    if (streamed == NULL) return;
+
+    streamer_resident_bytes -= streamed->resident_size;
+    Texture_Free(&streamed->data);
+    Array_DeleteShift(streamer_textures, (size_t)(streamed - streamer_textures));
+}
+
+// Allocates pool layers for the new level sets, uploads them in one copy pass and swaps them into the materials
+// changes may reorder streamer_textures
+static bool Streamer_Apply(Streamer_Change* changes, int change_count)
+{
+    if (change_count == 0) return true;
+
+    Uint32 total_size = 0;
+    for (int i = 0; i < change_count; i++)
+    {
+        changes[i].size = Streamer_GetSize(&streamer_textures[changes[i].index].data, changes[i].first_level);
+        changes[i].offset = (total_size + 15) & ~15u; // keep every texture block aligned
+        total_size = changes[i].offset + changes[i].size;
+    }
+
+    // a change larger than the staging buffer goes alone (see Streamer_Update), in its own transfer buffer
+    bool owns_transfer_buffer = total_size > STREAMER_FRAME_BUDGET_BYTES;
+    SDL_GPUTransferBuffer* transfer_buffer = streamer_transfer_buffer;
+    if (owns_transfer_buffer)
+    {
+        transfer_buffer = GPUMemory_CreateTransferBuffer
+        (
+            "texture streaming",
+            &(SDL_GPUTransferBufferCreateInfo)
+            {
+                .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+                .size = total_size
+            }
+        );
+        if (transfer_buffer == NULL)
+        {
+            SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to create texture transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+    }
+
+    Uint8* transfer_buffer_mapped = SDL_MapGPUTransferBuffer(gpu_device, transfer_buffer, !owns_transfer_buffer); // cycle the staging buffer; last frame's upload may still be reading it
+    if (transfer_buffer_mapped == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to map texture transfer buffer: %s", SDL_GetError());
+        if (owns_transfer_buffer) GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+        return false;
+    }
+
+    bool success = true;
+    for (int i = 0; i < change_count; i++)
+    {
+        Texture_Data levels = streamer_textures[changes[i].index].data;
+        levels.first_level = changes[i].first_level;
+        changes[i].texture = MaterialPool_Allocate(&levels);
+        if (changes[i].texture == MATERIALPOOL_TEXTURE_NONE)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate streamed texture");
+            success = false;
+            continue;
+        }
+        Texture_CopyToTransferBuffer(&levels, transfer_buffer_mapped + changes[i].offset);
+    }
+    SDL_UnmapGPUTransferBuffer(gpu_device, transfer_buffer);
+
+    SDL_GPUCommandBuffer* upload_command_buffer = SDL_AcquireGPUCommandBuffer(gpu_device);
+    if (upload_command_buffer == NULL)
+    {
+        SDL_LogCritical(SDL_LOG_CATEGORY_GPU, "Failed to acquire upload command buffer: %s", SDL_GetError());
+        for (int i = 0; i < change_count; i++)
+        {
+            MaterialPool_Release(changes[i].texture);
+        }
+        if (owns_transfer_buffer) GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+        return false;
+    }
+
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(upload_command_buffer);
+    for (int i = 0; i < change_count; i++)
+    {
+        if (changes[i].texture == MATERIALPOOL_TEXTURE_NONE) continue;
+        Texture_Data levels = streamer_textures[changes[i].index].data;
+        levels.first_level = changes[i].first_level;
+        MaterialPool_Upload(copy_pass, transfer_buffer, changes[i].offset, &levels, changes[i].texture);
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_SubmitGPUCommandBuffer(upload_command_buffer);
+    if (owns_transfer_buffer) GPUMemory_ReleaseTransferBuffer(transfer_buffer);
+
+    // the upload is submitted before this frame's draws, so the swap is safe right away
+    for (int i = 0; i < change_count; i++)
+    {
+        Streamer_Texture* streamed = &streamer_textures[changes[i].index];
+        streamed->next_level = STREAMER_NO_CHANGE;
+        if (changes[i].texture == MATERIALPOOL_TEXTURE_NONE) continue;
+
+        Model_ReplaceTexture(streamed->texture, changes[i].texture);
+        MaterialPool_Release(streamed->texture);
+        streamed->texture = changes[i].texture;
+        streamed->data.first_level = changes[i].first_level;
+        streamer_resident_bytes = streamer_resident_bytes - streamed->resident_size + changes[i].size;
+        streamed->resident_size = changes[i].size;
+    }
+    SDL_qsort(streamer_textures, Array_Len(streamer_textures), sizeof(Streamer_Texture), Streamer_CompareTextures);
+
+    return success;
+}
+
+// Swaps in new contents for a streamed texture (hot reload); takes ownership of texture_data
+// the new texture keeps as much detail as the old one had
+bool Streamer_ReplaceTextureData(MaterialPool_Texture texture, Texture_Data* texture_data)
+{
+    Streamer_Texture* streamed = Streamer_Find(texture);
+    if (streamed == NULL)
+    {
+        Texture_Free(texture_data);
+        return false;
+    }
+
+    Uint32 first_level = streamed->data.first_level;
+    Texture_Free(&streamed->data);
+    streamed->data = *texture_data;
+    SDL_zerop(texture_data);
+
+    Streamer_Change change =
+    {
+        .index = (Uint32)(streamed - streamer_textures),
+        .first_level = Texture_ClampFirstLevel(&streamed->data, first_level)
+    };
+    return Streamer_Apply(&change, 1);
+}
+
+// Level wanted at a distance: every doubling past STREAMER_FULL_DETAIL_DISTANCE halves the texels a surface can show
+static Uint32 Streamer_GetLevelForDistance(float distance)
+{
+    Uint32 level = streamer_mip_bias;
+    for (Uint32 height = virtual_screen_texture_height; height > 0 && height * 2 <= STREAMER_REFERENCE_HEIGHT; height *= 2)
+    {
+        level++;
+    }
+    for (float reach = STREAMER_FULL_DETAIL_DISTANCE; distance > reach && level < TEXTURE_MAX_LEVELS; reach *= 2.0f)
+    {
+        level++;
+    }
+    return level;
+}
+
+static void Streamer_Want(const Material* material, float distance)
+{
+    Uint32 level = Streamer_GetLevelForDistance(distance);
+    MaterialPool_Texture textures[3] = { material->texture_diffuse, material->texture_metallic_roughness, material->texture_normal };
+    for (int i = 0; i < 3; i++)
+    {
+        Streamer_Texture* streamed = Streamer_Find(textures[i]);
+        if (streamed == NULL) continue;
+
+        streamed->distance = SDL_min(streamed->distance, distance);
+        streamed->wanted_level = SDL_min(streamed->wanted_level, Texture_ClampFirstLevel(&streamed->data, level));
+    }
+}
+
+static float Streamer_GetDistanceToAABB(const vec3 point, const vec3 aabb_min, const vec3 aabb_max)
+{
+    float distance_squared = 0.0f;
+    for (int i = 0; i < 3; i++)
+    {
+        float outside = SDL_max(SDL_max(aabb_min[i] - point[i], point[i] - aabb_max[i]), 0.0f);
+        distance_squared += outside * outside;
+    }
+    return SDL_sqrtf(distance_squared);
+}
+
+// least recently needed texture with levels finer than this frame wants, which isn't changing already
+static Streamer_Texture* Streamer_FindEvictionVictim(void)
+{
+    Streamer_Texture* victim = NULL;
+    for (size_t i = 0; i < Array_Len(streamer_textures); i++)
+    {
+        Streamer_Texture* streamed = &streamer_textures[i];
+        if (streamed->next_level != STREAMER_NO_CHANGE || streamed->data.first_level >= streamed->wanted_level) continue;
+        if (victim == NULL ||
+            streamed->last_needed_frame < victim->last_needed_frame ||
+            (streamed->last_needed_frame == victim->last_needed_frame && streamed->distance > victim->distance))
+        {
+            victim = streamed;
+        }
+    }
+    return victim;
+}
+
+static int SDLCALL Streamer_CompareDistances(const void* a, const void* b)
+{
+    float distance_a = streamer_textures[*(const Uint32*)a].distance;
+    float distance_b = streamer_textures[*(const Uint32*)b].distance;
+    return (distance_a > distance_b) - (distance_a < distance_b); // nearest first
+}
+
+// Once per frame, after loading and before anything is drawn
+bool Streamer_Update(void)
+{
+    if (streamer_textures == NULL || Array_Len(streamer_textures) == 0) return true;
+
+    streamer_frame++;
+
+    // every texture settles for its initial level unless a mesh asks for more
+    for (size_t i = 0; i < Array_Len(streamer_textures); i++)
+    {
+        Streamer_Texture* streamed = &streamer_textures[i];
+        streamed->wanted_level = SDL_max(Streamer_GetInitialLevel(&streamed->data), streamed->data.first_level);
+        streamed->next_level = STREAMER_NO_CHANGE;
+        streamed->distance = FLT_MAX;
+    }
+
+    for (size_t i = 0; i < Array_Len(models_unanimated); i++)
+    {
+        Model* model = &models_unanimated[i];
+        float distance = model->submeshes ? FLT_MAX : Streamer_GetDistanceToAABB(camera_active->position, model->aabb_min, model->aabb_max);
+        for (size_t ii = 0; model->submeshes && ii < Array_Len(model->submeshes); ii++)
+        {
+            distance = SDL_min(distance, Streamer_GetDistanceToAABB(camera_active->position, model->submeshes[ii].aabb_min, model->submeshes[ii].aabb_max));
+        }
+        Streamer_Want(&model->mesh.material, distance);
+    }
+    for (size_t i = 0; i < Array_Len(models_instanced); i++)
+    {
+        Model* model = &models_instanced[i]; // the nearest instance is at least this far away
+        Streamer_Want(&model->mesh.material, Streamer_GetDistanceToAABB(camera_active->position, model->aabb_min, model->aabb_max));
+    }
+    for (size_t i = 0; i < Array_Len(models_bone_animated); i++)
+    {
+        Model* model = &models_bone_animated[i].model;
+        Streamer_Want(&model->mesh.material, Streamer_GetDistanceToAABB(camera_active->position, model->aabb_min, model->aabb_max));
+    }
+
+    Uint32* candidates = SDL_malloc(sizeof(Uint32) * Array_Len(streamer_textures));
+    if (candidates == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate texture streaming candidates");
+        return false;
+    }
+    Uint32 candidate_count = 0;
+    for (size_t i = 0; i < Array_Len(streamer_textures); i++)
+    {
+        Streamer_Texture* streamed = &streamer_textures[i];
+        if (streamed->wanted_level <= streamed->data.first_level) streamed->last_needed_frame = streamer_frame;
+        if (streamed->wanted_level < streamed->data.first_level) candidates[candidate_count++] = (Uint32)i;
+    }
+    SDL_qsort(candidates, candidate_count, sizeof(Uint32), Streamer_CompareDistances);
+
+    Streamer_Change changes[STREAMER_MAX_CHANGES_PER_FRAME * 2];
+    int change_count = 0;
+    int upgrade_count = 0;
+    // what the pools actually hold, free layers below the top of a pool included; the changes below are estimated from
+    // their levels, and whatever they don't give back (see materialpool.h) still shows up here next frame
+    Sint64 projected_bytes = (Sint64)SDL_max(GPUMemory_GetCategoryBytes(GPUMEMORY_CATEGORY_TEXTURE), streamer_resident_bytes);
+    Uint32 upload_bytes = 0;
+    bool starved = false; // something nearby wants more than the budget allows
+
+    for (Uint32 c = 0; c < candidate_count; c++)
+    {
+        Streamer_Texture* streamed = &streamer_textures[candidates[c]];
+        Uint32 size = Streamer_GetSize(&streamed->data, streamed->wanted_level);
+        if (upgrade_count == STREAMER_MAX_CHANGES_PER_FRAME || (upload_bytes > 0 && upload_bytes + size > STREAMER_FRAME_BUDGET_BYTES)) break;
+
+        // make room by dropping the fine levels nobody is using
+        while (projected_bytes + size - streamed->resident_size > STREAMER_VRAM_BUDGET_BYTES && change_count < SDL_arraysize(changes) - 1)
+        {
+            Streamer_Texture* victim = Streamer_FindEvictionVictim();
+            if (victim == NULL) break;
+            victim->next_level = victim->wanted_level;
+            changes[change_count++] = (Streamer_Change){ .index = (Uint32)(victim - streamer_textures), .first_level = victim->wanted_level };
+            projected_bytes += (Sint64)Streamer_GetSize(&victim->data, victim->wanted_level) - victim->resident_size;
+        }
+        if (projected_bytes + size - streamed->resident_size > STREAMER_VRAM_BUDGET_BYTES)
+        {
+            starved = true;
+            break;
+        }
+
+        streamed->next_level = streamed->wanted_level;
+        changes[change_count++] = (Streamer_Change){ .index = candidates[c], .first_level = streamed->wanted_level };
+        upgrade_count++;
+        projected_bytes += (Sint64)size - streamed->resident_size;
+        upload_bytes += size;
+    }
+    SDL_free(candidates);
+
+    // over budget without anything to upgrade (e.g. right after a load), so evict anyway
+    while (projected_bytes > STREAMER_VRAM_BUDGET_BYTES && change_count < SDL_arraysize(changes))
+    {
+        Streamer_Texture* victim = Streamer_FindEvictionVictim();
+        if (victim == NULL)
+        {
+            starved = true;
+            break;
+        }
+        victim->next_level = victim->wanted_level;
+        changes[change_count++] = (Streamer_Change){ .index = (Uint32)(victim - streamer_textures), .first_level = victim->wanted_level };
+        projected_bytes += (Sint64)Streamer_GetSize(&victim->data, victim->wanted_level) - victim->resident_size;
+    }
+
+    // everything resident is in use and it still doesn't fit: ask every material for one level less,
+    // until a quarter of the budget is free again
+    if (starved && streamer_mip_bias < STREAMER_MAX_MIP_BIAS)
+    {
+        streamer_mip_bias++;
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Texture streaming over budget; mip bias raised to %u", streamer_mip_bias);
+    }
+    else if (!starved && streamer_mip_bias > 0 && projected_bytes < STREAMER_VRAM_BUDGET_BYTES / 4 * 3)
+    {
+        streamer_mip_bias--;
+    }
+
+    return Streamer_Apply(changes, change_count);
+}
@@ -0,0 +1,35 @@
+#ifndef STREAMER_H
+#define STREAMER_H
+
+#include <SDL3/SDL.h>
+
+#include "helper.h"
+#include "texture.h"
+#include "materialpool.h"
+
+// Material texture streaming
+// textures are allocated (see materialpool.h) with only their coarse levels (up to STREAMER_INITIAL_MAX_SIZE); every decoded level stays in RAM
+// each frame, materials on meshes near camera_active ask for finer levels by distance, and textures move to a new pool layer with them
+// (nearest first, within STREAMER_FRAME_BUDGET_BYTES of uploads), as long as the texture memory actually allocated
+// (GPUMemory_GetCategoryBytes(GPUMEMORY_CATEGORY_TEXTURE), pool layers that are free included) fits in STREAMER_VRAM_BUDGET_BYTES;
+// room is made by dropping the fine levels of the textures that went longest without needing them
+// if everything wanted still doesn't fit, a global mip bias asks every material for coarser levels until it does
+
+#define STREAMER_VRAM_BUDGET_BYTES (256 * 1024 * 1024)
+#define STREAMER_FRAME_BUDGET_BYTES (8 * 1024 * 1024) // also the size of the staging transfer buffer
+#define STREAMER_MAX_CHANGES_PER_FRAME 16
+#define STREAMER_INITIAL_MAX_SIZE 64          // largest level uploaded when a texture is loaded
+#define STREAMER_FULL_DETAIL_DISTANCE 4.0f    // materials closer than this want level 0; every doubling of distance drops a level
+#define STREAMER_REFERENCE_HEIGHT 1080        // virtual screens shorter than this drop a level per halving
+#define STREAMER_MAX_MIP_BIAS 4
+
+bool Streamer_Init(void);
+void Streamer_Quit(void);
+bool Streamer_Update(void);
+Uint32 Streamer_GetInitialLevel(const Texture_Data* texture_data);
+void Streamer_RegisterTexture(MaterialPool_Texture texture, Texture_Data* texture_data);
+void Streamer_ForgetTexture(MaterialPool_Texture texture);
+bool Streamer_ReplaceTextureData(MaterialPool_Texture texture, Texture_Data* texture_data);
+Uint64 Streamer_GetResidentBytes(void);
+
+#endif // STREAMER_H
@@ -1,6 +1,7 @@
 #include "text.h"
 #include "globals.h"
 #include "array.h"
+#include "gpumemory.h"
 
 bool Text_Init()
 {
@@ -55,9 +56,10 @@ bool Text_Init()
         return false;
     }
     Uint32 vertex_data_size = (Uint32)(MAX_TEXT_VERTEX_COUNT * sizeof(Text_Vertex));
-    text_renderable.vertex_buffer = SDL_CreateGPUBuffer
+    text_renderable.vertex_buffer = GPUMemory_CreateBuffer
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_MESH,
+        "text",
         &(SDL_GPUBufferCreateInfo)
         {
             .usage = SDL_GPU_BUFFERUSAGE_VERTEX,
@@ -77,9 +79,10 @@ bool Text_Init()
         return false;
     }
     Uint32 index_data_size = (Uint32)(MAX_TEXT_INDEX_COUNT * sizeof(int));
-    text_renderable.index_buffer = SDL_CreateGPUBuffer
+    text_renderable.index_buffer = GPUMemory_CreateBuffer
     (
-        gpu_device,
+        GPUMEMORY_CATEGORY_MESH,
+        "text",
         &(SDL_GPUBufferCreateInfo)
         {
             .usage = SDL_GPU_BUFFERUSAGE_INDEX,
@@ -94,9 +97,9 @@ bool Text_Init()
 
     Uint32 combined_data_size = vertex_data_size + index_data_size;
 
-    text_transfer_buffer = SDL_CreateGPUTransferBuffer
+    text_transfer_buffer = GPUMemory_CreateTransferBuffer
     (
-        gpu_device,
+        "text",
         &(SDL_GPUTransferBufferCreateInfo)
         {
             .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
@@ -1,5 +1,12 @@
 #include "texture.h"
 #include "globals.h"
+#include "gpumemory.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 SDL_Surface* LoadImage(const char* imageFilename)
 {
@@ -36,4 +43,661 @@ Uint8 GetTextureIndex(const char* filename)
     // This function is a placeholder for texture index retrieval logic.
     static Uint16 texture_index = 0;
     return texture_index++;
-}
\ No newline at end of file
+}
+
+// Block Compressed Containers ////////////////////////////////////////////////
+
+// Pre-compressed textures live next to their source image with the same stem
+// textures/brick.png -> textures/brick.ktx2 or textures/brick.dds
+// see compress_textures.sh for the offline encoder step
+
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDPF_FOURCC      0x4
+#define DDPF_RGB         0x40
+
+#define KTX2_LEVEL_INDEX_OFFSET 80
+#define KTX2_LEVEL_INDEX_STRIDE 24
+
+static Uint32 Texture_Read32(const Uint8* bytes)
+{
+    Uint32 value;
+    SDL_memcpy(&value, bytes, sizeof(value));
+    return SDL_Swap32LE(value);
+}
+
+static Uint64 Texture_Read64(const Uint8* bytes)
+{
+    Uint64 value;
+    SDL_memcpy(&value, bytes, sizeof(value));
+    return SDL_Swap64LE(value);
+}
+
+// the container may store UNORM or SRGB; the usage decides how the GPU interprets it
+static SDL_GPUTextureFormat Texture_FormatForUsage(SDL_GPUTextureFormat format, Texture_Usage usage)
+{
+    bool srgb = usage == TEXTURE_USAGE_ALBEDO;
+    switch (format)
+    {
+        case SDL_GPU_TEXTUREFORMAT_BC5_RG_UNORM:
+            return usage == TEXTURE_USAGE_NORMAL ? format : SDL_GPU_TEXTUREFORMAT_INVALID;
+        case SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM_SRGB:
+            if (usage == TEXTURE_USAGE_NORMAL) return SDL_GPU_TEXTUREFORMAT_INVALID; // too lossy for normals
+            return srgb ? SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM_SRGB : SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM;
+        case SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM_SRGB:
+            return srgb ? SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM_SRGB : SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM;
+        case SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM_SRGB:
+            return srgb ? SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM_SRGB : SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM;
+        case SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB:
+            return srgb ? SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB : SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+        default:
+            return SDL_GPU_TEXTUREFORMAT_INVALID;
+    }
+}
+
+// fills in level offsets/sizes for tightly packed levels, largest first
+static bool Texture_SetPackedLevels(Texture_Data* texture_data, Uint32 level_count, size_t available_size)
+{
+    Uint32 offset = 0;
+    texture_data->level_count = SDL_clamp(level_count, 1, TEXTURE_MAX_LEVELS);
+    for (Uint32 level = 0; level < texture_data->level_count; level++)
+    {
+        Uint32 level_width = SDL_max(texture_data->width >> level, 1);
+        Uint32 level_height = SDL_max(texture_data->height >> level, 1);
+        Uint32 level_size = SDL_CalculateGPUTextureFormatSize(texture_data->format, level_width, level_height, 1);
+        if ((size_t)offset + level_size > available_size)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture data is truncated at mip level %u", level);
+            return false;
+        }
+        texture_data->level_offsets[level] = offset;
+        texture_data->level_sizes[level] = level_size;
+        offset += level_size;
+    }
+    return true;
+}
+
+static bool Texture_ParseDDS(const Uint8* file, size_t file_size, Texture_Data* texture_data)
+{
+    if (file_size < 128 || SDL_memcmp(file, "DDS ", 4) != 0 || Texture_Read32(file + 4) != 124)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid DDS header");
+        return false;
+    }
+
+    Uint32 flags = Texture_Read32(file + 8);
+    texture_data->height = Texture_Read32(file + 12);
+    texture_data->width = Texture_Read32(file + 16);
+    Uint32 mip_count = (flags & DDSD_MIPMAPCOUNT) ? Texture_Read32(file + 28) : 1;
+
+    Uint32 pixel_format_flags = Texture_Read32(file + 80);
+    Uint32 four_cc = Texture_Read32(file + 84);
+    size_t data_offset = 128;
+
+    texture_data->format = SDL_GPU_TEXTUREFORMAT_INVALID;
+    if (pixel_format_flags & DDPF_FOURCC)
+    {
+        if (four_cc == SDL_FOURCC('D', 'X', 'T', '1'))
+            texture_data->format = SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM;
+        else if (four_cc == SDL_FOURCC('D', 'X', 'T', '5'))
+            texture_data->format = SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM;
+        else if (four_cc == SDL_FOURCC('A', 'T', 'I', '2') || four_cc == SDL_FOURCC('B', 'C', '5', 'U'))
+            texture_data->format = SDL_GPU_TEXTUREFORMAT_BC5_RG_UNORM;
+        else if (four_cc == SDL_FOURCC('D', 'X', '1', '0'))
+        {
+            if (file_size < 148)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid DDS DX10 header");
+                return false;
+            }
+            data_offset = 148;
+
+            Uint32 array_size = Texture_Read32(file + 140);
+            if (array_size > 1)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "DDS texture arrays are not supported");
+                return false;
+            }
+
+            switch (Texture_Read32(file + 128)) // DXGI_FORMAT
+            {
+                case 28: texture_data->format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM; break;
+                case 29: texture_data->format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB; break;
+                case 71: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM; break;
+                case 72: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM_SRGB; break;
+                case 77: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM; break;
+                case 78: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM_SRGB; break;
+                case 83: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC5_RG_UNORM; break;
+                case 98: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM; break;
+                case 99: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM_SRGB; break;
+                default: break;
+            }
+        }
+    }
+    else if ((pixel_format_flags & DDPF_RGB) && 
+        Texture_Read32(file + 88) == 32 &&
+        Texture_Read32(file + 92) == 0x000000FF &&
+        Texture_Read32(file + 96) == 0x0000FF00 &&
+        Texture_Read32(file + 100) == 0x00FF0000)
+    {
+        texture_data->format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+    }
+
+    if (texture_data->format == SDL_GPU_TEXTUREFORMAT_INVALID)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unsupported DDS pixel format");
+        return false;
+    }
+
+    texture_data->data = file + data_offset;
+    return Texture_SetPackedLevels(texture_data, mip_count, file_size - data_offset);
+}
+
+static bool Texture_ParseKTX2(const Uint8* file, size_t file_size, Texture_Data* texture_data)
+{
+    static const Uint8 KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    if (file_size < KTX2_LEVEL_INDEX_OFFSET || SDL_memcmp(file, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid KTX2 header");
+        return false;
+    }
+
+    Uint32 vk_format = Texture_Read32(file + 12);
+    texture_data->width = Texture_Read32(file + 20);
+    texture_data->height = Texture_Read32(file + 24);
+    Uint32 pixel_depth = Texture_Read32(file + 28);
+    Uint32 layer_count = Texture_Read32(file + 32);
+    Uint32 face_count = Texture_Read32(file + 36);
+    Uint32 level_count = SDL_max(Texture_Read32(file + 40), 1);
+    Uint32 supercompression_scheme = Texture_Read32(file + 44);
+
+    if (pixel_depth > 1 || layer_count > 1 || face_count != 1)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Only single layer 2D KTX2 textures are supported");
+        return false;
+    }
+    if (supercompression_scheme != 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Supercompressed KTX2 textures are not supported (re-encode without zstd/basis)");
+        return false;
+    }
+
+    switch (vk_format)
+    {
+        case 37:  texture_data->format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM; break;
+        case 43:  texture_data->format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB; break;
+        case 131:
+        case 133: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM; break;
+        case 132:
+        case 134: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM_SRGB; break;
+        case 137: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM; break;
+        case 138: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM_SRGB; break;
+        case 141: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC5_RG_UNORM; break;
+        case 145: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM; break;
+        case 146: texture_data->format = SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM_SRGB; break;
+        default:
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unsupported KTX2 vkFormat %u", vk_format);
+            return false;
+    }
+
+    level_count = SDL_min(level_count, TEXTURE_MAX_LEVELS);
+    if (file_size < KTX2_LEVEL_INDEX_OFFSET + (size_t)level_count * KTX2_LEVEL_INDEX_STRIDE)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "KTX2 level index is truncated");
+        return false;
+    }
+
+    // KTX2 stores the smallest level first in the file, but the level index is largest first
+    // offsets are kept relative to the start of the file
+    texture_data->data = file;
+    texture_data->level_count = level_count;
+    for (Uint32 level = 0; level < level_count; level++)
+    {
+        const Uint8* level_index = file + KTX2_LEVEL_INDEX_OFFSET + level * KTX2_LEVEL_INDEX_STRIDE;
+        Uint64 byte_offset = Texture_Read64(level_index);
+        Uint64 byte_length = Texture_Read64(level_index + 8);
+
+        Uint32 level_width = SDL_max(texture_data->width >> level, 1);
+        Uint32 level_height = SDL_max(texture_data->height >> level, 1);
+        Uint32 level_size = SDL_CalculateGPUTextureFormatSize(texture_data->format, level_width, level_height, 1);
+        if (byte_length < level_size || byte_offset + level_size > file_size)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "KTX2 mip level %u is truncated", level);
+            return false;
+        }
+        texture_data->level_offsets[level] = (Uint32)byte_offset;
+        texture_data->level_sizes[level] = level_size;
+    }
+
+    return true;
+}
+
+// Mip Chain Generation ///////////////////////////////////////////////////////
+
+// Used when an RGBA8 texture arrives without mips (source images, or containers saved without them)
+// so the GPU texture never needs COLOR_TARGET usage for SDL_GenerateMipmapsForGPUTexture
+// 2x2 box filter; linear data is averaged with SIMD, sRGB data is averaged in linear space
+
+#define TEXTURE_LINEAR_TO_SRGB_TABLE_SIZE 4096
+
+static float texture_srgb_to_linear_table[256];
+static Uint8 texture_linear_to_srgb_table[TEXTURE_LINEAR_TO_SRGB_TABLE_SIZE];
+static SDL_InitState texture_srgb_tables_init;
+
+static void Texture_InitSRGBTables(void)
+{
+    if (!SDL_ShouldInit(&texture_srgb_tables_init))
+        return;
+
+    for (int i = 0; i < 256; i++)
+    {
+        float c = (float)i / 255.0f;
+        texture_srgb_to_linear_table[i] = c <= 0.04045f ? c / 12.92f : SDL_powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < TEXTURE_LINEAR_TO_SRGB_TABLE_SIZE; i++)
+    {
+        float c = (float)i / (float)(TEXTURE_LINEAR_TO_SRGB_TABLE_SIZE - 1);
+        float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * SDL_powf(c, 1.0f / 2.4f) - 0.055f;
+        texture_linear_to_srgb_table[i] = (Uint8)(srgb * 255.0f + 0.5f);
+    }
+
+    SDL_SetInitialized(&texture_srgb_tables_init, true);
+}
+
+static void Texture_Downsample_SRGB(const Uint8* src, Uint32 src_width, Uint32 src_height, Uint8* dst, Uint32 dst_width, Uint32 dst_height)
+{
+    for (Uint32 y = 0; y < dst_height; y++)
+    {
+        const Uint8* row0 = src + (size_t)SDL_min(y * 2, src_height - 1) * src_width * 4;
+        const Uint8* row1 = src + (size_t)SDL_min(y * 2 + 1, src_height - 1) * src_width * 4;
+        for (Uint32 x = 0; x < dst_width; x++)
+        {
+            Uint32 x0 = SDL_min(x * 2, src_width - 1) * 4;
+            Uint32 x1 = SDL_min(x * 2 + 1, src_width - 1) * 4;
+            Uint8* out = dst + ((size_t)y * dst_width + x) * 4;
+            for (int c = 0; c < 3; c++)
+            {
+                float sum = 
+                    texture_srgb_to_linear_table[row0[x0 + c]] + texture_srgb_to_linear_table[row0[x1 + c]] +
+                    texture_srgb_to_linear_table[row1[x0 + c]] + texture_srgb_to_linear_table[row1[x1 + c]];
+                out[c] = texture_linear_to_srgb_table[(int)(sum * 0.25f * (TEXTURE_LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+            }
+            out[3] = (Uint8)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) >> 2); // alpha is linear
+        }
+    }
+}
+
+static void Texture_Downsample_Linear(const Uint8* src, Uint32 src_width, Uint32 src_height, Uint8* dst, Uint32 dst_width, Uint32 dst_height)
+{
+    for (Uint32 y = 0; y < dst_height; y++)
+    {
+        const Uint8* row0 = src + (size_t)SDL_min(y * 2, src_height - 1) * src_width * 4;
+        const Uint8* row1 = src + (size_t)SDL_min(y * 2 + 1, src_height - 1) * src_width * 4;
+        Uint8* out = dst + (size_t)y * dst_width * 4;
+        Uint32 x = 0;
+
+        // 4 output pixels per iteration; only when no column needs clamping
+        // rounding averages can bias up by one step, which is fine for mips
+        if (src_width == dst_width * 2)
+        {
+#if defined(__SSE2__)
+            for (; x + 4 <= dst_width; x += 4)
+            {
+                __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row0 + x * 8)));
+                __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16)));
+                __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row1 + x * 8)));
+                __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16)));
+                __m128i even0 = _mm_castps_si128(_mm_shuffle_ps(a0, b0, _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i odd0  = _mm_castps_si128(_mm_shuffle_ps(a0, b0, _MM_SHUFFLE(3, 1, 3, 1)));
+                __m128i even1 = _mm_castps_si128(_mm_shuffle_ps(a1, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i odd1  = _mm_castps_si128(_mm_shuffle_ps(a1, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+                __m128i average = _mm_avg_epu8(_mm_avg_epu8(even0, odd0), _mm_avg_epu8(even1, odd1));
+                _mm_storeu_si128((__m128i*)(out + x * 4), average);
+            }
+#elif defined(__ARM_NEON)
+            for (; x + 4 <= dst_width; x += 4)
+            {
+                uint32x4x2_t pixels0 = vld2q_u32((const uint32_t*)(row0 + x * 8)); // deinterleaves even/odd pixels
+                uint32x4x2_t pixels1 = vld2q_u32((const uint32_t*)(row1 + x * 8));
+                uint8x16_t average0 = vrhaddq_u8(vreinterpretq_u8_u32(pixels0.val[0]), vreinterpretq_u8_u32(pixels0.val[1]));
+                uint8x16_t average1 = vrhaddq_u8(vreinterpretq_u8_u32(pixels1.val[0]), vreinterpretq_u8_u32(pixels1.val[1]));
+                vst1q_u8(out + x * 4, vrhaddq_u8(average0, average1));
+            }
+#endif
+        }
+
+        for (; x < dst_width; x++)
+        {
+            Uint32 x0 = SDL_min(x * 2, src_width - 1) * 4;
+            Uint32 x1 = SDL_min(x * 2 + 1, src_width - 1) * 4;
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (Uint8)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+// Replaces the single RGBA8 level in texture_data with a full chain (up to n_mipmap_levels)
+// pixels are copied, so the caller still owns level0_pixels
+static bool Texture_GenerateMipChain(Texture_Data* texture_data, const Uint8* level0_pixels)
+{
+    bool srgb = texture_data->format == SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB;
+    if (srgb) Texture_InitSRGBTables();
+
+    Uint32 full_chain_length = 1;
+    while ((SDL_max(texture_data->width, texture_data->height) >> full_chain_length) > 0)
+        full_chain_length++;
+    Uint32 level_count = SDL_min(SDL_clamp(n_mipmap_levels, 1, TEXTURE_MAX_LEVELS), full_chain_length);
+
+    Uint32 chain_size = 0;
+    for (Uint32 level = 0; level < level_count; level++)
+    {
+        Uint32 level_width = SDL_max(texture_data->width >> level, 1);
+        Uint32 level_height = SDL_max(texture_data->height >> level, 1);
+        texture_data->level_offsets[level] = chain_size;
+        texture_data->level_sizes[level] = level_width * level_height * 4;
+        chain_size += texture_data->level_sizes[level];
+    }
+
+    Uint8* chain = SDL_malloc(chain_size);
+    if (chain == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate %u bytes for mip chain", chain_size);
+        return false;
+    }
+    SDL_memcpy(chain, level0_pixels, texture_data->level_sizes[0]);
+
+    for (Uint32 level = 1; level < level_count; level++)
+    {
+        Uint32 src_width = SDL_max(texture_data->width >> (level - 1), 1);
+        Uint32 src_height = SDL_max(texture_data->height >> (level - 1), 1);
+        Uint32 dst_width = SDL_max(texture_data->width >> level, 1);
+        Uint32 dst_height = SDL_max(texture_data->height >> level, 1);
+        const Uint8* src = chain + texture_data->level_offsets[level - 1];
+        Uint8* dst = chain + texture_data->level_offsets[level];
+
+        if (srgb)
+            Texture_Downsample_SRGB(src, src_width, src_height, dst, dst_width, dst_height);
+        else
+            Texture_Downsample_Linear(src, src_width, src_height, dst, dst_width, dst_height);
+    }
+
+    texture_data->level_count = level_count;
+    texture_data->data = chain;
+    texture_data->memory = chain;
+    return true;
+}
+
+// Loading ////////////////////////////////////////////////////////////////////
+
+// Loads the pre-compressed version of a texture if one exists and the device can sample it,
+// otherwise falls back to the source image as uncompressed RGBA8
+// RGBA8 textures without stored mips get their chain generated on the CPU
+bool Texture_Load(const char* image_filename, Texture_Usage usage, Texture_Data* texture_data)
+{
+    SDL_zerop(texture_data);
+
+    if (image_filename == NULL)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture_Load called without a filename");
+        return false;
+    }
+
+    const char* extension = SDL_strrchr(image_filename, '.');
+    int stem_length = extension ? (int)(extension - image_filename) : (int)SDL_strlen(image_filename);
+
+    static const char* container_extensions[] = { "ktx2", "dds" };
+    for (size_t i = 0; i < SDL_arraysize(container_extensions); i++)
+    {
+        char path[MAXIMUM_URI_LENGTH];
+        SDL_snprintf(path, sizeof(path), "%stextures/%.*s.%s", base_path, stem_length, image_filename, container_extensions[i]);
+
+        size_t file_size = 0;
+        Uint8* file = SDL_LoadFile(path, &file_size);
+        if (file == NULL)
+            continue;
+
+        bool parsed = i == 0 ? 
+            Texture_ParseKTX2(file, file_size, texture_data) : 
+            Texture_ParseDDS(file, file_size, texture_data);
+        if (parsed)
+        {
+            SDL_GPUTextureFormat format = Texture_FormatForUsage(texture_data->format, usage);
+            if (format == SDL_GPU_TEXTUREFORMAT_INVALID)
+            {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%s: container format is not suitable for this texture usage", path);
+            }
+            else if (!SDL_GPUTextureSupportsFormat(gpu_device, format, SDL_GPU_TEXTURETYPE_2D, SDL_GPU_TEXTUREUSAGE_SAMPLER))
+            {
+                SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "%s: device does not support this texture format, falling back to RGBA8", path);
+            }
+            else if (texture_data->level_count == 1 && 
+                (format == SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM || format == SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB))
+            {
+                texture_data->format = format;
+                bool generated = Texture_GenerateMipChain(texture_data, texture_data->data + texture_data->level_offsets[0]);
+                SDL_free(file);
+                return generated;
+            }
+            else
+            {
+                // block compressed textures only get the mips stored in the file
+                texture_data->format = format;
+                texture_data->memory = file;
+                return true;
+            }
+        }
+        else
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to parse texture container: %s", path);
+        }
+
+        SDL_free(file);
+        SDL_zerop(texture_data);
+    }
+
+    SDL_Surface* surface = LoadImage(image_filename);
+    if (surface == NULL)
+        return false;
+
+    // LoadImage() guarantees the surface is SDL_PIXELFORMAT_RGBA32
+    texture_data->format = usage == TEXTURE_USAGE_ALBEDO ? SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM_SRGB : SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+    texture_data->width = (Uint32)surface->w;
+    texture_data->height = (Uint32)surface->h;
+
+    bool generated = Texture_GenerateMipChain(texture_data, surface->pixels);
+    SDL_DestroySurface(surface);
+    return generated;
+}
+
+#define TEXTURE_MAX_LOAD_THREADS 8
+
+Struct (Texture_LoadJob)
+{
+    const char* image_filename;
+    Texture_Usage usage;
+    Texture_Data* texture_data;
+    bool success;
+};
+
+static int SDLCALL Texture_LoadThread(void* data)
+{
+    Texture_LoadJob* job = data;
+    job->success = Texture_Load(job->image_filename, job->usage, job->texture_data);
+    return 0;
+}
+
+// Decodes and builds mip chains for several textures in parallel, one thread per texture
+// returns false if any of them failed; successfully loaded ones still need Texture_Free
+bool Texture_LoadMultiple(const char** image_filenames, const Texture_Usage* usages, Texture_Data* texture_datas, int count)
+{
+    bool success = true;
+    for (int first = 0; first < count; first += TEXTURE_MAX_LOAD_THREADS)
+    {
+        Texture_LoadJob jobs[TEXTURE_MAX_LOAD_THREADS] = {0};
+        SDL_Thread* threads[TEXTURE_MAX_LOAD_THREADS] = {0};
+        int batch_count = SDL_min(count - first, TEXTURE_MAX_LOAD_THREADS);
+
+        for (int i = 0; i < batch_count; i++)
+        {
+            jobs[i] = (Texture_LoadJob){ image_filenames[first + i], usages[first + i], &texture_datas[first + i], false };
+            threads[i] = SDL_CreateThread(Texture_LoadThread, "Texture_Load", &jobs[i]);
+            if (threads[i] == NULL) // run it here instead
+                Texture_LoadThread(&jobs[i]);
+        }
+        for (int i = 0; i < batch_count; i++)
+        {
+            if (threads[i]) SDL_WaitThread(threads[i], NULL);
+            success = success && jobs[i].success;
+        }
+    }
+    return success;
+}
+
+void Texture_Free(Texture_Data* texture_data)
+{
+    if (texture_data->memory) SDL_free(texture_data->memory);
+    SDL_zerop(texture_data);
+}
+
+// Copies just the levels (packed, without any container header) into a new allocation
+bool Texture_Duplicate(const Texture_Data* texture_data, Texture_Data* copy)
+{
+    *copy = *texture_data;
+    copy->data = NULL;
+    copy->memory = NULL;
+
+    size_t size = 0;
+    for (Uint32 level = 0; level < texture_data->level_count; level++)
+        size += texture_data->level_sizes[level];
+
+    Uint8* memory = SDL_malloc(SDL_max(size, 1));
+    if (memory == NULL)
+    {
+        SDL_zerop(copy);
+        return false;
+    }
+
+    Uint32 offset = 0;
+    for (Uint32 level = 0; level < texture_data->level_count; level++)
+    {
+        SDL_memcpy(memory + offset, texture_data->data + texture_data->level_offsets[level], texture_data->level_sizes[level]);
+        copy->level_offsets[level] = offset;
+        offset += texture_data->level_sizes[level];
+    }
+    copy->data = memory;
+    copy->memory = memory;
+    return true;
+}
+
+static bool Texture_IsBlockCompressed(SDL_GPUTextureFormat format)
+{
+    switch (format)
+    {
+        case SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM_SRGB:
+        case SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM_SRGB:
+        case SDL_GPU_TEXTUREFORMAT_BC5_RG_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM:
+        case SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// first_level, moved to a level that can be the top of a GPU texture
+// block compressed textures need a top level made of whole 4x4 blocks, so this may pick a finer level
+Uint32 Texture_ClampFirstLevel(const Texture_Data* texture_data, Uint32 first_level)
+{
+    if (texture_data->level_count == 0)
+        return 0;
+
+    Uint32 level = SDL_min(first_level, texture_data->level_count - 1);
+    if (Texture_IsBlockCompressed(texture_data->format))
+    {
+        while (level > 0 && (((texture_data->width >> level) & 3) || ((texture_data->height >> level) & 3)))
+            level--;
+    }
+    return level;
+}
+
+// levels that go to the GPU: first_level and coarser, up to n_mipmap_levels
+Uint32 Texture_GetGPULevelCount(const Texture_Data* texture_data)
+{
+    return SDL_clamp(n_mipmap_levels, 1, texture_data->level_count - texture_data->first_level);
+}
+
+SDL_GPUTexture* Texture_CreateGPUTexture(const Texture_Data* texture_data, const char* owner)
+{
+    return GPUMemory_CreateTexture(GPUMEMORY_CATEGORY_TEXTURE, owner, &(SDL_GPUTextureCreateInfo)
+    {
+        .type = SDL_GPU_TEXTURETYPE_2D,
+        .format = texture_data->format,
+        .width = SDL_max(texture_data->width >> texture_data->first_level, 1),
+        .height = SDL_max(texture_data->height >> texture_data->first_level, 1),
+        .layer_count_or_depth = 1,
+        .num_levels = Texture_GetGPULevelCount(texture_data),
+        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER // every level is uploaded, so no COLOR_TARGET for mip generation
+    });
+}
+
+// number of bytes needed in a transfer buffer to upload every GPU level of texture_data (first_level and coarser)
+Uint32 Texture_GetTransferSize(const Texture_Data* texture_data)
+{
+    Uint32 size = 0;
+    Uint32 level_count = Texture_GetGPULevelCount(texture_data);
+    for (Uint32 level = texture_data->first_level; level < texture_data->first_level + level_count; level++)
+        size += texture_data->level_sizes[level];
+    return size;
+}
+
+// levels are packed back to back, largest first
+void Texture_CopyToTransferBuffer(const Texture_Data* texture_data, Uint8* transfer_buffer_mapped)
+{
+    Uint32 level_count = Texture_GetGPULevelCount(texture_data);
+    for (Uint32 level = texture_data->first_level; level < texture_data->first_level + level_count; level++)
+    {
+        SDL_memcpy(transfer_buffer_mapped, texture_data->data + texture_data->level_offsets[level], texture_data->level_sizes[level]);
+        transfer_buffer_mapped += texture_data->level_sizes[level];
+    }
+}
+
+// layer is for array textures (see materialpool.h); 0 otherwise
+void Texture_Upload(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Texture_Data* texture_data, SDL_GPUTexture* texture, Uint32 layer)
+{
+    Uint32 level_count = Texture_GetGPULevelCount(texture_data);
+    for (Uint32 level = texture_data->first_level; level < texture_data->first_level + level_count; level++)
+    {
+        Uint32 level_width = SDL_max(texture_data->width >> level, 1);
+        Uint32 level_height = SDL_max(texture_data->height >> level, 1);
+
+        SDL_UploadToGPUTexture
+        (
+            copy_pass,
+            &(SDL_GPUTextureTransferInfo)
+            {
+                .transfer_buffer = transfer_buffer,
+                .offset = offset,
+                .pixels_per_row = 0, // tightly packed; block formats round up to whole blocks
+                .rows_per_layer = 0
+            },
+            &(SDL_GPUTextureRegion)
+            {
+                .texture = texture,
+                .mip_level = level - texture_data->first_level,
+                .layer = layer,
+                .x = 0, .y = 0, .z = 0,
+                .w = level_width,
+                .h = level_height,
+                .d = 1
+            },
+            false
+        );
+
+        offset += texture_data->level_sizes[level];
+    }
+}
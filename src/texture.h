@@ -4,7 +4,46 @@
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
 
+#include "helper.h"
+
+#define TEXTURE_MAX_LEVELS 16
+
+// Determines which GPU format a texture is created with
+// (sRGB vs linear, and which block-compressed formats are acceptable)
+Enum (Uint8, Texture_Usage)
+{
+    TEXTURE_USAGE_ALBEDO,             // sRGB color; BC7, BC3 or BC1
+    TEXTURE_USAGE_METALLIC_ROUGHNESS, // linear data; BC7, BC3 or BC1
+    TEXTURE_USAGE_NORMAL,             // linear two channel data; BC5 (z is reconstructed in the shader)
+};
+
+// CPU side texture data, ready to be copied into a transfer buffer
+// levels are stored largest first, either from the asset file or generated on the CPU
+Struct (Texture_Data)
+{
+    SDL_GPUTextureFormat format;
+    Uint32 width;
+    Uint32 height;
+    Uint32 level_count;
+    Uint32 first_level; // largest level that goes to the GPU; finer ones stay on the CPU (see streamer.c)
+    Uint32 level_offsets[TEXTURE_MAX_LEVELS]; // relative to data
+    Uint32 level_sizes[TEXTURE_MAX_LEVELS];
+    const Uint8* data;
+    void* memory; // owned; container file contents or generated mip chain
+};
+
 SDL_Surface* LoadImage(const char* imageFilename);
 Uint8 GetTextureIndex(const char* filename);
 
-#endif // TEXTURE_H
\ No newline at end of file
+bool Texture_Load(const char* image_filename, Texture_Usage usage, Texture_Data* texture_data);
+bool Texture_LoadMultiple(const char** image_filenames, const Texture_Usage* usages, Texture_Data* texture_datas, int count);
+void Texture_Free(Texture_Data* texture_data);
+bool Texture_Duplicate(const Texture_Data* texture_data, Texture_Data* copy);
+Uint32 Texture_ClampFirstLevel(const Texture_Data* texture_data, Uint32 first_level);
+Uint32 Texture_GetGPULevelCount(const Texture_Data* texture_data);
+SDL_GPUTexture* Texture_CreateGPUTexture(const Texture_Data* texture_data, const char* owner);
+Uint32 Texture_GetTransferSize(const Texture_Data* texture_data);
+void Texture_CopyToTransferBuffer(const Texture_Data* texture_data, Uint8* transfer_buffer_mapped);
+void Texture_Upload(SDL_GPUCopyPass* copy_pass, SDL_GPUTransferBuffer* transfer_buffer, Uint32 offset, const Texture_Data* texture_data, SDL_GPUTexture* texture, Uint32 layer);
+
+#endif // TEXTURE_H
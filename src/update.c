@@ -2,6 +2,7 @@
 
 #include "update.h"
 #include "globals.h"
+#include "render.h"
 
 bool Update()
 {
@@ -60,6 +61,8 @@ void Update_FrameRate(void)
         average_frame_rate = 1.0 / (total_frame_time / FRAME_TIME_ARRAY_SIZE);
     }
 
+    if (previous_frame_end_ticks) Render_UpdateDynamicResolution(frame_time);
+
     if ((swapchain_present_mode == SDL_GPU_PRESENTMODE_IMMEDIATE) && (frame_time < minimum_frame_time)) 
     {
         SDL_DelayPrecise((minimum_frame_time - frame_time) * 1000000000.0);